@@ -255,6 +255,30 @@ void uds_request_queue_enqueue(struct uds_request_queue *queue, struct uds_reque
 		wake_up_worker(queue);
 }
 
+/*
+ * Enqueue a list of new requests, linked through their next_request fields, with a single
+ * operation on the queue and at most one wakeup of the worker thread.
+ */
+void uds_request_queue_enqueue_list(struct uds_request_queue *queue, struct uds_request *requests)
+{
+	struct uds_request *request;
+	bool unbatched = false;
+
+	for (request = requests; ; request = request->next_request) {
+		unbatched |= request->unbatched;
+		if (request->next_request == NULL)
+			break;
+
+		request->queue_link.next = &request->next_request->queue_link;
+	}
+
+	funnel_queue_put_chain(queue->main_queue, &requests->queue_link, &request->queue_link);
+
+	/* As in uds_request_queue_enqueue(), the queue operation acts as a read fence. */
+	if (atomic_read(&queue->dormant) || unbatched)
+		wake_up_worker(queue);
+}
+
 void uds_request_queue_finish(struct uds_request_queue *queue)
 {
 	int result;
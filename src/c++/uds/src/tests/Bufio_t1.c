@@ -119,11 +119,56 @@ static void doubleTest(void)
   put_uds_io_factory(factory);
 }
 
+/**********************************************************************/
+static void prefetchTest(void)
+{
+  struct io_factory *factory;
+  UDS_ASSERT_SUCCESS(make_uds_io_factory(getTestIndexName(), &factory));
+  writePage(factory, 1, SHAKESPEARE_SONNET_2, sizeof(SHAKESPEARE_SONNET_2));
+  writePage(factory, 2, SHAKESPEARE_SONNET_3, sizeof(SHAKESPEARE_SONNET_3));
+
+  struct dm_bufio_client *client = NULL;
+  UDS_ASSERT_SUCCESS(make_uds_bufio(factory, 0, UDS_BLOCK_SIZE, 1, &client));
+  dm_bufio_prefetch(client, 0, 4);
+
+  // Read the prefetched blocks out of order.
+  struct dm_buffer *buffer = NULL;
+  void *data = dm_bufio_read(client, 2, &buffer);
+  UDS_ASSERT_KERNEL_SUCCESS(data);
+  UDS_ASSERT_EQUAL_BYTES(data, SHAKESPEARE_SONNET_3,
+                         sizeof(SHAKESPEARE_SONNET_3));
+  dm_bufio_release(buffer);
+  data = dm_bufio_read(client, 1, &buffer);
+  UDS_ASSERT_KERNEL_SUCCESS(data);
+  UDS_ASSERT_EQUAL_BYTES(data, SHAKESPEARE_SONNET_2,
+                         sizeof(SHAKESPEARE_SONNET_2));
+  dm_bufio_release(buffer);
+
+  // Rewriting a prefetched block must discard the prefetched copy.
+  data = dm_bufio_new(client, 2, &buffer);
+  UDS_ASSERT_KERNEL_SUCCESS(data);
+  dm_bufio_prefetch(client, 2, 1);
+  memset(data, 0, UDS_BLOCK_SIZE);
+  memcpy(data, SHAKESPEARE_SONNET_2, sizeof(SHAKESPEARE_SONNET_2));
+  dm_bufio_mark_buffer_dirty(buffer);
+  dm_bufio_release(buffer);
+  data = dm_bufio_read(client, 2, &buffer);
+  UDS_ASSERT_KERNEL_SUCCESS(data);
+  UDS_ASSERT_EQUAL_BYTES(data, SHAKESPEARE_SONNET_2,
+                         sizeof(SHAKESPEARE_SONNET_2));
+  dm_bufio_release(buffer);
+
+  // Blocks 0 and 3 are still prefetched when the client is destroyed.
+  dm_bufio_client_destroy(client);
+  put_uds_io_factory(factory);
+}
+
 /**********************************************************************/
 static const CU_TestInfo tests[] = {
-  { "noio",   noioTest },
-  { "single", singleTest },
-  { "double", doubleTest },
+  { "noio",     noioTest },
+  { "single",   singleTest },
+  { "double",   doubleTest },
+  { "prefetch", prefetchTest },
   CU_TEST_INFO_NULL,
 };
 
@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright Red Hat
+ */
+
+/**
+ * DeltaIndex_p1 measures the lookup rate of each zone of a multi-zone
+ * delta index, comparing get_delta_index_entry() with a search which
+ * decodes one entry at a time using next_delta_index_entry().
+ **/
+
+#include "albtest.h"
+#include "assertions.h"
+#include "delta-index.h"
+#include "memory-alloc.h"
+#include "random.h"
+#include "testPrototypes.h"
+#include "time-utils.h"
+
+enum {
+  ZONE_COUNT       = 4,
+  LISTS_PER_ZONE   = 1024,
+  LIST_COUNT       = ZONE_COUNT * LISTS_PER_ZONE,
+  ENTRIES_PER_LIST = 256,
+  MEAN_DELTA       = 4096,
+  PAYLOAD_BITS     = 8,
+  LOOKUP_COUNT     = 1 << 20,
+};
+
+static struct delta_index deltaIndex;
+static unsigned int *keys;
+
+/**
+ * Search a delta list one entry at a time, the way get_delta_index_entry()
+ * did before it decoded several entries per load.
+ **/
+static int searchOneAtATime(unsigned int listNumber, unsigned int key,
+                            struct delta_index_entry *entry)
+{
+  int result = start_delta_index_search(&deltaIndex, listNumber, key, entry);
+  if (result != UDS_SUCCESS) {
+    return result;
+  }
+
+  do {
+    result = next_delta_index_entry(entry);
+    if (result != UDS_SUCCESS) {
+      return result;
+    }
+  } while (!entry->at_end && (key > entry->key));
+
+  return remember_delta_index_offset(entry);
+}
+
+/**
+ * Fill every delta list with keys spaced about the mean delta apart.
+ **/
+static void fillDeltaIndex(void)
+{
+  UDS_ASSERT_SUCCESS(UDS_ALLOCATE(LIST_COUNT * ENTRIES_PER_LIST, unsigned int,
+                                  __func__, &keys));
+  struct uds_record_name name;
+  memset(&name, 0, sizeof(name));
+  for (unsigned int list = 0; list < LIST_COUNT; list++) {
+    unsigned int key = 0;
+    for (unsigned int i = 0; i < ENTRIES_PER_LIST; i++) {
+      key += 1 + random() % (2 * MEAN_DELTA - 1);
+      keys[list * ENTRIES_PER_LIST + i] = key;
+
+      struct delta_index_entry entry;
+      UDS_ASSERT_SUCCESS(get_delta_index_entry(&deltaIndex, list, key,
+                                               name.name, &entry));
+      CU_ASSERT_TRUE(entry.at_end);
+      UDS_ASSERT_SUCCESS(put_delta_index_entry(&entry, key,
+                                               i % (1 << PAYLOAD_BITS),
+                                               NULL));
+    }
+  }
+}
+
+/**
+ * Time random lookups of present keys in the lists of one zone.
+ *
+ * @param zone         The zone to search
+ * @param oneAtATime   Whether to decode only one entry per call
+ *
+ * @return the elapsed time
+ **/
+static ktime_t timeLookups(unsigned int zone, bool oneAtATime)
+{
+  struct uds_record_name name;
+  memset(&name, 0, sizeof(name));
+  ktime_t start = current_time_ns(CLOCK_MONOTONIC);
+  for (unsigned int i = 0; i < LOOKUP_COUNT; i++) {
+    unsigned int list = zone * LISTS_PER_ZONE + random() % LISTS_PER_ZONE;
+    unsigned int index = random() % ENTRIES_PER_LIST;
+    unsigned int key = keys[list * ENTRIES_PER_LIST + index];
+    struct delta_index_entry entry;
+    if (oneAtATime) {
+      UDS_ASSERT_SUCCESS(searchOneAtATime(list, key, &entry));
+    } else {
+      UDS_ASSERT_SUCCESS(get_delta_index_entry(&deltaIndex, list, key,
+                                               name.name, &entry));
+    }
+    CU_ASSERT_EQUAL(key, entry.key);
+    CU_ASSERT_EQUAL(index % (1 << PAYLOAD_BITS),
+                    get_delta_entry_value(&entry));
+  }
+  return current_time_ns(CLOCK_MONOTONIC) - start;
+}
+
+/**********************************************************************/
+static void reportLookups(const char *title, unsigned int zone,
+                          ktime_t elapsed)
+{
+  char *perLookup;
+  UDS_ASSERT_SUCCESS(rel_time_to_string(&perLookup, elapsed / LOOKUP_COUNT));
+  albPrint("zone %u %s: %lu lookups/second, average = %s/lookup",
+           zone, title,
+           (unsigned long) (LOOKUP_COUNT * 1000000000ULL
+                            / (elapsed > 0 ? elapsed : 1)),
+           perLookup);
+  UDS_FREE(perLookup);
+}
+
+/**********************************************************************/
+static void lookupTest(void)
+{
+  UDS_ASSERT_SUCCESS(initialize_delta_index(&deltaIndex, ZONE_COUNT,
+                                            LIST_COUNT, MEAN_DELTA,
+                                            PAYLOAD_BITS, 32 * MEGABYTE,
+                                            false, 'm'));
+  fillDeltaIndex();
+  for (unsigned int zone = 0; zone < ZONE_COUNT; zone++) {
+    reportLookups("one entry per step", zone, timeLookups(zone, true));
+    reportLookups("several entries per load", zone, timeLookups(zone, false));
+  }
+
+  uninitialize_delta_index(&deltaIndex);
+  UDS_FREE(keys);
+}
+
+/**********************************************************************/
+static const CU_TestInfo tests[] = {
+  { "delta index lookup performance", lookupTest },
+  CU_TEST_INFO_NULL,
+};
+
+static const CU_SuiteInfo suite = {
+  .name  = "DeltaIndex_p1",
+  .tests = tests
+};
+
+/**********************************************************************/
+const CU_SuiteInfo *initializeModule(void)
+{
+  return &suite;
+}
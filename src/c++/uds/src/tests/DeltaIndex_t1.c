@@ -11,6 +11,7 @@
 #include "numeric.h"
 #include "random.h"
 #include "testPrototypes.h"
+#include "uds-threads.h"
 
 enum { ONE_ZONE = 1 };  // We generally test with one zone
 
@@ -106,7 +107,8 @@ static void initializationTest(void)
   size_t memSize = 16 * MEGABYTE;
 
   UDS_ASSERT_SUCCESS(initialize_delta_index(&di, ONE_ZONE, numLists, meanDelta,
-                                            numPayloadBits, memSize, 'm'));
+                                            numPayloadBits, memSize,
+                                            false, 'm'));
   uninitialize_delta_index(&di);
   uninitialize_delta_index(&di);
 }
@@ -119,7 +121,7 @@ static void basicTest(void)
   struct delta_index di;
   struct delta_index_entry entry;
   enum { NUM_LISTS = 1 };
-  UDS_ASSERT_SUCCESS(initialize_delta_index(&di, ONE_ZONE, NUM_LISTS, 256, 8, 2 * MEGABYTE, 'm'));
+  UDS_ASSERT_SUCCESS(initialize_delta_index(&di, ONE_ZONE, NUM_LISTS, 256, 8, 2 * MEGABYTE, false, 'm'));
 
   // Should not find a record with key 0 in an empty list
   struct uds_record_name name0;
@@ -223,7 +225,8 @@ static void recordSizeTest(void)
   struct delta_index di;
   enum { NUM_LISTS = 1, PAYLOAD_BITS = 4 };
   UDS_ASSERT_SUCCESS(initialize_delta_index(&di, ONE_ZONE, NUM_LISTS, 1024,
-                                            PAYLOAD_BITS, 2 * MEGABYTE, 'm'));
+                                            PAYLOAD_BITS, 2 * MEGABYTE,
+                                            false, 'm'));
 
   unsigned int filler, i;
   for (filler = 0; filler < 2; filler++) {
@@ -297,7 +300,8 @@ static void testAddRemove(const unsigned int *keys, unsigned int numKeys,
   struct delta_index_stats stats;
   enum { NUM_LISTS = 1, PAYLOAD_BITS = 4 };
   UDS_ASSERT_SUCCESS(initialize_delta_index(&di, ONE_ZONE, NUM_LISTS, 1024,
-                                            PAYLOAD_BITS, 2 * MEGABYTE, 'm'));
+                                            PAYLOAD_BITS, 2 * MEGABYTE,
+                                            false, 'm'));
   CU_ASSERT_EQUAL(di.list_count, NUM_LISTS);
   get_delta_index_stats(&di, &stats);
   CU_ASSERT_EQUAL(stats.record_count, 0);
@@ -442,7 +446,8 @@ static void overflowTest(void)
   enum { PAYLOAD_BITS = 8 };
   enum { PAYLOAD_MASK = (1 << PAYLOAD_BITS) - 1 };
   UDS_ASSERT_SUCCESS(initialize_delta_index(&di, ONE_ZONE, NUM_LISTS, 256,
-                                            PAYLOAD_BITS, 2 * MEGABYTE, 'm'));
+                                            PAYLOAD_BITS, 2 * MEGABYTE,
+                                            false, 'm'));
   get_delta_index_stats(&di, &stats);
   CU_ASSERT_EQUAL(stats.record_count, 0);
   CU_ASSERT_EQUAL(stats.overflow_count, 0);
@@ -536,7 +541,8 @@ static void lookupTest(void)
 
   // Create index with 1 delta list.  Ensure that the saved offset is valid.
   UDS_ASSERT_SUCCESS(initialize_delta_index(&di, ONE_ZONE, 1, 256,
-                                            PAYLOAD_BITS, 2 * MEGABYTE, 'm'));
+                                            PAYLOAD_BITS, 2 * MEGABYTE,
+                                            false, 'm'));
   assertSavedValid(&di);
 
   // Make names for keys 1 to 7.  Insert all but keys 4 and 5 into the index.
@@ -702,6 +708,8 @@ static void restoreIndex(struct delta_index *di,
 {
   UDS_ASSERT_SUCCESS(start_restoring_delta_index(di, &bufferedReader, 1));
   UDS_ASSERT_SUCCESS(finish_restoring_delta_index(di, &bufferedReader, 1));
+  // The guard list holds the checksum of the saved stream
+  UDS_ASSERT_SUCCESS(check_guard_delta_lists(&bufferedReader, 1));
 }
 
 /**
@@ -730,7 +738,7 @@ static void saveRestoreTest(void)
   unsigned int meanDelta = (NUM_LISTS * MAX_KEY) / NUM_KEYS;
   enum { MEMORY_SIZE = 2 * MEGABYTE };
   UDS_ASSERT_SUCCESS(initialize_delta_index(&di, ONE_ZONE, NUM_LISTS, meanDelta,
-                                            4, MEMORY_SIZE, 'm'));
+                                            4, MEMORY_SIZE, false, 'm'));
 
   // Compute the size needed for saving the delta index
   size_t saveSize = compute_delta_index_save_bytes(NUM_LISTS, MEMORY_SIZE);
@@ -784,6 +792,264 @@ static void saveRestoreTest(void)
   UDS_FREE(names);
 }
 
+/**
+ * Fill a delta index for the zone restore tests, making sure that list 0 is
+ * not empty.
+ **/
+static void fillIndex(struct delta_index *di, unsigned int numLists,
+                      unsigned int maxKey, unsigned int numKeys,
+                      unsigned int *keys, unsigned int *lists,
+                      struct uds_record_name *names)
+{
+  struct delta_index_entry entry;
+  unsigned int i;
+  for (i = 0; i < numKeys; i++) {
+    keys[i] = random() % maxKey;
+    lists[i] = (i == 0) ? 0 : random() % numLists;
+    createBlockName(&names[i]);
+    UDS_ASSERT_SUCCESS(get_delta_index_entry(di, lists[i], keys[i], names[i].name, &entry));
+    bool isFound = !entry.at_end && entry.key == keys[i];
+    UDS_ASSERT_SUCCESS(put_delta_index_entry(&entry, keys[i], 0,
+                                             isFound ? names[i].name : NULL));
+  }
+}
+
+/**
+ * Save each zone of a delta index to its own region of the test storage.
+ **/
+static void saveZones(struct delta_index *di, struct io_factory *factory,
+                      size_t saveSize)
+{
+  unsigned int z;
+  for (z = 0; z < di->zone_count; z++) {
+    struct buffered_writer *writer;
+    UDS_ASSERT_SUCCESS(make_buffered_writer(factory, z * saveSize * UDS_BLOCK_SIZE,
+                                            saveSize, &writer));
+    UDS_ASSERT_SUCCESS(start_saving_delta_index(di, z, writer));
+    UDS_ASSERT_SUCCESS(finish_saving_delta_index(di, z));
+    UDS_ASSERT_SUCCESS(write_guard_delta_list(writer));
+    UDS_ASSERT_SUCCESS(flush_buffered_writer(writer));
+    free_buffered_writer(writer);
+  }
+}
+
+/**
+ * Open a reader on the saved region of each zone.
+ **/
+static void openZoneReaders(struct io_factory *factory, size_t saveSize,
+                            unsigned int zoneCount,
+                            struct buffered_reader **readers)
+{
+  unsigned int z;
+  for (z = 0; z < zoneCount; z++) {
+    UDS_ASSERT_SUCCESS(make_buffered_reader(factory, z * saveSize * UDS_BLOCK_SIZE,
+                                            saveSize, &readers[z]));
+  }
+}
+
+/**
+ * Assert that two delta indexes hold the same entries in every list.
+ **/
+static void assertSameEntries(const struct delta_index *expected,
+                              const struct delta_index *actual,
+                              unsigned int numLists)
+{
+  unsigned int list;
+  for (list = 0; list < numLists; list++) {
+    struct delta_index_entry expectedEntry, actualEntry;
+    UDS_ASSERT_SUCCESS(start_delta_index_search(expected, list, 0, &expectedEntry));
+    UDS_ASSERT_SUCCESS(start_delta_index_search(actual, list, 0, &actualEntry));
+    for (;;) {
+      UDS_ASSERT_SUCCESS(next_delta_index_entry(&expectedEntry));
+      UDS_ASSERT_SUCCESS(next_delta_index_entry(&actualEntry));
+      CU_ASSERT_EQUAL(expectedEntry.at_end, actualEntry.at_end);
+      if (expectedEntry.at_end || actualEntry.at_end) {
+        break;
+      }
+      CU_ASSERT_EQUAL(expectedEntry.key, actualEntry.key);
+      CU_ASSERT_EQUAL(expectedEntry.is_collision, actualEntry.is_collision);
+      CU_ASSERT_EQUAL(get_delta_entry_value(&expectedEntry),
+                      get_delta_entry_value(&actualEntry));
+    }
+  }
+
+  struct delta_index_stats expectedStats, actualStats;
+  get_delta_index_stats(expected, &expectedStats);
+  get_delta_index_stats(actual, &actualStats);
+  CU_ASSERT_EQUAL(expectedStats.record_count, actualStats.record_count);
+  CU_ASSERT_EQUAL(expectedStats.collision_count, actualStats.collision_count);
+}
+
+typedef struct {
+  struct delta_index     *di;
+  struct buffered_reader *reader;
+  unsigned int            zone;
+  int                     result;
+} ZoneRestore;
+
+/**********************************************************************/
+static void restoreZone(void *arg)
+{
+  ZoneRestore *restore = arg;
+  restore->result = finish_restoring_delta_index_zone(restore->di, restore->reader,
+                                                      restore->zone);
+  if (restore->result == UDS_SUCCESS) {
+    restore->result = check_guard_delta_lists(&restore->reader, 1);
+  }
+}
+
+/**
+ * Test that restoring the zones of a delta index concurrently, each from its
+ * own stream, produces the same index as restoring them serially.
+ **/
+static void parallelRestoreTest(void)
+{
+  enum { NUM_ZONES = 4 };
+  enum { NUM_LISTS = 64 };
+  enum { MAX_KEY = 1024 };
+  enum { NUM_KEYS = 1000 };
+  enum { MEMORY_SIZE = 2 * MEGABYTE };
+  unsigned int meanDelta = (NUM_LISTS * MAX_KEY) / NUM_KEYS;
+  struct delta_index di, serial, parallel;
+  UDS_ASSERT_SUCCESS(initialize_delta_index(&di, NUM_ZONES, NUM_LISTS, meanDelta,
+                                            4, MEMORY_SIZE, false, 'm'));
+  UDS_ASSERT_SUCCESS(initialize_delta_index(&serial, NUM_ZONES, NUM_LISTS, meanDelta,
+                                            4, MEMORY_SIZE, false, 'm'));
+  UDS_ASSERT_SUCCESS(initialize_delta_index(&parallel, NUM_ZONES, NUM_LISTS,
+                                            meanDelta, 4, MEMORY_SIZE, false, 'm'));
+
+  size_t saveSize = compute_delta_index_save_bytes(NUM_LISTS, MEMORY_SIZE);
+  saveSize += sizeof(struct delta_list_save_info);
+  saveSize = DIV_ROUND_UP(saveSize, UDS_BLOCK_SIZE);
+
+  unsigned int *keys, *lists;
+  struct uds_record_name *names;
+  UDS_ASSERT_SUCCESS(UDS_ALLOCATE(NUM_KEYS, unsigned int, __func__, &keys));
+  UDS_ASSERT_SUCCESS(UDS_ALLOCATE(NUM_KEYS, unsigned int, __func__, &lists));
+  UDS_ASSERT_SUCCESS(UDS_ALLOCATE(NUM_KEYS, struct uds_record_name, __func__, &names));
+  fillIndex(&di, NUM_LISTS, MAX_KEY, NUM_KEYS, keys, lists, names);
+
+  struct io_factory *factory;
+  UDS_ASSERT_SUCCESS(make_uds_io_factory(getTestIndexName(), &factory));
+  saveZones(&di, factory, saveSize);
+
+  // Restore all the zones serially from one thread
+  struct buffered_reader *readers[NUM_ZONES];
+  unsigned int z;
+  openZoneReaders(factory, saveSize, NUM_ZONES, readers);
+  UDS_ASSERT_SUCCESS(start_restoring_delta_index(&serial, readers, NUM_ZONES));
+  UDS_ASSERT_SUCCESS(finish_restoring_delta_index(&serial, readers, NUM_ZONES));
+  UDS_ASSERT_SUCCESS(check_guard_delta_lists(readers, NUM_ZONES));
+  for (z = 0; z < NUM_ZONES; z++) {
+    free_buffered_reader(readers[z]);
+  }
+
+  // Restore each zone on its own thread
+  ZoneRestore restores[NUM_ZONES];
+  struct thread *threads[NUM_ZONES];
+  openZoneReaders(factory, saveSize, NUM_ZONES, readers);
+  UDS_ASSERT_SUCCESS(start_restoring_delta_index(&parallel, readers, NUM_ZONES));
+  for (z = 0; z < NUM_ZONES; z++) {
+    restores[z] = (ZoneRestore) {
+      .di     = &parallel,
+      .reader = readers[z],
+      .zone   = z,
+      .result = UDS_SUCCESS,
+    };
+    UDS_ASSERT_SUCCESS(uds_create_thread(restoreZone, &restores[z], "restore",
+                                         &threads[z]));
+  }
+  for (z = 0; z < NUM_ZONES; z++) {
+    uds_join_threads(threads[z]);
+    UDS_ASSERT_SUCCESS(restores[z].result);
+    free_buffered_reader(readers[z]);
+  }
+
+  verifyAllKeys(&parallel, NUM_KEYS, keys, lists, names);
+  assertSameEntries(&di, &serial, NUM_LISTS);
+  assertSameEntries(&serial, &parallel, NUM_LISTS);
+  validateDeltaIndex(&parallel);
+
+  put_uds_io_factory(factory);
+  uninitialize_delta_index(&di);
+  uninitialize_delta_index(&serial);
+  uninitialize_delta_index(&parallel);
+  UDS_FREE(keys);
+  UDS_FREE(lists);
+  UDS_FREE(names);
+}
+
+/**
+ * Test that a change to the list data of a saved stream is caught by the
+ * checksum in the guard list.
+ **/
+static void corruptStreamTest(void)
+{
+  enum { NUM_LISTS = 32 };
+  enum { MAX_KEY = 1024 };
+  enum { NUM_KEYS = 100 };
+  enum { MEMORY_SIZE = 2 * MEGABYTE };
+  // The saved header is an 8 byte magic number, four u32 fields, and two u64
+  // fields, followed by a u16 size for each list.
+  enum { HEADER_BYTES = 8 + (4 * sizeof(u32)) + (2 * sizeof(u64)) };
+  unsigned int meanDelta = (NUM_LISTS * MAX_KEY) / NUM_KEYS;
+  struct delta_index di;
+  UDS_ASSERT_SUCCESS(initialize_delta_index(&di, ONE_ZONE, NUM_LISTS, meanDelta,
+                                            4, MEMORY_SIZE, false, 'm'));
+
+  size_t saveSize = compute_delta_index_save_bytes(NUM_LISTS, MEMORY_SIZE);
+  saveSize += sizeof(struct delta_list_save_info);
+  saveSize = DIV_ROUND_UP(saveSize, UDS_BLOCK_SIZE);
+
+  unsigned int *keys, *lists;
+  struct uds_record_name *names;
+  UDS_ASSERT_SUCCESS(UDS_ALLOCATE(NUM_KEYS, unsigned int, __func__, &keys));
+  UDS_ASSERT_SUCCESS(UDS_ALLOCATE(NUM_KEYS, unsigned int, __func__, &lists));
+  UDS_ASSERT_SUCCESS(UDS_ALLOCATE(NUM_KEYS, struct uds_record_name, __func__, &names));
+  fillIndex(&di, NUM_LISTS, MAX_KEY, NUM_KEYS, keys, lists, names);
+
+  struct io_factory *factory;
+  UDS_ASSERT_SUCCESS(make_uds_io_factory(getTestIndexName(), &factory));
+  saveZones(&di, factory, saveSize);
+
+  // Read back the raw stream and flip a byte of the data of list 0, which is
+  // the first list saved.
+  size_t streamBytes = saveSize * UDS_BLOCK_SIZE;
+  u8 *stream;
+  UDS_ASSERT_SUCCESS(UDS_ALLOCATE(streamBytes, u8, __func__, &stream));
+  struct buffered_reader *reader;
+  UDS_ASSERT_SUCCESS(make_buffered_reader(factory, 0, saveSize, &reader));
+  UDS_ASSERT_SUCCESS(read_from_buffered_reader(reader, stream, streamBytes));
+  free_buffered_reader(reader);
+
+  u8 *saveInfo = &stream[HEADER_BYTES + (NUM_LISTS * sizeof(u16))];
+  CU_ASSERT_EQUAL('m', saveInfo[0]);
+  CU_ASSERT_EQUAL(0, get_unaligned_le32(&saveInfo[4]));
+  u16 byteCount = get_unaligned_le16(&saveInfo[2]);
+  CU_ASSERT(byteCount > 0);
+  saveInfo[sizeof(struct delta_list_save_info) + byteCount - 1] ^= 0xFF;
+
+  struct buffered_writer *writer;
+  UDS_ASSERT_SUCCESS(make_buffered_writer(factory, 0, saveSize, &writer));
+  UDS_ASSERT_SUCCESS(write_to_buffered_writer(writer, stream, streamBytes));
+  UDS_ASSERT_SUCCESS(flush_buffered_writer(writer));
+  free_buffered_writer(writer);
+
+  // The lists restore, but the checksum no longer matches.
+  UDS_ASSERT_SUCCESS(make_buffered_reader(factory, 0, saveSize, &reader));
+  UDS_ASSERT_SUCCESS(start_restoring_delta_index(&di, &reader, 1));
+  UDS_ASSERT_SUCCESS(finish_restoring_delta_index_zone(&di, reader, 0));
+  UDS_ASSERT_ERROR(UDS_CORRUPT_DATA, check_guard_delta_lists(&reader, 1));
+  free_buffered_reader(reader);
+
+  put_uds_io_factory(factory);
+  uninitialize_delta_index(&di);
+  UDS_FREE(stream);
+  UDS_FREE(keys);
+  UDS_FREE(lists);
+  UDS_FREE(names);
+}
+
 /**********************************************************************/
 
 static const CU_TestInfo tests[] = {
@@ -797,6 +1063,8 @@ static const CU_TestInfo tests[] = {
   {"Overflow",               overflowTest },
   {"Lookup",                 lookupTest },
   {"Save and Restore",       saveRestoreTest },
+  {"Parallel Zone Restore",  parallelRestoreTest },
+  {"Corrupt Stream",         corruptStreamTest },
   CU_TEST_INFO_NULL,
 };
 
@@ -145,7 +145,8 @@ static void testExtend(struct delta_list *pdl, int numLists, int initialValue)
   // Get the delta memory corresponding to the delta lists
   UDS_ASSERT_SUCCESS(UDS_ALLOCATE(1, struct delta_index, __func__, &delta_index));
   UDS_ASSERT_SUCCESS(initialize_delta_index(delta_index, 1, numLists, MEAN_DELTA,
-                                            NUM_PAYLOAD_BITS, initSize, 'm'));
+                                            NUM_PAYLOAD_BITS, initSize,
+                                            false, 'm'));
   struct delta_zone *dm = &delta_index->delta_zones[0];
   memset(dm->memory, initialValue, dm->size);
   memcpy(dm->delta_lists, pdl, pdlSize);
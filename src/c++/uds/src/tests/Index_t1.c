@@ -7,6 +7,8 @@
 #include "assertions.h"
 #include "config.h"
 #include "index.h"
+#include "index-page-map.h"
+#include "volume.h"
 #include "volume-index.h"
 #include "string-utils.h"
 #include "testPrototypes.h"
@@ -299,6 +301,150 @@ static void saveLoadTest(void)
   free_index(theIndex);
 }
 
+/**********************************************************************/
+static void closeTimesTest(void)
+{
+  enum { CHAPTERS = 3 };
+  createIndex(false, config);
+  indexAdd(1, 1);
+  unsigned int i;
+  for (i = 0; i < CHAPTERS; i++) {
+    fillChapterRandomly(theIndex);
+  }
+
+  // Every chapter written appears in the histogram of close times.
+  struct uds_index_stats stats;
+  memset(&stats, 0, sizeof(stats));
+  get_index_stats(theIndex, &stats);
+  uint64_t closes = 0;
+  for (i = 0; i < UDS_CHAPTER_CLOSE_BUCKETS; i++) {
+    closes += stats.chapter_close_times[i];
+  }
+  CU_ASSERT_EQUAL(CHAPTERS, closes);
+  CU_ASSERT_EQUAL(CHAPTERS, theIndex->newest_virtual_chapter);
+  indexLookup(1, true, 1);
+  free_index(theIndex);
+}
+
+/**********************************************************************/
+static void indexLookupNoUpdate(unsigned int hashIndex,
+                                unsigned int expectedMetaIndex)
+{
+  struct uds_request request = {
+    .record_name = hashes[hashIndex],
+    .type        = UDS_QUERY_NO_UPDATE,
+  };
+  verify_test_request(theIndex, &request, true, &metas[expectedMetaIndex]);
+}
+
+/**
+ * Count the cached pages of a physical chapter.
+ *
+ * @param chapter        The physical chapter
+ * @param protectedPtr   A pointer to hold the number of those pages which are
+ *                       protected
+ *
+ * @return The number of pages of the chapter in the cache
+ **/
+static unsigned int countCachedPages(unsigned int  chapter,
+                                     unsigned int *protectedPtr)
+{
+  struct volume *volume = theIndex->volume;
+  unsigned int cached = 0;
+  unsigned int protected = 0;
+  unsigned int page;
+  uds_lock_mutex(&volume->read_threads_mutex);
+  for (page = 0; page < volume->geometry->pages_per_chapter; page++) {
+    struct cached_page *cachedPage;
+    get_page_from_cache(volume->page_cache,
+                        map_to_physical_page(volume->geometry, chapter, page),
+                        &cachedPage);
+    if (cachedPage != NULL) {
+      cached++;
+      if (cachedPage->cp_protected) {
+        protected++;
+      }
+    }
+  }
+  uds_unlock_mutex(&volume->read_threads_mutex);
+  *protectedPtr = protected;
+  return cached;
+}
+
+/**********************************************************************/
+static void assertPageLookups(const struct uds_index_stats *before,
+                              uint64_t                      indexHits,
+                              uint64_t                      indexMisses,
+                              uint64_t                      recordHits,
+                              uint64_t                      recordMisses)
+{
+  struct uds_index_stats after;
+  get_index_stats(theIndex, &after);
+  CU_ASSERT_EQUAL(before->index_page_hits + indexHits, after.index_page_hits);
+  CU_ASSERT_EQUAL(before->index_page_misses + indexMisses,
+                  after.index_page_misses);
+  CU_ASSERT_EQUAL(before->record_page_hits + recordHits,
+                  after.record_page_hits);
+  CU_ASSERT_EQUAL(before->record_page_misses + recordMisses,
+                  after.record_page_misses);
+}
+
+/**
+ * Test that pages read for queued requests are not protected or counted as
+ * hits until they are used again.
+ **/
+static void pageCacheTest(void)
+{
+  createIndex(false, smallConfig);
+  indexAdd(1, 1);
+  // Move the record out of the open chapter and the chapter being written.
+  fillChapterRandomly(theIndex);
+  fillChapterRandomly(theIndex);
+
+  // Drop the pages of the chapter so that a lookup has to read them.
+  struct volume *volume = theIndex->volume;
+  unsigned int chapter = map_to_physical_chapter(volume->geometry, 0);
+  uds_lock_mutex(&volume->read_threads_mutex);
+  invalidate_page_cache_for_chapter(volume->page_cache, chapter,
+                                    volume->geometry->pages_per_chapter);
+  uds_unlock_mutex(&volume->read_threads_mutex);
+  unsigned int protected;
+  CU_ASSERT_EQUAL(0, countCachedPages(chapter, &protected));
+
+  // The lookup queues a read of the index page and then of the record page.
+  struct uds_index_stats before;
+  get_index_stats(theIndex, &before);
+  indexLookupNoUpdate(1, 1);
+  assertPageLookups(&before, 0, 1, 0, 1);
+  CU_ASSERT_EQUAL(2, countCachedPages(chapter, &protected));
+  CU_ASSERT_EQUAL(0, protected);
+
+  // A requeued request which repeats its lookup does not use the page again.
+  unsigned int indexPage = find_index_page_number(volume->index_page_map,
+                                                  &hashes[1], chapter);
+  unsigned int physicalPage = map_to_physical_page(volume->geometry, chapter,
+                                                   indexPage);
+  struct uds_request retry = {
+    .record_name = hashes[1],
+    .requeued    = true,
+  };
+  struct cached_page *page;
+  begin_pending_search(volume->page_cache, physicalPage, 0);
+  UDS_ASSERT_SUCCESS(get_volume_page_protected(volume, &retry, physicalPage,
+                                               &page));
+  end_pending_search(volume->page_cache, 0);
+  CU_ASSERT_FALSE(page->cp_protected);
+  assertPageLookups(&before, 0, 1, 0, 1);
+
+  // Using the pages again hits them and protects them.
+  get_index_stats(theIndex, &before);
+  indexLookupNoUpdate(1, 1);
+  assertPageLookups(&before, 1, 0, 1, 0);
+  CU_ASSERT_EQUAL(2, countCachedPages(chapter, &protected));
+  CU_ASSERT_EQUAL(2, protected);
+  free_index(theIndex);
+}
+
 /**********************************************************************/
 static const CU_TestInfo indexTests[] = {
   {"Add",           addTest },
@@ -311,6 +457,8 @@ static const CU_TestInfo indexTests[] = {
   {"LRU Update2",   lruUpdate2Test },
   {"LRU Lookup",    lruLookupTest },
   {"Save Load",     saveLoadTest },
+  {"Close Times",   closeTimesTest },
+  {"Page Cache",    pageCacheTest },
   CU_TEST_INFO_NULL,
 };
 
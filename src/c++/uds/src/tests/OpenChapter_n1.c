@@ -13,6 +13,11 @@
 enum { CHAPTER_COUNT = 32 };
 enum { NAMES_PER_CHAPTER = 256 * 1024 };
 
+// The percentages of a chapter zone's capacity at which to time operations
+static const unsigned int FILL_LEVELS[] = { 25, 50, 75, 90, 100 };
+// A prime used to visit the records in a scattered order
+enum { SCATTER = 1000003 };
+
 static ktime_t  totalOpenTime    = 0;
 static ktime_t  totalCloseTime   = 0;
 static ktime_t  totalPutTime     = 0;
@@ -163,9 +168,96 @@ static void testFilling(void)
   free_uds_index_layout(layout);
 }
 
+/**********************************************************************/
+static void reportFillLevelTimes(unsigned int level, uint64_t puts,
+                                 ktime_t putTime, uint64_t lookups,
+                                 ktime_t hitTime, ktime_t missTime)
+{
+  char *putString, *hitString, *missString;
+  UDS_ASSERT_SUCCESS(rel_time_to_string(&putString, putTime / puts));
+  UDS_ASSERT_SUCCESS(rel_time_to_string(&hitString, hitTime / lookups));
+  UDS_ASSERT_SUCCESS(rel_time_to_string(&missString, missTime / lookups));
+  albPrint("%3u%% full: put %s, hit %s, miss %s per record",
+           level, putString, hitString, missString);
+  UDS_FREE(putString);
+  UDS_FREE(hitString);
+  UDS_FREE(missString);
+}
+
+/**********************************************************************/
+static void testFillLevels(void)
+{
+  struct uds_parameters params = {
+    .memory_size = 1,
+  };
+  struct configuration *config;
+  UDS_ASSERT_SUCCESS(make_configuration(&params, &config));
+  struct open_chapter_zone *openChapter;
+  UDS_ASSERT_SUCCESS(make_open_chapter(config->geometry, 1, &openChapter));
+
+  // The second half of the names are never added, so searches for them miss.
+  unsigned int capacity = openChapter->capacity;
+  struct uds_record_name *names;
+  UDS_ASSERT_SUCCESS(UDS_ALLOCATE(2 * capacity, struct uds_record_name,
+                                  "record names for chapter test", &names));
+  unsigned int i;
+  for (i = 0; i < 2 * capacity; i++) {
+    createRandomBlockName(&names[i]);
+  }
+
+  reset_open_chapter(openChapter);
+  unsigned int size = 0;
+  unsigned int level;
+  for (level = 0; level < ARRAY_SIZE(FILL_LEVELS); level++) {
+    unsigned int target = (uint64_t) capacity * FILL_LEVELS[level] / 100;
+    struct uds_record_data metadata;
+    memset(&metadata, 0, sizeof(metadata));
+
+    unsigned int remaining = capacity - size;
+    ktime_t start = current_time_ns(CLOCK_MONOTONIC);
+    for (i = size; i < target; i++) {
+      remaining = put_open_chapter(openChapter, &names[i], &metadata);
+    }
+    ktime_t putTime = ktime_sub(current_time_ns(CLOCK_MONOTONIC), start);
+    uint64_t puts = target - size;
+    size = target;
+    CU_ASSERT_EQUAL(size, openChapter->size);
+    CU_ASSERT_EQUAL(capacity - size, remaining);
+
+    // Search for the names in a scattered order, as deduplication would.
+    bool found;
+    unsigned int hits = 0;
+    start = current_time_ns(CLOCK_MONOTONIC);
+    for (i = 0; i < size; i++) {
+      search_open_chapter(openChapter, &names[((uint64_t) i * SCATTER) % size],
+                          &metadata, &found);
+      hits += found;
+    }
+    ktime_t hitTime = ktime_sub(current_time_ns(CLOCK_MONOTONIC), start);
+    CU_ASSERT_EQUAL(size, hits);
+
+    start = current_time_ns(CLOCK_MONOTONIC);
+    for (i = 0; i < size; i++) {
+      search_open_chapter(openChapter, &names[capacity + i], &metadata,
+                          &found);
+      hits += found;
+    }
+    ktime_t missTime = ktime_sub(current_time_ns(CLOCK_MONOTONIC), start);
+    CU_ASSERT_EQUAL(size, hits);
+
+    reportFillLevelTimes(FILL_LEVELS[level], puts, putTime, size, hitTime,
+                         missTime);
+  }
+
+  UDS_FREE(names);
+  free_open_chapter(openChapter);
+  free_configuration(config);
+}
+
 /**********************************************************************/
 static const CU_TestInfo openChapterPerformanceTests[] = {
-  {"Open Chapter Put performance", testFilling },
+  {"Open Chapter Put performance",       testFilling    },
+  {"Open Chapter fill level performance", testFillLevels },
   CU_TEST_INFO_NULL,
 };
 
@@ -190,12 +190,55 @@ static void testQuadraticProbing(void)
   free_open_chapter(theChapter);
 }
 
+/**********************************************************************/
+static void testGroupOverflow(void)
+{
+  /*
+   * Test that names which all hash into the first group of slots spill into
+   * other groups, and that each of them can still be found. The chapter has
+   * room for all the names in its other groups.
+   */
+  enum { NAME_COUNT = 40 };
+  struct open_chapter_zone *theChapter;
+  geometry->records_per_chapter = 64;
+  UDS_ASSERT_SUCCESS(make_open_chapter(geometry, 1, &theChapter));
+  CU_ASSERT(NAME_COUNT <= theChapter->capacity);
+
+  struct uds_record_name names[NAME_COUNT];
+  struct uds_record_data data;
+  unsigned int i;
+  for (i = 0; i < NAME_COUNT; ++i) {
+    do {
+      createRandomBlockName(&names[i]);
+    } while (name_to_hash_slot(&names[i], theChapter->slot_count) >= 16);
+    memcpy(&data.data, &names[i].name, UDS_RECORD_NAME_SIZE);
+    CU_ASSERT_EQUAL(theChapter->capacity - i - 1,
+                    put_open_chapter(theChapter, &names[i], &data));
+  }
+
+  for (i = 0; i < NAME_COUNT; ++i) {
+    bool found;
+    search_open_chapter(theChapter, &names[i], &data, &found);
+    CU_ASSERT_TRUE(found);
+    UDS_ASSERT_EQUAL_BYTES(&data.data, &names[i].name, UDS_RECORD_NAME_SIZE);
+  }
+
+  // A name which differs from one in the chapter only in its tag is missing.
+  struct uds_record_name missing = names[NAME_COUNT - 1];
+  missing.name[CHAPTER_INDEX_BYTES_OFFSET] ^= 0x01;
+  bool found;
+  search_open_chapter(theChapter, &missing, &data, &found);
+  CU_ASSERT_FALSE(found);
+  free_open_chapter(theChapter);
+}
+
 /**********************************************************************/
 static const CU_TestInfo openChapterTests[] = {
   {"Empty",                         testEmpty               },
   {"Singleton",                     testSingleton           },
   {"Filling",                       testFilling             },
   {"Quadratic Probing",             testQuadraticProbing    },
+  {"Group Overflow",                testGroupOverflow       },
   CU_TEST_INFO_NULL,
 };
 
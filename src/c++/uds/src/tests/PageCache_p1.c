@@ -283,6 +283,111 @@ static void testMixedMT(unsigned int numThreads, int percentageHits)
   deinit();
 }
 
+/**********************************************************************/
+static unsigned int pickNumber(unsigned long *counter, unsigned int range)
+{
+  union {
+    unsigned char hash[ 128 / 8 ];
+    unsigned int val;
+  } rand;
+
+  murmurhash3_128(counter, sizeof(*counter), 0, &rand.hash);
+  *counter += 1;
+  return rand.val % range;
+}
+
+/**********************************************************************/
+static void usePage(unsigned int physicalPage, unsigned long *hits)
+{
+  struct cached_page *page = NULL;
+  get_page_from_cache(cache, physicalPage, &page);
+  if (page != NULL) {
+    make_page_most_recent(cache, page);
+    *hits += 1;
+    return;
+  }
+
+  UDS_ASSERT_SUCCESS(select_victim_in_cache(cache, &page));
+  UDS_ASSERT_SUCCESS(put_page_in_cache(cache, physicalPage, page));
+}
+
+enum {
+  HOT_CHAPTERS     = 96,
+  HOT_RECORD_PAGES = 2,
+  ROUNDS           = 64,
+  STEADY_LOOKUPS   = 4096,
+  BURST_PAGES      = 512,
+};
+
+/**********************************************************************/
+static void runPolicy(const char *policy, bool protect)
+{
+  struct uds_parameters params = {
+    .memory_size = 1,
+  };
+  UDS_ASSERT_SUCCESS(make_configuration(&params, &config));
+  resizeDenseConfiguration(config, 4 * BYTES_PER_RECORD, 64, 1024);
+  UDS_ASSERT_SUCCESS(make_page_cache(config->geometry, config->cache_chapters,
+                                     config->zone_count, &cache));
+  if (!protect) {
+    cache->protected_limit = 0;
+  }
+
+  const struct geometry *geometry = config->geometry;
+  unsigned long counter = 0;
+  unsigned long indexHits = 0;
+  unsigned long recordHits = 0;
+  unsigned long burstHits = 0;
+  unsigned int burstChapter = HOT_CHAPTERS;
+  unsigned int burstPage = 0;
+  ktime_t loopStart = current_time_ns(CLOCK_MONOTONIC);
+  unsigned int round;
+  for (round = 0; round < ROUNDS; round++) {
+    // Dense lookups concentrated on a set of hot chapters, each of which
+    // reads an index page and then a record page.
+    unsigned int i;
+    for (i = 0; i < STEADY_LOOKUPS; i++) {
+      unsigned int chapter = pickNumber(&counter, HOT_CHAPTERS);
+      unsigned int indexPage
+        = pickNumber(&counter, geometry->index_pages_per_chapter);
+      unsigned int recordPage = (geometry->index_pages_per_chapter
+                                 + pickNumber(&counter, HOT_RECORD_PAGES));
+      usePage(map_to_physical_page(geometry, chapter, indexPage), &indexHits);
+      usePage(map_to_physical_page(geometry, chapter, recordPage),
+              &recordHits);
+    }
+
+    // A burst of lookups which each read a record page only once.
+    for (i = 0; i < BURST_PAGES; i++) {
+      unsigned int recordPage = geometry->index_pages_per_chapter + burstPage;
+      usePage(map_to_physical_page(geometry, burstChapter, recordPage),
+              &burstHits);
+      if (++burstPage == geometry->record_pages_per_chapter) {
+        burstPage = 0;
+        if (++burstChapter == geometry->chapters_per_volume) {
+          burstChapter = HOT_CHAPTERS;
+        }
+      }
+    }
+  }
+  ktime_t loopElapsed = ktime_sub(current_time_ns(CLOCK_MONOTONIC), loopStart);
+
+  unsigned long lookups = ROUNDS * STEADY_LOOKUPS;
+  albPrint("%s: index page hits %lu%%, record page hits %lu%%, burst page hits %lu%%",
+           policy, (100 * indexHits) / lookups, (100 * recordHits) / lookups,
+           (100 * burstHits) / (ROUNDS * BURST_PAGES));
+  report(loopElapsed, ROUNDS * ((2 * STEADY_LOOKUPS) + BURST_PAGES));
+
+  deinit();
+}
+
+/**********************************************************************/
+static void policyTest(void)
+{
+  runPolicy("LRU", false);
+  runPolicy("Segmented LRU", true);
+}
+
 /**********************************************************************/
 static void singleThreadTest(void)
 {
@@ -310,6 +415,7 @@ static void multipleThreadTest(void)
 static const CU_TestInfo tests[] = {
   { "single thread",   singleThreadTest },
   { "multiple thread", multipleThreadTest },
+  { "policy",          policyTest },
   CU_TEST_INFO_NULL,
 };
 
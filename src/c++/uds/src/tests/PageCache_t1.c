@@ -242,12 +242,115 @@ static void testInvalidateAll(void)
   }
 }
 
+/**********************************************************************/
+static bool isPageCached(unsigned int physicalPage)
+{
+  struct cached_page *page = NULL;
+  get_page_from_cache(cache, physicalPage, &page);
+  return ((page != NULL) && (page->cp_physical_page == physicalPage));
+}
+
+/**********************************************************************/
+static void usePage(unsigned int physicalPage)
+{
+  struct cached_page *page = NULL;
+  get_page_from_cache(cache, physicalPage, &page);
+  if (page == NULL) {
+    UDS_ASSERT_SUCCESS(addPageToCache(cache, physicalPage, &page));
+  } else {
+    make_page_most_recent(cache, page);
+  }
+}
+
+/**********************************************************************/
+static bool isIndexPage(unsigned int physicalPage)
+{
+  const struct geometry *geometry = config->geometry;
+  return (((physicalPage - 1) % geometry->pages_per_chapter)
+          < geometry->index_pages_per_chapter);
+}
+
+/**********************************************************************/
+static void scanCache(unsigned int firstPage)
+{
+  // Use every page from firstPage on exactly once.
+  unsigned int physicalPage;
+  for (physicalPage = firstPage; physicalPage < cache->num_index_entries;
+       physicalPage++) {
+    usePage(physicalPage);
+  }
+}
+
+/**********************************************************************/
+static void testScanResistance(void)
+{
+  // Enough pages are left over to replace the whole cache.
+  CU_ASSERT_TRUE(cache->num_index_entries - 2 > cache->num_cache_entries);
+
+  // A page used twice survives a scan of pages used only once.
+  usePage(1);
+  usePage(1);
+  scanCache(2);
+  CU_ASSERT_TRUE(isPageCached(1));
+
+  // Without a protected segment, the cache is a plain LRU.
+  invalidate_page_cache(cache);
+  cache->protected_limit = 0;
+  usePage(1);
+  usePage(1);
+  scanCache(2);
+  CU_ASSERT_FALSE(isPageCached(1));
+}
+
+/**********************************************************************/
+static void testProtectedBalance(void)
+{
+  // Protect every index page first, so they are the least recently used.
+  unsigned int indexPages = 0;
+  unsigned int physicalPage;
+  for (physicalPage = 1; physicalPage < cache->num_index_entries;
+       physicalPage++) {
+    if (isIndexPage(physicalPage)) {
+      usePage(physicalPage);
+      usePage(physicalPage);
+      indexPages++;
+    }
+  }
+  CU_ASSERT_TRUE(2 * indexPages < cache->protected_limit);
+
+  // Then protect record pages until the cache is full.
+  unsigned int cached = indexPages;
+  for (physicalPage = 1; cached < cache->num_cache_entries; physicalPage++) {
+    if (!isIndexPage(physicalPage)) {
+      usePage(physicalPage);
+      usePage(physicalPage);
+      cached++;
+    }
+  }
+
+  // Record pages are demoted to make room, leaving the index pages.
+  for (; physicalPage < cache->num_index_entries; physicalPage++) {
+    if (!isIndexPage(physicalPage)) {
+      usePage(physicalPage);
+    }
+  }
+
+  for (physicalPage = 1; physicalPage < cache->num_index_entries;
+       physicalPage++) {
+    if (isIndexPage(physicalPage)) {
+      CU_ASSERT_TRUE(isPageCached(physicalPage));
+    }
+  }
+}
+
 /**********************************************************************/
 static const CU_TestInfo tests[] = {
-  {"AddPages",        testAddPages},
-  {"UpdatePages",     testUpdatePages},
-  {"InvalidatePages", testInvalidatePages},
-  {"InvalidateAll",   testInvalidateAll},
+  {"AddPages",         testAddPages},
+  {"UpdatePages",      testUpdatePages},
+  {"InvalidatePages",  testInvalidatePages},
+  {"InvalidateAll",    testInvalidateAll},
+  {"ScanResistance",   testScanResistance},
+  {"ProtectedBalance", testProtectedBalance},
   CU_TEST_INFO_NULL,
 };
 
@@ -5,6 +5,8 @@
  * Rebuild_p1 measures the rebuild performance of a UDS index.
  */
 
+#include <linux/atomic.h>
+
 #include "albtest.h"
 #include "assertions.h"
 #include "blockTestUtils.h"
@@ -13,37 +15,19 @@
 #include "oldInterfaces.h"
 #include "resourceUsage.h"
 #include "testPrototypes.h"
+#include "uds-threads.h"
 
 static const char *indexName;
 
 /**********************************************************************/
-static void runTest(bool sparse)
+static void rebuildIndex(struct uds_parameters *params,
+                         struct uds_index_session *indexSession,
+                         unsigned int zoneCount)
 {
-  struct uds_parameters params = {
-    .memory_size = UDS_MEMORY_CONFIG_256MB,
-    .name = indexName,
-    .sparse = true,
-  };
-
-  // Create and fill the index (using UDS interfaces).
-  initializeOldInterfaces(1000);
-  struct uds_index_session *indexSession;
-  UDS_ASSERT_SUCCESS(uds_create_index_session(&indexSession));
-  UDS_ASSERT_SUCCESS(uds_open_index(UDS_CREATE, &params, indexSession));
-  unsigned long numRecords = getBlocksPerIndex(indexSession);
-  unsigned long i;
-  for (i = 0; i < numRecords; i++) {
-    struct uds_record_name chunkName = hash_record_name(&i, sizeof(i));
-    oldPostBlockName(indexSession, NULL, (struct uds_record_data *) &chunkName,
-                     &chunkName, cbStatus);
-  }
-  UDS_ASSERT_SUCCESS(uds_close_index(indexSession));
-  uninitializeOldInterfaces();
-
   // Discard the index state so that we need to do a full rebuild (using index
   // interfaces).
   struct configuration *config;
-  UDS_ASSERT_SUCCESS(make_configuration(&params, &config));
+  UDS_ASSERT_SUCCESS(make_configuration(params, &config));
   config->zone_count = 1;
   struct uds_index *index;
   UDS_ASSERT_SUCCESS(make_index(config, UDS_NO_REBUILD, NULL, NULL, &index));
@@ -52,23 +36,63 @@ static void runTest(bool sparse)
   free_configuration(config);
 
   // Rebuild the volume index.  This is where we do the performance timing.
+  params->zone_count = zoneCount;
+  int startChapters = atomic_read_acquire(&chapters_replayed);
   ThreadStatistics *preThreadStats = getThreadStatistics();
   ktime_t startTime = current_time_ns(CLOCK_MONOTONIC);
-  UDS_ASSERT_SUCCESS(uds_open_index(UDS_LOAD, &params, indexSession));
+  UDS_ASSERT_SUCCESS(uds_open_index(UDS_LOAD, params, indexSession));
   ktime_t loadElapsed = ktime_sub(current_time_ns(CLOCK_MONOTONIC), startTime);
   ThreadStatistics *postThreadStats = getThreadStatistics();
+  int chapters = atomic_read_acquire(&chapters_replayed) - startChapters;
   char *elapsed;
   UDS_ASSERT_SUCCESS(rel_time_to_string(&elapsed, loadElapsed));
-  albPrint("Rebuild %s index in %s", sparse ? "sparse" : "dense", elapsed);
+  albPrint("Rebuild %s index with %u zone%s in %s (%llu chapters/sec)",
+           params->sparse ? "sparse" : "dense", zoneCount,
+           (zoneCount == 1) ? "" : "s", elapsed,
+           (unsigned long long) (chapters * NSEC_PER_SEC
+                                 / max(loadElapsed, (ktime_t) 1)));
   UDS_FREE(elapsed);
   printThreadStatistics(preThreadStats, postThreadStats);
   UDS_ASSERT_SUCCESS(uds_close_index(indexSession));
-  UDS_ASSERT_SUCCESS(uds_destroy_index_session(indexSession));
 
   freeThreadStatistics(postThreadStats);
   freeThreadStatistics(preThreadStats);
 }
 
+/**********************************************************************/
+static void runTest(bool sparse)
+{
+  struct uds_parameters params = {
+    .memory_size = UDS_MEMORY_CONFIG_256MB,
+    .name = indexName,
+    .sparse = sparse,
+  };
+
+  // Create and fill the index (using UDS interfaces).
+  initializeOldInterfaces(1000);
+  struct uds_index_session *indexSession;
+  UDS_ASSERT_SUCCESS(uds_create_index_session(&indexSession));
+  UDS_ASSERT_SUCCESS(uds_open_index(UDS_CREATE, &params, indexSession));
+  unsigned long numRecords = getBlocksPerIndex(indexSession);
+  unsigned long i;
+  for (i = 0; i < numRecords; i++) {
+    struct uds_record_name chunkName = hash_record_name(&i, sizeof(i));
+    oldPostBlockName(indexSession, NULL, (struct uds_record_data *) &chunkName,
+                     &chunkName, cbStatus);
+  }
+  UDS_ASSERT_SUCCESS(uds_close_index(indexSession));
+  uninitializeOldInterfaces();
+
+  // Rebuild with more replay threads each time, up to one per core.
+  unsigned int maxZones = min(uds_get_num_cores(), (unsigned int) MAX_ZONES);
+  unsigned int zoneCount;
+  for (zoneCount = 1; zoneCount <= maxZones; zoneCount *= 2) {
+    rebuildIndex(&params, indexSession, zoneCount);
+  }
+
+  UDS_ASSERT_SUCCESS(uds_destroy_index_session(indexSession));
+}
+
 /**********************************************************************/
 static void testDense(void)
 {
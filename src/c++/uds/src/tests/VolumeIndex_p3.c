@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright Red Hat
+ */
+
+/**
+ * VolumeIndex_p3 compares the single zone lookup latency of the volume
+ * index when its delta memory is backed by ordinary 4K pages and when it is
+ * backed by 2M huge pages.  The index is filled with a fixed sequence of
+ * record names and then probed with randomly chosen names from that
+ * sequence, so the accesses are spread across all of the delta memory.
+ **/
+
+#include "albtest.h"
+#include "assertions.h"
+#include "hash-utils.h"
+#include "memory-alloc.h"
+#include "random.h"
+#include "testPrototypes.h"
+
+enum {
+  FILL_CHAPTERS = 64,
+  LOOKUP_COUNT  = 4 * 1000 * 1000,
+};
+
+static struct configuration *config;
+
+/**********************************************************************/
+static void reportTimes(const char *title, bool hugePages,
+                        unsigned long numBlocks, ktime_t elapsed)
+{
+  char *total, *perRecord;
+  UDS_ASSERT_SUCCESS(rel_time_to_string(&total, elapsed));
+  UDS_ASSERT_SUCCESS(rel_time_to_string(&perRecord, elapsed / numBlocks));
+  albPrint("%s pages: %s %lu blocks took %s, average = %s/record",
+           (hugePages ? "2M" : "4K"), title, numBlocks, total, perRecord);
+  UDS_FREE(total);
+  UDS_FREE(perRecord);
+}
+
+/**
+ * Fill the volume index with the first records from the fixed sequence of
+ * names.
+ *
+ * @return the number of records added
+ **/
+static uint64_t fillVolumeIndex(struct volume_index *volumeIndex)
+{
+  uint64_t blocksPerChapter = config->geometry->records_per_chapter;
+  uint64_t counter = 0;
+  for (uint64_t chapter = 0; chapter < FILL_CHAPTERS; chapter++) {
+    set_volume_index_open_chapter(volumeIndex, chapter);
+    for (uint64_t i = 0; i < blocksPerChapter; i++) {
+      struct uds_record_name name
+        = hash_record_name(&counter, sizeof(counter));
+      counter++;
+      struct volume_index_record record;
+      UDS_ASSERT_SUCCESS(get_volume_index_record(volumeIndex, &name,
+                                                 &record));
+      UDS_ASSERT_SUCCESS(put_volume_index_record(&record, chapter));
+    }
+  }
+  return counter;
+}
+
+/**********************************************************************/
+static void lookupTest(bool hugePages)
+{
+  config->huge_pages = hugePages;
+  struct volume_index *volumeIndex;
+  UDS_ASSERT_SUCCESS(make_volume_index(config, 0, &volumeIndex));
+
+  ktime_t start = current_time_ns(CLOCK_MONOTONIC);
+  uint64_t recordCount = fillVolumeIndex(volumeIndex);
+  reportTimes("fill", hugePages, recordCount,
+              ktime_sub(current_time_ns(CLOCK_MONOTONIC), start));
+
+  // Pick the names before starting the clock so only lookups are timed.
+  struct uds_record_name *names;
+  UDS_ASSERT_SUCCESS(UDS_ALLOCATE(LOOKUP_COUNT, struct uds_record_name,
+                                  __func__, &names));
+  for (unsigned int i = 0; i < LOOKUP_COUNT; i++) {
+    uint64_t counter = random() % recordCount;
+    names[i] = hash_record_name(&counter, sizeof(counter));
+  }
+
+  unsigned long found = 0;
+  start = current_time_ns(CLOCK_MONOTONIC);
+  for (unsigned int i = 0; i < LOOKUP_COUNT; i++) {
+    struct volume_index_record record;
+    UDS_ASSERT_SUCCESS(get_volume_index_record(volumeIndex, &names[i],
+                                               &record));
+    if (record.is_found) {
+      found++;
+    }
+  }
+  reportTimes("lookup", hugePages, LOOKUP_COUNT,
+              ktime_sub(current_time_ns(CLOCK_MONOTONIC), start));
+
+  // Every name was added, so only an overflowed delta list can lose one.
+  CU_ASSERT(found >= LOOKUP_COUNT * 99UL / 100);
+  UDS_FREE(names);
+  free_volume_index(volumeIndex);
+}
+
+/**********************************************************************/
+static void smallPagesTest(void)
+{
+  lookupTest(false);
+}
+
+/**********************************************************************/
+static void hugePagesTest(void)
+{
+  lookupTest(true);
+}
+
+/**********************************************************************/
+static void initSuite(int argc, const char **argv)
+{
+  config = createConfigForAlbtest(argc, argv);
+  config->zone_count = 1;
+}
+
+/**********************************************************************/
+static void cleanSuite(void)
+{
+  free_configuration(config);
+}
+
+/**********************************************************************/
+static const CU_TestInfo tests[] = {
+  { "4K page lookups", smallPagesTest },
+  { "2M page lookups", hugePagesTest  },
+  CU_TEST_INFO_NULL,
+};
+
+static const CU_SuiteInfo suite = {
+  .name                     = "VolumeIndex_p3",
+  .initializerWithArguments = initSuite,
+  .cleaner                  = cleanSuite,
+  .tests                    = tests
+};
+
+/**********************************************************************/
+const CU_SuiteInfo *initializeModule(void)
+{
+  return &suite;
+}
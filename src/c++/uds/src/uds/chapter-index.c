@@ -50,6 +50,7 @@ int make_open_chapter_index(struct open_chapter_index **chapter_index,
 					geometry->chapter_mean_delta,
 					geometry->chapter_payload_bits,
 					memory_size,
+					false,
 					'm');
 	if (result != UDS_SUCCESS) {
 		UDS_FREE(index);
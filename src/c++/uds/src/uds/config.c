@@ -578,6 +578,7 @@ int make_configuration(const struct uds_parameters *params, struct configuration
 
 	config->cache_chapters = DEFAULT_CACHE_CHAPTERS;
 	config->volume_index_mean_delta = DEFAULT_VOLUME_INDEX_MEAN_DELTA;
+	config->huge_pages = params->huge_pages;
 	config->sparse_sample_rate = (params->sparse ? DEFAULT_SPARSE_SAMPLE_RATE : 0);
 	config->nonce = params->nonce;
 	config->name = params->name;
@@ -606,6 +607,7 @@ void log_uds_configuration(struct configuration *config)
 	uds_log_debug("  Sparse chapters per volume: %10u", geometry->sparse_chapters_per_volume);
 	uds_log_debug("  Cache size (chapters):      %10u", config->cache_chapters);
 	uds_log_debug("  Volume index mean delta:    %10u", config->volume_index_mean_delta);
+	uds_log_debug("  Volume index huge pages:    %10s", config->huge_pages ? "yes" : "no");
 	uds_log_debug("  Bytes per page:             %10zu", geometry->bytes_per_page);
 	uds_log_debug("  Sparse sample rate:         %10u", config->sparse_sample_rate);
 	uds_log_debug("  Nonce:                      %llu", (unsigned long long) config->nonce);
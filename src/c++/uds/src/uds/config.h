@@ -56,6 +56,9 @@ struct configuration {
 	/* The mean delta for the volume index */
 	unsigned int volume_index_mean_delta;
 
+	/* Whether to back the volume index with huge pages */
+	bool huge_pages;
+
 	/* Sampling rate for sparse indexing */
 	unsigned int sparse_sample_rate;
 };
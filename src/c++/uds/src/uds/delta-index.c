@@ -374,11 +374,15 @@ static int initialize_delta_zone(struct delta_zone *delta_zone,
 				 unsigned int list_count,
 				 unsigned int mean_delta,
 				 unsigned int payload_bits,
+				 bool huge_pages,
 				 u8 tag)
 {
 	int result;
 
-	result = UDS_ALLOCATE(size, u8, "delta list", &delta_zone->memory);
+	if (huge_pages)
+		result = uds_allocate_huge_memory(size, "delta list", &delta_zone->memory);
+	else
+		result = UDS_ALLOCATE(size, u8, "delta list", &delta_zone->memory);
 	if (result != UDS_SUCCESS)
 		return result;
 
@@ -420,6 +424,7 @@ int initialize_delta_index(struct delta_index *delta_index,
 			   unsigned int mean_delta,
 			   unsigned int payload_bits,
 			   size_t memory_size,
+			   bool huge_pages,
 			   u8 tag)
 {
 	int result;
@@ -465,6 +470,7 @@ int initialize_delta_index(struct delta_index *delta_index,
 					       lists_in_zone,
 					       mean_delta,
 					       payload_bits,
+					       huge_pages,
 					       tag);
 		if (result != UDS_SUCCESS) {
 			uninitialize_delta_index(delta_index);
@@ -1153,6 +1159,7 @@ static int restore_delta_list_to_zone(struct delta_zone *delta_zone,
 static int restore_delta_list_data(struct delta_index *delta_index,
 				   unsigned int load_zone,
 				   struct buffered_reader *buffered_reader,
+				   bool same_zone,
 				   u8 *data)
 {
 	int result;
@@ -1192,9 +1199,46 @@ static int restore_delta_list_data(struct delta_index *delta_index,
 
 	delta_index->load_lists[load_zone] -= 1;
 	new_zone = save_info.index / delta_index->lists_per_zone;
+	if (same_zone && (new_zone != load_zone))
+		return uds_log_warning_strerror(UDS_CORRUPT_DATA,
+						"delta list %u from zone %u belongs to zone %u",
+						save_info.index,
+						load_zone,
+						new_zone);
+
 	return restore_delta_list_to_zone(&delta_index->delta_zones[new_zone], &save_info, data);
 }
 
+/*
+ * Restore the delta lists from one saved zone, when the index is being restored with the same
+ * number of zones it was saved with. Since every list in the stream then belongs to the zone being
+ * restored, the zones can be restored concurrently, each from its own stream.
+ */
+int finish_restoring_delta_index_zone(struct delta_index *delta_index,
+				      struct buffered_reader *buffered_reader,
+				      unsigned int zone_number)
+{
+	int result;
+	u8 *data;
+
+	result = UDS_ALLOCATE(DELTA_LIST_MAX_BYTE_COUNT, u8, __func__, &data);
+	if (result != UDS_SUCCESS)
+		return result;
+
+	while (delta_index->load_lists[zone_number] > 0) {
+		result = restore_delta_list_data(delta_index,
+						 zone_number,
+						 buffered_reader,
+						 true,
+						 data);
+		if (result != UDS_SUCCESS)
+			break;
+	}
+
+	UDS_FREE(data);
+	return result;
+}
+
 /* Restore delta lists from saved data. */
 int finish_restoring_delta_index(struct delta_index *delta_index,
 				 struct buffered_reader **buffered_readers,
@@ -1214,6 +1258,7 @@ int finish_restoring_delta_index(struct delta_index *delta_index,
 			result = restore_delta_list_data(delta_index,
 							 z,
 							 buffered_readers[z],
+							 false,
 							 data);
 			if (result != UDS_SUCCESS) {
 				saved_result = result;
@@ -1233,12 +1278,23 @@ int check_guard_delta_lists(struct buffered_reader **buffered_readers, unsigned
 	u8 buffer[sizeof(struct delta_list_save_info)];
 
 	for (z = 0; z < reader_count; z++) {
+		u32 checksum = get_buffered_reader_checksum(buffered_readers[z]);
+		u32 saved_checksum;
+
 		result = read_from_buffered_reader(buffered_readers[z], buffer, sizeof(buffer));
 		if (result != UDS_SUCCESS)
 			return result;
 
 		if (buffer[0] != 'z')
 			return UDS_CORRUPT_DATA;
+
+		/* Saves made before checksums were recorded have zeros here. */
+		saved_checksum = get_unaligned_le32(&buffer[4]);
+		if ((saved_checksum != 0) && (saved_checksum != checksum))
+			return uds_log_warning_strerror(UDS_CORRUPT_DATA,
+							"delta index stream checksum %08x does not match saved checksum %08x",
+							checksum,
+							saved_checksum);
 	}
 
 	return UDS_SUCCESS;
@@ -1392,6 +1448,8 @@ int write_guard_delta_list(struct buffered_writer *buffered_writer)
 
 	memset(buffer, 0, sizeof(struct delta_list_save_info));
 	buffer[0] = 'z';
+	/* The guard carries the checksum of everything written to the stream before it. */
+	put_unaligned_le32(get_buffered_writer_checksum(buffered_writer), &buffer[4]);
 
 	result = write_to_buffered_writer(buffered_writer, buffer, sizeof(buffer));
 	if (result != UDS_SUCCESS)
@@ -1588,6 +1646,117 @@ noinline int next_delta_index_entry(struct delta_index_entry *delta_entry)
 	return UDS_SUCCESS;
 }
 
+/*
+ * Advance a search to the first entry whose key is not less than the given key, exactly as
+ * repeated calls to next_delta_index_entry() would. Rather than decoding one entry per call, this
+ * keeps the zone's coding constants and the search state in registers and decodes consecutive
+ * entries straight out of a single 64-bit load of the list memory, so a search through short
+ * entries usually decodes two or three deltas per memory access. An entry which cannot be decoded
+ * from a fresh load, as well as the end of the list and any corruption, is handed to
+ * next_delta_index_entry() so that the results and errors are identical to the entry-at-a-time
+ * path.
+ */
+static int search_delta_list(struct delta_index_entry *delta_entry, unsigned int key)
+{
+	int result;
+	const struct delta_zone *delta_zone = delta_entry->delta_zone;
+	const u8 *memory = delta_zone->memory;
+	unsigned int value_bits = delta_entry->value_bits;
+	unsigned int min_bits = delta_zone->min_bits;
+	unsigned int min_keys = delta_zone->min_keys;
+	unsigned int incr_keys = delta_zone->incr_keys;
+	unsigned int min_mask = (1 << min_bits) - 1;
+	u64 list_start = delta_entry->delta_list->start;
+	u32 size = delta_entry->delta_list->size;
+	unsigned int entry_key = delta_entry->key;
+	u32 entry_offset = delta_entry->offset;
+	unsigned int entry_bits = delta_entry->entry_bits;
+	unsigned int entry_delta = 0;
+	bool decoded = false;
+	bool found = false;
+
+	for (;;) {
+		u32 offset = entry_offset + entry_bits;
+		u32 load_offset = offset;
+		u64 bit_offset = list_start + offset;
+		unsigned int available = 64 - (bit_offset % BITS_PER_BYTE);
+		u64 data;
+
+		if (unlikely(offset >= size))
+			break;
+
+		/* The guard bytes make this load safe anywhere within the list. */
+		data = get_unaligned_le64(memory + bit_offset / BITS_PER_BYTE) >>
+		       (bit_offset % BITS_PER_BYTE);
+		for (;;) {
+			u64 code = data >> value_bits;
+			unsigned int key_bits = min_bits;
+			unsigned int delta = code & min_mask;
+			unsigned int bits;
+
+			if (value_bits + min_bits >= available)
+				break;
+
+			if (delta >= min_keys) {
+				/* Bits past the end of the load are zero, so a code must end within it. */
+				u32 tail = code >> min_bits;
+
+				if (tail == 0)
+					break;
+
+				key_bits += ffs(tail);
+				delta += (key_bits - min_bits - 1) * incr_keys;
+			}
+
+			bits = value_bits + key_bits;
+			if (unlikely((delta == 0) && (offset > 0)))
+				bits += COLLISION_BITS;
+
+			if (unlikely(offset + bits > size))
+				break;
+
+			entry_offset = offset;
+			entry_bits = bits;
+			entry_delta = delta;
+			entry_key += delta;
+			decoded = true;
+			if (key <= entry_key) {
+				found = true;
+				break;
+			}
+
+			offset += bits;
+			if ((bits >= available) || (offset >= size))
+				break;
+
+			data >>= bits;
+			available -= bits;
+		}
+
+		if (found || (offset == load_offset))
+			break;
+	}
+
+	if (decoded) {
+		delta_entry->key = entry_key;
+		delta_entry->offset = entry_offset;
+		delta_entry->entry_bits = entry_bits;
+		delta_entry->delta = entry_delta;
+		delta_entry->is_collision = ((entry_delta == 0) && (entry_offset > 0));
+	}
+
+	if (found)
+		return UDS_SUCCESS;
+
+	do {
+		result = next_delta_index_entry(delta_entry);
+		if (result != UDS_SUCCESS)
+			return result;
+	} while (!delta_entry->at_end && (key > delta_entry->key));
+
+	return UDS_SUCCESS;
+}
+
 int remember_delta_index_offset(const struct delta_index_entry *delta_entry)
 {
 	int result;
@@ -1652,11 +1821,9 @@ int get_delta_index_entry(const struct delta_index *delta_index,
 	if (result != UDS_SUCCESS)
 		return result;
 
-	do {
-		result = next_delta_index_entry(delta_entry);
-		if (result != UDS_SUCCESS)
-			return result;
-	} while (!delta_entry->at_end && (key > delta_entry->key));
+	result = search_delta_list(delta_entry, key);
+	if (result != UDS_SUCCESS)
+		return result;
 
 	result = remember_delta_index_offset(delta_entry);
 	if (result != UDS_SUCCESS)
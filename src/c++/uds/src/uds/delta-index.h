@@ -211,6 +211,7 @@ int __must_check initialize_delta_index(struct delta_index *delta_index,
 					unsigned int mean_delta,
 					unsigned int payload_bits,
 					size_t memory_size,
+					bool huge_pages,
 					u8 tag);
 
 int __must_check initialize_delta_index_page(struct delta_index_page *delta_index_page,
@@ -236,6 +237,10 @@ int __must_check start_restoring_delta_index(struct delta_index *delta_index,
 					     struct buffered_reader **buffered_readers,
 					     unsigned int reader_count);
 
+int __must_check finish_restoring_delta_index_zone(struct delta_index *delta_index,
+						   struct buffered_reader *buffered_reader,
+						   unsigned int zone_number);
+
 int __must_check finish_restoring_delta_index(struct delta_index *delta_index,
 					      struct buffered_reader **buffered_readers,
 					      unsigned int reader_count);
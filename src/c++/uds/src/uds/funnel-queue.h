@@ -100,6 +100,23 @@ static inline void funnel_queue_put(struct funnel_queue *queue, struct funnel_qu
 	WRITE_ONCE(previous->next, entry);
 }
 
+/*
+ * Put a chain of entries on the end of the queue with a single atomic exchange. The caller must
+ * already have linked the entries from first to last through their "next" fields; the chain is
+ * consumed in that order.
+ */
+static inline void funnel_queue_put_chain(struct funnel_queue *queue,
+					  struct funnel_queue_entry *first,
+					  struct funnel_queue_entry *last)
+{
+	struct funnel_queue_entry *previous;
+
+	/* The barrier requirements are the same as for funnel_queue_put(). */
+	WRITE_ONCE(last->next, NULL);
+	previous = xchg(&queue->newest, last);
+	WRITE_ONCE(previous->next, first);
+}
+
 struct funnel_queue_entry *__must_check funnel_queue_poll(struct funnel_queue *queue);
 
 bool __must_check is_funnel_queue_empty(struct funnel_queue *queue);
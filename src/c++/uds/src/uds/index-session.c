@@ -58,26 +58,35 @@ enum index_session_flag {
 	IS_FLAG_DESTROYING = (1 << IS_FLAG_BIT_DESTROYING),
 };
 
-/* Release a reference to an index session. */
-static void release_index_session(struct uds_index_session *index_session)
+/* Release some references to an index session. */
+static void release_index_session_references(struct uds_index_session *index_session,
+					     unsigned int count)
 {
 	uds_lock_mutex(&index_session->request_mutex);
-	if (--index_session->request_count == 0)
+	index_session->request_count -= count;
+	if (index_session->request_count == 0)
 		uds_broadcast_cond(&index_session->request_cond);
 	uds_unlock_mutex(&index_session->request_mutex);
 }
 
+/* Release a reference to an index session. */
+static void release_index_session(struct uds_index_session *index_session)
+{
+	release_index_session_references(index_session, 1);
+}
+
 /*
- * Acquire a reference to the index session for an asynchronous index request. The reference must
- * eventually be released with a corresponding call to release_index_session().
+ * Acquire references to the index session for some asynchronous index requests. Each reference
+ * must eventually be released with a corresponding call to release_index_session().
  */
-static int get_index_session(struct uds_index_session *index_session)
+static int get_index_session_references(struct uds_index_session *index_session,
+					unsigned int count)
 {
 	unsigned int state;
 	int result = UDS_SUCCESS;
 
 	uds_lock_mutex(&index_session->request_mutex);
-	index_session->request_count++;
+	index_session->request_count += count;
 	state = index_session->state;
 	uds_unlock_mutex(&index_session->request_mutex);
 
@@ -93,14 +102,23 @@ static int get_index_session(struct uds_index_session *index_session)
 		result = UDS_NO_INDEX;
 	}
 
-	release_index_session(index_session);
+	release_index_session_references(index_session, count);
 	return result;
 }
 
-int uds_launch_request(struct uds_request *request)
+/*
+ * Acquire a reference to the index session for an asynchronous index request. The reference must
+ * eventually be released with a corresponding call to release_index_session().
+ */
+static int get_index_session(struct uds_index_session *index_session)
+{
+	return get_index_session_references(index_session, 1);
+}
+
+/* Check that a request is valid, and reset its internal fields before processing. */
+static int prepare_request(struct uds_request *request)
 {
 	size_t internal_size;
-	int result;
 
 	if (request->callback == NULL) {
 		uds_log_error("missing required callback");
@@ -123,19 +141,58 @@ int uds_launch_request(struct uds_request *request)
 	internal_size = sizeof(struct uds_request) - offsetof(struct uds_request, zone_number);
 	// FIXME should be using struct_group for this instead
 	memset((char *) request + sizeof(*request) - internal_size, 0, internal_size);
+	request->found = false;
+	return UDS_SUCCESS;
+}
+
+int uds_launch_request(struct uds_request *request)
+{
+	int result;
+
+	result = prepare_request(request);
+	if (result != UDS_SUCCESS)
+		return result;
 
 	result = get_index_session(request->session);
 	if (result != UDS_SUCCESS)
 		return result;
 
-	request->found = false;
-	request->unbatched = false;
 	request->index = request->session->index;
-
 	enqueue_request(request, STAGE_TRIAGE);
 	return UDS_SUCCESS;
 }
 
+int uds_launch_requests(struct uds_request **requests, unsigned int count)
+{
+	struct uds_index_session *session;
+	unsigned int i;
+	int result;
+
+	if (count == 0)
+		return UDS_SUCCESS;
+
+	session = requests[0]->session;
+	for (i = 0; i < count; i++) {
+		result = prepare_request(requests[i]);
+		if (result != UDS_SUCCESS)
+			return result;
+
+		if (requests[i]->session != session) {
+			uds_log_error("batched requests must share an index session");
+			return -EINVAL;
+		}
+
+		requests[i]->index = session->index;
+	}
+
+	result = get_index_session_references(session, count);
+	if (result != UDS_SUCCESS)
+		return result;
+
+	enqueue_new_requests(session->index, requests, count);
+	return UDS_SUCCESS;
+}
+
 static void enter_callback_stage(struct uds_request *request)
 {
 	if (request->status != UDS_SUCCESS) {
@@ -808,6 +865,11 @@ int uds_get_index_stats(struct uds_index_session *index_session, struct uds_inde
 		stats->memory_used = 0;
 		stats->collisions = 0;
 		stats->entries_discarded = 0;
+		stats->index_page_hits = 0;
+		stats->index_page_misses = 0;
+		stats->record_page_hits = 0;
+		stats->record_page_misses = 0;
+		memset(stats->chapter_close_times, 0, sizeof(stats->chapter_close_times));
 	}
 
 	return UDS_SUCCESS;
@@ -6,11 +6,14 @@
 
 #include "index.h"
 
+#include <linux/log2.h>
+
 #include "hash-utils.h"
 #include "logger.h"
 #include "memory-alloc.h"
 #include "request-queue.h"
 #include "sparse-cache.h"
+#include "time-utils.h"
 
 static const u64 NO_LAST_SAVE = U64_MAX;
 #ifdef TEST_INTERNAL
@@ -70,6 +73,8 @@ struct chapter_writer {
 	size_t memory_allocated;
 	/* The number of zones which have submitted a chapter for writing */
 	unsigned int zones_to_write;
+	/* The histogram of chapter close times */
+	u64 close_times[UDS_CHAPTER_CLOSE_BUCKETS];
 	/* Open chapter index used by close_open_chapter() */
 	struct open_chapter_index *open_chapter_index;
 	/* Collated records used by close_open_chapter() */
@@ -683,12 +688,25 @@ static int initialize_index_queues(struct uds_index *index, const struct geometr
 	return UDS_SUCCESS;
 }
 
+/* Count a chapter close in the histogram of close times, with the writer mutex held. */
+static void record_close_time(struct chapter_writer *writer, ktime_t close_time)
+{
+	s64 milliseconds = ktime_to_ms(close_time);
+	unsigned int bucket = 0;
+
+	if (milliseconds > 0)
+		bucket = min(ilog2(milliseconds) + 1, UDS_CHAPTER_CLOSE_BUCKETS - 1);
+
+	writer->close_times[bucket]++;
+}
+
 /* This is the driver function for the chapter writer thread. */
 static void close_chapters(void *arg)
 {
 	int result;
 	struct chapter_writer *writer = arg;
 	struct uds_index *index = writer->index;
+	ktime_t start_time;
 
 	uds_log_debug("chapter writer starting");
 	uds_lock_mutex(&writer->mutex);
@@ -712,6 +730,7 @@ static void close_chapters(void *arg)
 		 * fields without the lock since those aren't allowed to change until we're done.
 		 */
 		uds_unlock_mutex(&writer->mutex);
+		start_time = current_time_ns(CLOCK_MONOTONIC);
 
 		if (index->has_saved_open_chapter) {
 			/*
@@ -747,6 +766,8 @@ static void close_chapters(void *arg)
 		index->oldest_virtual_chapter +=
 			chapters_to_expire(index->volume->geometry, index->newest_virtual_chapter);
 		writer->result = result;
+		record_close_time(writer,
+				  ktime_sub(current_time_ns(CLOCK_MONOTONIC), start_time));
 		writer->zones_to_write = 0;
 		uds_broadcast_cond(&writer->cond);
 	}
@@ -903,12 +924,86 @@ static int rebuild_index_page_map(struct uds_index *index, u64 vcn)
 	return UDS_SUCCESS;
 }
 
-static int replay_record(struct uds_index *index,
+/*
+ * A rebuild replays every record of every chapter in the volume into the volume index. Since the
+ * volume index is divided into zones which can be updated independently, the replay is split
+ * into a pipeline of threads. The thread doing the rebuild reads the record pages of each chapter
+ * into a batch, prefetching several chapters ahead so that the storage stays busy. A partitioner
+ * thread then sorts the names of each batch by volume index zone, and a worker thread for each
+ * zone adds its share of every batch to the volume index. Chapters are replayed in order within
+ * each zone, so the rebuilt volume index is the same as it would be from a serial replay.
+ *
+ * The volume page cache and the index page map are not safe for concurrent use outside of the
+ * normal request path, so any thread using them must hold the replay's volume mutex.
+ */
+
+enum {
+	/* The number of chapters which can be in the replay pipeline at once */
+	REPLAY_BATCH_COUNT = 4,
+	/* The number of chapters to prefetch ahead of the chapter being read */
+	REPLAY_PREFETCH_CHAPTERS = 8,
+};
+
+struct replay_batch {
+	u64 virtual_chapter;
+	bool sparse;
+	/* The names read from the record pages of the chapter */
+	struct uds_record_name *names;
+	/* The names to be replayed, grouped by volume index zone */
+	struct uds_record_name *zone_names;
+	/* The start of each zone's names in zone_names, with an extra entry for the end */
+	unsigned int *zone_offsets;
+};
+
+struct replay_worker {
+	/* The replay to which we belong */
+	struct replay_context *context;
+	/* The volume index zone to replay */
+	unsigned int zone_number;
+	/* The thread replaying this zone */
+	struct thread *thread;
+	/* The number of chapters this zone has replayed */
+	u64 chapters_replayed;
+};
+
+struct replay_context {
+	/* The index being rebuilt */
+	struct uds_index *index;
+	/* The first chapter to replay */
+	u64 from_virtual;
+	/* The number of chapters to replay */
+	u64 chapter_count;
+	/* The lock serializing use of the volume page cache and index page map */
+	struct mutex volume_mutex;
+	/* The lock protecting the following fields */
+	struct mutex mutex;
+	/* The condition signalled whenever a stage finishes a chapter */
+	struct cond_var cond;
+	/* Set to true to stop all the replay threads */
+	bool stop;
+	/* The first error encountered by any replay thread */
+	int result;
+	/* The number of chapters which have been read */
+	u64 chapters_read;
+	/* The number of chapters which have been partitioned */
+	u64 chapters_partitioned;
+	/* The thread partitioning names by zone */
+	struct thread *partitioner;
+	/* The next position in each zone's names, used by the partitioner */
+	unsigned int *zone_cursors;
+	/* The chapters in the pipeline */
+	struct replay_batch batches[REPLAY_BATCH_COUNT];
+	/* The zone workers */
+	struct replay_worker workers[];
+};
+
+static int replay_record(struct replay_context *context,
 			 const struct uds_record_name *name,
 			 u64 virtual_chapter,
 			 bool will_be_sparse_chapter)
 {
 	int result;
+	struct uds_index *index = context->index;
 	struct volume_index_record record;
 	bool update_record;
 
@@ -948,12 +1043,14 @@ static int replay_record(struct uds_index *index,
 			 * need to search that chapter to determine if the volume index entry was
 			 * for the same record or a different one.
 			 */
+			uds_lock_mutex(&context->volume_mutex);
 			result = search_volume_page_cache(index->volume,
 							  NULL,
 							  name,
 							  record.virtual_chapter,
 							  NULL,
 							  &update_record);
+			uds_unlock_mutex(&context->volume_mutex);
 			if (result != UDS_SUCCESS)
 				return result;
 			}
@@ -983,7 +1080,36 @@ static int replay_record(struct uds_index *index,
 	return result;
 }
 
-static bool check_for_suspend(struct uds_index *index)
+/* Stop the replay, recording the first error. The caller must hold the replay mutex. */
+static void stop_replay(struct replay_context *context, int result)
+{
+	if (context->result == UDS_SUCCESS)
+		context->result = result;
+	context->stop = true;
+	uds_broadcast_cond(&context->cond);
+}
+
+static u64 get_chapters_replayed(const struct replay_context *context)
+{
+	unsigned int z;
+	u64 replayed = context->chapter_count;
+
+	for (z = 0; z < context->index->zone_count; z++)
+		replayed = min(replayed, context->workers[z].chapters_replayed);
+
+	return replayed;
+}
+
+/* Wait for every chapter which has been read to be replayed by every zone. */
+static void wait_for_replay_idle(struct replay_context *context)
+{
+	uds_lock_mutex(&context->mutex);
+	while (!context->stop && (get_chapters_replayed(context) < context->chapters_read))
+		uds_wait_cond(&context->cond, &context->mutex);
+	uds_unlock_mutex(&context->mutex);
+}
+
+static bool check_for_suspend(struct uds_index *index, struct replay_context *context)
 {
 	bool closing;
 
@@ -996,6 +1122,9 @@ static bool check_for_suspend(struct uds_index *index)
 		return false;
 	}
 
+	/* Finish the chapters already read so the index is quiescent while suspended. */
+	wait_for_replay_idle(context);
+
 	/* Notify that we are suspended and wait for the resume. */
 	index->load_context->status = INDEX_SUSPENDED;
 	uds_broadcast_cond(&index->load_context->cond);
@@ -1009,13 +1138,27 @@ static bool check_for_suspend(struct uds_index *index)
 	return closing;
 }
 
-static int replay_chapter(struct uds_index *index, u64 virtual, bool sparse)
+static void prefetch_chapter(struct uds_index *index, u64 virtual)
+{
+	const struct geometry *geometry = index->volume->geometry;
+	unsigned int physical_chapter = map_to_physical_chapter(geometry, virtual);
+
+	dm_bufio_prefetch(index->volume->client,
+			  map_to_physical_page(geometry, physical_chapter, 0),
+			  geometry->pages_per_chapter);
+}
+
+/* Rebuild the index page map for a chapter and read its record names into a batch. */
+static int read_chapter(struct replay_context *context, struct replay_batch *batch)
 {
 	int result;
 	unsigned int i;
 	unsigned int j;
-	const struct geometry *geometry;
-	unsigned int physical_chapter;
+	struct uds_index *index = context->index;
+	const struct geometry *geometry = index->volume->geometry;
+	u64 virtual = batch->virtual_chapter;
+	unsigned int physical_chapter = map_to_physical_chapter(geometry, virtual);
+	struct uds_record_name *name = batch->names;
 #ifdef TEST_INTERNAL
 
 	/*
@@ -1026,24 +1169,23 @@ static int replay_chapter(struct uds_index *index, u64 virtual, bool sparse)
 	atomic_inc(&chapters_replayed);
 #endif /* TEST_INTERNAL */
 
-	if (check_for_suspend(index)) {
+	if (check_for_suspend(index, context)) {
 		uds_log_info("Replay interrupted by index shutdown at chapter %llu",
 			     (unsigned long long) virtual);
 		return -EBUSY;
 	}
 
-	geometry = index->volume->geometry;
-	physical_chapter = map_to_physical_chapter(geometry, virtual);
-	dm_bufio_prefetch(index->volume->client,
-			  map_to_physical_page(geometry, physical_chapter, 0),
-			  geometry->pages_per_chapter);
-	set_volume_index_open_chapter(index->volume_index, virtual);
+	if (virtual + REPLAY_PREFETCH_CHAPTERS < context->from_virtual + context->chapter_count)
+		prefetch_chapter(index, virtual + REPLAY_PREFETCH_CHAPTERS);
 
+	uds_lock_mutex(&context->volume_mutex);
 	result = rebuild_index_page_map(index, virtual);
-	if (result != UDS_SUCCESS)
+	if (result != UDS_SUCCESS) {
+		uds_unlock_mutex(&context->volume_mutex);
 		return uds_log_error_strerror(result,
 					      "could not rebuild index page map for chapter %u",
 					      physical_chapter);
+	}
 
 	for (i = 0; i < geometry->record_pages_per_chapter; i++) {
 		u8 *record_page;
@@ -1054,21 +1196,322 @@ static int replay_chapter(struct uds_index *index, u64 virtual, bool sparse)
 						physical_chapter,
 						record_page_number,
 						&record_page);
-		if (result != UDS_SUCCESS)
+		if (result != UDS_SUCCESS) {
+			uds_unlock_mutex(&context->volume_mutex);
 			return uds_log_error_strerror(result,
 						      "could not get page %d",
 						      record_page_number);
+		}
 
-		for (j = 0; j < geometry->records_per_page; j++) {
-			const u8 *name_bytes;
-			struct uds_record_name name;
+		for (j = 0; j < geometry->records_per_page; j++, name++)
+			memcpy(&name->name,
+			       record_page + (j * BYTES_PER_RECORD),
+			       UDS_RECORD_NAME_SIZE);
+	}
 
-			name_bytes = record_page + (j * BYTES_PER_RECORD);
-			memcpy(&name.name, name_bytes, UDS_RECORD_NAME_SIZE);
-			result = replay_record(index, &name, virtual, sparse);
-			if (result != UDS_SUCCESS)
-				return result;
+	uds_unlock_mutex(&context->volume_mutex);
+	return UDS_SUCCESS;
+}
+
+/* Group the names of a batch by zone, dropping those a sparse chapter won't keep. */
+static void partition_chapter(struct replay_context *context, struct replay_batch *batch)
+{
+	unsigned int i;
+	unsigned int z;
+	struct uds_index *index = context->index;
+	struct volume_index *volume_index = index->volume_index;
+	unsigned int record_count = index->volume->geometry->records_per_chapter;
+	unsigned int *offsets = batch->zone_offsets;
+	unsigned int *cursors = context->zone_cursors;
+
+	memset(cursors, 0, index->zone_count * sizeof(unsigned int));
+	for (i = 0; i < record_count; i++) {
+		const struct uds_record_name *name = &batch->names[i];
+
+		if (batch->sparse && !is_volume_index_sample(volume_index, name))
+			continue;
+
+		cursors[get_volume_index_zone(volume_index, name)]++;
+	}
+
+	offsets[0] = 0;
+	for (z = 0; z < index->zone_count; z++) {
+		offsets[z + 1] = offsets[z] + cursors[z];
+		cursors[z] = offsets[z];
+	}
+
+	for (i = 0; i < record_count; i++) {
+		const struct uds_record_name *name = &batch->names[i];
+
+		if (batch->sparse && !is_volume_index_sample(volume_index, name))
+			continue;
+
+		batch->zone_names[cursors[get_volume_index_zone(volume_index, name)]++] = *name;
+	}
+}
+
+/* This is the driver function for the replay partitioner thread. */
+static void partition_chapters(void *arg)
+{
+	struct replay_context *context = arg;
+	u64 n;
+
+	for (n = 0; n < context->chapter_count; n++) {
+		uds_lock_mutex(&context->mutex);
+		while (!context->stop && (context->chapters_read <= n))
+			uds_wait_cond(&context->cond, &context->mutex);
+		if (context->stop) {
+			uds_unlock_mutex(&context->mutex);
+			return;
+		}
+		uds_unlock_mutex(&context->mutex);
+
+		partition_chapter(context, &context->batches[n % REPLAY_BATCH_COUNT]);
+
+		uds_lock_mutex(&context->mutex);
+		context->chapters_partitioned++;
+		uds_broadcast_cond(&context->cond);
+		uds_unlock_mutex(&context->mutex);
+	}
+}
+
+static int replay_zone_chapter(struct replay_worker *worker, struct replay_batch *batch)
+{
+	int result;
+	unsigned int i;
+	struct replay_context *context = worker->context;
+	unsigned int zone = worker->zone_number;
+
+	set_volume_index_zone_open_chapter(context->index->volume_index,
+					   zone,
+					   batch->virtual_chapter);
+	for (i = batch->zone_offsets[zone]; i < batch->zone_offsets[zone + 1]; i++) {
+		result = replay_record(context,
+				       &batch->zone_names[i],
+				       batch->virtual_chapter,
+				       batch->sparse);
+		if (result != UDS_SUCCESS)
+			return result;
+	}
+
+	return UDS_SUCCESS;
+}
+
+/* This is the driver function for the replay thread of each volume index zone. */
+static void replay_chapters(void *arg)
+{
+	struct replay_worker *worker = arg;
+	struct replay_context *context = worker->context;
+	int result;
+	u64 n;
+
+	for (n = 0; n < context->chapter_count; n++) {
+		uds_lock_mutex(&context->mutex);
+		while (!context->stop && (context->chapters_partitioned <= n))
+			uds_wait_cond(&context->cond, &context->mutex);
+		if (context->stop) {
+			uds_unlock_mutex(&context->mutex);
+			return;
+		}
+		uds_unlock_mutex(&context->mutex);
+
+		result = replay_zone_chapter(worker, &context->batches[n % REPLAY_BATCH_COUNT]);
+
+		uds_lock_mutex(&context->mutex);
+		if (result != UDS_SUCCESS) {
+			stop_replay(context, result);
+			uds_unlock_mutex(&context->mutex);
+			return;
+		}
+
+		worker->chapters_replayed++;
+		uds_broadcast_cond(&context->cond);
+		uds_unlock_mutex(&context->mutex);
+	}
+}
+
+static void free_replay_context(struct replay_context *context)
+{
+	unsigned int i;
+
+	for (i = 0; i < REPLAY_BATCH_COUNT; i++) {
+		UDS_FREE(context->batches[i].names);
+		UDS_FREE(context->batches[i].zone_names);
+		UDS_FREE(context->batches[i].zone_offsets);
+	}
+
+	UDS_FREE(context->zone_cursors);
+	uds_destroy_cond(&context->cond);
+	uds_destroy_mutex(&context->mutex);
+	uds_destroy_mutex(&context->volume_mutex);
+	UDS_FREE(context);
+}
+
+static int make_replay_context(struct uds_index *index,
+			       u64 from_virtual,
+			       u64 upto_virtual,
+			       struct replay_context **context_ptr)
+{
+	int result;
+	unsigned int i;
+	struct replay_context *context;
+	unsigned int record_count = index->volume->geometry->records_per_chapter;
+
+	result = UDS_ALLOCATE_EXTENDED(struct replay_context,
+				       index->zone_count,
+				       struct replay_worker,
+				       "replay context",
+				       &context);
+	if (result != UDS_SUCCESS)
+		return result;
+
+	context->index = index;
+	context->from_virtual = from_virtual;
+	context->chapter_count = upto_virtual - from_virtual;
+	result = uds_init_mutex(&context->volume_mutex);
+	if (result != UDS_SUCCESS) {
+		UDS_FREE(context);
+		return result;
+	}
+
+	result = uds_init_mutex(&context->mutex);
+	if (result != UDS_SUCCESS) {
+		uds_destroy_mutex(&context->volume_mutex);
+		UDS_FREE(context);
+		return result;
+	}
+
+	result = uds_init_cond(&context->cond);
+	if (result != UDS_SUCCESS) {
+		uds_destroy_mutex(&context->mutex);
+		uds_destroy_mutex(&context->volume_mutex);
+		UDS_FREE(context);
+		return result;
+	}
+
+	result = UDS_ALLOCATE(index->zone_count, unsigned int, "replay zone cursors",
+			      &context->zone_cursors);
+	if (result != UDS_SUCCESS) {
+		free_replay_context(context);
+		return result;
+	}
+
+	for (i = 0; i < REPLAY_BATCH_COUNT; i++) {
+		struct replay_batch *batch = &context->batches[i];
+
+		result = UDS_ALLOCATE(record_count, struct uds_record_name, "replay names",
+				      &batch->names);
+		if (result != UDS_SUCCESS) {
+			free_replay_context(context);
+			return result;
+		}
+
+		result = UDS_ALLOCATE(record_count, struct uds_record_name, "replay zone names",
+				      &batch->zone_names);
+		if (result != UDS_SUCCESS) {
+			free_replay_context(context);
+			return result;
+		}
+
+		result = UDS_ALLOCATE(index->zone_count + 1, unsigned int, "replay zone offsets",
+				      &batch->zone_offsets);
+		if (result != UDS_SUCCESS) {
+			free_replay_context(context);
+			return result;
+		}
+	}
+
+	for (i = 0; i < index->zone_count; i++) {
+		context->workers[i].context = context;
+		context->workers[i].zone_number = i;
+	}
+
+	*context_ptr = context;
+	return UDS_SUCCESS;
+}
+
+/* Stop the replay threads once they have finished, or as soon as possible after an error. */
+static int finish_replay(struct replay_context *context, int result)
+{
+	unsigned int z;
+
+	uds_lock_mutex(&context->mutex);
+	if (result != UDS_SUCCESS)
+		stop_replay(context, result);
+	while (!context->stop && (get_chapters_replayed(context) < context->chapter_count))
+		uds_wait_cond(&context->cond, &context->mutex);
+	stop_replay(context, UDS_SUCCESS);
+	result = context->result;
+	uds_unlock_mutex(&context->mutex);
+
+	if (context->partitioner != NULL)
+		uds_join_threads(context->partitioner);
+
+	for (z = 0; z < context->index->zone_count; z++) {
+		if (context->workers[z].thread != NULL)
+			uds_join_threads(context->workers[z].thread);
+	}
+
+	return result;
+}
+
+static int start_replay_threads(struct replay_context *context)
+{
+	int result;
+	unsigned int z;
+
+	result = uds_create_thread(partition_chapters, context, "partitioner",
+				   &context->partitioner);
+	if (result != UDS_SUCCESS)
+		return result;
+
+	for (z = 0; z < context->index->zone_count; z++) {
+		result = uds_create_thread(replay_chapters, &context->workers[z], "replayer",
+					   &context->workers[z].thread);
+		if (result != UDS_SUCCESS)
+			return result;
+	}
+
+	return UDS_SUCCESS;
+}
+
+/* Read each chapter into the pipeline once its batch has been replayed by every zone. */
+static int read_chapters(struct replay_context *context, u64 upto_virtual)
+{
+	int result;
+	u64 n;
+	u64 virtual;
+	struct uds_index *index = context->index;
+
+	for (n = 0; n < REPLAY_PREFETCH_CHAPTERS && n < context->chapter_count; n++)
+		prefetch_chapter(index, context->from_virtual + n);
+
+	for (n = 0; n < context->chapter_count; n++) {
+		struct replay_batch *batch = &context->batches[n % REPLAY_BATCH_COUNT];
+
+		uds_lock_mutex(&context->mutex);
+		while (!context->stop && (get_chapters_replayed(context) + REPLAY_BATCH_COUNT <= n))
+			uds_wait_cond(&context->cond, &context->mutex);
+		if (context->stop) {
+			uds_unlock_mutex(&context->mutex);
+			return UDS_SUCCESS;
 		}
+		uds_unlock_mutex(&context->mutex);
+
+		virtual = context->from_virtual + n;
+		batch->virtual_chapter = virtual;
+		batch->sparse = is_chapter_sparse(index->volume->geometry,
+						  context->from_virtual,
+						  upto_virtual,
+						  virtual);
+		result = read_chapter(context, batch);
+		if (result != UDS_SUCCESS)
+			return result;
+
+		uds_lock_mutex(&context->mutex);
+		context->chapters_read++;
+		uds_broadcast_cond(&context->cond);
+		uds_unlock_mutex(&context->mutex);
 	}
 
 	return UDS_SUCCESS;
@@ -1079,10 +1522,9 @@ static int replay_volume(struct uds_index *index)
 	int result;
 	u64 old_map_update;
 	u64 new_map_update;
-	u64 virtual;
 	u64 from_virtual = index->oldest_virtual_chapter;
 	u64 upto_virtual = index->newest_virtual_chapter;
-	bool will_be_sparse;
+	struct replay_context *context;
 
 	uds_log_info("Replaying volume from chapter %llu through chapter %llu",
 		     (unsigned long long) from_virtual,
@@ -1099,16 +1541,19 @@ static int replay_volume(struct uds_index *index)
 	 *
 	 * Also, go through each index page for each chapter and rebuild the index page map.
 	 */
+	result = make_replay_context(index, from_virtual, upto_virtual, &context);
+	if (result != UDS_SUCCESS)
+		return result;
+
 	old_map_update = index->volume->index_page_map->last_update;
-	for (virtual = from_virtual; virtual < upto_virtual; ++virtual) {
-		will_be_sparse = is_chapter_sparse(index->volume->geometry,
-						   from_virtual,
-						   upto_virtual,
-						   virtual);
-		result = replay_chapter(index, virtual, will_be_sparse);
-		if (result != UDS_SUCCESS)
-			return result;
-	}
+	result = start_replay_threads(context);
+	if (result == UDS_SUCCESS)
+		result = read_chapters(context, upto_virtual);
+
+	result = finish_replay(context, result);
+	free_replay_context(context);
+	if (result != UDS_SUCCESS)
+		return result;
 
 	/* Also reap the chapter being replaced by the open chapter. */
 	set_volume_index_open_chapter(index->volume_index, upto_virtual);
@@ -1396,8 +1841,10 @@ void get_index_stats(struct uds_index *index, struct uds_index_stats *counters)
 {
 	struct volume_index_stats dense_stats;
 	struct volume_index_stats sparse_stats;
+	struct page_cache_stats cache_stats;
 
 	get_volume_index_stats(index->volume_index, &dense_stats, &sparse_stats);
+	get_page_cache_stats(index->volume, &cache_stats);
 
 	counters->entries_indexed = dense_stats.record_count + sparse_stats.record_count;
 	counters->memory_used = ((u64) dense_stats.memory_allocated +
@@ -1406,6 +1853,16 @@ void get_index_stats(struct uds_index *index, struct uds_index_stats *counters)
 				 index->chapter_writer->memory_allocated);
 	counters->collisions = (dense_stats.collision_count + sparse_stats.collision_count);
 	counters->entries_discarded = (dense_stats.discard_count + sparse_stats.discard_count);
+	counters->index_page_hits = cache_stats.index_page_hits;
+	counters->index_page_misses = cache_stats.index_page_misses;
+	counters->record_page_hits = cache_stats.record_page_hits;
+	counters->record_page_misses = cache_stats.record_page_misses;
+
+	uds_lock_mutex(&index->chapter_writer->mutex);
+	memcpy(counters->chapter_close_times,
+	       index->chapter_writer->close_times,
+	       sizeof(counters->chapter_close_times));
+	uds_unlock_mutex(&index->chapter_writer->mutex);
 }
 
 void enqueue_request(struct uds_request *request, enum request_stage stage)
@@ -1438,3 +1895,44 @@ void enqueue_request(struct uds_request *request, enum request_stage stage)
 
 	uds_request_queue_enqueue(queue, request);
 }
+
+/*
+ * Send a batch of new requests to the triage stage. The requests are sorted into one list for each
+ * queue they go to, preserving their order, and each list is enqueued with a single operation.
+ */
+void enqueue_new_requests(struct uds_index *index, struct uds_request **requests,
+			  unsigned int count)
+{
+	struct uds_request *heads[MAX_ZONES] = { NULL };
+	struct uds_request *tails[MAX_ZONES];
+	unsigned int zone;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		struct uds_request *request = requests[i];
+
+		/* With a triage queue, zones are assigned by the triage stage. */
+		if (index->triage_queue == NULL)
+			request->zone_number = get_volume_index_zone(index->volume_index,
+								     &request->record_name);
+
+		zone = request->zone_number;
+		request->next_request = NULL;
+		if (heads[zone] == NULL)
+			heads[zone] = request;
+		else
+			tails[zone]->next_request = request;
+		tails[zone] = request;
+	}
+
+	/* No request may be touched once its list has been enqueued. */
+	if (index->triage_queue != NULL) {
+		uds_request_queue_enqueue_list(index->triage_queue, heads[0]);
+		return;
+	}
+
+	for (zone = 0; zone < index->zone_count; zone++) {
+		if (heads[zone] != NULL)
+			uds_request_queue_enqueue_list(index->zone_queues[zone], heads[zone]);
+	}
+}
@@ -7,8 +7,14 @@
 
 #include <linux/atomic.h>
 #include <linux/blkdev.h>
+#ifdef __KERNEL__
+#include <linux/crc32.h>
+#endif /* __KERNEL__ */
 #include <linux/err.h>
 #include <linux/mount.h>
+#ifndef __KERNEL__
+#include <zlib.h>
+#endif /* not __KERNEL__ */
 
 #ifdef TEST_INTERNAL
 #include "dory.h"
@@ -40,6 +46,8 @@ struct buffered_reader {
 	sector_t block_number;
 	u8 *start;
 	u8 *end;
+	/* The checksum of all the data read so far */
+	u32 checksum;
 };
 
 enum { MAX_READ_AHEAD_BLOCKS = 4 };
@@ -57,8 +65,24 @@ struct buffered_writer {
 	u8 *start;
 	u8 *end;
 	int error;
+	/* The checksum of all the data written so far */
+	u32 checksum;
 };
 
+/*
+ * Add data to the running CRC-32 of a buffered stream. The kernel crc32() does not precondition or
+ * postcondition the value while the zlib one does, so the kernel version inverts the value on both
+ * sides to compute the same checksum in both environments.
+ */
+static inline u32 update_checksum(u32 checksum, const u8 *data, size_t length)
+{
+#ifdef __KERNEL__
+	return ~crc32(~checksum, data, length);
+#else /* not __KERNEL__ */
+	return crc32(checksum, data, length);
+#endif /* __KERNEL__ */
+}
+
 static void get_uds_io_factory(struct io_factory *factory)
 {
 	atomic_inc(&factory->ref_count);
@@ -215,6 +239,7 @@ int make_buffered_reader(struct io_factory *factory,
 		.block_number = 0,
 		.start = NULL,
 		.end = NULL,
+		.checksum = 0,
 	};
 
 	read_ahead(reader, 0);
@@ -281,6 +306,7 @@ int read_from_buffered_reader(struct buffered_reader *reader, u8 *data, size_t l
 
 		chunk_size = min(length, bytes_remaining_in_read_buffer(reader));
 		memcpy(data, reader->end, chunk_size);
+		reader->checksum = update_checksum(reader->checksum, data, chunk_size);
 		length -= chunk_size;
 		data += chunk_size;
 		reader->end += chunk_size;
@@ -299,6 +325,7 @@ int verify_buffered_data(struct buffered_reader *reader, const u8 *value, size_t
 	size_t chunk_size;
 	sector_t start_block_number = reader->block_number;
 	int start_offset = reader->end - reader->start;
+	u32 checksum = update_checksum(reader->checksum, value, length);
 
 	while (length > 0) {
 		result = reset_reader(reader);
@@ -320,10 +347,21 @@ int verify_buffered_data(struct buffered_reader *reader, const u8 *value, size_t
 
 	if (result != UDS_SUCCESS)
 		position_reader(reader, start_block_number, start_offset);
+	else
+		reader->checksum = checksum;
 
 	return result;
 }
 
+/*
+ * Get the checksum of all the data consumed from a reader so far, which matches the checksum of
+ * the writer which produced it after writing the same data.
+ */
+u32 get_buffered_reader_checksum(const struct buffered_reader *reader)
+{
+	return reader->checksum;
+}
+
 /* Create a buffered writer for an index region starting at offset. */
 int make_buffered_writer(struct io_factory *factory,
 			 off_t offset,
@@ -353,6 +391,7 @@ int make_buffered_writer(struct io_factory *factory,
 		.end = NULL,
 		.block_number = 0,
 		.error = UDS_SUCCESS,
+		.checksum = 0,
 	};
 
 	get_uds_io_factory(factory);
@@ -458,6 +497,7 @@ int write_to_buffered_writer(struct buffered_writer *writer, const u8 *data, siz
 			data += chunk_size;
 		}
 
+		writer->checksum = update_checksum(writer->checksum, writer->end, chunk_size);
 		length -= chunk_size;
 		writer->end += chunk_size;
 
@@ -468,6 +508,12 @@ int write_to_buffered_writer(struct buffered_writer *writer, const u8 *data, siz
 	return result;
 }
 
+/* Get the checksum of all the data written to a writer so far. */
+u32 get_buffered_writer_checksum(const struct buffered_writer *writer)
+{
+	return writer->checksum;
+}
+
 int flush_buffered_writer(struct buffered_writer *writer)
 {
 	if (writer->error != UDS_SUCCESS)
@@ -51,6 +51,8 @@ read_from_buffered_reader(struct buffered_reader *reader, u8 *data, size_t lengt
 int __must_check
 verify_buffered_data(struct buffered_reader *reader, const u8 *value, size_t length);
 
+u32 __must_check get_buffered_reader_checksum(const struct buffered_reader *reader);
+
 int __must_check make_buffered_writer(struct io_factory *factory,
 				      off_t offset,
 				      u64 block_count,
@@ -61,6 +63,8 @@ void free_buffered_writer(struct buffered_writer *buffer);
 int __must_check
 write_to_buffered_writer(struct buffered_writer *writer, const u8 *data, size_t length);
 
+u32 __must_check get_buffered_writer_checksum(const struct buffered_writer *writer);
+
 int __must_check flush_buffered_writer(struct buffered_writer *writer);
 
 #endif /* IO_FACTORY_H */
@@ -10,6 +10,13 @@
 #include <linux/compiler.h>
 #include <linux/types.h>
 
+enum {
+	/* The number of keys hashed in parallel by murmurhash3_128_batch() */
+	MURMURHASH3_LANES = 4,
+};
+
 void murmurhash3_128(const void *key, int len, u32 seed, void *out);
+void murmurhash3_128_batch(const void * const keys[], unsigned int count, int len, u32 seed,
+			   void * const outs[]);
 
 #endif /* _MURMURHASH3_H_ */
@@ -148,6 +148,8 @@ static inline int __must_check uds_allocate_cache_aligned(size_t size, const cha
 	return uds_allocate_memory(size, L1_CACHE_BYTES, what, ptr);
 }
 
+int __must_check uds_allocate_huge_memory(size_t size, const char *what, void *ptr);
+
 void *__must_check uds_allocate_memory_nowait(size_t size, const char *what);
 
 /*
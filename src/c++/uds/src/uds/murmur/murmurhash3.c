@@ -52,45 +52,34 @@ static __always_inline u64 fmix64(u64 k)
 	return k;
 }
 
-void murmurhash3_128(const void *key, const int len, const u32 seed, void *out)
-{
-	const u8 *data = (const u8 *)key;
-	const int nblocks = len / 16;
-
-	u64 h1 = seed;
-	u64 h2 = seed;
+static const u64 c1 = 0x87c37b91114253d5LLU;
+static const u64 c2 = 0x4cf5ad432745937fLLU;
 
-	const u64 c1 = 0x87c37b91114253d5LLU;
-	const u64 c2 = 0x4cf5ad432745937fLLU;
-
-	/* body */
-
-	const u64 *blocks = (const u64 *)(data);
-
-	int i;
+static __always_inline void mix_block(u64 *h1, u64 *h2, u64 k1, u64 k2)
+{
+	k1 *= c1;
+	k1 = ROTL64(k1, 31);
+	k1 *= c2;
+	*h1 ^= k1;
+
+	*h1 = ROTL64(*h1, 27);
+	*h1 += *h2;
+	*h1 = *h1 * 5 + 0x52dce729;
+
+	k2 *= c2;
+	k2 = ROTL64(k2, 33);
+	k2 *= c1;
+	*h2 ^= k2;
+
+	*h2 = ROTL64(*h2, 31);
+	*h2 += *h1;
+	*h2 = *h2 * 5 + 0x38495ab5;
+}
 
-	for (i = 0; i < nblocks; i++) {
-		u64 k1 = getblock64(blocks, i * 2 + 0);
-		u64 k2 = getblock64(blocks, i * 2 + 1);
-
-		k1 *= c1;
-		k1 = ROTL64(k1, 31);
-		k1 *= c2;
-		h1 ^= k1;
-
-		h1 = ROTL64(h1, 27);
-		h1 += h2;
-		h1 = h1 * 5 + 0x52dce729;
-
-		k2 *= c2;
-		k2 = ROTL64(k2, 33);
-		k2 *= c1;
-		h2 ^= k2;
-
-		h2 = ROTL64(h2, 31);
-		h2 += h1;
-		h2 = h2 * 5 + 0x38495ab5;
-	}
+/* Mix in the tail bytes of the key, finalize the hash, and store it. */
+static __always_inline void finish_hash(const u8 *data, const int len, u64 h1, u64 h2, void *out)
+{
+	const int nblocks = len / 16;
 
 	/* tail */
 
@@ -176,8 +165,77 @@ void murmurhash3_128(const void *key, const int len, const u32 seed, void *out)
 	putblock64((u64 *)out, 0, h1);
 	putblock64((u64 *)out, 1, h2);
 }
+
+void murmurhash3_128(const void *key, const int len, const u32 seed, void *out)
+{
+	const u8 *data = (const u8 *)key;
+	const int nblocks = len / 16;
+
+	u64 h1 = seed;
+	u64 h2 = seed;
+
+	/* body */
+
+	const u64 *blocks = (const u64 *)(data);
+
+	int i;
+
+	for (i = 0; i < nblocks; i++)
+		mix_block(&h1, &h2, getblock64(blocks, i * 2 + 0), getblock64(blocks, i * 2 + 1));
+
+	finish_hash(data, len, h1, h2, out);
+}
+
+/*
+ * Hash MURMURHASH3_LANES keys of the same length at once. Each key's state only depends on its own
+ * previous state, so interleaving the body loops of several keys gives the processor independent
+ * multiply chains to overlap instead of stalling on the latency of each one in turn.
+ */
+static void murmurhash3_128_lanes(const void * const keys[], const int len, const u32 seed,
+				  void * const outs[])
+{
+	const int nblocks = len / 16;
+	const u64 *blocks[MURMURHASH3_LANES];
+	u64 h1[MURMURHASH3_LANES];
+	u64 h2[MURMURHASH3_LANES];
+	int i;
+	int lane;
+
+	for (lane = 0; lane < MURMURHASH3_LANES; lane++) {
+		blocks[lane] = (const u64 *) keys[lane];
+		h1[lane] = seed;
+		h2[lane] = seed;
+	}
+
+	for (i = 0; i < nblocks; i++) {
+		for (lane = 0; lane < MURMURHASH3_LANES; lane++)
+			mix_block(&h1[lane], &h2[lane],
+				  getblock64(blocks[lane], i * 2 + 0),
+				  getblock64(blocks[lane], i * 2 + 1));
+	}
+
+	for (lane = 0; lane < MURMURHASH3_LANES; lane++)
+		finish_hash((const u8 *) keys[lane], len, h1[lane], h2[lane], outs[lane]);
+}
+
+/*
+ * Compute the hashes of a batch of keys which all have the same length. The results are identical
+ * to calling murmurhash3_128() on each key in turn.
+ */
+void murmurhash3_128_batch(const void * const keys[], unsigned int count, const int len,
+			   const u32 seed, void * const outs[])
+{
+	unsigned int i;
+
+	for (i = 0; i + MURMURHASH3_LANES <= count; i += MURMURHASH3_LANES)
+		murmurhash3_128_lanes(&keys[i], len, seed, &outs[i]);
+
+	for (; i < count; i++)
+		murmurhash3_128(keys[i], len, seed, outs[i]);
+}
 #ifdef __KERNEL__
 EXPORT_SYMBOL(murmurhash3_128);
+EXPORT_SYMBOL(murmurhash3_128_batch);
 
 #ifndef UDS_MURMURHASH3
 MODULE_LICENSE("GPL");
@@ -22,11 +22,20 @@
  * If new metadata for an existing name arrives, the record is altered in place. The array of
  * records is 1-based so that record number 0 can be used to indicate an unused hash slot.
  *
+ * The hash slots are arranged in groups of sixteen, each of which fills a cache line along with a
+ * one-byte tag for each slot. The tag of a used slot has its high bit set and holds seven bits of
+ * the record name which are not used to choose the hash slot. A search probes whole groups,
+ * scanning the tags of a group for the tag of the wanted name, so it only looks at a record (a
+ * likely cache miss) when the record's tag matches. The scan of each group starts at the slot the
+ * name hashes to and wraps around, and a record always takes the first unused slot it finds, so
+ * an unused slot ends the search.
+ *
  * Deleted records are marked with a flag rather than actually removed to simplify hash table
  * management. The array of deleted flags overlays the array of hash slots, but the flags are
- * indexed by record number instead of by record name. The number of hash slots will always be a
- * power of two that is greater than the number of records to be indexed, guaranteeing that hash
- * insertion cannot fail, and that there are sufficient flags for all records.
+ * indexed by record number instead of by record name. The hash slot of a deleted record is also
+ * given a tag which no name can match. The number of hash slots will always be a power of two
+ * that is greater than the number of records to be indexed, guaranteeing that hash insertion
+ * cannot fail, and that there are sufficient flags for all records.
  *
  * Once any open chapter zone fills its available space, the chapter is closed. The records from
  * each zone are interleaved to attempt to preserve temporal locality and assigned to record pages.
@@ -49,6 +58,10 @@ enum {
 	OPEN_CHAPTER_MAGIC_LENGTH = sizeof(OPEN_CHAPTER_MAGIC) - 1,
 	OPEN_CHAPTER_VERSION_LENGTH = sizeof(OPEN_CHAPTER_VERSION) - 1,
 	LOAD_RATIO = 2,
+	/* The tag of a hash slot for a deleted record */
+	DELETED_SLOT_TAG = 0x7F,
+	/* The tag of a hash slot for an undeleted record always has this bit set. */
+	RECORD_SLOT_TAG = 0x80,
 };
 
 static inline size_t records_size(const struct open_chapter_zone *open_chapter)
@@ -56,9 +69,32 @@ static inline size_t records_size(const struct open_chapter_zone *open_chapter)
 	return sizeof(struct uds_volume_record) * (1 + open_chapter->capacity);
 }
 
-static inline size_t slots_size(size_t slot_count)
+static inline size_t groups_size(size_t slot_count)
+{
+	return sizeof(struct open_chapter_slot_group) * (slot_count / OPEN_CHAPTER_GROUP_SLOTS);
+}
+
+static inline struct open_chapter_zone_slot *get_slot(struct open_chapter_zone *open_chapter,
+						      unsigned int slot)
+{
+	struct open_chapter_slot_group *group;
+
+	group = &open_chapter->groups[slot / OPEN_CHAPTER_GROUP_SLOTS];
+	return &group->slots[slot % OPEN_CHAPTER_GROUP_SLOTS];
+}
+
+static inline void set_slot_tag(struct open_chapter_zone *open_chapter, unsigned int slot, u8 tag)
 {
-	return sizeof(struct open_chapter_zone_slot) * slot_count;
+	struct open_chapter_slot_group *group;
+
+	group = &open_chapter->groups[slot / OPEN_CHAPTER_GROUP_SLOTS];
+	group->tags[slot % OPEN_CHAPTER_GROUP_SLOTS] = tag;
+}
+
+static inline u8 name_to_slot_tag(const struct uds_record_name *name)
+{
+	/* This byte holds the highest bits of the value used to choose the hash slot. */
+	return name->name[CHAPTER_INDEX_BYTES_OFFSET] | RECORD_SLOT_TAG;
 }
 
 int make_open_chapter(const struct geometry *geometry,
@@ -70,11 +106,10 @@ int make_open_chapter(const struct geometry *geometry,
 	size_t capacity = geometry->records_per_chapter / zone_count;
 	size_t slot_count = (1 << bits_per(capacity * LOAD_RATIO));
 
-	result = UDS_ALLOCATE_EXTENDED(struct open_chapter_zone,
-				       slot_count,
-				       struct open_chapter_zone_slot,
-				       "open chapter",
-				       &open_chapter);
+	/* The hash slots must make up at least one complete group. */
+	slot_count = max(slot_count, (size_t) OPEN_CHAPTER_GROUP_SLOTS);
+
+	result = UDS_ALLOCATE(1, struct open_chapter_zone, "open chapter", &open_chapter);
 	if (result != UDS_SUCCESS)
 		return result;
 
@@ -88,6 +123,14 @@ int make_open_chapter(const struct geometry *geometry,
 		return result;
 	}
 
+	result = uds_allocate_cache_aligned(groups_size(slot_count),
+					    "open chapter hash slots",
+					    &open_chapter->groups);
+	if (result != UDS_SUCCESS) {
+		free_open_chapter(open_chapter);
+		return result;
+	}
+
 	*open_chapter_ptr = open_chapter;
 	return UDS_SUCCESS;
 }
@@ -98,42 +141,54 @@ void reset_open_chapter(struct open_chapter_zone *open_chapter)
 	open_chapter->deletions = 0;
 
 	memset(open_chapter->records, 0, records_size(open_chapter));
-	memset(open_chapter->slots, 0, slots_size(open_chapter->slot_count));
+	memset(open_chapter->groups, 0, groups_size(open_chapter->slot_count));
 }
 
 static unsigned int
 probe_chapter_slots(struct open_chapter_zone *open_chapter, const struct uds_record_name *name)
 {
-	struct uds_volume_record *record;
-	unsigned int slot_count = open_chapter->slot_count;
-	unsigned int slot = name_to_hash_slot(name, slot_count);
-	unsigned int record_number;
+	unsigned int group_count = open_chapter->slot_count / OPEN_CHAPTER_GROUP_SLOTS;
+	unsigned int slot = name_to_hash_slot(name, open_chapter->slot_count);
+	unsigned int group_number = slot / OPEN_CHAPTER_GROUP_SLOTS;
+	unsigned int home = slot % OPEN_CHAPTER_GROUP_SLOTS;
+	u8 tag = name_to_slot_tag(name);
 	unsigned int attempts = 1;
 
 	while (true) {
-		record_number = open_chapter->slots[slot].record_number;
-
-		/*
-		 * If the hash slot is empty, we've reached the end of a chain without finding the
-		 * record and should terminate the search.
-		 */
-		if (record_number == 0)
-			return slot;
+		struct open_chapter_slot_group *group = &open_chapter->groups[group_number];
+		unsigned int first_slot = group_number * OPEN_CHAPTER_GROUP_SLOTS;
+		unsigned int i;
+
+		for (i = 0; i < OPEN_CHAPTER_GROUP_SLOTS; i++) {
+			unsigned int index = (home + i) % OPEN_CHAPTER_GROUP_SLOTS;
+			unsigned int record_number;
+
+			/*
+			 * If a hash slot is empty, we've reached the end of a chain without
+			 * finding the record and should terminate the search.
+			 */
+			if (group->tags[index] == 0)
+				return first_slot + index;
+
+			/*
+			 * Only a slot with a matching tag can reference the requested name.
+			 * (Deleted records never have matching tags.)
+			 */
+			if (group->tags[index] != tag)
+				continue;
 
-		/*
-		 * If the name of the record referenced by the slot matches and has not been
-		 * deleted, then we've found the requested name.
-		 */
-		record = &open_chapter->records[record_number];
-		if ((memcmp(&record->name, name, UDS_RECORD_NAME_SIZE) == 0) &&
-		    !open_chapter->slots[record_number].deleted)
-			return slot;
+			record_number = group->slots[index].record_number;
+			if (memcmp(&open_chapter->records[record_number].name,
+				   name,
+				   UDS_RECORD_NAME_SIZE) == 0)
+				return first_slot + index;
+		}
 
 		/*
-		 * Quadratic probing: advance the probe by 1, 2, 3, etc. and try again. This
-		 * performs better than linear probing and works best for 2^N slots.
+		 * Quadratic probing: advance the probe by 1, 2, 3, etc. groups and try again.
+		 * This performs better than linear probing and works best for 2^N groups.
 		 */
-		slot = (slot + attempts++) % slot_count;
+		group_number = (group_number + attempts++) % group_count;
 	}
 }
 
@@ -146,7 +201,7 @@ void search_open_chapter(struct open_chapter_zone *open_chapter,
 	unsigned int record_number;
 
 	slot = probe_chapter_slots(open_chapter, name);
-	record_number = open_chapter->slots[slot].record_number;
+	record_number = get_slot(open_chapter, slot)->record_number;
 	if (record_number == 0) {
 		*found = false;
 	} else {
@@ -168,11 +223,12 @@ int put_open_chapter(struct open_chapter_zone *open_chapter,
 		return 0;
 
 	slot = probe_chapter_slots(open_chapter, name);
-	record_number = open_chapter->slots[slot].record_number;
+	record_number = get_slot(open_chapter, slot)->record_number;
 
 	if (record_number == 0) {
 		record_number = ++open_chapter->size;
-		open_chapter->slots[slot].record_number = record_number;
+		get_slot(open_chapter, slot)->record_number = record_number;
+		set_slot_tag(open_chapter, slot, name_to_slot_tag(name));
 	}
 
 	record = &open_chapter->records[record_number];
@@ -189,10 +245,11 @@ void remove_from_open_chapter(struct open_chapter_zone *open_chapter,
 	unsigned int record_number;
 
 	slot = probe_chapter_slots(open_chapter, name);
-	record_number = open_chapter->slots[slot].record_number;
+	record_number = get_slot(open_chapter, slot)->record_number;
 
 	if (record_number > 0) {
-		open_chapter->slots[record_number].deleted = true;
+		get_slot(open_chapter, record_number)->deleted = true;
+		set_slot_tag(open_chapter, slot, DELETED_SLOT_TAG);
 		open_chapter->deletions += 1;
 	}
 }
@@ -200,6 +257,7 @@ void remove_from_open_chapter(struct open_chapter_zone *open_chapter,
 void free_open_chapter(struct open_chapter_zone *open_chapter)
 {
 	if (open_chapter != NULL) {
+		UDS_FREE(open_chapter->groups);
 		UDS_FREE(open_chapter->records);
 		UDS_FREE(open_chapter);
 	}
@@ -250,7 +308,7 @@ static int fill_delta_chapter_index(struct open_chapter_zone **chapter_zones,
 
 		/* Use the fill record in place of an unused record. */
 		if (record_index > open_chapter->size ||
-		    open_chapter->slots[record_index].deleted) {
+		    get_slot(open_chapter, record_index)->deleted) {
 			*record = *fill_record;
 			continue;
 		}
@@ -332,7 +390,7 @@ int save_open_chapter(struct uds_index *index, struct buffered_writer *writer)
 			if (record_index > open_chapter->size)
 				continue;
 
-			if (open_chapter->slots[record_index].deleted)
+			if (get_slot(open_chapter, record_index)->deleted)
 				continue;
 
 			record = &open_chapter->records[record_index];
@@ -19,6 +19,8 @@
 
 enum {
 	OPEN_CHAPTER_RECORD_NUMBER_BITS = 23,
+	/* The number of hash slots in a group, which together fill a cache line */
+	OPEN_CHAPTER_GROUP_SLOTS = 16,
 };
 
 struct open_chapter_zone_slot {
@@ -28,6 +30,13 @@ struct open_chapter_zone_slot {
 	bool deleted : 1;
 } __packed;
 
+struct open_chapter_slot_group {
+	/* The tag of each hash slot, which is zero if the slot is unused */
+	u8 tags[OPEN_CHAPTER_GROUP_SLOTS];
+	/* The hash slots, referencing virtual record numbers */
+	struct open_chapter_zone_slot slots[OPEN_CHAPTER_GROUP_SLOTS];
+};
+
 struct open_chapter_zone {
 	/* The maximum number of records that can be stored */
 	unsigned int capacity;
@@ -39,8 +48,8 @@ struct open_chapter_zone {
 	struct uds_volume_record *records;
 	/* The number of slots in the hash table */
 	unsigned int slot_count;
-	/* The hash table slots, referencing virtual record numbers */
-	struct open_chapter_zone_slot slots[];
+	/* The hash table slots, in cache-aligned groups */
+	struct open_chapter_slot_group *groups;
 };
 
 int __must_check make_open_chapter(const struct geometry *geometry,
@@ -96,6 +96,11 @@ enum {
 	UDS_RECORD_DATA_SIZE = 16,
 };
 
+enum {
+	/* The number of buckets in the histogram of chapter close times */
+	UDS_CHAPTER_CLOSE_BUCKETS = 16,
+};
+
 /*
  * A type representing a UDS memory configuration which is either a positive integer number of
  * gigabytes or one of the six special constants for configurations smaller than one gigabyte.
@@ -151,6 +156,8 @@ struct uds_parameters {
 	unsigned int zone_count;
 	/* The number of threads used to read volume pages */
 	unsigned int read_threads;
+	/* Whether to back the volume index with huge pages */
+	bool huge_pages;
 };
 
 /*
@@ -199,6 +206,20 @@ struct uds_index_stats {
 	u64 queries_not_found;
 	/* The total number of requests processed */
 	u64 requests;
+	/* The number of chapter index page lookups which found the page in the page cache */
+	u64 index_page_hits;
+	/* The number of chapter index page lookups which had to read the page */
+	u64 index_page_misses;
+	/* The number of record page lookups which found the page in the page cache */
+	u64 record_page_hits;
+	/* The number of record page lookups which had to read the page */
+	u64 record_page_misses;
+	/*
+	 * A histogram of the time taken to write each closed chapter. The first bucket counts
+	 * chapters which took less than a millisecond, bucket N counts those which took at least
+	 * 2^(N-1) milliseconds but less than 2^N, and the last bucket also counts any longer ones.
+	 */
+	u64 chapter_close_times[UDS_CHAPTER_CLOSE_BUCKETS];
 };
 
 enum uds_index_region {
@@ -341,4 +362,11 @@ uds_get_index_stats(struct uds_index_session *session, struct uds_index_stats *s
 /* This function will fail if any required field of the request is not set. */
 int __must_check uds_launch_request(struct uds_request *request);
 
+/*
+ * Launch several requests on the same index session at once. This is equivalent to launching each
+ * of them with uds_launch_request(), but queues them with one operation per index zone. If this
+ * function fails, none of the requests have been launched.
+ */
+int __must_check uds_launch_requests(struct uds_request **requests, unsigned int count);
+
 #endif /* UDS_H */
@@ -19,6 +19,7 @@
 #include "logger.h"
 #include "memory-alloc.h"
 #include "permassert.h"
+#include "time-utils.h"
 #include "uds.h"
 #include "uds-threads.h"
 
@@ -1175,29 +1176,138 @@ static int finish_restoring_volume_index(struct volume_index *volume_index,
 	return result;
 }
 
+/* The state of the save or restore of one zone's stream on its own thread. */
+struct zone_stream {
+	struct volume_index *volume_index;
+	unsigned int zone_number;
+	struct buffered_reader *reader;
+	struct buffered_writer *writer;
+	struct thread *thread;
+	int result;
+};
+
+/*
+ * Run the save or restore of every zone stream, each on its own thread. The first stream is
+ * handled by the calling thread, as is any stream for which a thread could not be started.
+ */
+static int run_zone_streams(struct zone_stream *streams,
+			    unsigned int stream_count,
+			    void (*stream_function)(void *),
+			    const char *name)
+{
+	int result;
+	unsigned int z;
+
+	for (z = 1; z < stream_count; z++) {
+		result = uds_create_thread(stream_function, &streams[z], name, &streams[z].thread);
+		if (result != UDS_SUCCESS) {
+			streams[z].thread = NULL;
+			stream_function(&streams[z]);
+		}
+	}
+
+	stream_function(&streams[0]);
+
+	for (z = 1; z < stream_count; z++) {
+		if (streams[z].thread != NULL)
+			uds_join_threads(streams[z].thread);
+	}
+
+	for (z = 0; z < stream_count; z++) {
+		if (streams[z].result != UDS_SUCCESS)
+			return streams[z].result;
+	}
+
+	return UDS_SUCCESS;
+}
+
+static void restore_volume_index_zone(void *arg)
+{
+	struct zone_stream *stream = arg;
+	struct volume_index *volume_index = stream->volume_index;
+	int result;
+
+	result = finish_restoring_delta_index_zone(&volume_index->vi_non_hook.delta_index,
+						   stream->reader,
+						   stream->zone_number);
+	if ((result == UDS_SUCCESS) && has_sparse(volume_index))
+		result = finish_restoring_delta_index_zone(&volume_index->vi_hook.delta_index,
+							   stream->reader,
+							   stream->zone_number);
+
+	/* Check the final guard list to make sure we read everything. */
+	if (result == UDS_SUCCESS)
+		result = check_guard_delta_lists(&stream->reader, 1);
+
+	stream->result = result;
+}
+
+/* Restore each zone from its own stream, with all the zones loading concurrently. */
+static int restore_volume_index_zones(struct volume_index *volume_index,
+				      struct buffered_reader **readers,
+				      unsigned int num_readers)
+{
+	int result;
+	unsigned int z;
+	struct zone_stream *streams;
+
+	result = UDS_ALLOCATE(num_readers, struct zone_stream, __func__, &streams);
+	if (result != UDS_SUCCESS)
+		return result;
+
+	for (z = 0; z < num_readers; z++) {
+		streams[z].volume_index = volume_index;
+		streams[z].zone_number = z;
+		streams[z].reader = readers[z];
+	}
+
+	result = run_zone_streams(streams, num_readers, restore_volume_index_zone, "loadvi");
+	UDS_FREE(streams);
+	return result;
+}
+
 int load_volume_index(struct volume_index *volume_index,
 		      struct buffered_reader **readers,
 		      unsigned int num_readers)
 {
 	int result;
+	ktime_t start = current_time_ns(CLOCK_MONOTONIC);
 
 	/* Start by reading the header section of the stream. */
 	result = start_restoring_volume_index(volume_index, readers, num_readers);
 	if (result != UDS_SUCCESS)
 		return result;
 
-	result = finish_restoring_volume_index(volume_index, readers, num_readers);
-	if (result != UDS_SUCCESS) {
-		abort_restoring_volume_index(volume_index);
-		return result;
-	}
+	/*
+	 * A stream only holds the lists of a single zone when the index was saved with the same
+	 * zone count it is being loaded with, and only then can the zones be restored in parallel.
+	 */
+	if (num_readers == volume_index->num_zones) {
+		result = restore_volume_index_zones(volume_index, readers, num_readers);
+		if (result != UDS_SUCCESS) {
+			abort_restoring_volume_index(volume_index);
+			return result;
+		}
+	} else {
+		result = finish_restoring_volume_index(volume_index, readers, num_readers);
+		if (result != UDS_SUCCESS) {
+			abort_restoring_volume_index(volume_index);
+			return result;
+		}
 
-	/* Check the final guard lists to make sure we read everything. */
-	result = check_guard_delta_lists(readers, num_readers);
-	if (result != UDS_SUCCESS)
-		abort_restoring_volume_index(volume_index);
+		/* Check the final guard lists to make sure we read everything. */
+		result = check_guard_delta_lists(readers, num_readers);
+		if (result != UDS_SUCCESS) {
+			abort_restoring_volume_index(volume_index);
+			return result;
+		}
+	}
 
-	return result;
+	uds_log_info("loaded volume index from %u zone%s in %lld ms",
+		     num_readers,
+		     (num_readers == 1) ? "" : "s",
+		     (long long) ktime_to_ms(ktime_sub(current_time_ns(CLOCK_MONOTONIC), start)));
+	return UDS_SUCCESS;
 }
 
 static int __must_check
@@ -1366,32 +1476,56 @@ finish_saving_volume_index(const struct volume_index *volume_index, unsigned int
 	return result;
 }
 
+static void save_volume_index_zone(void *arg)
+{
+	struct zone_stream *stream = arg;
+	int result;
+
+	result = start_saving_volume_index(stream->volume_index,
+					   stream->zone_number,
+					   stream->writer);
+	if (result == UDS_SUCCESS)
+		result = finish_saving_volume_index(stream->volume_index, stream->zone_number);
+
+	if (result == UDS_SUCCESS)
+		result = write_guard_delta_list(stream->writer);
+
+	if (result == UDS_SUCCESS)
+		result = flush_buffered_writer(stream->writer);
+
+	stream->result = result;
+}
+
 int save_volume_index(struct volume_index *volume_index,
 		      struct buffered_writer **writers,
 		      unsigned int num_writers)
 {
-	int result = UDS_SUCCESS;
-	unsigned int zone;
-
-	for (zone = 0; zone < num_writers; ++zone) {
-		result = start_saving_volume_index(volume_index, zone, writers[zone]);
-		if (result != UDS_SUCCESS)
-			break;
-
-		result = finish_saving_volume_index(volume_index, zone);
-		if (result != UDS_SUCCESS)
-			break;
+	int result;
+	unsigned int z;
+	struct zone_stream *streams;
+	ktime_t start = current_time_ns(CLOCK_MONOTONIC);
 
-		result = write_guard_delta_list(writers[zone]);
-		if (result != UDS_SUCCESS)
-			break;
+	result = UDS_ALLOCATE(num_writers, struct zone_stream, __func__, &streams);
+	if (result != UDS_SUCCESS)
+		return result;
 
-		result = flush_buffered_writer(writers[zone]);
-		if (result != UDS_SUCCESS)
-			break;
+	for (z = 0; z < num_writers; z++) {
+		streams[z].volume_index = volume_index;
+		streams[z].zone_number = z;
+		streams[z].writer = writers[z];
 	}
 
-	return result;
+	/* Each zone writes its own stream, so all the zones are saved concurrently. */
+	result = run_zone_streams(streams, num_writers, save_volume_index_zone, "savevi");
+	UDS_FREE(streams);
+	if (result != UDS_SUCCESS)
+		return result;
+
+	uds_log_info("saved volume index to %u zone%s in %lld ms",
+		     num_writers,
+		     (num_writers == 1) ? "" : "s",
+		     (long long) ktime_to_ms(ktime_sub(current_time_ns(CLOCK_MONOTONIC), start)));
+	return UDS_SUCCESS;
 }
 
 static void get_volume_sub_index_stats(const struct volume_sub_index *sub_index,
@@ -1477,6 +1611,7 @@ static int initialize_volume_sub_index(const struct configuration *config,
 					params.mean_delta,
 					params.chapter_bits,
 					params.memory_size,
+					config->huge_pages,
 					tag);
 	if (result != UDS_SUCCESS)
 		return result;
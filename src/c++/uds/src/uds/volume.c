@@ -46,16 +46,23 @@
  * volume uses the index page map to determine which chapter index page needs to be loaded, and
  * then reads the relevant record page number from the chapter index. Both index and record pages
  * are stored in a page cache when read for the common case that subsequent records need the same
- * pages. The page cache evicts the least recently accessed entries when caching new pages. In
- * addition, the volume uses dm-bufio to manage access to the storage, which may allow for
- * additional caching depending on available system resources.
+ * pages. The page cache is a segmented LRU: a newly cached page is probationary, and becomes
+ * protected if it is used again. New pages replace the least recently used probationary page, so a
+ * burst of lookups which each touch a page only once (such as a run of sparse chapter hits) cannot
+ * flush the chapter index pages that steady-state lookups depend on. When too many pages are
+ * protected, the least recently used protected page of whichever page type has more protected
+ * pages is demoted, so index pages and record pages cannot crowd each other out. In addition, the
+ * volume uses dm-bufio to manage access to the storage, which may allow for additional caching
+ * depending on available system resources.
  *
  * Record requests are handled from cached pages when possible. If a page needs to be read, it is
  * placed on a queue along with the request that wants to read it. Any requests for the same page
  * that arrive while the read is pending are added to the queue entry. A separate reader thread
  * handles the queued reads, adding the page to the cache and updating any requests queued with it
  * so they can continue processing. This allows the index zone threads to continue processing new
- * requests rather than wait for the storage reads.
+ * requests rather than wait for the storage reads. Before a reader thread reads its page, it starts
+ * prefetches of the pages for other queued reads which no reader has claimed yet, so that the
+ * storage can work on many reads at once rather than one per reader thread.
  *
  * When an index rebuild is necessary, the volume reads each stored chapter to determine which
  * range of chapters contain valid records, so that those records can be used to reconstruct the
@@ -65,6 +72,8 @@
 enum {
 	/* The maximum allowable number of contiguous bad chapters */
 	MAX_BAD_CHAPTERS = 100,
+	/* The number of queued reads beyond those claimed by reader threads to prefetch */
+	MAX_PREFETCHED_READS = 64,
 };
 
 #ifdef TEST_INTERNAL
@@ -89,7 +98,7 @@ map_to_chapter_number(struct geometry *geometry, unsigned int physical_page)
 	return (physical_page - 1) / geometry->pages_per_chapter;
 }
 
-static inline bool is_record_page(struct geometry *geometry, unsigned int physical_page)
+static inline bool is_record_page(const struct geometry *geometry, unsigned int physical_page)
 {
 	return ((physical_page - 1) % geometry->pages_per_chapter) >=
 	       geometry->index_pages_per_chapter;
@@ -121,6 +130,7 @@ static void clear_cache_page(struct page_cache *cache, struct cached_page *page)
 	release_page_buffer(page);
 	page->cp_physical_page = cache->num_index_entries;
 	WRITE_ONCE(page->cp_last_used, 0);
+	WRITE_ONCE(page->cp_protected, false);
 }
 
 static void get_page_and_index(struct page_cache *cache,
@@ -218,6 +228,8 @@ static int __must_check initialize_page_cache(struct page_cache *cache,
 	cache->geometry = geometry;
 	cache->num_index_entries = geometry->pages_per_volume + 1;
 	cache->num_cache_entries = chapters_in_cache * geometry->record_pages_per_chapter;
+	/* Leave a quarter of the cache for pages which have not yet been used twice. */
+	cache->protected_limit = (cache->num_cache_entries * 3) / 4;
 	cache->zone_count = zone_count;
 	atomic64_set(&cache->clock, 1);
 
@@ -235,6 +247,13 @@ static int __must_check initialize_page_cache(struct page_cache *cache,
 	if (result != UDS_SUCCESS)
 		return result;
 
+	result = UDS_ALLOCATE(cache->zone_count,
+			      struct page_cache_stats,
+			      "page cache stats",
+			      &cache->zone_stats);
+	if (result != UDS_SUCCESS)
+		return result;
+
 	result = ASSERT((cache->num_cache_entries <= VOLUME_CACHE_MAX_ENTRIES),
 			"requested cache size, %u, within limit %u",
 			cache->num_cache_entries,
@@ -299,6 +318,7 @@ void free_page_cache(struct page_cache *cache)
 	UDS_FREE(cache->index);
 	UDS_FREE(cache->cache);
 	UDS_FREE(cache->search_pending_counters);
+	UDS_FREE(cache->zone_stats);
 	UDS_FREE(cache->read_queue);
 	UDS_FREE(cache);
 }
@@ -326,44 +346,88 @@ void invalidate_page_cache_for_chapter(struct page_cache *cache,
 		invalidate_page(cache, page_offset + i);
 }
 
+static void touch_page(struct page_cache *cache, struct cached_page *page)
+{
+	if (atomic64_read(&cache->clock) != READ_ONCE(page->cp_last_used))
+		WRITE_ONCE(page->cp_last_used,
+			   atomic64_inc_return(&cache->clock));
+}
+
+/* Protect a page which has been used again since it was cached. */
+static void protect_page(struct page_cache *cache, struct cached_page *page)
+{
+	if ((cache->protected_limit > 0) && !READ_ONCE(page->cp_protected))
+		WRITE_ONCE(page->cp_protected, true);
+}
+
 EXTERNAL_STATIC void make_page_most_recent(struct page_cache *cache, struct cached_page *page)
 {
 	/*
 	 * ASSERTION: We are either a zone thread holding a search_pending_counter, or we are any
 	 * thread holding the read_threads_mutex.
 	 */
-	if (atomic64_read(&cache->clock) != READ_ONCE(page->cp_last_used))
-		WRITE_ONCE(page->cp_last_used,
-			   atomic64_inc_return(&cache->clock));
+	protect_page(cache, page);
+	touch_page(cache, page);
+}
+
+static inline bool is_older_page(const struct cached_page *page, const struct cached_page *oldest)
+{
+	return ((oldest == NULL) ||
+		(READ_ONCE(page->cp_last_used) <= READ_ONCE(oldest->cp_last_used)));
 }
 
 static int __must_check
 get_least_recent_page(struct page_cache *cache, struct cached_page **page_ptr)
 {
 	/* We hold the read_threads_mutex. */
-	int oldest_index = 0;
+	struct cached_page *oldest = NULL;
+	/* The least recent protected index page and record page */
+	struct cached_page *oldest_protected[2] = { NULL, NULL };
+	unsigned int protected_count[2] = { 0, 0 };
 	unsigned int i;
+	bool is_record;
 
-	for (i = 0;; i++) {
-		if (i >= cache->num_cache_entries)
-			/* This should never happen. */
-			return ASSERT(false, "oldest page is not NULL");
+	for (i = 0; i < cache->num_cache_entries; i++) {
+		struct cached_page *page = &cache->cache[i];
 
 		/* A page with a pending read must not be replaced. */
-		if (!cache->cache[i].cp_read_pending) {
-			oldest_index = i;
-			break;
+		if (page->cp_read_pending)
+			continue;
+
+		if (!READ_ONCE(page->cp_protected)) {
+			if (is_older_page(page, oldest))
+				oldest = page;
+			continue;
 		}
+
+		is_record = is_record_page(cache->geometry, page->cp_physical_page);
+		protected_count[is_record]++;
+		if (is_older_page(page, oldest_protected[is_record]))
+			oldest_protected[is_record] = page;
 	}
 
-	for (i = 0; i < cache->num_cache_entries; i++) {
-		if (!cache->cache[i].cp_read_pending &&
-		    (READ_ONCE(cache->cache[i].cp_last_used) <=
-		     READ_ONCE(cache->cache[oldest_index].cp_last_used)))
-			oldest_index = i;
+	if (protected_count[0] + protected_count[1] > cache->protected_limit) {
+		struct cached_page *demoted;
+
+		is_record = (protected_count[1] >= protected_count[0]);
+		demoted = oldest_protected[is_record];
+		WRITE_ONCE(demoted->cp_protected, false);
+		if (is_older_page(demoted, oldest))
+			oldest = demoted;
+	}
+
+	if (oldest == NULL) {
+		/* Every page is protected, so replace the least recent of them. */
+		oldest = oldest_protected[0];
+		if ((oldest_protected[1] != NULL) && is_older_page(oldest_protected[1], oldest))
+			oldest = oldest_protected[1];
 	}
 
-	*page_ptr = &cache->cache[oldest_index];
+	if (oldest == NULL)
+		/* This should never happen. */
+		return ASSERT(false, "oldest page is not NULL");
+
+	*page_ptr = oldest;
 	return UDS_SUCCESS;
 }
 
@@ -426,7 +490,7 @@ put_page_in_cache(struct page_cache *cache, unsigned int physical_page, struct c
 	if (result != UDS_SUCCESS)
 		return result;
 
-	make_page_most_recent(cache, page);
+	touch_page(cache, page);
 	page->cp_read_pending = false;
 
 	/*
@@ -491,6 +555,7 @@ enqueue_read(struct page_cache *cache, struct uds_request *request, unsigned int
 		/* Fill in the read queue entry. */
 		cache->read_queue[last].physical_page = physical_page;
 		cache->read_queue[last].invalid = false;
+		cache->read_queue[last].prefetched = false;
 		cache->read_queue[last].first_request = NULL;
 		cache->read_queue[last].last_request = NULL;
 
@@ -632,6 +697,40 @@ static inline struct queued_read *wait_to_reserve_read_queue_entry(struct volume
 	return queue_entry;
 }
 
+/*
+ * Start reading the pages of the queued reads which are next in line to be claimed by a reader
+ * thread.
+ */
+static void prefetch_queued_reads(struct volume *volume)
+{
+	/* We hold the read_threads_mutex. */
+	struct page_cache *cache = volume->page_cache;
+	unsigned int pages[MAX_PREFETCHED_READS];
+	unsigned int count = 0;
+	unsigned int i;
+	u16 position = cache->read_queue_last_read;
+
+	for (i = 0;
+	     (i < MAX_PREFETCHED_READS) && (position != cache->read_queue_last);
+	     i++, advance_queue_position(&position)) {
+		struct queued_read *entry = &cache->read_queue[position];
+
+		if (entry->prefetched || entry->invalid)
+			continue;
+
+		entry->prefetched = true;
+		pages[count++] = entry->physical_page;
+	}
+
+	if (count == 0)
+		return;
+
+	uds_unlock_mutex(&volume->read_threads_mutex);
+	for (i = 0; i < count; i++)
+		dm_bufio_prefetch(volume->client, pages[i], 1);
+	uds_lock_mutex(&volume->read_threads_mutex);
+}
+
 static int init_chapter_index_page(const struct volume *volume,
 				   u8 *index_page,
 				   unsigned int chapter,
@@ -878,6 +977,8 @@ static void read_thread_function(void *arg)
 		if ((volume->reader_state & READER_STATE_EXIT) != 0)
 			break;
 
+		prefetch_queued_reads(volume);
+
 		result = process_entry(volume, queue_entry);
 		release_queued_requests(volume, queue_entry, result);
 	}
@@ -957,6 +1058,36 @@ EXTERNAL_STATIC int get_volume_page_locked(struct volume *volume,
 	return UDS_SUCCESS;
 }
 
+static inline void count_once(u64 *count_ptr)
+{
+	WRITE_ONCE(*count_ptr, READ_ONCE(*count_ptr) + 1);
+}
+
+/* Count a page lookup. Each zone's counts are only updated by that zone's thread. */
+static void count_page_lookup(struct page_cache *cache,
+			      unsigned int zone_number,
+			      unsigned int physical_page,
+			      bool hit)
+{
+	struct page_cache_stats *stats = &cache->zone_stats[zone_number];
+
+	if (is_record_page(cache->geometry, physical_page))
+		count_once(hit ? &stats->record_page_hits : &stats->record_page_misses);
+	else
+		count_once(hit ? &stats->index_page_hits : &stats->index_page_misses);
+}
+
+/*
+ * A requeued request repeats the lookup it was queued for unless the reader thread has already
+ * searched that page for it. The repeat is not a new use of the page, so it is neither counted nor
+ * allowed to protect the page.
+ */
+static inline bool is_repeated_lookup(const struct uds_request *request)
+{
+	return ((request != NULL) && request->requeued &&
+		(request->location != UDS_LOCATION_INDEX_PAGE_LOOKUP));
+}
+
 /* Retrieve a page from the cache while holding a search_pending lock. */
 EXTERNAL_STATIC int get_volume_page_protected(struct volume *volume,
 					      struct uds_request *request,
@@ -966,14 +1097,23 @@ EXTERNAL_STATIC int get_volume_page_protected(struct volume *volume,
 	int result;
 	unsigned int zone_number;
 	struct cached_page *page = NULL;
+	bool repeated = is_repeated_lookup(request);
 
 	get_page_from_cache(volume->page_cache, physical_page, &page);
 
 	zone_number = get_zone_number(request);
 	if (page != NULL) {
+		if (repeated) {
+			*page_ptr = page;
+			return UDS_SUCCESS;
+		}
+
+		count_page_lookup(volume->page_cache, zone_number, physical_page, true);
 		if (zone_number == 0)
 			/* Only one zone is allowed to update the LRU. */
 			make_page_most_recent(volume->page_cache, page);
+		else
+			protect_page(volume->page_cache, page);
 
 		*page_ptr = page;
 		return UDS_SUCCESS;
@@ -992,6 +1132,9 @@ EXTERNAL_STATIC int get_volume_page_protected(struct volume *volume,
 	 * the same page.
 	 */
 	get_page_from_cache(volume->page_cache, physical_page, &page);
+	if (!repeated)
+		count_page_lookup(volume->page_cache, zone_number, physical_page, (page != NULL));
+
 	if (page == NULL) {
 		result = read_page_locked(volume, request, physical_page, &page);
 		if (result != UDS_SUCCESS) {
@@ -1438,7 +1581,7 @@ int write_record_pages(struct volume *volume,
 	struct dm_buffer *page_buffer;
 	const struct uds_volume_record *next_record = records;
 
-	/* Skip over the index pages, which have already been written. */
+	/* The record pages follow the index pages, which may still be being written. */
 	physical_page += geometry->index_pages_per_chapter;
 
 	for (record_page_number = 0;
@@ -1481,6 +1624,70 @@ int write_record_pages(struct volume *volume,
 	return UDS_SUCCESS;
 }
 
+/* This is the driver function for the record page writer thread. */
+static void write_record_pages_function(void *arg)
+{
+	struct volume *volume = arg;
+	struct record_page_writer *writer = &volume->record_writer;
+
+	uds_log_debug("record page writer starting");
+	uds_lock_mutex(&writer->mutex);
+	for (;;) {
+		const struct uds_volume_record *records;
+		int physical_page;
+		int result;
+
+		while ((writer->records == NULL) && !writer->stop)
+			uds_wait_cond(&writer->cond, &writer->mutex);
+
+		if (writer->records == NULL)
+			break;
+
+		records = writer->records;
+		physical_page = writer->physical_page;
+		uds_unlock_mutex(&writer->mutex);
+		result = write_record_pages(volume, physical_page, records, NULL);
+		uds_lock_mutex(&writer->mutex);
+		writer->result = result;
+		writer->records = NULL;
+		uds_broadcast_cond(&writer->cond);
+	}
+
+	uds_unlock_mutex(&writer->mutex);
+	uds_log_debug("record page writer stopping");
+}
+
+static void start_record_pages(struct volume *volume,
+			       int physical_page,
+			       const struct uds_volume_record *records)
+{
+	struct record_page_writer *writer = &volume->record_writer;
+
+	uds_lock_mutex(&writer->mutex);
+	writer->physical_page = physical_page;
+	writer->records = records;
+	uds_broadcast_cond(&writer->cond);
+	uds_unlock_mutex(&writer->mutex);
+}
+
+static int finish_record_pages(struct volume *volume)
+{
+	int result;
+	struct record_page_writer *writer = &volume->record_writer;
+
+	uds_lock_mutex(&writer->mutex);
+	while (writer->records != NULL)
+		uds_wait_cond(&writer->cond, &writer->mutex);
+	result = writer->result;
+	uds_unlock_mutex(&writer->mutex);
+	return result;
+}
+
+/*
+ * The index pages and the record pages of a chapter are independent of each other, so the record
+ * pages are sorted, encoded, and written by the record page writer thread while this thread packs
+ * and writes the index pages. The chapter is synced once both are done.
+ */
 int write_chapter(struct volume *volume,
 		  struct open_chapter_index *chapter_index,
 		  const struct uds_volume_record *records)
@@ -1490,14 +1697,16 @@ int write_chapter(struct volume *volume,
 		map_to_physical_chapter(geometry, chapter_index->virtual_chapter_number);
 	int physical_page = map_to_physical_page(geometry, physical_chapter_number, 0);
 	int result;
+	int record_result;
 
+	start_record_pages(volume, physical_page, records);
 	result = write_index_pages(volume, physical_page, chapter_index, NULL);
+	record_result = finish_record_pages(volume);
 	if (result != UDS_SUCCESS)
 		return result;
 
-	result = write_record_pages(volume, physical_page, records, NULL);
-	if (result != UDS_SUCCESS)
-		return result;
+	if (record_result != UDS_SUCCESS)
+		return record_result;
 
 	result = -dm_bufio_write_dirty_buffers(volume->client);
 	if (result != UDS_SUCCESS)
@@ -1515,6 +1724,22 @@ size_t get_cache_size(struct volume *volume)
 	return size;
 }
 
+void get_page_cache_stats(const struct volume *volume, struct page_cache_stats *stats)
+{
+	const struct page_cache *cache = volume->page_cache;
+	unsigned int z;
+
+	memset(stats, 0, sizeof(*stats));
+	for (z = 0; z < cache->zone_count; z++) {
+		const struct page_cache_stats *zone_stats = &cache->zone_stats[z];
+
+		stats->index_page_hits += READ_ONCE(zone_stats->index_page_hits);
+		stats->index_page_misses += READ_ONCE(zone_stats->index_page_misses);
+		stats->record_page_hits += READ_ONCE(zone_stats->record_page_hits);
+		stats->record_page_misses += READ_ONCE(zone_stats->record_page_misses);
+	}
+}
+
 static int probe_chapter(struct volume *volume,
 			 unsigned int chapter_number,
 			 u64 *virtual_chapter_number)
@@ -1930,6 +2155,27 @@ int make_volume(const struct configuration *config,
 		return result;
 	}
 
+	result = uds_init_mutex(&volume->record_writer.mutex);
+	if (result != UDS_SUCCESS) {
+		free_volume(volume);
+		return result;
+	}
+
+	result = uds_init_cond(&volume->record_writer.cond);
+	if (result != UDS_SUCCESS) {
+		free_volume(volume);
+		return result;
+	}
+
+	result = uds_create_thread(write_record_pages_function,
+				   (void *) volume,
+				   "recwriter",
+				   &volume->record_writer.thread);
+	if (result != UDS_SUCCESS) {
+		free_volume(volume);
+		return result;
+	}
+
 	for (i = 0; i < config->read_threads; i++) {
 		result = uds_create_thread(read_thread_function,
 					   (void *) volume,
@@ -1966,6 +2212,15 @@ void free_volume(struct volume *volume)
 		volume->reader_threads = NULL;
 	}
 
+	if (volume->record_writer.thread != NULL) {
+		uds_lock_mutex(&volume->record_writer.mutex);
+		volume->record_writer.stop = true;
+		uds_broadcast_cond(&volume->record_writer.cond);
+		uds_unlock_mutex(&volume->record_writer.mutex);
+		uds_join_threads(volume->record_writer.thread);
+		volume->record_writer.thread = NULL;
+	}
+
 	/* Must destroy the client AFTER freeing the caches. */
 	free_page_cache(volume->page_cache);
 	free_sparse_cache(volume->sparse_cache);
@@ -1975,6 +2230,8 @@ void free_volume(struct volume *volume)
 	uds_destroy_cond(&volume->read_threads_cond);
 	uds_destroy_cond(&volume->read_threads_read_done_cond);
 	uds_destroy_mutex(&volume->read_threads_mutex);
+	uds_destroy_cond(&volume->record_writer.cond);
+	uds_destroy_mutex(&volume->record_writer.mutex);
 	free_index_page_map(volume->index_page_map);
 	free_radix_sorter(volume->radix_sorter);
 	UDS_FREE(volume->geometry);
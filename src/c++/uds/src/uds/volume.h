@@ -52,6 +52,7 @@ enum {
 struct queued_read {
 	bool invalid;
 	bool reserved;
+	bool prefetched;
 	unsigned int physical_page;
 	struct uds_request *first_request;
 	struct uds_request *last_request;
@@ -83,12 +84,22 @@ struct cached_page {
 	unsigned int cp_physical_page;
 	/* The value of the volume clock when this page was last used */
 	s64 cp_last_used;
+	/* Whether this page has been used again since it was cached */
+	bool cp_protected;
 	/* The cached page buffer */
 	struct dm_buffer *buffer;
 	/* The chapter index page, meaningless for record pages */
 	struct delta_index_page cp_index_page;
 };
 
+/* Page cache hit and miss counts, kept separately for each zone */
+struct __aligned(L1_CACHE_BYTES) page_cache_stats {
+	u64 index_page_hits;
+	u64 index_page_misses;
+	u64 record_page_hits;
+	u64 record_page_misses;
+};
+
 struct page_cache {
 	/* Geometry governing the volume */
 	const struct geometry *geometry;
@@ -98,12 +109,16 @@ struct page_cache {
 	unsigned int num_index_entries;
 	/* The maximum number of cached entries */
 	u16 num_cache_entries;
+	/* The maximum number of entries protected from eviction, or 0 to evict in LRU order */
+	u16 protected_limit;
 	/* An index for each physical page noting where it is in the cache */
 	u16 *index;
 	/* The array of cached pages */
 	struct cached_page *cache;
 	/* A counter for each zone tracking if a search is occurring there */
 	struct search_pending_counter *search_pending_counters;
+	/* The hit and miss counts for each zone */
+	struct page_cache_stats *zone_stats;
 	/* The read queue entries as a circular array */
 	struct queued_read *read_queue;
 
@@ -125,6 +140,24 @@ struct page_cache {
 	atomic64_t clock;
 };
 
+/* A thread which writes the record pages of a chapter while its index pages are being written */
+struct record_page_writer {
+	/* The thread which sorts, encodes, and writes the record pages */
+	struct thread *thread;
+	/* The lock protecting the following fields */
+	struct mutex mutex;
+	/* The condition signalled on state changes */
+	struct cond_var cond;
+	/* The records of the chapter to write, or NULL if there are none */
+	const struct uds_volume_record *records;
+	/* The first physical page of the chapter to write */
+	int physical_page;
+	/* The result from the most recent write */
+	int result;
+	/* Set to true to stop the thread */
+	bool stop;
+};
+
 struct volume {
 	struct geometry *geometry;
 	struct dm_bufio_client *client;
@@ -146,6 +179,8 @@ struct volume {
 	unsigned int num_read_threads;
 	enum reader_state reader_state;
 
+	struct record_page_writer record_writer;
+
 	enum index_lookup_mode lookup_mode;
 	unsigned int reserved_buffers;
 };
@@ -340,6 +375,8 @@ int __must_check get_volume_index_page(struct volume *volume,
 
 size_t __must_check get_cache_size(struct volume *volume);
 
+void get_page_cache_stats(const struct volume *volume, struct page_cache_stats *stats);
+
 int __must_check
 find_volume_chapter_boundaries_impl(unsigned int chapter_limit,
 				    unsigned int max_bad_chapters,
@@ -5,6 +5,7 @@
 
 #include <linux/dm-bufio.h>
 
+#include <aio.h>
 #include <linux/blkdev.h>
 #include <linux/err.h>
 
@@ -19,8 +20,19 @@
  * creating new ones when necessary. When a buffer is marked dirty, the client
  * writes its data immediately so that it can return the buffer to circulation
  * and not have to track unsaved buffers.
+ *
+ * Prefetching starts an asynchronous read of each block into a buffer which
+ * is held until dm_bufio_read() asks for that block, so that a caller can
+ * keep many reads in flight at once. Prefetched buffers are found through a
+ * small hash table, and the oldest ones are discarded once there are too many
+ * of them. Writing a block discards any prefetched copy of it.
  */
 
+enum {
+	MAX_PREFETCHED_BUFFERS = 4096,
+	PREFETCH_HASH_BUCKETS = 1024,
+};
+
 struct dm_buffer;
 
 struct dm_bufio_client {
@@ -31,6 +43,13 @@ struct dm_bufio_client {
 
 	struct mutex buffer_mutex;
 	struct dm_buffer *buffer_list;
+
+	/* These fields are protected by the buffer_mutex. */
+	struct dm_buffer *prefetch_buckets[PREFETCH_HASH_BUCKETS];
+	struct dm_buffer *oldest_prefetch;
+	struct dm_buffer *newest_prefetch;
+	unsigned int prefetch_count;
+	u64 write_count;
 };
 
 struct dm_buffer {
@@ -38,6 +57,11 @@ struct dm_buffer {
 	struct dm_buffer *next;
 	sector_t offset;
 	u8 *data;
+
+	/* These fields are used only while the buffer holds a prefetched block. */
+	struct aiocb aio;
+	struct dm_buffer *older;
+	struct dm_buffer *newer;
 };
 
 struct dm_bufio_client *
@@ -70,10 +94,19 @@ dm_bufio_client_create(struct block_device *bdev,
 	return client;
 }
 
+static void remove_prefetched_buffer(struct dm_buffer *buffer);
+static void discard_prefetched_buffer(struct dm_buffer *buffer);
+
 void dm_bufio_client_destroy(struct dm_bufio_client *client)
 {
 	struct dm_buffer *buffer;
 
+	while (client->oldest_prefetch != NULL) {
+		buffer = client->oldest_prefetch;
+		remove_prefetched_buffer(buffer);
+		discard_prefetched_buffer(buffer);
+	}
+
 	while (client->buffer_list != NULL) {
 		buffer = client->buffer_list;
 		client->buffer_list = buffer->next;
@@ -127,22 +160,148 @@ void *dm_bufio_new(struct dm_bufio_client *client,
 	return buffer->data;
 }
 
+static inline struct dm_buffer **get_prefetch_bucket(struct dm_bufio_client *client,
+						     sector_t offset)
+{
+	return &client->prefetch_buckets[(offset / client->bytes_per_page) %
+					 PREFETCH_HASH_BUCKETS];
+}
+
+/* Find a prefetched buffer, with the buffer_mutex held. */
+static struct dm_buffer *find_prefetched_buffer(struct dm_bufio_client *client,
+						sector_t offset)
+{
+	struct dm_buffer *buffer;
+
+	for (buffer = *get_prefetch_bucket(client, offset);
+	     buffer != NULL;
+	     buffer = buffer->next) {
+		if (buffer->offset == offset)
+			return buffer;
+	}
+
+	return NULL;
+}
+
+/* Remove a prefetched buffer from the client, with the buffer_mutex held. */
+static void remove_prefetched_buffer(struct dm_buffer *buffer)
+{
+	struct dm_bufio_client *client = buffer->client;
+	struct dm_buffer **link = get_prefetch_bucket(client, buffer->offset);
+
+	while (*link != buffer)
+		link = &(*link)->next;
+	*link = buffer->next;
+
+	if (buffer->older == NULL)
+		client->oldest_prefetch = buffer->newer;
+	else
+		buffer->older->newer = buffer->newer;
+
+	if (buffer->newer == NULL)
+		client->newest_prefetch = buffer->older;
+	else
+		buffer->newer->older = buffer->older;
+
+	client->prefetch_count--;
+}
+
+/* Add a prefetched buffer to the client, with the buffer_mutex held. */
+static void add_prefetched_buffer(struct dm_buffer *buffer)
+{
+	struct dm_bufio_client *client = buffer->client;
+	struct dm_buffer **bucket = get_prefetch_bucket(client, buffer->offset);
+
+	buffer->next = *bucket;
+	*bucket = buffer;
+
+	buffer->older = client->newest_prefetch;
+	buffer->newer = NULL;
+	if (client->newest_prefetch == NULL)
+		client->oldest_prefetch = buffer;
+	else
+		client->newest_prefetch->newer = buffer;
+	client->newest_prefetch = buffer;
+
+	client->prefetch_count++;
+}
+
+/* Wait for the asynchronous read of a removed prefetched buffer to finish. */
+static int finish_prefetch(struct dm_buffer *buffer, size_t *read_length)
+{
+	const struct aiocb *reads[] = { &buffer->aio };
+	ssize_t bytes_read;
+	int result;
+
+	while ((result = aio_error(&buffer->aio)) == EINPROGRESS)
+		aio_suspend(reads, 1, NULL);
+
+	bytes_read = aio_return(&buffer->aio);
+	if (result != 0)
+		return result;
+
+	*read_length = bytes_read;
+	return UDS_SUCCESS;
+}
+
+/* Release a prefetched buffer which has been removed from the client. */
+static void discard_prefetched_buffer(struct dm_buffer *buffer)
+{
+	size_t read_length;
+
+	finish_prefetch(buffer, &read_length);
+	dm_bufio_release(buffer);
+}
+
+/* Discard any prefetched copies of a block which has been rewritten. */
+static void discard_prefetched_block(struct dm_bufio_client *client, sector_t offset)
+{
+	struct dm_buffer *buffer;
+
+	for (;;) {
+		uds_lock_mutex(&client->buffer_mutex);
+		client->write_count++;
+		buffer = find_prefetched_buffer(client, offset);
+		if (buffer != NULL)
+			remove_prefetched_buffer(buffer);
+		uds_unlock_mutex(&client->buffer_mutex);
+
+		if (buffer == NULL)
+			return;
+
+		discard_prefetched_buffer(buffer);
+	}
+}
+
 /* This gets a new buffer to read data into. */
 void *dm_bufio_read(struct dm_bufio_client *client,
 		    sector_t block,
 		    struct dm_buffer **buffer_ptr)
 {
-	int result;
+	int result = UDS_SUCCESS;
 	size_t read_length = 0;
+	sector_t offset = client->start_offset + block * client->bytes_per_page;
 	struct dm_buffer *buffer;
 	u8 *data;
 
-	data = dm_bufio_new(client, block, &buffer);
-	if (IS_ERR(data)) {
-		uds_log_error_strerror(-PTR_ERR(data),
-				       "error reading physical page %lu",
-				       block);
-		return data;
+	uds_lock_mutex(&client->buffer_mutex);
+	buffer = find_prefetched_buffer(client, offset);
+	if (buffer != NULL)
+		remove_prefetched_buffer(buffer);
+	uds_unlock_mutex(&client->buffer_mutex);
+
+	/* A failed prefetch is retried synchronously. */
+	if ((buffer != NULL) && (finish_prefetch(buffer, &read_length) == UDS_SUCCESS))
+		goto read_done;
+
+	if (buffer == NULL) {
+		data = dm_bufio_new(client, block, &buffer);
+		if (IS_ERR(data)) {
+			uds_log_error_strerror(-PTR_ERR(data),
+					       "error reading physical page %lu",
+					       block);
+			return data;
+		}
 	}
 
 	result = read_data_at_offset(client->bdev->fd,
@@ -158,6 +317,7 @@ void *dm_bufio_read(struct dm_bufio_client *client,
 		return ERR_PTR(-EIO);
 	}
 
+read_done:
 	if (read_length < client->bytes_per_page)
 		memset(&buffer->data[read_length],
 		       0,
@@ -167,11 +327,69 @@ void *dm_bufio_read(struct dm_bufio_client *client,
 	return buffer->data;
 }
 
-void dm_bufio_prefetch(struct dm_bufio_client *client __always_unused,
-		       sector_t block __always_unused,
-		       unsigned block_count __always_unused)
+static void prefetch_block(struct dm_bufio_client *client, sector_t block)
 {
-	/* Prefetching is meaningless when dealing with files. */
+	sector_t offset = client->start_offset + block * client->bytes_per_page;
+	struct dm_buffer *buffer;
+	u64 write_count;
+	u8 *data;
+
+	uds_lock_mutex(&client->buffer_mutex);
+	buffer = find_prefetched_buffer(client, offset);
+	write_count = client->write_count;
+	uds_unlock_mutex(&client->buffer_mutex);
+	if (buffer != NULL)
+		return;
+
+	data = dm_bufio_new(client, block, &buffer);
+	if (IS_ERR(data))
+		return;
+
+	memset(&buffer->aio, 0, sizeof(buffer->aio));
+	buffer->aio.aio_fildes = client->bdev->fd;
+	buffer->aio.aio_offset = buffer->offset;
+	buffer->aio.aio_buf = buffer->data;
+	buffer->aio.aio_nbytes = client->bytes_per_page;
+	buffer->aio.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+	/* The buffer must not be found by a reader until its read is queued. */
+	if (aio_read(&buffer->aio) != 0) {
+		dm_bufio_release(buffer);
+		return;
+	}
+
+	/*
+	 * If any block was written while the read was being started, the read
+	 * may have missed the new data, so the buffer is discarded rather than
+	 * risk handing it out.
+	 */
+	uds_lock_mutex(&client->buffer_mutex);
+	if (client->write_count == write_count) {
+		add_prefetched_buffer(buffer);
+		buffer = NULL;
+		if (client->prefetch_count > MAX_PREFETCHED_BUFFERS) {
+			buffer = client->oldest_prefetch;
+			remove_prefetched_buffer(buffer);
+		}
+	}
+	uds_unlock_mutex(&client->buffer_mutex);
+
+	if (buffer != NULL)
+		discard_prefetched_buffer(buffer);
+}
+
+/*
+ * Start asynchronous reads of the blocks. Prefetching is only advice, so a
+ * read which cannot be started is simply left for dm_bufio_read() to do.
+ */
+void dm_bufio_prefetch(struct dm_bufio_client *client,
+		       sector_t block,
+		       unsigned block_count)
+{
+	unsigned int i;
+
+	for (i = 0; i < block_count; i++)
+		prefetch_block(client, block + i);
 }
 
 void dm_bufio_release(struct dm_buffer *buffer)
@@ -207,8 +425,15 @@ void dm_bufio_mark_buffer_dirty(struct dm_buffer *buffer)
 					buffer->offset,
 					buffer->data,
 					client->bytes_per_page);
-	if (client->status == UDS_SUCCESS)
-		client->status = result;
+	if (result != UDS_SUCCESS) {
+		/* Index and record pages may be written by different threads. */
+		uds_lock_mutex(&client->buffer_mutex);
+		if (client->status == UDS_SUCCESS)
+			client->status = result;
+		uds_unlock_mutex(&client->buffer_mutex);
+	}
+
+	discard_prefetched_block(client, buffer->offset);
 }
 
 /* Since we already wrote all the dirty buffers, just sync the file. */
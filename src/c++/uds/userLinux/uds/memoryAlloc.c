@@ -6,11 +6,13 @@
 #include <linux/types.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "logger.h"
 #include "memory-alloc.h"
 
 enum { DEFAULT_MALLOC_ALIGNMENT = 2 * sizeof(size_t) }; // glibc malloc
+enum { HUGE_PAGE_SIZE = 2 * 1024 * 1024 };
 
 /**
  * Allocate storage based on memory size and alignment, logging an error if
@@ -67,6 +69,48 @@ int uds_allocate_memory(size_t size, size_t align, const char *what, void *ptr)
 	return UDS_SUCCESS;
 }
 
+/**
+ * Allocate a large region which should be backed by transparent huge pages
+ * where possible, to reduce TLB misses when it is accessed randomly. The
+ * region is aligned to and padded out to a huge page boundary so that the
+ * kernel can map all of it with huge pages. The memory will be zeroed, and
+ * is freed with UDS_FREE() like any other allocation.
+ *
+ * @param size  The size of the region
+ * @param what  What is being allocated (for error logging)
+ * @param ptr   A pointer to hold the allocated memory
+ *
+ * @return UDS_SUCCESS or an error code
+ **/
+int uds_allocate_huge_memory(size_t size, const char *what, void *ptr)
+{
+	size_t huge_size = (size + HUGE_PAGE_SIZE - 1) & ~((size_t) HUGE_PAGE_SIZE - 1);
+	int result;
+	void *p;
+
+	if (size == 0)
+		return uds_allocate_memory(size, HUGE_PAGE_SIZE, what, ptr);
+
+	result = posix_memalign(&p, HUGE_PAGE_SIZE, huge_size);
+	if (result != 0) {
+		uds_log_error_strerror(result,
+				       "failed to posix_memalign %s (%zu bytes)",
+				       what,
+				       huge_size);
+		return -result;
+	}
+
+	// The advice must be taken before the memory is first touched.
+	if (madvise(p, huge_size, MADV_HUGEPAGE) != 0)
+		uds_log_debug("huge pages not available for %s: %s",
+			      what,
+			      strerror(errno));
+
+	memset(p, 0, huge_size);
+	*((void **) ptr) = p;
+	return UDS_SUCCESS;
+}
+
 /*
  * Allocate storage based on memory size, failing immediately if the required
  * memory is not available. The memory will be zeroed.
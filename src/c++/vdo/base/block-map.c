@@ -109,6 +109,10 @@ const physical_block_number_t VDO_INVALID_PBN = 0xFFFFFFFFFFFFFFFF;
 enum {
 	LOG_INTERVAL = 4000,
 	DISPLAY_INTERVAL = 100000,
+	/* The number of times a read stride must repeat before leaf pages are prefetched */
+	BLOCK_MAP_PREFETCH_THRESHOLD = 1,
+	/* The number of leaf pages to prefetch ahead of a sequential read */
+	BLOCK_MAP_PREFETCH_DEPTH = 2,
 };
 
 /*
@@ -229,6 +233,26 @@ static int __must_check allocate_cache_components(struct vdo_page_cache *cache)
 	if (result != UDS_SUCCESS)
 		return result;
 
+	if (cache->policy == VDO_BLOCK_MAP_CACHE_2Q) {
+		page_count_t i;
+
+		cache->probation_target = cache->page_count / 4;
+		cache->ghost_capacity = (cache->page_count / 2) + 1;
+		result = UDS_ALLOCATE(cache->ghost_capacity,
+				      physical_block_number_t,
+				      "page cache ghosts",
+				      &cache->ghosts);
+		if (result != UDS_SUCCESS)
+			return result;
+
+		for (i = 0; i < cache->ghost_capacity; i++)
+			cache->ghosts[i] = NO_PAGE;
+
+		result = make_int_map(cache->ghost_capacity, 0, &cache->ghost_map);
+		if (result != UDS_SUCCESS)
+			return result;
+	}
+
 	return initialize_info(cache);
 }
 
@@ -329,11 +353,78 @@ static void update_counter(struct page_info *info, s32 delta)
 	}
 }
 
-/** update_lru() - Update the lru information for an active page. */
+/** ghost_slot_value() - Encode a ghost ring slot as a non-NULL int_map value. */
+static inline void *ghost_slot_value(page_count_t slot)
+{
+	return (void *) (uintptr_t) (slot + 1);
+}
+
+/**
+ * remember_ghost() - Remember the pbn of a page which is being evicted from the 2Q probation
+ *                    list.
+ *
+ * The ghost ring holds only page numbers, so a probationary page which is referenced again soon
+ * after its eviction can be recognized as worth protecting when it is reloaded.
+ */
+static void remember_ghost(struct vdo_page_cache *cache, physical_block_number_t pbn)
+{
+	page_count_t slot = cache->ghost_next;
+	physical_block_number_t old_pbn = cache->ghosts[slot];
+
+	/* Don't forget the old pbn if it has since been remembered again in a newer slot. */
+	if ((old_pbn != NO_PAGE) &&
+	    (int_map_get(cache->ghost_map, old_pbn) == ghost_slot_value(slot)))
+		int_map_remove(cache->ghost_map, old_pbn);
+
+	cache->ghost_next = (slot + 1) % cache->ghost_capacity;
+	cache->ghosts[slot] = pbn;
+	if (int_map_put(cache->ghost_map, pbn, ghost_slot_value(slot), true, NULL) != UDS_SUCCESS) {
+		/* A ghost is only a hint, so failing to record one is harmless. */
+		cache->ghosts[slot] = NO_PAGE;
+	}
+}
+
+/**
+ * update_lru() - Update the lru information for an active page.
+ *
+ * Under the 2Q policy, a newly loaded page goes on the probation list unless it was recently
+ * evicted from there, in which case it goes straight to the protected (lru) list. Further
+ * references to a page on probation do not move it: a sequential pass references each block map
+ * page many times in quick succession, and those references should not be mistaken for reuse.
+ */
 static void update_lru(struct page_info *info)
 {
-	if (info->cache->lru_list.prev != &info->lru_entry)
-		list_move_tail(&info->lru_entry, &info->cache->lru_list);
+	struct vdo_page_cache *cache = info->cache;
+
+	if (cache->policy == VDO_BLOCK_MAP_CACHE_2Q) {
+		if (info->on_probation)
+			return;
+
+		if (list_empty(&info->lru_entry)) {
+			if (int_map_remove(cache->ghost_map, info->pbn) == NULL) {
+				info->on_probation = true;
+				cache->probation_count++;
+				list_add_tail(&info->lru_entry, &cache->probation_list);
+				return;
+			}
+
+			ADD_ONCE(cache->stats.ghost_hits, 1);
+		}
+	}
+
+	if (cache->lru_list.prev != &info->lru_entry)
+		list_move_tail(&info->lru_entry, &cache->lru_list);
+}
+
+/** remove_from_lru() - Remove a page from whichever lru list it is on. */
+static void remove_from_lru(struct page_info *info)
+{
+	if (info->on_probation) {
+		info->on_probation = false;
+		info->cache->probation_count--;
+	}
+
+	list_del_init(&info->lru_entry);
 }
 
 /**
@@ -405,9 +496,14 @@ static int reset_page_info(struct page_info *info)
 	if (result != UDS_SUCCESS)
 		return result;
 
+	if (info->prefetched) {
+		info->prefetched = false;
+		ADD_ONCE(info->cache->stats.prefetch_wasted, 1);
+	}
+
 	result = set_info_pbn(info, NO_PAGE);
 	set_info_state(info, PS_FREE);
-	list_del_init(&info->lru_entry);
+	remove_from_lru(info);
 	return result;
 }
 
@@ -441,6 +537,21 @@ find_page(struct vdo_page_cache *cache, physical_block_number_t pbn)
 	return cache->last_found;
 }
 
+/**
+ * select_evictable_page() - Find the first page on an lru list which is neither busy nor in
+ *                           flight.
+ */
+static struct page_info * __must_check select_evictable_page(struct list_head *list)
+{
+	struct page_info *info;
+
+	list_for_each_entry(info, list, lru_entry)
+		if ((info->busy == 0) && !is_in_flight(info))
+			return info;
+
+	return NULL;
+}
+
 /**
  * select_lru_page() - Determine which page is least recently used.
  *
@@ -448,6 +559,9 @@ find_page(struct vdo_page_cache *cache, physical_block_number_t pbn)
  * ring. Since whenever we mark a page busy we also put it to the end of the ring it is unlikely
  * that the entries at the front are busy unless the queue is very short, but not impossible.
  *
+ * Under the 2Q policy, the oldest probationary page is chosen while the probation list is over
+ * its target size, so that a scan can only displace pages which have not proven themselves.
+ *
  * Return: A pointer to the info structure for a relevant page, or NULL if no such page can be
  *         found. The page can be dirty or resident.
  */
@@ -455,11 +569,20 @@ static struct page_info * __must_check select_lru_page(struct vdo_page_cache *ca
 {
 	struct page_info *info;
 
-	list_for_each_entry(info, &cache->lru_list, lru_entry)
-		if ((info->busy == 0) && !is_in_flight(info))
+	if (cache->policy != VDO_BLOCK_MAP_CACHE_2Q)
+		return select_evictable_page(&cache->lru_list);
+
+	if (cache->probation_count > cache->probation_target) {
+		info = select_evictable_page(&cache->probation_list);
+		if (info != NULL)
 			return info;
+	}
 
-	return NULL;
+	info = select_evictable_page(&cache->lru_list);
+	if (info != NULL)
+		return info;
+
+	return select_evictable_page(&cache->probation_list);
 }
 
 /* ASYNCHRONOUS INTERFACE BEYOND THIS POINT */
@@ -928,6 +1051,9 @@ static void discard_a_page(struct vdo_page_cache *cache)
 		return;
 	}
 
+	if (info->on_probation)
+		remember_ghost(cache, info->pbn);
+
 	if (!is_dirty(info)) {
 		allocate_free_page(info);
 		return;
@@ -1242,6 +1368,11 @@ void vdo_get_page(struct vdo_page_completion *page_completion,
 	info = find_page(cache, page_completion->pbn);
 	if (info != NULL) {
 		/* The page is in the cache already. */
+		if (info->prefetched) {
+			info->prefetched = false;
+			ADD_ONCE(cache->stats.prefetch_used, 1);
+		}
+
 		if ((info->write_status == WRITE_STATUS_DEFERRED) ||
 		    is_incoming(info) ||
 		    (is_outgoing(info) && page_completion->writable)) {
@@ -1266,6 +1397,7 @@ void vdo_get_page(struct vdo_page_completion *page_completion,
 	}
 
 	/* The page must be fetched. */
+	ADD_ONCE(cache->stats.cache_misses, 1);
 	info = find_free_page(cache);
 	if (info != NULL) {
 		ADD_ONCE(cache->stats.fetch_required, 1);
@@ -1278,6 +1410,56 @@ void vdo_get_page(struct vdo_page_completion *page_completion,
 	discard_page_for_completion(page_completion);
 }
 
+/**
+ * prefetch_page() - Start loading a page which is expected to be requested soon.
+ * @pbn: The absolute physical block of the page.
+ *
+ * A prefetch never waits and never causes a dirty page to be written; if there is no free page
+ * and no clean page to evict, or if any requests are already waiting for pages, nothing is done.
+ *
+ * Return: true if the page is now cached or being loaded.
+ */
+static bool prefetch_page(struct vdo_page_cache *cache, physical_block_number_t pbn)
+{
+	struct page_info *info;
+	int result;
+
+	assert_on_cache_thread(cache, __func__);
+	if (find_page(cache, pbn) != NULL)
+		return true;
+
+	if ((cache->waiter_count > 0) || cache->rebuilding)
+		return false;
+
+	info = find_free_page(cache);
+	if (info == NULL) {
+		info = select_lru_page(cache);
+		if ((info == NULL) || is_dirty(info))
+			return false;
+
+		if (info->on_probation)
+			remember_ghost(cache, info->pbn);
+
+		result = reset_page_info(info);
+		if (result != VDO_SUCCESS) {
+			set_persistent_error(cache, "cannot reset page info", result);
+			return false;
+		}
+
+		info = find_free_page(cache);
+	}
+
+	result = launch_page_load(info, pbn);
+	if (result != VDO_SUCCESS) {
+		set_persistent_error(cache, "cannot prefetch page", result);
+		return false;
+	}
+
+	info->prefetched = true;
+	ADD_ONCE(cache->stats.prefetch_issued, 1);
+	return true;
+}
+
 /**
  * vdo_request_page_write() - Request that a VDO page be written out as soon as it is not busy.
  * @completion: The vdo_page_completion containing the page.
@@ -2752,6 +2934,7 @@ static int __must_check initialize_block_map_zone(struct block_map *map,
 						  const struct thread_config *thread_config,
 						  struct vdo *vdo,
 						  page_count_t cache_size,
+						  enum block_map_cache_policy cache_policy,
 						  block_count_t maximum_age)
 {
 	int result;
@@ -2800,6 +2983,7 @@ static int __must_check initialize_block_map_zone(struct block_map *map,
 	zone->page_cache.zone = zone;
 	zone->page_cache.vdo = vdo;
 	zone->page_cache.page_count = cache_size / map->zone_count;
+	zone->page_cache.policy = cache_policy;
 	zone->page_cache.stats.free_pages = zone->page_cache.page_count;
 
 	result = allocate_cache_components(&zone->page_cache);
@@ -2808,6 +2992,7 @@ static int __must_check initialize_block_map_zone(struct block_map *map,
 
 	/* initialize empty circular queues */
 	INIT_LIST_HEAD(&zone->page_cache.lru_list);
+	INIT_LIST_HEAD(&zone->page_cache.probation_list);
 	INIT_LIST_HEAD(&zone->page_cache.outgoing_list);
 
 	return VDO_SUCCESS;
@@ -2878,6 +3063,8 @@ static void uninitialize_block_map_zone(struct block_map_zone *zone)
 	}
 
 	free_int_map(UDS_FORGET(cache->page_map));
+	free_int_map(UDS_FORGET(cache->ghost_map));
+	UDS_FREE(UDS_FORGET(cache->ghosts));
 	UDS_FREE(UDS_FORGET(cache->infos));
 	UDS_FREE(UDS_FORGET(cache->pages));
 }
@@ -2907,6 +3094,7 @@ int vdo_decode_block_map(struct block_map_state_2_0 state,
 			 struct recovery_journal *journal,
 			 nonce_t nonce,
 			 page_count_t cache_size,
+			 enum block_map_cache_policy cache_policy,
 			 block_count_t maximum_age,
 			 struct block_map **map_ptr)
 {
@@ -2951,6 +3139,7 @@ int vdo_decode_block_map(struct block_map_state_2_0 state,
 						   thread_config,
 						   vdo,
 						   cache_size,
+						   cache_policy,
 						   maximum_age);
 		if (result != VDO_SUCCESS) {
 			vdo_free_block_map(map);
@@ -3344,9 +3533,91 @@ static void put_mapping_in_fetched_page(struct vdo_completion *completion)
 	finish_processing_page(completion, VDO_SUCCESS);
 }
 
+/**
+ * detect_sequential_read() - Note a read of a leaf page and decide whether the zone is reading
+ *                            sequentially.
+ *
+ * Since each root is owned by a single zone, a sequential read visits the leaf pages of a zone at
+ * a fixed stride (which is the number of zones if they evenly divide the roots). Reads which fall
+ * a little behind the pattern are assumed to be stragglers from the same stream and are ignored.
+ *
+ * Return: The stride of the sequential pattern, or 0 if the reads do not appear to be sequential.
+ */
+static page_number_t detect_sequential_read(struct block_map_zone *zone,
+					    page_number_t page_number)
+{
+	struct read_stride_detector *detector = &zone->read_detector;
+	page_number_t stride;
+
+	if (page_number == detector->last_page)
+		return 0;
+
+	if (page_number < detector->last_page) {
+		if ((detector->last_page - page_number) > detector->stride)
+			*detector = (struct read_stride_detector) { .last_page = page_number };
+		return 0;
+	}
+
+	stride = page_number - detector->last_page;
+	detector->last_page = page_number;
+	if (stride > zone->block_map->root_count) {
+		detector->stride = 0;
+		detector->repeats = 0;
+		return 0;
+	}
+
+	if (stride != detector->stride) {
+		detector->stride = stride;
+		detector->repeats = 0;
+		return 0;
+	}
+
+	if (detector->repeats < BLOCK_MAP_PREFETCH_THRESHOLD)
+		detector->repeats++;
+
+	return ((detector->repeats < BLOCK_MAP_PREFETCH_THRESHOLD) ? 0 : stride);
+}
+
+/**
+ * prefetch_leaf_pages() - Load the leaf pages which a sequential read in a zone will need next.
+ *
+ * Only pages whose parents are already in memory can be located without I/O, so the prefetch
+ * stops at the first page whose location is unknown.
+ */
+static void prefetch_leaf_pages(struct block_map_zone *zone, page_number_t page_number)
+{
+	struct block_map *map = zone->block_map;
+	page_count_t leaf_pages = vdo_compute_block_map_page_count(map->entry_count);
+	page_number_t stride;
+	unsigned int i;
+
+	if (!vdo_is_state_normal(&zone->state))
+		return;
+
+	stride = detect_sequential_read(zone, page_number);
+	if (stride == 0)
+		return;
+
+	for (i = 1; i <= BLOCK_MAP_PREFETCH_DEPTH; i++) {
+		physical_block_number_t pbn;
+
+		page_number += stride;
+		if (page_number >= leaf_pages)
+			return;
+
+		pbn = vdo_find_block_map_page_pbn(map, page_number);
+		if ((pbn == VDO_ZERO_BLOCK) || !prefetch_page(&zone->page_cache, pbn))
+			return;
+	}
+}
+
 /* Read a stored block mapping into a data_vio. */
 void vdo_get_mapped_block(struct data_vio *data_vio)
 {
+	struct block_map_zone *zone = data_vio->logical.zone->block_map_zone;
+	page_number_t page_number = data_vio->tree_lock.tree_slots[0].page_index;
+	bool read = data_vio->read;
+
 	if (data_vio->tree_lock.tree_slots[0].block_map_slot.pbn == VDO_ZERO_BLOCK) {
 		/*
 		 * We know that the block map page for this LBN has not been allocated, so the
@@ -3354,10 +3625,13 @@ void vdo_get_mapped_block(struct data_vio *data_vio)
 		 */
 		clear_mapped_location(data_vio);
 		continue_data_vio(data_vio);
-		return;
+	} else {
+		fetch_mapping_page(data_vio, false, get_mapping_from_fetched_page);
 	}
 
-	fetch_mapping_page(data_vio, false, get_mapping_from_fetched_page);
+	/* Prefetch after the fetch so that the data_vio's own page is not delayed. */
+	if (read)
+		prefetch_leaf_pages(zone, page_number);
 }
 
 /* Update a stored block mapping to reflect a data_vio's new mapping. */
@@ -3395,6 +3669,11 @@ struct block_map_statistics vdo_get_block_map_statistics(struct block_map *map)
 		totals.pages_loaded += READ_ONCE(stats->pages_loaded);
 		totals.pages_saved += READ_ONCE(stats->pages_saved);
 		totals.flush_count += READ_ONCE(stats->flush_count);
+		totals.cache_misses += READ_ONCE(stats->cache_misses);
+		totals.ghost_hits += READ_ONCE(stats->ghost_hits);
+		totals.prefetch_issued += READ_ONCE(stats->prefetch_issued);
+		totals.prefetch_used += READ_ONCE(stats->prefetch_used);
+		totals.prefetch_wasted += READ_ONCE(stats->prefetch_wasted);
 	}
 
 	return totals;
@@ -56,8 +56,24 @@ struct vdo_page_cache {
 	struct page_info *last_found;
 	/* map of page number to info */
 	struct int_map *page_map;
-	/* main LRU list (all infos) */
+	/* main LRU list (all infos); the protected queue when using the 2Q policy */
 	struct list_head lru_list;
+	/* the replacement policy for this cache */
+	enum block_map_cache_policy policy;
+	/* 2Q: FIFO of pages which have not been re-referenced since they were loaded */
+	struct list_head probation_list;
+	/* 2Q: number of pages on the probation list */
+	page_count_t probation_count;
+	/* 2Q: probation pages are evicted first once there are more than this many of them */
+	page_count_t probation_target;
+	/* 2Q: ring of the pbns of pages recently evicted from probation */
+	physical_block_number_t *ghosts;
+	/* 2Q: number of slots in the ghost ring */
+	page_count_t ghost_capacity;
+	/* 2Q: the next slot in the ghost ring to overwrite */
+	page_count_t ghost_next;
+	/* 2Q: map of ghost pbn to its slot in the ghost ring (plus one) */
+	struct int_map *ghost_map;
 	/* free page list (oldest first) */
 	struct list_head free_list;
 	/* outgoing page list */
@@ -141,6 +157,10 @@ struct page_info {
 	struct list_head state_entry;
 	/* LRU entry */
 	struct list_head lru_entry;
+	/* whether the LRU entry is on the 2Q probation list */
+	bool on_probation;
+	/* whether the page was loaded by a prefetch and has not been requested since */
+	bool prefetched;
 	/*
 	 * The earliest recovery journal block containing uncommitted updates to the block map page
 	 * associated with this page_info. A reference (lock) is held on that block to prevent it
@@ -222,6 +242,16 @@ struct dirty_lists {
 	dirty_era_t eras[];
 };
 
+/* Tracks the leaf pages read in a zone in order to recognize a sequential pattern. */
+struct read_stride_detector {
+	/* the most recently read leaf page which advanced the pattern */
+	page_number_t last_page;
+	/* the distance between the last two such pages */
+	page_number_t stride;
+	/* the number of consecutive times that stride has repeated */
+	unsigned int repeats;
+};
+
 struct block_map_zone {
 	zone_count_t zone_number;
 	thread_id_t thread_id;
@@ -233,6 +263,7 @@ struct block_map_zone {
 	data_vio_count_t active_lookups;
 	struct int_map *loading_pages;
 	struct vio_pool *vio_pool;
+	struct read_stride_detector read_detector;
 	/* The tree page which has issued or will be issuing a flush */
 	struct tree_page *flusher;
 	struct wait_queue flush_waiters;
@@ -333,6 +364,7 @@ int __must_check vdo_decode_block_map(struct block_map_state_2_0 state,
 				      struct recovery_journal *journal,
 				      nonce_t nonce,
 				      page_count_t cache_size,
+				      enum block_map_cache_policy cache_policy,
 				      block_count_t maximum_age,
 				      struct block_map **map_ptr);
 
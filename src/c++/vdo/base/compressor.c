@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright Red Hat
+ */
+
+#include "compressor.h"
+
+#include <linux/lz4.h>
+#include <linux/version.h>
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0))
+#include <linux/zstd.h>
+#endif
+
+#include "logger.h"
+#include "memory-alloc.h"
+
+#include "constants.h"
+#include "status-codes.h"
+
+enum {
+	/* A negative level selects zstd's fast strategies, trading ratio for speed. */
+	VDO_ZSTD_LEVEL = -1,
+};
+
+struct compressor_context {
+	/* Working memory for LZ4_compress_default() */
+	char *lz4_workspace;
+	/* Working memory for LZ4_compress_HC() */
+	char *lz4hc_workspace;
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0))
+	zstd_parameters zstd_parameters;
+	char *zstd_compress_workspace;
+	zstd_cctx *zstd_cctx;
+	char *zstd_decompress_workspace;
+	zstd_dctx *zstd_dctx;
+#endif
+};
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0))
+static int __must_check make_zstd_contexts(struct compressor_context *context)
+{
+	size_t size;
+	int result;
+
+	context->zstd_parameters = zstd_get_params(VDO_ZSTD_LEVEL, VDO_BLOCK_SIZE);
+	size = zstd_cctx_workspace_bound(&context->zstd_parameters.cParams);
+	result = UDS_ALLOCATE(size, char, "zstd compression context",
+			      &context->zstd_compress_workspace);
+	if (result != VDO_SUCCESS)
+		return result;
+
+	context->zstd_cctx = zstd_init_cctx(context->zstd_compress_workspace, size);
+	if (context->zstd_cctx == NULL)
+		return uds_log_error_strerror(VDO_BAD_CONFIGURATION,
+					      "cannot initialize zstd compression context");
+
+	size = zstd_dctx_workspace_bound();
+	result = UDS_ALLOCATE(size, char, "zstd decompression context",
+			      &context->zstd_decompress_workspace);
+	if (result != VDO_SUCCESS)
+		return result;
+
+	context->zstd_dctx = zstd_init_dctx(context->zstd_decompress_workspace, size);
+	if (context->zstd_dctx == NULL)
+		return uds_log_error_strerror(VDO_BAD_CONFIGURATION,
+					      "cannot initialize zstd decompression context");
+
+	return VDO_SUCCESS;
+}
+#endif
+
+/**
+ * vdo_make_compressor_context() - Allocate the working memory for every supported compressor.
+ * @context_ptr: A pointer to hold the new context.
+ *
+ * Return: VDO_SUCCESS or an error.
+ */
+int vdo_make_compressor_context(struct compressor_context **context_ptr)
+{
+	struct compressor_context *context;
+	int result;
+
+	result = UDS_ALLOCATE(1, struct compressor_context, __func__, &context);
+	if (result != VDO_SUCCESS)
+		return result;
+
+	result = UDS_ALLOCATE(LZ4_MEM_COMPRESS, char, "LZ4 context", &context->lz4_workspace);
+	if (result != VDO_SUCCESS) {
+		vdo_free_compressor_context(context);
+		return result;
+	}
+
+	result = UDS_ALLOCATE(LZ4HC_MEM_COMPRESS, char, "LZ4HC context",
+			      &context->lz4hc_workspace);
+	if (result != VDO_SUCCESS) {
+		vdo_free_compressor_context(context);
+		return result;
+	}
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0))
+	result = make_zstd_contexts(context);
+	if (result != VDO_SUCCESS) {
+		vdo_free_compressor_context(context);
+		return result;
+	}
+#endif
+
+	*context_ptr = context;
+	return VDO_SUCCESS;
+}
+
+/**
+ * vdo_free_compressor_context() - Free a compressor context.
+ * @context: The context to free.
+ */
+void vdo_free_compressor_context(struct compressor_context *context)
+{
+	if (context == NULL)
+		return;
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0))
+	UDS_FREE(UDS_FORGET(context->zstd_decompress_workspace));
+	UDS_FREE(UDS_FORGET(context->zstd_compress_workspace));
+#endif
+	UDS_FREE(UDS_FORGET(context->lz4hc_workspace));
+	UDS_FREE(UDS_FORGET(context->lz4_workspace));
+	UDS_FREE(context);
+}
+
+/**
+ * vdo_is_compression_type_supported() - Check whether a compressor is available in this build.
+ * @type: The compressor to check.
+ */
+bool vdo_is_compression_type_supported(enum vdo_compression_type type)
+{
+	switch (type) {
+	case VDO_COMPRESSION_LZ4:
+	case VDO_COMPRESSION_LZ4HC:
+		return true;
+
+	case VDO_COMPRESSION_ZSTD:
+		return (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0));
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * vdo_get_compression_type_name() - Get the name of a compressor as used in the table line.
+ * @type: The compressor.
+ */
+const char *vdo_get_compression_type_name(enum vdo_compression_type type)
+{
+	switch (type) {
+	case VDO_COMPRESSION_LZ4:
+		return "lz4";
+
+	case VDO_COMPRESSION_LZ4HC:
+		return "lz4hc";
+
+	case VDO_COMPRESSION_ZSTD:
+		return "zstd";
+
+	default:
+		return "unknown";
+	}
+}
+
+/**
+ * vdo_compress_block() - Compress one block of data.
+ * @context: The working memory of the calling thread.
+ * @type: The compressor to use.
+ * @data: The VDO_BLOCK_SIZE bytes of data to compress.
+ * @fragment: The buffer to hold the compressed data.
+ * @capacity: The size of the fragment buffer.
+ *
+ * Return: The size of the compressed fragment, or 0 if the data could not be compressed into the
+ *         fragment buffer.
+ */
+int vdo_compress_block(struct compressor_context *context,
+		       enum vdo_compression_type type,
+		       const char *data,
+		       char *fragment,
+		       int capacity)
+{
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0))
+	size_t size;
+#endif
+
+	switch (type) {
+	case VDO_COMPRESSION_LZ4:
+		return LZ4_compress_default(data,
+					    fragment,
+					    VDO_BLOCK_SIZE,
+					    capacity,
+					    context->lz4_workspace);
+
+	case VDO_COMPRESSION_LZ4HC:
+		return LZ4_compress_HC(data,
+				       fragment,
+				       VDO_BLOCK_SIZE,
+				       capacity,
+				       LZ4HC_DEFAULT_CLEVEL,
+				       context->lz4hc_workspace);
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0))
+	case VDO_COMPRESSION_ZSTD:
+		size = zstd_compress_cctx(context->zstd_cctx,
+					  fragment,
+					  capacity,
+					  data,
+					  VDO_BLOCK_SIZE,
+					  &context->zstd_parameters);
+		return (zstd_is_error(size) ? 0 : size);
+#endif
+
+	default:
+		return 0;
+	}
+}
+
+/**
+ * vdo_uncompress_fragment() - Uncompress a fragment back into a full block.
+ * @context: The working memory of the calling thread.
+ * @type: The compressor which produced the fragment.
+ * @fragment: The compressed data.
+ * @fragment_size: The size of the compressed data.
+ * @data: The VDO_BLOCK_SIZE buffer to receive the uncompressed data.
+ *
+ * Return: VDO_SUCCESS or VDO_INVALID_FRAGMENT if the fragment does not uncompress to a full block.
+ */
+int vdo_uncompress_fragment(struct compressor_context *context,
+			    enum vdo_compression_type type,
+			    const char *fragment,
+			    int fragment_size,
+			    char *data)
+{
+	size_t size;
+
+	switch (type) {
+	case VDO_COMPRESSION_LZ4:
+	case VDO_COMPRESSION_LZ4HC:
+		size = LZ4_decompress_safe(fragment, data, fragment_size, VDO_BLOCK_SIZE);
+		break;
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0))
+	case VDO_COMPRESSION_ZSTD:
+		size = zstd_decompress_dctx(context->zstd_dctx,
+					    data,
+					    VDO_BLOCK_SIZE,
+					    fragment,
+					    fragment_size);
+		if (zstd_is_error(size))
+			return VDO_INVALID_FRAGMENT;
+		break;
+#endif
+
+	default:
+		return VDO_INVALID_FRAGMENT;
+	}
+
+	return ((size == VDO_BLOCK_SIZE) ? VDO_SUCCESS : VDO_INVALID_FRAGMENT);
+}
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright Red Hat
+ */
+
+#ifndef VDO_COMPRESSOR_H
+#define VDO_COMPRESSOR_H
+
+#include "types.h"
+
+/*
+ * A compressor context holds the working memory every supported compressor needs to compress or
+ * uncompress one block. Each CPU thread owns one, so the compressor used for new writes can be
+ * changed by a table reload without reallocating anything, and fragments written by any of the
+ * compressors can always be read back.
+ */
+struct compressor_context;
+
+int __must_check vdo_make_compressor_context(struct compressor_context **context_ptr);
+
+void vdo_free_compressor_context(struct compressor_context *context);
+
+bool __must_check vdo_is_compression_type_supported(enum vdo_compression_type type);
+
+const char * __must_check vdo_get_compression_type_name(enum vdo_compression_type type);
+
+int __must_check vdo_compress_block(struct compressor_context *context,
+				    enum vdo_compression_type type,
+				    const char *data,
+				    char *fragment,
+				    int capacity);
+
+int __must_check vdo_uncompress_fragment(struct compressor_context *context,
+					 enum vdo_compression_type type,
+					 const char *fragment,
+					 int fragment_size,
+					 char *data);
+
+#endif /* VDO_COMPRESSOR_H */
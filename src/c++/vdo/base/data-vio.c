@@ -8,12 +8,12 @@
 #include <linux/atomic.h>
 #include <linux/bio.h>
 #include <linux/blkdev.h>
+#include <linux/cache.h>
 #include <linux/delay.h>
 #include <linux/device-mapper.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
-#include <linux/lz4.h>
 #include <linux/minmax.h>
 #include <linux/murmurhash3.h>
 #include <linux/sched.h>
@@ -28,12 +28,15 @@
 #include "permassert.h"
 
 #include "block-map.h"
+#include "compressor.h"
+#include "decompression-cache.h"
 #include "dump.h"
 #include "encodings.h"
 #include "int-map.h"
 #include "io-submitter.h"
 #include "logical-zone.h"
 #include "packer.h"
+#include "physical-zone.h"
 #include "recovery-journal.h"
 #include "slab-depot.h"
 #include "slab-journal.h"
@@ -117,10 +120,19 @@ static unsigned int PASSTHROUGH_FLAGS = (REQ_PRIO | REQ_META | REQ_SYNC | REQ_RA
  * doesn't need one and relaunched. If neither of these exist, the data_vio is returned to the
  * pool. Finally, if any waiting bios were launched, the threads which blocked trying to submit
  * them are awakened.
+ *
+ * Hashing is batched in a similar way. When a data_vio is ready to be hashed, prepare_for_dedupe()
+ * adds it to the hash batcher's funnel queue and, if the batcher is not already scheduled, enqueues
+ * the batcher's completion on a cpu queue. When that completion runs, hash_data_vio_batch() takes
+ * up to DATA_VIO_HASH_BATCH_SIZE data_vios from the queue and then immediately reschedules itself
+ * if more are waiting, so that other cpu threads can collect the next batch while this one is
+ * hashed. The batch is hashed with murmurhash3_128_batch(), which interleaves the hashing of
+ * several blocks to make better use of the processor.
  */
 
 enum {
 	DATA_VIO_RELEASE_BATCH_SIZE = 128,
+	DATA_VIO_HASH_BATCH_SIZE = 16,
 };
 
 static const unsigned int VDO_SECTORS_PER_BLOCK_MASK = VDO_SECTORS_PER_BLOCK - 1;
@@ -158,6 +170,16 @@ struct limiter {
 	u64 arrival;
 };
 
+/* A collector of data_vios which are waiting to be hashed. */
+struct hash_batcher {
+	/* Completion for scheduling hashing */
+	struct vdo_completion completion;
+	/* The queue of data_vios waiting to be hashed */
+	struct funnel_queue *queue;
+	/* Whether the batcher is collecting, or scheduled to collect, a batch */
+	atomic_t processing;
+};
+
 /*
  * A data_vio_pool is a collection of preallocated data_vios which may be acquired from any thread,
  * and are released in batches.
@@ -181,6 +203,8 @@ struct data_vio_pool {
 	struct funnel_queue *queue;
 	/* Whether the pool is processing, or scheduled to process releases */
 	atomic_t processing;
+	/* The batcher for data_vios waiting to be hashed */
+	struct hash_batcher hasher;
 	/* The data vios in the pool */
 	struct data_vio data_vios[];
 };
@@ -225,6 +249,13 @@ as_data_vio_pool(struct vdo_completion *completion)
 	return container_of(completion, struct data_vio_pool, completion);
 }
 
+static inline struct hash_batcher * __must_check
+as_hash_batcher(struct vdo_completion *completion)
+{
+	vdo_assert_completion_type(completion, VDO_HASH_BATCH_COMPLETION);
+	return container_of(completion, struct hash_batcher, completion);
+}
+
 static inline u64 get_arrival_time(struct bio *bio)
 {
 	return (u64) bio->bi_private;
@@ -540,19 +571,41 @@ static void launch_data_vio(struct data_vio *data_vio, logical_block_number_t lb
 	vdo_invoke_completion_callback_with_priority(completion, VDO_DEFAULT_Q_MAP_BIO_PRIORITY);
 }
 
+/**
+ * is_zero_block() - Check whether a data block is all zeros.
+ * @block: The block to check.
+ *
+ * The block is examined one cache line at a time. The words of each line are OR'd together
+ * without intervening branches, which lets the compiler use whatever vector registers are
+ * available, and the scan stops at the first line containing a non-zero byte. Since most written
+ * blocks are not zero, the common case touches only the first cache line. Explicit SIMD would
+ * require kernel_fpu_begin()/kernel_fpu_end() around every call, which costs more than the
+ * single line a non-zero block usually needs.
+ *
+ * Return: true if the block contains only zeros.
+ */
 EXTERNAL_STATIC bool is_zero_block(char *block)
 {
-	int i;
+	unsigned int i;
 
 #ifdef INTERNAL
-	STATIC_ASSERT(VDO_BLOCK_SIZE % sizeof(u64) == 0);
+	STATIC_ASSERT(VDO_BLOCK_SIZE % L1_CACHE_BYTES == 0);
 	ASSERT_LOG_ONLY((uintptr_t) block % sizeof(u64) == 0,
 			"Data blocks are expected to be aligned");
 
 #endif	/* INTERNAL */
-	for (i = 0; i < VDO_BLOCK_SIZE; i += sizeof(u64))
-		if (*((u64 *) &block[i]))
+	for (i = 0; i < VDO_BLOCK_SIZE; i += L1_CACHE_BYTES) {
+		const u64 *word = (const u64 *) &block[i];
+		u64 bits = 0;
+		unsigned int j;
+
+		for (j = 0; j < L1_CACHE_BYTES / sizeof(u64); j++)
+			bits |= word[j];
+
+		if (bits != 0)
 			return false;
+	}
+
 	return true;
 }
 
@@ -814,6 +867,82 @@ static void process_release_callback(struct vdo_completion *completion)
 		vdo_finish_draining(&pool->state);
 }
 
+/**
+ * schedule_hashing() - Ensure that collection of a hash batch is scheduled.
+ *
+ * If this call switches the state to processing, enqueue. Otherwise, some other thread has already
+ * done so.
+ */
+static void schedule_hashing(struct hash_batcher *hasher)
+{
+	/* Pairs with the barrier in hash_data_vio_batch(). */
+	smp_mb__before_atomic();
+	if (atomic_cmpxchg(&hasher->processing, false, true))
+		return;
+
+	hasher->completion.requeue = true;
+	vdo_invoke_completion_callback_with_priority(&hasher->completion,
+						     CPU_Q_HASH_BLOCK_PRIORITY);
+}
+
+/**
+ * hash_data_vio_batch() - Hash the data in a batch of data_vios and set their hash zones (which
+ *			   also flags their record names as set).
+ * @completion: The hash batcher.
+ *
+ * This callback is registered in make_data_vio_pool().
+ */
+static void hash_data_vio_batch(struct vdo_completion *completion)
+{
+	struct hash_batcher *hasher = as_hash_batcher(completion);
+	struct data_vio *data_vios[DATA_VIO_HASH_BATCH_SIZE];
+	const void *blocks[DATA_VIO_HASH_BATCH_SIZE];
+	void *names[DATA_VIO_HASH_BATCH_SIZE];
+	unsigned int count;
+	unsigned int i;
+	bool reschedule;
+
+	for (count = 0; count < DATA_VIO_HASH_BATCH_SIZE; count++) {
+		struct data_vio *data_vio;
+		struct funnel_queue_entry *entry = funnel_queue_poll(hasher->queue);
+
+		if (entry == NULL)
+			break;
+
+		data_vio = as_data_vio(container_of(entry,
+						    struct vdo_completion,
+						    work_queue_entry_link));
+		assert_data_vio_on_cpu_thread(data_vio);
+		ASSERT_LOG_ONLY(!data_vio->is_zero, "zero blocks should not be hashed");
+		data_vios[count] = data_vio;
+		blocks[count] = data_vio->vio.data;
+		names[count] = &data_vio->record_name;
+	}
+
+	/*
+	 * Let another cpu thread collect the next batch while this one is hashed. The batch has been
+	 * removed from the queue, so nothing below touches the batcher.
+	 */
+	atomic_set(&hasher->processing, false);
+	/* Pairs with the barrier in schedule_hashing(). */
+	smp_mb();
+	reschedule = !is_funnel_queue_empty(hasher->queue);
+	if (reschedule)
+		schedule_hashing(hasher);
+
+	murmurhash3_128_batch(blocks, count, VDO_BLOCK_SIZE, 0x62ea60be, names);
+
+	for (i = 0; i < count; i++) {
+		struct data_vio *data_vio = data_vios[i];
+
+		data_vio->hash_zone =
+			vdo_select_hash_zone(vdo_from_data_vio(data_vio)->hash_zones,
+					     &data_vio->record_name);
+		data_vio->last_async_operation = VIO_ASYNC_OP_ACQUIRE_VDO_HASH_LOCK;
+		launch_data_vio_hash_zone_callback(data_vio, vdo_acquire_hash_lock);
+	}
+}
+
 static void initialize_limiter(struct limiter *limiter,
 			       struct data_vio_pool *pool,
 			       assigner *assigner,
@@ -921,6 +1050,18 @@ int make_data_vio_pool(struct vdo *vdo,
 		return result;
 	}
 
+	vdo_initialize_completion(&pool->hasher.completion, vdo, VDO_HASH_BATCH_COMPLETION);
+	vdo_prepare_completion(&pool->hasher.completion,
+			       hash_data_vio_batch,
+			       hash_data_vio_batch,
+			       vdo->thread_config->cpu_thread,
+			       NULL);
+	result = make_funnel_queue(&pool->hasher.queue);
+	if (result != UDS_SUCCESS) {
+		free_data_vio_pool(UDS_FORGET(pool));
+		return result;
+	}
+
 	for (i = 0; i < pool_size; i++) {
 		struct data_vio *data_vio = &pool->data_vios[i];
 
@@ -956,6 +1097,7 @@ void free_data_vio_pool(struct data_vio_pool *pool)
 	 */
 	smp_mb();
 	BUG_ON(atomic_read(&pool->processing));
+	BUG_ON(atomic_read(&pool->hasher.processing));
 
 	spin_lock(&pool->lock);
 	ASSERT_LOG_ONLY((pool->limiter.busy == 0),
@@ -975,6 +1117,7 @@ void free_data_vio_pool(struct data_vio_pool *pool)
 	}
 
 	free_funnel_queue(UDS_FORGET(pool->queue));
+	free_funnel_queue(UDS_FORGET(pool->hasher.queue));
 	UDS_FREE(pool);
 }
 
@@ -1475,11 +1618,12 @@ int uncompress_data_vio(struct data_vio *data_vio,
 			enum block_mapping_state mapping_state,
 			char *buffer)
 {
-	int size;
+	enum vdo_compression_type fragment_type;
 	u16 fragment_offset, fragment_size;
 	struct compressed_block *block = data_vio->compression.block;
 	int result = vdo_get_compressed_block_fragment(mapping_state,
 						       block,
+						       &fragment_type,
 						       &fragment_offset,
 						       &fragment_size);
 
@@ -1488,13 +1632,16 @@ int uncompress_data_vio(struct data_vio *data_vio,
 		return result;
 	}
 
-	size = LZ4_decompress_safe((block->data + fragment_offset),
-				   buffer,
-				   fragment_size,
-				   VDO_BLOCK_SIZE);
-	if (size != VDO_BLOCK_SIZE) {
-		uds_log_debug("%s: lz4 error", __func__);
-		return VDO_INVALID_FRAGMENT;
+	result = vdo_uncompress_fragment(get_work_queue_private_data(),
+					 fragment_type,
+					 (block->data + fragment_offset),
+					 fragment_size,
+					 buffer);
+	if (result != VDO_SUCCESS) {
+		uds_log_debug("%s: %s error",
+			      __func__,
+			      vdo_get_compression_type_name(fragment_type));
+		return result;
 	}
 
 	return VDO_SUCCESS;
@@ -1527,6 +1674,27 @@ static void modify_for_partial_write(struct vdo_completion *completion)
 	launch_data_vio_logical_callback(data_vio, continue_data_vio_with_block_map_slot);
 }
 
+/**
+ * finish_read() - Deliver the data of a completed read.
+ * @data_vio: The data_vio which has read its data.
+ * @copy: Whether the data is in the data_vio's buffer rather than already in the user bio.
+ */
+static void finish_read(struct data_vio *data_vio, bool copy)
+{
+	struct vdo_completion *completion = &data_vio->vio.completion;
+
+	if (data_vio->write) {
+		modify_for_partial_write(completion);
+		return;
+	}
+
+	if (copy)
+		copy_to_bio(data_vio->user_bio, data_vio->vio.data + data_vio->offset);
+
+	acknowledge_data_vio(data_vio);
+	complete_data_vio(completion);
+}
+
 static void complete_read(struct vdo_completion *completion)
 {
 	struct data_vio *data_vio = as_data_vio(completion);
@@ -1542,18 +1710,30 @@ static void complete_read(struct vdo_completion *completion)
 			continue_data_vio_with_error(data_vio, result);
 			return;
 		}
-	}
 
-	if (data_vio->write) {
-		modify_for_partial_write(completion);
-		return;
+		vdo_cache_decompressed_fragment(data_vio->mapped.zone->decompression_cache,
+						data_vio->mapped.pbn,
+						data_vio->mapped.state,
+						data,
+						data_vio->compression.cache_generation);
 	}
 
-	if (compressed || data_vio->is_partial)
-		copy_to_bio(data_vio->user_bio, data + data_vio->offset);
+	finish_read(data_vio, (compressed || data_vio->is_partial));
+}
 
-	acknowledge_data_vio(data_vio);
-	complete_data_vio(completion);
+/**
+ * complete_cached_read() - Finish a read of a compressed fragment which was found in the
+ *                          decompression cache.
+ * @completion: The data_vio, whose buffer holds the uncompressed data.
+ *
+ * This callback is registered in read_block().
+ */
+static void complete_cached_read(struct vdo_completion *completion)
+{
+	struct data_vio *data_vio = as_data_vio(completion);
+
+	assert_data_vio_on_cpu_thread(data_vio);
+	finish_read(data_vio, true);
 }
 
 static void read_endio(struct bio *bio)
@@ -1609,6 +1789,17 @@ static void read_block(struct vdo_completion *completion)
 
 	data_vio->last_async_operation = VIO_ASYNC_OP_READ_DATA_VIO;
 	if (vdo_is_state_compressed(data_vio->mapped.state)) {
+		if (vdo_get_decompressed_fragment(data_vio->mapped.zone->decompression_cache,
+						  data_vio->mapped.pbn,
+						  data_vio->mapped.state,
+						  vio->data,
+						  &data_vio->compression.cache_generation)) {
+			launch_data_vio_cpu_callback(data_vio,
+						     complete_cached_read,
+						     CPU_Q_COMPLETE_READ_PRIORITY);
+			return;
+		}
+
 		result = vio_reset_bio(vio,
 				       (char *) data_vio->compression.block,
 				       read_endio,
@@ -1759,6 +1950,7 @@ static void journal_remapping(struct vdo_completion *completion)
 
 	data_vio->decrement_updater.operation = VDO_JOURNAL_DATA_REMAPPING;
 	data_vio->decrement_updater.zpbn = data_vio->mapped;
+	data_vio->decrement_updater.coalesced = false;
 	if (data_vio->new_mapped.pbn == VDO_ZERO_BLOCK) {
 		data_vio->first_reference_operation_complete = true;
 		if (data_vio->mapped.pbn == VDO_ZERO_BLOCK)
@@ -1836,6 +2028,7 @@ static void pack_compressed_data(struct vdo_completion *completion)
 static void compress_data_vio(struct vdo_completion *completion)
 {
 	struct data_vio *data_vio = as_data_vio(completion);
+	enum vdo_compression_type type = READ_ONCE(vdo_from_data_vio(data_vio)->compression_type);
 	int size;
 
 	assert_data_vio_on_cpu_thread(data_vio);
@@ -1844,13 +2037,16 @@ static void compress_data_vio(struct vdo_completion *completion)
 	 * By putting the compressed data at the start of the compressed block data field, we won't
 	 * need to copy it if this data_vio becomes a compressed write agent.
 	 */
-	size = LZ4_compress_default(data_vio->vio.data,
-				    data_vio->compression.block->data,
-				    VDO_BLOCK_SIZE,
-				    VDO_MAX_COMPRESSED_FRAGMENT_SIZE,
-				    (char *) get_work_queue_private_data());
+	size = vdo_compress_block(get_work_queue_private_data(),
+				  type,
+				  data_vio->vio.data,
+				  data_vio->compression.block->data,
+				  VDO_MAX_COMPRESSED_FRAGMENT_SIZE);
+	vdo_record_compression_result(data_vio->logical.zone,
+				      ((size > 0) && (size < VDO_COMPRESSED_BLOCK_DATA_SIZE)));
 	if ((size > 0) && (size < VDO_COMPRESSED_BLOCK_DATA_SIZE)) {
 		data_vio->compression.size = size;
+		data_vio->compression.type = type;
 		launch_data_vio_packer_callback(data_vio, pack_compressed_data);
 		return;
 	}
@@ -1871,7 +2067,7 @@ void launch_compress_data_vio(struct data_vio *data_vio)
 			"data_vio to compress has an allocation");
 
 	/*
-	 * There are 4 reasons why a data_vio which has reached this point will not be eligible for
+	 * There are 5 reasons why a data_vio which has reached this point will not be eligible for
 	 * compression:
 	 *
 	 * 1) Since data_vios can block indefinitely in the packer, it would be bad to do so if the
@@ -1882,12 +2078,16 @@ void launch_compress_data_vio(struct data_vio *data_vio)
 	 * 3) A data_vio could be doing a partial write on behalf of a larger discard which has not
 	 * yet been acknowledged and hence blocking in the packer would be bad.
 	 *
-	 * 4) Some other data_vio may be waiting on this data_vio in which case blocking in the
+	 * 4) Recent writes to the same logical zone have mostly failed to compress, so this one
+	 * probably would too, and the attempt would only waste a cpu thread and delay the write.
+	 *
+	 * 5) Some other data_vio may be waiting on this data_vio in which case blocking in the
 	 * packer would also be bad.
 	 */
 	if (data_vio->fua ||
 	    !vdo_get_compressing(vdo_from_data_vio(data_vio)) ||
 	    ((data_vio->user_bio != NULL) && (bio_op(data_vio->user_bio) == REQ_OP_DISCARD)) ||
+	    vdo_should_bypass_compression(data_vio->logical.zone) ||
 	    (advance_data_vio_compression_stage(data_vio).stage != DATA_VIO_COMPRESSING)) {
 		write_data_vio(data_vio);
 		return;
@@ -1897,33 +2097,11 @@ void launch_compress_data_vio(struct data_vio *data_vio)
 	launch_data_vio_cpu_callback(data_vio, compress_data_vio, CPU_Q_COMPRESS_BLOCK_PRIORITY);
 }
 
-/**
- * hash_data_vio() - Hash the data in a data_vio and set the hash zone (which also flags the record
- *		     name as set).
-
- * This callback is registered in prepare_for_dedupe().
- */
-static void hash_data_vio(struct vdo_completion *completion)
-{
-	struct data_vio *data_vio = as_data_vio(completion);
-
-	assert_data_vio_on_cpu_thread(data_vio);
-	ASSERT_LOG_ONLY(!data_vio->is_zero, "zero blocks should not be hashed");
-
-	murmurhash3_128(data_vio->vio.data,
-			VDO_BLOCK_SIZE,
-			0x62ea60be,
-			&data_vio->record_name);
-
-	data_vio->hash_zone = vdo_select_hash_zone(vdo_from_data_vio(data_vio)->hash_zones,
-						   &data_vio->record_name);
-	data_vio->last_async_operation = VIO_ASYNC_OP_ACQUIRE_VDO_HASH_LOCK;
-	launch_data_vio_hash_zone_callback(data_vio, vdo_acquire_hash_lock);
-}
-
 /** prepare_for_dedupe() - Prepare for the dedupe path after attempting to get an allocation. */
 static void prepare_for_dedupe(struct data_vio *data_vio)
 {
+	struct hash_batcher *hasher = &vdo_from_data_vio(data_vio)->data_vio_pool->hasher;
+
 	/* We don't care what thread we are on. */
 	ASSERT_LOG_ONLY(!data_vio->is_zero, "must not prepare to dedupe zero blocks");
 
@@ -1932,7 +2110,8 @@ static void prepare_for_dedupe(struct data_vio *data_vio)
 	 * step is to hash the block data.
 	 */
 	data_vio->last_async_operation = VIO_ASYNC_OP_HASH_DATA_VIO;
-	launch_data_vio_cpu_callback(data_vio, hash_data_vio, CPU_Q_HASH_BLOCK_PRIORITY);
+	funnel_queue_put(hasher->queue, &data_vio->vio.completion.work_queue_entry_link);
+	schedule_hashing(hasher);
 }
 
 /**
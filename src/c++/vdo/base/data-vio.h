@@ -121,6 +121,12 @@ struct compression_state {
 	/* The compressed size of this block */
 	u16 size;
 
+	/* The compressor which produced the compressed form of this block */
+	enum vdo_compression_type type;
+
+	/* The decompression cache generation noted when a compressed read missed in the cache */
+	u64 cache_generation;
+
 	/* The packer input or output bin slot which holds the enclosing data_vio */
 	slot_number_t slot;
 
@@ -167,6 +173,8 @@ struct allocation {
 struct reference_updater {
 	enum journal_operation operation;
 	bool increment;
+	/* Whether this update was netted out against the other update of its data_vio */
+	bool coalesced;
 	struct zoned_pbn zpbn;
 	struct pbn_lock *lock;
 	struct waiter waiter;
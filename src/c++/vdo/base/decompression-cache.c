@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright Red Hat
+ */
+
+#include "decompression-cache.h"
+
+#ifndef __KERNEL__
+#include <string.h>
+#endif
+
+#include "memory-alloc.h"
+
+#include "constants.h"
+#include "status-codes.h"
+
+/**
+ * vdo_make_decompression_cache() - Make an empty decompression cache.
+ * @cache_ptr: A pointer to hold the new cache.
+ *
+ * Return: VDO_SUCCESS or an error.
+ */
+int vdo_make_decompression_cache(struct decompression_cache **cache_ptr)
+{
+	struct decompression_cache *cache;
+	unsigned int s, w;
+	char *data;
+	int result;
+
+	result = UDS_ALLOCATE(1, struct decompression_cache, __func__, &cache);
+	if (result != VDO_SUCCESS)
+		return result;
+
+	result = UDS_ALLOCATE(DECOMPRESSION_CACHE_SETS * DECOMPRESSION_CACHE_WAYS * VDO_BLOCK_SIZE,
+			      char,
+			      "decompression cache data",
+			      &cache->buffer);
+	if (result != VDO_SUCCESS) {
+		UDS_FREE(cache);
+		return result;
+	}
+
+	data = cache->buffer;
+	for (s = 0; s < DECOMPRESSION_CACHE_SETS; s++) {
+		struct decompression_cache_set *set = &cache->sets[s];
+
+		spin_lock_init(&set->lock);
+		for (w = 0; w < DECOMPRESSION_CACHE_WAYS; w++) {
+			set->entries[w].pbn = VDO_ZERO_BLOCK;
+			set->entries[w].data = data;
+			data += VDO_BLOCK_SIZE;
+		}
+	}
+
+	atomic64_set(&cache->hits, 0);
+	atomic64_set(&cache->misses, 0);
+	*cache_ptr = cache;
+	return VDO_SUCCESS;
+}
+
+/**
+ * vdo_free_decompression_cache() - Free a decompression cache.
+ * @cache: The cache to free.
+ */
+void vdo_free_decompression_cache(struct decompression_cache *cache)
+{
+	if (cache == NULL)
+		return;
+
+	UDS_FREE(UDS_FORGET(cache->buffer));
+	UDS_FREE(cache);
+}
+
+static inline struct decompression_cache_set *
+get_set(struct decompression_cache *cache, physical_block_number_t pbn)
+{
+	return &cache->sets[pbn % DECOMPRESSION_CACHE_SETS];
+}
+
+static inline u64 *get_generation(struct decompression_cache_set *set, physical_block_number_t pbn)
+{
+	return &set->generations[(pbn / DECOMPRESSION_CACHE_SETS) % DECOMPRESSION_CACHE_GENERATIONS];
+}
+
+static struct decompression_cache_entry *
+find_entry(struct decompression_cache_set *set, physical_block_number_t pbn, slot_number_t slot)
+{
+	unsigned int w;
+
+	for (w = 0; w < DECOMPRESSION_CACHE_WAYS; w++) {
+		struct decompression_cache_entry *entry = &set->entries[w];
+
+		if ((entry->pbn == pbn) && (entry->slot == slot))
+			return entry;
+	}
+
+	return NULL;
+}
+
+/**
+ * vdo_get_decompressed_fragment() - Look up the uncompressed data of a compressed fragment.
+ * @cache: The cache of the physical zone which owns the compressed block.
+ * @pbn: The compressed block.
+ * @mapping_state: The mapping state of the fragment.
+ * @buffer: The VDO_BLOCK_SIZE buffer to receive the data if it is cached.
+ * @generation_ptr: A pointer to receive the generation to pass to
+ *                  vdo_cache_decompressed_fragment() if the data is not cached.
+ *
+ * Return: true if the data was found and copied into the buffer.
+ */
+bool vdo_get_decompressed_fragment(struct decompression_cache *cache,
+				   physical_block_number_t pbn,
+				   enum block_mapping_state mapping_state,
+				   char *buffer,
+				   u64 *generation_ptr)
+{
+	struct decompression_cache_set *set = get_set(cache, pbn);
+	struct decompression_cache_entry *entry;
+
+	spin_lock(&set->lock);
+	entry = find_entry(set, pbn, mapping_state - VDO_MAPPING_STATE_COMPRESSED_BASE);
+	if (entry == NULL) {
+		*generation_ptr = *get_generation(set, pbn);
+		spin_unlock(&set->lock);
+		atomic64_inc(&cache->misses);
+		return false;
+	}
+
+	entry->last_used = ++set->clock;
+	memcpy(buffer, entry->data, VDO_BLOCK_SIZE);
+	spin_unlock(&set->lock);
+	atomic64_inc(&cache->hits);
+	return true;
+}
+
+/**
+ * vdo_cache_decompressed_fragment() - Add the uncompressed data of a fragment to the cache.
+ * @cache: The cache of the physical zone which owns the compressed block.
+ * @pbn: The compressed block.
+ * @mapping_state: The mapping state of the fragment.
+ * @data: The uncompressed data.
+ * @generation: The generation from the vdo_get_decompressed_fragment() call which missed.
+ *
+ * The data will not be cached if the block may have been reallocated since the lookup.
+ */
+void vdo_cache_decompressed_fragment(struct decompression_cache *cache,
+				     physical_block_number_t pbn,
+				     enum block_mapping_state mapping_state,
+				     const char *data,
+				     u64 generation)
+{
+	struct decompression_cache_set *set = get_set(cache, pbn);
+	slot_number_t slot = mapping_state - VDO_MAPPING_STATE_COMPRESSED_BASE;
+	struct decompression_cache_entry *entry;
+	unsigned int w;
+
+	spin_lock(&set->lock);
+	if (*get_generation(set, pbn) != generation) {
+		spin_unlock(&set->lock);
+		return;
+	}
+
+	entry = find_entry(set, pbn, slot);
+	if (entry == NULL) {
+		entry = &set->entries[0];
+		for (w = 1; w < DECOMPRESSION_CACHE_WAYS; w++) {
+			if (set->entries[w].last_used < entry->last_used)
+				entry = &set->entries[w];
+		}
+
+		entry->pbn = pbn;
+		entry->slot = slot;
+		memcpy(entry->data, data, VDO_BLOCK_SIZE);
+	}
+
+	entry->last_used = ++set->clock;
+	spin_unlock(&set->lock);
+}
+
+/**
+ * vdo_discard_decompressed_fragments() - Discard any cached fragments of a block.
+ * @cache: The cache of the physical zone which owns the block.
+ * @pbn: The block whose contents are about to change.
+ */
+void vdo_discard_decompressed_fragments(struct decompression_cache *cache,
+					physical_block_number_t pbn)
+{
+	struct decompression_cache_set *set = get_set(cache, pbn);
+	unsigned int w;
+
+	spin_lock(&set->lock);
+	(*get_generation(set, pbn))++;
+	for (w = 0; w < DECOMPRESSION_CACHE_WAYS; w++) {
+		struct decompression_cache_entry *entry = &set->entries[w];
+
+		if (entry->pbn == pbn) {
+			entry->pbn = VDO_ZERO_BLOCK;
+			entry->last_used = 0;
+		}
+	}
+	spin_unlock(&set->lock);
+}
+
+/**
+ * vdo_add_decompression_cache_statistics() - Add the statistics of a cache to a running total.
+ * @cache: The cache.
+ * @stats: The totals to update.
+ */
+void vdo_add_decompression_cache_statistics(const struct decompression_cache *cache,
+					    struct decompression_cache_statistics *stats)
+{
+	stats->hits += atomic64_read(&cache->hits);
+	stats->misses += atomic64_read(&cache->misses);
+}
@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright Red Hat
+ */
+
+#ifndef VDO_DECOMPRESSION_CACHE_H
+#define VDO_DECOMPRESSION_CACHE_H
+
+#include <linux/atomic.h>
+#include <linux/spinlock.h>
+
+#include "statistics.h"
+#include "types.h"
+
+/*
+ * A decompression cache holds the uncompressed contents of recently read compressed fragments so
+ * that reads and dedupe verifications of hot compressed blocks need neither re-read the compressed
+ * block nor uncompress the fragment again. Each physical zone has a cache for the blocks it owns.
+ *
+ * Lookups are made from the logical and hash zone threads and insertions from the cpu threads, so
+ * the cache is divided into sets, each protected by its own spin lock. All the fragments of a
+ * compressed block map to the same set so that allocating the block, which is the only way its
+ * contents can change, can discard them all at once. Within a set, the least recently used entry
+ * is replaced.
+ *
+ * A read which races with the reallocation of its block could insert stale data after the
+ * allocation has discarded the old entries. To prevent this, each set has generations which are
+ * advanced by discards; the blocks of a set are spread over several generations so that writes
+ * elsewhere in the set rarely prevent caching. A reader notes the generation of its block when it
+ * misses, and its data is only cached if that generation has not changed by the time it has been
+ * uncompressed.
+ */
+
+enum {
+	DECOMPRESSION_CACHE_SETS = 32,
+	/* Enough for every fragment of a compressed block, with room to spare */
+	DECOMPRESSION_CACHE_WAYS = 16,
+	DECOMPRESSION_CACHE_GENERATIONS = 8,
+};
+
+struct decompression_cache_entry {
+	/* The compressed block holding the fragment, or VDO_ZERO_BLOCK if the entry is unused */
+	physical_block_number_t pbn;
+	/* The slot of the fragment in the compressed block */
+	slot_number_t slot;
+	/* The set clock value when this entry was last used */
+	u64 last_used;
+	/* The uncompressed data */
+	char *data;
+};
+
+struct decompression_cache_set {
+	/* The lock protecting the set */
+	spinlock_t lock;
+	/* The number of times blocks in this set have been discarded, for each group of blocks */
+	u64 generations[DECOMPRESSION_CACHE_GENERATIONS];
+	/* The clock used to find the least recently used entry */
+	u64 clock;
+	struct decompression_cache_entry entries[DECOMPRESSION_CACHE_WAYS];
+};
+
+struct decompression_cache {
+	/* The number of lookups which found the fragment */
+	atomic64_t hits;
+	/* The number of lookups which did not find the fragment */
+	atomic64_t misses;
+	/* The memory holding the data of every entry */
+	char *buffer;
+	struct decompression_cache_set sets[DECOMPRESSION_CACHE_SETS];
+};
+
+int __must_check vdo_make_decompression_cache(struct decompression_cache **cache_ptr);
+
+void vdo_free_decompression_cache(struct decompression_cache *cache);
+
+bool __must_check vdo_get_decompressed_fragment(struct decompression_cache *cache,
+						physical_block_number_t pbn,
+						enum block_mapping_state mapping_state,
+						char *buffer,
+						u64 *generation_ptr);
+
+void vdo_cache_decompressed_fragment(struct decompression_cache *cache,
+				     physical_block_number_t pbn,
+				     enum block_mapping_state mapping_state,
+				     const char *data,
+				     u64 generation);
+
+void vdo_discard_decompressed_fragments(struct decompression_cache *cache,
+					physical_block_number_t pbn);
+
+void vdo_add_decompression_cache_statistics(const struct decompression_cache *cache,
+					    struct decompression_cache_statistics *stats);
+
+#endif /* VDO_DECOMPRESSION_CACHE_H */
@@ -134,6 +134,7 @@
 #include "completion.h"
 #include "constants.h"
 #include "data-vio.h"
+#include "decompression-cache.h"
 #include "io-submitter.h"
 #include "packer.h"
 #include "physical-zone.h"
@@ -324,6 +325,15 @@ struct hash_zone {
 	unsigned int active;
 	atomic_t timer_state;
 
+	/*
+	 * Index requests which have been prepared but not yet launched, and the completion which
+	 * launches them
+	 */
+	struct uds_request *unlaunched[DEDUPE_LAUNCH_BATCH_SIZE];
+	unsigned int unlaunched_count;
+	struct vdo_completion launcher;
+	bool launch_scheduled;
+
 	/* The dedupe contexts for querying the index from this zone */
 	struct dedupe_context contexts[MAXIMUM_VDO_USER_VIOS];
 };
@@ -374,6 +384,12 @@ static inline struct hash_zone *as_hash_zone(struct vdo_completion *completion)
 	return container_of(completion, struct hash_zone, completion);
 }
 
+static inline struct hash_zone *as_hash_zone_launcher(struct vdo_completion *completion)
+{
+	vdo_assert_completion_type(completion, VDO_DEDUPE_LAUNCH_COMPLETION);
+	return container_of(completion, struct hash_zone, launcher);
+}
+
 static inline struct hash_zones *as_hash_zones(struct vdo_completion *completion)
 {
 	vdo_assert_completion_type(completion, VDO_HASH_ZONES_COMPLETION);
@@ -1200,6 +1216,11 @@ static void uncompress_and_verify(struct vdo_completion *completion)
 
 	result = uncompress_data_vio(agent, agent->duplicate.state, agent->scratch_block);
 	if (result == VDO_SUCCESS) {
+		vdo_cache_decompressed_fragment(agent->duplicate.zone->decompression_cache,
+						agent->duplicate.pbn,
+						agent->duplicate.state,
+						agent->scratch_block,
+						agent->compression.cache_generation);
 		verify_callback(completion);
 		return;
 	}
@@ -1245,14 +1266,24 @@ static void start_verifying(struct hash_lock *lock, struct data_vio *agent)
 {
 	int result;
 	struct vio *vio = &agent->vio;
-	char *buffer = (vdo_is_state_compressed(agent->duplicate.state) ?
-			(char *) agent->compression.block :
-			agent->scratch_block);
+	bool compressed = vdo_is_state_compressed(agent->duplicate.state);
+	char *buffer = (compressed ? (char *) agent->compression.block : agent->scratch_block);
 
 	lock->state = VDO_HASH_LOCK_VERIFYING;
 	ASSERT_LOG_ONLY(!lock->verified, "hash lock only verifies advice once");
 
 	agent->last_async_operation = VIO_ASYNC_OP_VERIFY_DUPLICATION;
+	if (compressed &&
+	    vdo_get_decompressed_fragment(agent->duplicate.zone->decompression_cache,
+					  agent->duplicate.pbn,
+					  agent->duplicate.state,
+					  agent->scratch_block,
+					  &agent->compression.cache_generation)) {
+		/* The candidate's data was recently uncompressed, so there's no need to read it. */
+		launch_data_vio_cpu_callback(agent, verify_callback, CPU_Q_COMPLETE_READ_PRIORITY);
+		return;
+	}
+
 	result = vio_reset_bio(vio, buffer, verify_endio, REQ_OP_READ, agent->duplicate.pbn);
 	if (result != VDO_SUCCESS) {
 		set_data_vio_hash_zone_callback(agent, finish_verifying);
@@ -2316,6 +2347,7 @@ static int initialize_index(struct vdo *vdo, struct hash_zones *zones)
 		.memory_size = geometry.index_config.mem,
 		.sparse = geometry.index_config.sparse,
 		.nonce = (u64) geometry.nonce,
+		.huge_pages = vdo->device_config->index_huge_pages,
 	};
 
 	result = uds_create_index_session(&zones->index_session);
@@ -2461,6 +2493,100 @@ static void timeout_index_operations(struct timer_list *t)
 		vdo_invoke_completion_callback(&zone->completion);
 }
 
+#ifdef INTERNAL
+/*
+ * Apply the test hook to a batch of index requests, finishing any it fails and dropping any it
+ * takes over.
+ *
+ * Return: The number of requests left in the batch to launch.
+ */
+static unsigned int apply_launch_request_hook(struct uds_request **requests, unsigned int count)
+{
+	unsigned int kept = 0;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		int result = ((uds_launch_request_hook == NULL) ?
+			      UDS_SUCCESS :
+			      uds_launch_request_hook(requests[i]));
+
+		if (result == UDS_ERROR_CODE_LAST)
+			continue;
+
+		if (result != UDS_SUCCESS) {
+			requests[i]->status = result;
+			finish_index_operation(requests[i]);
+			continue;
+		}
+
+		requests[kept++] = requests[i];
+	}
+
+	return kept;
+}
+
+#endif /* INTERNAL */
+/**
+ * launch_index_requests() - Launch all of a hash zone's unlaunched index requests.
+ * @zone: The hash zone.
+ *
+ * The requests are launched with a single call so that UDS can queue them together.
+ */
+static void launch_index_requests(struct hash_zone *zone)
+{
+	struct uds_request **requests = zone->unlaunched;
+	unsigned int count = zone->unlaunched_count;
+	unsigned int i;
+	int result;
+
+	zone->unlaunched_count = 0;
+#ifdef INTERNAL
+	count = apply_launch_request_hook(requests, count);
+#endif /* INTERNAL */
+	result = uds_launch_requests(requests, count);
+	if (result == UDS_SUCCESS)
+		return;
+
+	for (i = 0; i < count; i++) {
+		requests[i]->status = result;
+		finish_index_operation(requests[i]);
+	}
+}
+
+/* Implements vdo_action. */
+static void launch_index_requests_callback(struct vdo_completion *completion)
+{
+	struct hash_zone *zone = as_hash_zone_launcher(completion);
+
+	zone->launch_scheduled = false;
+	launch_index_requests(zone);
+}
+
+/**
+ * add_to_launch_batch() - Add an index request to its hash zone's batch of requests to launch.
+ * @zone: The hash zone.
+ * @request: The prepared request.
+ *
+ * The batch is launched when it is full, or else when the launcher completion, which is enqueued
+ * behind whatever work the zone already has when the batch is started, runs. Requests which
+ * arrive in a burst are therefore launched together without waiting for more to arrive.
+ */
+static void add_to_launch_batch(struct hash_zone *zone, struct uds_request *request)
+{
+	zone->unlaunched[zone->unlaunched_count++] = request;
+	if (zone->unlaunched_count == DEDUPE_LAUNCH_BATCH_SIZE) {
+		launch_index_requests(zone);
+		return;
+	}
+
+	if (zone->launch_scheduled)
+		return;
+
+	zone->launch_scheduled = true;
+	zone->launcher.requeue = true;
+	vdo_invoke_completion_callback(&zone->launcher);
+}
+
 static int __must_check
 initialize_zone(struct vdo *vdo, struct hash_zones *zones, zone_count_t zone_number)
 {
@@ -2483,6 +2609,10 @@ initialize_zone(struct vdo *vdo, struct hash_zones *zones, zone_count_t zone_num
 	vdo_set_completion_callback(&zone->completion,
 				    timeout_index_operations_callback,
 				    zone->thread_id);
+	vdo_initialize_completion(&zone->launcher, vdo, VDO_DEDUPE_LAUNCH_COMPLETION);
+	vdo_set_completion_callback(&zone->launcher,
+				    launch_index_requests_callback,
+				    zone->thread_id);
 	INIT_LIST_HEAD(&zone->lock_pool);
 	result = UDS_ALLOCATE(LOCK_POOL_CAPACITY,
 			      struct hash_lock,
@@ -3046,24 +3176,6 @@ static void prepare_uds_request(struct uds_request *request,
 	}
 }
 
-#ifdef INTERNAL
-static int test_launch_request(struct uds_request *request)
-{
-	int result;
-
-	if (uds_launch_request_hook != NULL) {
-		result = uds_launch_request_hook(request);
-		if (result == UDS_ERROR_CODE_LAST)
-			return UDS_SUCCESS;
-
-		if (result != UDS_SUCCESS)
-			return result;
-	}
-
-	return uds_launch_request(request);
-}
-
-#endif /* INTERNAL */
 /*
  * The index operation will inquire about data_vio.record_name, providing (if the operation is
  * appropriate) advice from the data_vio's new_mapped fields. The advice found in the index (or
@@ -3072,7 +3184,6 @@ static int test_launch_request(struct uds_request *request)
  */
 static void query_index(struct data_vio *data_vio, enum uds_request_type operation)
 {
-	int result;
 	struct dedupe_context *context;
 	struct vdo *vdo = vdo_from_data_vio(data_vio);
 	struct hash_zone *zone = data_vio->hash_zone;
@@ -3098,15 +3209,7 @@ static void query_index(struct data_vio *data_vio, enum uds_request_type operati
 	atomic_set(&context->state, DEDUPE_CONTEXT_PENDING);
 	list_add_tail(&context->list_entry, &zone->pending);
 	start_expiration_timer(context);
-#ifdef INTERNAL
-	result = test_launch_request(&context->request);
-#else /* not INTERNAL */
-	result = uds_launch_request(&context->request);
-#endif /* INTERNAL */
-	if (result != UDS_SUCCESS) {
-		context->request.status = result;
-		finish_index_operation(&context->request);
-	}
+	add_to_launch_batch(zone, &context->request);
 }
 
 static void set_target_state(struct hash_zones *zones,
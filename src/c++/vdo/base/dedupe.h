@@ -20,6 +20,11 @@ struct hash_lock;
 struct hash_zone;
 struct hash_zones;
 
+enum {
+	/* The most index requests a hash zone will launch at once */
+	DEDUPE_LAUNCH_BATCH_SIZE = 64,
+};
+
 struct pbn_lock * __must_check vdo_get_duplicate_lock(struct data_vio *data_vio);
 
 void vdo_acquire_hash_lock(struct vdo_completion *completion);
@@ -21,6 +21,7 @@
 #include "dm-vdo/admin-state.h"
 #include "dm-vdo/block-map.h"
 #include "dm-vdo/completion.h"
+#include "dm-vdo/compressor.h"
 #include "dm-vdo/constants.h"
 #include "dm-vdo/data-vio.h"
 #include "dm-vdo/dedupe.h"
@@ -32,6 +33,7 @@
 #include "dm-vdo/logger.h"
 #include "dm-vdo/memory-alloc.h"
 #include "dm-vdo/message-stats.h"
+#include "dm-vdo/physical-zone.h"
 #include "dm-vdo/pool-sysfs.h"
 #include "dm-vdo/recovery.h"
 #include "dm-vdo/recovery-journal.h"
@@ -49,6 +51,7 @@
 #include "admin-state.h"
 #include "block-map.h"
 #include "completion.h"
+#include "compressor.h"
 #include "constants.h"
 #include "data-vio.h"
 #include "dedupe.h"
@@ -61,6 +64,7 @@
 #include "logger.h"
 #include "memory-alloc.h"
 #include "message-stats.h"
+#include "physical-zone.h"
 #include "recovery.h"
 #include "recovery-journal.h"
 #include "slab-depot.h"
@@ -260,7 +264,11 @@ static void free_device_config(struct device_config *config)
 	if (config->owned_device != NULL)
 		dm_put_device(config->owning_target, config->owned_device);
 
+	if (config->journal_device != NULL)
+		dm_put_device(config->owning_target, config->journal_device);
+
 	UDS_FREE(config->parent_device_name);
+	UDS_FREE(config->journal_device_name);
 	UDS_FREE(config->original_string);
 
 	/* Reduce the chance a use-after-free (as in BZ 1669960) happens to work. */
@@ -455,6 +463,55 @@ parse_bool(const char *bool_str, const char *true_str, const char *false_str, bo
 	return VDO_SUCCESS;
 }
 
+/*
+ * parse_cache_policy() - Parse the name of a block map cache replacement policy.
+ * @policy_str: The string value to convert.
+ * @policy_ptr: A pointer to return the policy in.
+ *
+ * Return: VDO_SUCCESS or an error if policy_str is neither "lru" nor "2q".
+ */
+static int __must_check
+parse_cache_policy(const char *policy_str, enum block_map_cache_policy *policy_ptr)
+{
+	if (strcmp(policy_str, "lru") == 0) {
+		*policy_ptr = VDO_BLOCK_MAP_CACHE_LRU;
+		return VDO_SUCCESS;
+	}
+
+	if (strcmp(policy_str, "2q") == 0) {
+		*policy_ptr = VDO_BLOCK_MAP_CACHE_2Q;
+		return VDO_SUCCESS;
+	}
+
+	uds_log_error("optional parameter error: unknown block map cache policy \"%s\"",
+		      policy_str);
+	return VDO_BAD_CONFIGURATION;
+}
+
+/**
+ * parse_compression_type() - Parse the name of a compressor.
+ * @type_str: The string value to convert.
+ * @type_ptr: A pointer to return the compressor in.
+ *
+ * Return: VDO_SUCCESS or an error if type_str does not name a compressor available in this build.
+ */
+static int __must_check
+parse_compression_type(const char *type_str, enum vdo_compression_type *type_ptr)
+{
+	enum vdo_compression_type type;
+
+	for (type = VDO_COMPRESSION_LZ4; type <= VDO_COMPRESSION_ZSTD; type++) {
+		if ((strcmp(type_str, vdo_get_compression_type_name(type)) == 0) &&
+		    vdo_is_compression_type_supported(type)) {
+			*type_ptr = type;
+			return VDO_SUCCESS;
+		}
+	}
+
+	uds_log_error("optional parameter error: unknown compression type \"%s\"", type_str);
+	return VDO_BAD_CONFIGURATION;
+}
+
 /**
  * process_one_thread_config_spec() - Process one component of a thread parameter configuration
  *				      string and update the configuration data structure.
@@ -650,6 +707,24 @@ process_one_key_value_pair(const char *key, unsigned int value, struct device_co
 		config->max_discard_blocks = value;
 		return VDO_SUCCESS;
 	}
+	if (strcmp(key, "journalCommitWindow") == 0) {
+		if (value > VDO_MAX_JOURNAL_COMMIT_WINDOW) {
+			uds_log_error("optional parameter error: at most %d milliseconds of journal commit window are allowed",
+				      VDO_MAX_JOURNAL_COMMIT_WINDOW);
+			return -EINVAL;
+		}
+		config->journal_commit_window = value;
+		return VDO_SUCCESS;
+	}
+	if (strcmp(key, "allocationExtent") == 0) {
+		if (value > VDO_MAX_ALLOCATION_EXTENT) {
+			uds_log_error("optional parameter error: at most %d blocks may be reserved for an allocation extent",
+				      VDO_MAX_ALLOCATION_EXTENT);
+			return -EINVAL;
+		}
+		config->allocation_extent = value;
+		return VDO_SUCCESS;
+	}
 	/* Handles unknown key names */
 	return process_one_thread_config_spec(key, value, &config->thread_counts);
 }
@@ -675,6 +750,24 @@ parse_one_key_value_pair(const char *key, const char *value, struct device_confi
 	if (strcmp(key, "compression") == 0)
 		return parse_bool(value, "on", "off", &config->compression);
 
+	if (strcmp(key, "indexHugePages") == 0)
+		return parse_bool(value, "on", "off", &config->index_huge_pages);
+
+	if (strcmp(key, "blockMapCachePolicy") == 0)
+		return parse_cache_policy(value, &config->cache_policy);
+
+	if (strcmp(key, "compressionType") == 0)
+		return parse_compression_type(value, &config->compression_type);
+
+	if (strcmp(key, "packerLookahead") == 0)
+		return parse_bool(value, "on", "off", &config->packer_lookahead);
+
+	if (strcmp(key, "journalDevice") == 0) {
+		UDS_FREE(config->journal_device_name);
+		return uds_duplicate_string(value, "journal device name",
+					    &config->journal_device_name);
+	}
+
 	/* The remaining arguments must have integral values. */
 	result = kstrtouint(value, 10, &count);
 	if (result != UDS_SUCCESS) {
@@ -831,7 +924,13 @@ static int parse_device_config(int argc,
 	};
 	config->max_discard_blocks = 1;
 	config->deduplication = true;
+	config->index_huge_pages = false;
 	config->compression = false;
+	config->compression_type = VDO_COMPRESSION_LZ4;
+	config->packer_lookahead = false;
+	config->journal_commit_window = 0;
+	config->allocation_extent = 0;
+	config->cache_policy = VDO_BLOCK_MAP_CACHE_LRU;
 
 	arg_set.argc = argc;
 	arg_set.argv = argv;
@@ -955,6 +1054,20 @@ static int parse_device_config(int argc,
 		return VDO_BAD_CONFIGURATION;
 	}
 
+	if (config->journal_device_name != NULL) {
+		result = dm_get_device(ti,
+				       config->journal_device_name,
+				       dm_table_get_mode(ti->table),
+				       &config->journal_device);
+		if (result != 0) {
+			uds_log_error("couldn't open journal device \"%s\": error %d",
+				      config->journal_device_name,
+				      result);
+			handle_parse_error(config, error_ptr, "Unable to open journal device");
+			return VDO_BAD_CONFIGURATION;
+		}
+	}
+
 	if (config->version == 0) {
 		u64 device_size = i_size_read(config->owned_device->bdev->bd_inode);
 
@@ -1107,11 +1220,20 @@ static void vdo_io_hints(struct dm_target *ti, struct queue_limits *limits)
 static int vdo_iterate_devices(struct dm_target *ti, iterate_devices_callout_fn fn, void *data)
 {
 	struct device_config *config = get_vdo_for_target(ti)->device_config;
+	int result;
+
+	result = fn(ti,
+		    config->owned_device,
+		    0,
+		    config->physical_blocks * VDO_SECTORS_PER_BLOCK,
+		    data);
+	if ((result != 0) || (config->journal_device == NULL))
+		return result;
 
 	return fn(ti,
-		  config->owned_device,
+		  config->journal_device,
 		  0,
-		  config->physical_blocks * VDO_SECTORS_PER_BLOCK,
+		  i_size_read(config->journal_device->bdev->bd_inode) >> SECTOR_SHIFT,
 		  data);
 }
 
@@ -1423,6 +1545,40 @@ static void finish_operation_callback(struct vdo_completion *completion)
 	complete(&admin->callback_sync);
 }
 
+/**
+ * validate_journal_device() - Check that the journal device in the device config matches the one
+ *                             recorded in the layout.
+ * @vdo: The vdo being loaded.
+ *
+ * Return: VDO_SUCCESS or an error.
+ */
+static int __must_check validate_journal_device(struct vdo *vdo)
+{
+	const struct device_config *config = vdo->device_config;
+	block_count_t journal_size, device_size;
+
+	journal_size = vdo_get_fixed_layout_journal_device_size(vdo->states.layout);
+	if ((journal_size > 0) != vdo_uses_journal_device(vdo)) {
+		return uds_log_error_strerror(VDO_PARAMETER_MISMATCH,
+					      ((journal_size > 0) ?
+					       "vdo requires a journal device" :
+					       "vdo was not formatted with a journal device"));
+	}
+
+	if (journal_size == 0)
+		return VDO_SUCCESS;
+
+	device_size = i_size_read(config->journal_device->bdev->bd_inode) / VDO_BLOCK_SIZE;
+	if (device_size < journal_size) {
+		return uds_log_error_strerror(VDO_PARAMETER_MISMATCH,
+					      "journal device has %llu blocks, but the vdo requires %llu",
+					      (unsigned long long) device_size,
+					      (unsigned long long) journal_size);
+	}
+
+	return VDO_SUCCESS;
+}
+
 /**
  * decode_from_super_block() - Decode the VDO state from the super block and validate that it is
  *                             correct.
@@ -1465,6 +1621,10 @@ static int __must_check decode_from_super_block(struct vdo *vdo)
 	if (result != VDO_SUCCESS)
 		return result;
 
+	result = validate_journal_device(vdo);
+	if (result != VDO_SUCCESS)
+		return result;
+
 	return vdo_decode_layout(vdo->states.layout, &vdo->layout);
 }
 
@@ -1534,6 +1694,7 @@ static int __must_check decode_vdo(struct vdo *vdo)
 				      vdo->recovery_journal,
 				      vdo->states.vdo.nonce,
 				      vdo->device_config->cache_size,
+				      vdo->device_config->cache_policy,
 				      maximum_age,
 				      &vdo->block_map);
 	if (result != VDO_SUCCESS)
@@ -1631,8 +1792,18 @@ vdo_initialize(struct dm_target *ti, unsigned int instance, struct device_config
 	uds_log_debug("Physical blocks        = %llu", config->physical_blocks);
 	uds_log_debug("Block map cache blocks = %u", config->cache_size);
 	uds_log_debug("Block map maximum age  = %u", config->block_map_maximum_age);
+	uds_log_debug("Block map cache policy = %s",
+		      ((config->cache_policy == VDO_BLOCK_MAP_CACHE_2Q) ? "2q" : "lru"));
 	uds_log_debug("Deduplication          = %s", (config->deduplication ? "on" : "off"));
+	uds_log_debug("Index huge pages       = %s", (config->index_huge_pages ? "on" : "off"));
 	uds_log_debug("Compression            = %s", (config->compression ? "on" : "off"));
+	uds_log_debug("Compression type       = %s",
+		      vdo_get_compression_type_name(config->compression_type));
+	uds_log_debug("Packer look-ahead      = %s", (config->packer_lookahead ? "on" : "off"));
+	uds_log_debug("Journal commit window  = %u ms", config->journal_commit_window);
+	uds_log_debug("Allocation extent      = %u blocks", config->allocation_extent);
+	uds_log_debug("Journal device         = %s",
+		      ((config->journal_device_name == NULL) ? "none" : config->journal_device_name));
 
 	vdo = vdo_find_matching(vdo_uses_device, config);
 	if (vdo != NULL) {
@@ -1906,6 +2077,11 @@ static int validate_new_device_config(struct device_config *to_validate,
 		return VDO_PARAMETER_MISMATCH;
 	}
 
+	if (to_validate->cache_policy != config->cache_policy) {
+		*error_ptr = "Block map cache policy cannot change";
+		return VDO_PARAMETER_MISMATCH;
+	}
+
 	if (memcmp(&to_validate->thread_counts,
 		   &config->thread_counts,
 		   sizeof(struct thread_count_config)) != 0) {
@@ -1913,6 +2089,23 @@ static int validate_new_device_config(struct device_config *to_validate,
 		return VDO_PARAMETER_MISMATCH;
 	}
 
+	if (to_validate->index_huge_pages != config->index_huge_pages) {
+		*error_ptr = "Index huge pages setting cannot change";
+		return VDO_PARAMETER_MISMATCH;
+	}
+
+	if ((to_validate->journal_device_name == NULL) != (config->journal_device_name == NULL)) {
+		*error_ptr = "Journal device cannot be added or removed";
+		return VDO_PARAMETER_MISMATCH;
+	}
+
+	/* A different journal device would need its geometry copy and nonce checked again. */
+	if ((config->journal_device_name != NULL) &&
+	    (strcmp(to_validate->journal_device_name, config->journal_device_name) != 0)) {
+		*error_ptr = "Journal device cannot change";
+		return VDO_PARAMETER_MISMATCH;
+	}
+
 	if (to_validate->physical_blocks < config->physical_blocks) {
 		*error_ptr = "Removing physical storage from a VDO is not supported";
 		return VDO_NOT_IMPLEMENTED;
@@ -2416,6 +2609,7 @@ static void load_callback(struct vdo_completion *completion)
 
 	case LOAD_PHASE_DATA_REDUCTION:
 		WRITE_ONCE(vdo->compressing, vdo->device_config->compression);
+		WRITE_ONCE(vdo->compression_type, vdo->device_config->compression_type);
 		if (vdo->device_config->deduplication)
 			/*
 			 * Don't try to load or rebuild the index first (and log scary error
@@ -2542,10 +2736,14 @@ static void resume_callback(struct vdo_completion *completion)
 		return;
 
 	case RESUME_PHASE_DEPOT:
+		vdo_set_allocation_extent_size(vdo->physical_zones,
+					       vdo->device_config->allocation_extent);
 		vdo_resume_slab_depot(vdo->depot, completion);
 		return;
 
 	case RESUME_PHASE_JOURNAL:
+		vdo_set_recovery_journal_commit_window(vdo->recovery_journal,
+						       vdo->device_config->journal_commit_window);
 		vdo_resume_recovery_journal(vdo->recovery_journal, completion);
 		return;
 
@@ -2566,6 +2764,10 @@ static void resume_callback(struct vdo_completion *completion)
 			WRITE_ONCE(vdo->compressing, enable);
 		uds_log_info("compression is %s", (enable ? "enabled" : "disabled"));
 
+		/* The packer is empty while suspended, so no bin can mix compressors. */
+		WRITE_ONCE(vdo->compression_type, vdo->device_config->compression_type);
+		vdo_set_packer_lookahead(vdo->packer, vdo->device_config->packer_lookahead);
+
 		vdo_resume_packer(vdo->packer, completion);
 		return;
 	}
@@ -8,6 +8,9 @@
 #include <linux/bio.h>
 #include <linux/kernel.h>
 #include <linux/mutex.h>
+#ifndef VDO_UPSTREAM
+#include <linux/version.h>
+#endif /* VDO_UPSTREAM */
 
 #include "memory-alloc.h"
 #include "permassert.h"
@@ -18,6 +21,24 @@
 #include "vdo.h"
 #include "vio.h"
 
+/*
+ * A write to the journal device which requests a preflush must first flush the backing device,
+ * since the data and metadata it commits live there. Each bio queue keeps at most one such flush
+ * in flight; journal bios which arrive while it is outstanding wait for the next one, so a burst
+ * of journal writes shares a single flush of the backing device.
+ */
+struct journal_flush {
+	/* The completion which resumes the journal bios on the bio thread */
+	struct vdo_completion completion;
+	/* The flush of the backing device */
+	struct bio *bio;
+	bool active;
+	/* The journal bios which will be submitted when the active flush finishes */
+	struct bio_list flushing;
+	/* The journal bios which arrived after the active flush was issued */
+	struct bio_list waiting;
+};
+
 /*
  * Submission of bio operations to the underlying storage device will go through a separate work
  * queue thread (or more than one) to prevent blocking in other threads if the storage device has a
@@ -39,6 +60,7 @@ struct bio_queue_data {
 	struct int_map *map;
 	struct mutex lock;
 	unsigned int queue_number;
+	struct journal_flush journal_flush;
 };
 
 struct io_submitter {
@@ -106,6 +128,120 @@ static void assert_in_bio_zone(struct vio *vio)
 	assert_vio_in_bio_zone(vio);
 }
 
+static void journal_flush_endio(struct bio *bio)
+{
+	struct journal_flush *flush = bio->bi_private;
+
+	vdo_enqueue_completion_with_priority(&flush->completion, BIO_Q_FLUSH_PRIORITY);
+}
+
+/**
+ * launch_journal_flush() - Flush the backing device on behalf of the waiting journal bios.
+ * @flush: The journal flush of a bio queue.
+ */
+static void launch_journal_flush(struct journal_flush *flush)
+{
+	struct vdo *vdo = flush->completion.vdo;
+	struct bio *bio = flush->bio;
+
+#ifndef VDO_UPSTREAM
+#undef VDO_USE_ALTERNATE
+#ifdef RHEL_RELEASE_CODE
+#if (RHEL_RELEASE_CODE < RHEL_RELEASE_VERSION(9, 1))
+#define VDO_USE_ALTERNATE
+#endif
+#else /* !RHEL_RELEASE_CODE */
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 18, 0))
+#define VDO_USE_ALTERNATE
+#endif
+#endif /* !RHEL_RELEASE_CODE */
+#endif /* !VDO_UPSTREAM */
+#ifdef VDO_USE_ALTERNATE
+	bio_init(bio, 0, 0);
+	bio_set_dev(bio, vdo_get_backing_device(vdo));
+	bio->bi_opf = REQ_OP_WRITE | REQ_PREFLUSH;
+#else
+	bio_init(bio, vdo_get_backing_device(vdo), 0, 0, REQ_OP_WRITE | REQ_PREFLUSH);
+#endif
+	bio->bi_end_io = journal_flush_endio;
+	bio->bi_private = flush;
+	flush->active = true;
+	atomic64_inc(&vdo->stats.flush_out);
+	submit_bio_noacct(bio);
+}
+
+/**
+ * finish_journal_flush() - Submit the journal bios which were waiting for a flush of the backing
+ *                          device, and start the next flush if more have arrived.
+ * @completion: The journal flush completion.
+ *
+ * This callback is registered in vdo_make_io_submitter().
+ */
+static void finish_journal_flush(struct vdo_completion *completion)
+{
+	struct journal_flush *flush = container_of(completion, struct journal_flush, completion);
+	struct vdo *vdo = completion->vdo;
+	int result = blk_status_to_errno(flush->bio->bi_status);
+	struct bio_list flushed;
+	struct bio *bio;
+
+	bio_uninit(flush->bio);
+	bio_list_init(&flushed);
+	bio_list_merge(&flushed, &flush->flushing);
+	bio_list_init(&flush->flushing);
+	bio_list_merge(&flush->flushing, &flush->waiting);
+	bio_list_init(&flush->waiting);
+	flush->active = false;
+	if (!bio_list_empty(&flush->flushing))
+		launch_journal_flush(flush);
+
+	if (result != VDO_SUCCESS)
+		uds_log_error_strerror(result,
+				       "backing device flush for journal device write failed");
+
+	while ((bio = bio_list_pop(&flushed)) != NULL) {
+		if (result != VDO_SUCCESS) {
+			bio->bi_status = errno_to_blk_status(result);
+			bio_endio(bio);
+			continue;
+		}
+
+		bio_set_dev(bio, vdo_get_journal_device(vdo));
+		submit_bio_noacct(bio);
+	}
+}
+
+/**
+ * send_bio_to_journal_device() - Submit a bio to the vdo's separate journal device.
+ * @vio: The vio associated with the bio.
+ * @bio: The bio to submit.
+ *
+ * The data, block map pages, and slab journal blocks which the recovery journal and slab summary
+ * refer to are on the backing device, so a flush before a journal device write must also flush
+ * the backing device. Such a bio is held until a flush of the backing device, issued after it
+ * arrived, has finished.
+ */
+static void send_bio_to_journal_device(struct vio *vio, struct bio *bio)
+{
+	struct vdo *vdo = vio->completion.vdo;
+	struct journal_flush *flush;
+
+	if ((bio->bi_opf & REQ_PREFLUSH) != REQ_PREFLUSH) {
+		bio_set_dev(bio, vdo_get_journal_device(vdo));
+		submit_bio_noacct(bio);
+		return;
+	}
+
+	flush = &vdo->io_submitter->bio_queue_data[vio->bio_zone].journal_flush;
+	if (flush->active) {
+		bio_list_add(&flush->waiting, bio);
+		return;
+	}
+
+	bio_list_add(&flush->flushing, bio);
+	launch_journal_flush(flush);
+}
+
 /**
  * send_bio_to_device() - Update stats and tracing info, then submit the supplied bio to the OS for
  *                        processing.
@@ -129,6 +265,11 @@ static void send_bio_to_device(struct vio *vio, struct bio *bio)
 			       jiffies - vio->bio_submission_jiffies);
 	vio->bio_submission_jiffies = jiffies;
 #endif
+	if (vio_uses_journal_device(vio)) {
+		send_bio_to_journal_device(vio, bio);
+		return;
+	}
+
 	bio_set_dev(bio, vdo_get_backing_device(vdo));
 	submit_bio_noacct(bio);
 }
@@ -429,6 +570,14 @@ int vdo_make_io_submitter(unsigned int thread_count,
 		struct bio_queue_data *bio_queue_data = &io_submitter->bio_queue_data[i];
 
 		mutex_init(&bio_queue_data->lock);
+		bio_list_init(&bio_queue_data->journal_flush.flushing);
+		bio_list_init(&bio_queue_data->journal_flush.waiting);
+		vdo_initialize_completion(&bio_queue_data->journal_flush.completion,
+					  vdo,
+					  VDO_JOURNAL_FLUSH_COMPLETION);
+		vdo_set_completion_callback(&bio_queue_data->journal_flush.completion,
+					    finish_journal_flush,
+					    vdo->thread_config->bio_threads[i]);
 		/*
 		 * One I/O operation per request, but both first & last sector numbers.
 		 *
@@ -449,6 +598,15 @@ int vdo_make_io_submitter(unsigned int thread_count,
 			return result;
 		}
 
+		result = UDS_ALLOCATE(1, struct bio, "journal flush bio",
+				      &bio_queue_data->journal_flush.bio);
+		if (result != VDO_SUCCESS) {
+			free_int_map(UDS_FORGET(bio_queue_data->map));
+			vdo_cleanup_io_submitter(io_submitter);
+			vdo_free_io_submitter(io_submitter);
+			return result;
+		}
+
 		bio_queue_data->queue_number = i;
 		result = vdo_make_thread(vdo,
 					 vdo->thread_config->bio_threads[i],
@@ -461,6 +619,7 @@ int vdo_make_io_submitter(unsigned int thread_count,
 			 * initialization failed.
 			 */
 			free_int_map(UDS_FORGET(bio_queue_data->map));
+			UDS_FREE(UDS_FORGET(bio_queue_data->journal_flush.bio));
 			uds_log_error("bio queue initialization failed %d", result);
 			vdo_cleanup_io_submitter(io_submitter);
 			vdo_free_io_submitter(io_submitter);
@@ -510,6 +669,7 @@ void vdo_free_io_submitter(struct io_submitter *io_submitter)
 		/* vdo_destroy() will free the work queue, so just give up our reference to it. */
 		UDS_FORGET(io_submitter->bio_queue_data[i].queue);
 		free_int_map(UDS_FORGET(io_submitter->bio_queue_data[i].map));
+		UDS_FREE(UDS_FORGET(io_submitter->bio_queue_data[i].journal_flush.bio));
 	}
 	UDS_FREE(io_submitter);
 }
@@ -65,6 +65,7 @@ static int initialize_zone(struct logical_zones *zones, zone_count_t zone_number
 		zone->next = &zones->zones[zone_number + 1];
 
 	vdo_initialize_completion(&zone->completion, vdo, VDO_GENERATION_FLUSHED_COMPLETION);
+	vdo_initialize_completion(&zone->extent_completion, vdo, VDO_EXTENT_RELEASE_COMPLETION);
 	zone->zones = zones;
 	zone->zone_number = zone_number;
 	zone->thread_id = vdo_get_logical_zone_thread(vdo->thread_config, zone_number);
@@ -158,7 +159,7 @@ static inline void assert_on_zone_thread(struct logical_zone *zone, const char *
 static void check_for_drain_complete(struct logical_zone *zone)
 {
 	if (!vdo_is_state_draining(&zone->state) || zone->notifying ||
-	    !list_empty(&zone->write_vios))
+	    (zone->extent_release_zone != NULL) || !list_empty(&zone->write_vios))
 		return;
 
 	vdo_finish_draining(&zone->state);
@@ -348,17 +349,145 @@ void vdo_release_flush_generation_lock(struct data_vio *data_vio)
 	attempt_generation_complete_notification(&zone->completion);
 }
 
+/**
+ * finish_extent_release() - Note that a physical zone has returned the extent of a logical zone.
+ * @completion: The zone's extent completion.
+ *
+ * This callback is registered in release_extent().
+ */
+static void finish_extent_release(struct vdo_completion *completion)
+{
+	struct logical_zone *zone = container_of(completion, struct logical_zone,
+						 extent_completion);
+
+	assert_on_zone_thread(zone, __func__);
+	zone->extent_release_zone = NULL;
+	check_for_drain_complete(zone);
+}
+
+/**
+ * release_extent() - Return the blocks a physical zone reserved for this zone's stream.
+ * @completion: The zone's extent completion.
+ *
+ * This callback is registered in vdo_get_next_allocation_zone().
+ */
+static void release_extent(struct vdo_completion *completion)
+{
+	struct logical_zone *zone = container_of(completion, struct logical_zone,
+						 extent_completion);
+
+	vdo_release_allocation_extent(zone->extent_release_zone, zone->zone_number);
+	vdo_launch_completion_callback(completion, finish_extent_release, zone->thread_id);
+}
+
 struct physical_zone *vdo_get_next_allocation_zone(struct logical_zone *zone)
 {
 	if (zone->allocation_count == ALLOCATIONS_PER_ZONE) {
+		struct physical_zone *old_zone = zone->allocation_zone;
+
 		zone->allocation_count = 0;
-		zone->allocation_zone = zone->allocation_zone->next;
+		zone->allocation_zone = old_zone->next;
+
+		/*
+		 * The rest of any extent in the old zone would only be returned at the next
+		 * suspend. If a release is still in progress, the extent is returned then instead.
+		 */
+		if ((old_zone->extent_size > 0) && (zone->allocation_zone != old_zone) &&
+		    (zone->extent_release_zone == NULL)) {
+			zone->extent_release_zone = old_zone;
+			vdo_launch_completion_callback(&zone->extent_completion, release_extent,
+						       old_zone->thread_id);
+		}
 	}
 
 	zone->allocation_count++;
 	return zone->allocation_zone;
 }
 
+/**
+ * vdo_should_bypass_compression() - Check whether a write should skip compression because recent
+ *                                   writes to its zone have not been compressible.
+ * @zone: The logical zone of the write.
+ *
+ * Context: This may be called from any thread.
+ * Return: true if the write should not be compressed.
+ */
+bool vdo_should_bypass_compression(struct logical_zone *zone)
+{
+	struct compressibility_tracker *tracker = &zone->compressibility;
+
+	if (atomic_read(&tracker->bypassing) == 0)
+		return false;
+
+	if ((atomic_inc_return(&tracker->considered) % COMPRESSION_SAMPLE_INTERVAL) == 0) {
+		atomic64_inc(&tracker->blocks_sampled);
+		return false;
+	}
+
+	atomic64_inc(&tracker->blocks_skipped);
+	return true;
+}
+
+/**
+ * vdo_record_compression_result() - Record the outcome of compressing a write.
+ * @zone: The logical zone of the write.
+ * @compressed: Whether the write compressed to a packable fragment.
+ *
+ * At the end of each window of attempts, compression is bypassed or resumed according to the
+ * fraction of the attempts which succeeded. Updates racing with the end of a window may be lost,
+ * which only makes the estimate slightly noisier.
+ *
+ * Context: This may be called from any thread.
+ */
+void vdo_record_compression_result(struct logical_zone *zone, bool compressed)
+{
+	struct compressibility_tracker *tracker = &zone->compressibility;
+	int successes;
+
+	if (compressed)
+		atomic_inc(&tracker->successes);
+
+	if (atomic_inc_return(&tracker->attempts) != COMPRESSIBILITY_WINDOW)
+		return;
+
+	successes = atomic_read(&tracker->successes);
+	atomic_set(&tracker->successes, 0);
+	atomic_set(&tracker->attempts, 0);
+	if ((successes * COMPRESSIBILITY_THRESHOLD) >= COMPRESSIBILITY_WINDOW) {
+		atomic_set(&tracker->bypassing, 0);
+		return;
+	}
+
+	if (atomic_cmpxchg(&tracker->bypassing, 0, 1) == 0)
+		atomic_set(&tracker->considered, 0);
+}
+
+/**
+ * vdo_get_compression_bypass_statistics() - Get the compression bypass statistics for all zones.
+ * @zones: The logical zones to query.
+ *
+ * Return: The sum of the statistics from each zone.
+ */
+struct compression_bypass_statistics
+vdo_get_compression_bypass_statistics(const struct logical_zones *zones)
+{
+	struct compression_bypass_statistics stats = {
+		.blocks_skipped = 0,
+		.blocks_sampled = 0,
+	};
+	zone_count_t zone;
+
+	for (zone = 0; zone < zones->zone_count; zone++) {
+		const struct compressibility_tracker *tracker =
+			&zones->zones[zone].compressibility;
+
+		stats.blocks_skipped += atomic64_read(&tracker->blocks_skipped);
+		stats.blocks_sampled += atomic64_read(&tracker->blocks_sampled);
+	}
+
+	return stats;
+}
+
 /**
  * vdo_dump_logical_zone() - Dump information about a logical zone to the log for debugging.
  * @zone: The zone to dump
@@ -375,4 +504,6 @@ void vdo_dump_logical_zone(const struct logical_zone *zone)
 		     (unsigned long long) READ_ONCE(zone->notification_generation),
 		     uds_bool_to_string(READ_ONCE(zone->notifying)),
 		     (unsigned long long) READ_ONCE(zone->ios_in_flush_generation));
+	uds_log_info("  compression bypassed=%s",
+		     uds_bool_to_string(atomic_read(&zone->compressibility.bypassing) != 0));
 }
@@ -6,14 +6,46 @@
 #ifndef VDO_LOGICAL_ZONE_H
 #define VDO_LOGICAL_ZONE_H
 
+#include <linux/atomic.h>
 #include <linux/list.h>
 
 #include "admin-state.h"
 #include "int-map.h"
+#include "statistics.h"
 #include "types.h"
 
 struct physical_zone;
 
+enum {
+	/* The number of compression attempts over which compressibility is judged */
+	COMPRESSIBILITY_WINDOW = 32,
+	/* Compression is bypassed if fewer than 1 in this many attempts succeed */
+	COMPRESSIBILITY_THRESHOLD = 8,
+	/* While bypassing, one in this many blocks is compressed anyway */
+	COMPRESSION_SAMPLE_INTERVAL = 16,
+};
+
+/*
+ * Writes to a zone stop being compressed when too few of the recent attempts produced a fragment
+ * small enough to pack. While compression is bypassed, a sample of blocks is still compressed so
+ * that compression resumes once the data becomes compressible again. The tracker is updated from
+ * the hash zone and cpu threads, so all of its fields are atomic.
+ */
+struct compressibility_tracker {
+	/* The number of compression attempts in the current window */
+	atomic_t attempts;
+	/* The number of those attempts which produced a packable fragment */
+	atomic_t successes;
+	/* Whether compression is being bypassed */
+	atomic_t bypassing;
+	/* The number of blocks considered since compression started being bypassed */
+	atomic_t considered;
+	/* The number of blocks written without attempting compression */
+	atomic64_t blocks_skipped;
+	/* The number of blocks compressed to sample compressibility while bypassing */
+	atomic64_t blocks_sampled;
+};
+
 struct logical_zone {
 	/* The completion for flush notifications */
 	struct vdo_completion completion;
@@ -48,6 +80,12 @@ struct logical_zone {
 	struct physical_zone *allocation_zone;
 	/* The number of allocations done from the current allocation_zone */
 	block_count_t allocation_count;
+	/* The completion for returning this zone's extent to a physical zone it has left */
+	struct vdo_completion extent_completion;
+	/* The physical zone whose extent is being returned, or NULL if none is */
+	struct physical_zone *extent_release_zone;
+	/* The recent compressibility of writes to this zone */
+	struct compressibility_tracker compressibility;
 	/* The next zone */
 	struct logical_zone *next;
 };
@@ -82,6 +120,13 @@ void vdo_release_flush_generation_lock(struct data_vio *data_vio);
 
 struct physical_zone * __must_check vdo_get_next_allocation_zone(struct logical_zone *zone);
 
+bool __must_check vdo_should_bypass_compression(struct logical_zone *zone);
+
+void vdo_record_compression_result(struct logical_zone *zone, bool compressed);
+
+struct compression_bypass_statistics __must_check
+vdo_get_compression_bypass_statistics(const struct logical_zones *zones);
+
 void vdo_dump_logical_zone(const struct logical_zone *zone);
 
 #endif /* VDO_LOGICAL_ZONE_H */
@@ -26,11 +26,21 @@
 #include "vdo.h"
 #include "vio.h"
 
+/*
+ * The minor version of a compressed block records the format of its fragments: 1.0 blocks hold
+ * LZ4 fragments, which both LZ4 and LZ4HC produce, and 1.1 blocks hold zstd fragments. LZ4 blocks
+ * keep the original version so that they remain readable by older versions of VDO.
+ */
 static const struct version_number COMPRESSED_BLOCK_1_0 = {
 	.major_version = 1,
 	.minor_version = 0,
 };
 
+static const struct version_number COMPRESSED_BLOCK_1_1 = {
+	.major_version = 1,
+	.minor_version = 1,
+};
+
 enum {
 	COMPRESSED_BLOCK_1_0_SIZE = 4 + 4 + (2 * VDO_MAX_COMPRESSION_SLOTS),
 };
@@ -40,6 +50,7 @@ enum {
  *                                       block.
  * @mapping_state [in] The mapping state for the look up.
  * @compressed_block [in] The compressed block that was read from disk.
+ * @fragment_type [out] The compressor which can uncompress the fragment.
  * @fragment_offset [out] The offset of the fragment within a compressed block.
  * @fragment_size [out] The size of the fragment.
  *
@@ -48,6 +59,7 @@ enum {
  */
 int vdo_get_compressed_block_fragment(enum block_mapping_state mapping_state,
 				      struct compressed_block *block,
+				      enum vdo_compression_type *fragment_type,
 				      u16 *fragment_offset,
 				      u16 *fragment_size)
 {
@@ -61,7 +73,11 @@ int vdo_get_compressed_block_fragment(enum block_mapping_state mapping_state,
 		return VDO_INVALID_FRAGMENT;
 
 	version = vdo_unpack_version_number(block->header.version);
-	if (!vdo_are_same_version(version, COMPRESSED_BLOCK_1_0))
+	if (vdo_are_same_version(version, COMPRESSED_BLOCK_1_0))
+		*fragment_type = VDO_COMPRESSION_LZ4;
+	else if (vdo_are_same_version(version, COMPRESSED_BLOCK_1_1))
+		*fragment_type = VDO_COMPRESSION_ZSTD;
+	else
 		return VDO_INVALID_FRAGMENT;
 
 	slot = mapping_state - VDO_MAPPING_STATE_COMPRESSED_BASE;
@@ -159,6 +175,7 @@ int vdo_make_packer(struct vdo *vdo, block_count_t bin_count, struct packer **pa
 
 	packer->thread_id = vdo->thread_config->packer_thread;
 	packer->size = bin_count;
+	packer->lookahead = vdo->device_config->packer_lookahead;
 	INIT_LIST_HEAD(&packer->bins);
 	vdo_set_admin_state_code(&packer->state, VDO_ADMIN_STATE_NORMAL_OPERATION);
 
@@ -184,6 +201,15 @@ int vdo_make_packer(struct vdo *vdo, block_count_t bin_count, struct packer **pa
 		return result;
 	}
 
+	result = UDS_ALLOCATE_EXTENDED(struct packer_bin,
+				       PACKER_LOOKAHEAD_WINDOW,
+				       struct vio *, __func__,
+				       &packer->window);
+	if (result != VDO_SUCCESS) {
+		vdo_free_packer(packer);
+		return result;
+	}
+
 	result = vdo_make_default_thread(vdo, packer->thread_id);
 	if (result != VDO_SUCCESS) {
 		vdo_free_packer(packer);
@@ -210,6 +236,7 @@ void vdo_free_packer(struct packer *packer)
 		UDS_FREE(bin);
 	}
 
+	UDS_FREE(UDS_FORGET(packer->window));
 	UDS_FREE(UDS_FORGET(packer->canceled_bin));
 	UDS_FREE(packer);
 }
@@ -239,6 +266,12 @@ struct packer_statistics vdo_get_packer_statistics(const struct packer *packer)
 		.compressed_fragments_written = READ_ONCE(stats->compressed_fragments_written),
 		.compressed_blocks_written = READ_ONCE(stats->compressed_blocks_written),
 		.compressed_fragments_in_packer = READ_ONCE(stats->compressed_fragments_in_packer),
+		.blocks_under_half_full = READ_ONCE(stats->blocks_under_half_full),
+		.blocks_half_to_three_quarters_full =
+			READ_ONCE(stats->blocks_half_to_three_quarters_full),
+		.blocks_three_quarters_to_ninety_percent_full =
+			READ_ONCE(stats->blocks_three_quarters_to_ninety_percent_full),
+		.blocks_over_ninety_percent_full = READ_ONCE(stats->blocks_over_ninety_percent_full),
 	};
 }
 
@@ -371,13 +404,15 @@ static struct data_vio *remove_from_bin(struct packer *packer, struct packer_bin
  * initialize_compressed_block() - Initialize a compressed block.
  * @block: The compressed block to initialize.
  * @size: The size of the agent's fragment.
+ * @type: The compressor which produced the fragments of the block.
  *
  * This method initializes the compressed block in the compressed write agent. Because the
  * compressor already put the agent's compressed fragment at the start of the compressed block's
  * data field, it needn't be copied. So all we need do is initialize the header and set the size of
  * the agent's fragment.
  */
-EXTERNAL_STATIC void initialize_compressed_block(struct compressed_block *block, u16 size)
+EXTERNAL_STATIC void
+initialize_compressed_block(struct compressed_block *block, u16 size, enum vdo_compression_type type)
 {
 	/*
 	 * Make sure the block layout isn't accidentally changed by changing the length of the
@@ -385,7 +420,9 @@ EXTERNAL_STATIC void initialize_compressed_block(struct compressed_block *block,
 	 */
 	STATIC_ASSERT_SIZEOF(struct compressed_block_header, COMPRESSED_BLOCK_1_0_SIZE);
 
-	block->header.version = vdo_pack_version_number(COMPRESSED_BLOCK_1_0);
+	block->header.version = vdo_pack_version_number((type == VDO_COMPRESSION_ZSTD) ?
+							COMPRESSED_BLOCK_1_1 :
+							COMPRESSED_BLOCK_1_0);
 	block->header.sizes[0] = __cpu_to_le16(size);
 }
 
@@ -409,6 +446,9 @@ pack_fragment(struct compression_state *compression,
 	struct compression_state *to_pack = &data_vio->compression;
 	char *fragment = to_pack->block->data;
 
+	/* The compressor only changes while suspended, when the packer is empty. */
+	ASSERT_LOG_ONLY((to_pack->type == compression->type),
+			"fragments packed together are from the same compressor");
 	to_pack->next_in_batch = compression->next_in_batch;
 	compression->next_in_batch = data_vio;
 	to_pack->slot = slot;
@@ -417,6 +457,28 @@ pack_fragment(struct compression_state *compression,
 	return (offset + to_pack->size);
 }
 
+/**
+ * count_block_fill() - Add a compressed block to the fill histogram.
+ * @stats: The packer statistics to update.
+ * @used: The number of bytes of fragment data in the block.
+ */
+static void count_block_fill(struct packer_statistics *stats, block_size_t used)
+{
+	unsigned int percent = (used * 100) / VDO_COMPRESSED_BLOCK_DATA_SIZE;
+
+	if (percent < 50)
+		WRITE_ONCE(stats->blocks_under_half_full, stats->blocks_under_half_full + 1);
+	else if (percent < 75)
+		WRITE_ONCE(stats->blocks_half_to_three_quarters_full,
+			   stats->blocks_half_to_three_quarters_full + 1);
+	else if (percent < 90)
+		WRITE_ONCE(stats->blocks_three_quarters_to_ninety_percent_full,
+			   stats->blocks_three_quarters_to_ninety_percent_full + 1);
+	else
+		WRITE_ONCE(stats->blocks_over_ninety_percent_full,
+			   stats->blocks_over_ninety_percent_full + 1);
+}
+
 /**
  * compressed_write_end_io() - The bio_end_io for a compressed block write.
  * @bio: The bio for the compressed write.
@@ -452,7 +514,7 @@ static void write_bin(struct packer *packer, struct packer_bin *bin)
 	compression = &agent->compression;
 	compression->slot = 0;
 	block = compression->block;
-	initialize_compressed_block(block, compression->size);
+	initialize_compressed_block(block, compression->size, compression->type);
 	offset = compression->size;
 
 	while ((client = remove_from_bin(packer, bin)) != NULL)
@@ -499,6 +561,7 @@ static void write_bin(struct packer *packer, struct packer_bin *bin)
 	WRITE_ONCE(stats->compressed_fragments_written,
 		   (stats->compressed_fragments_written + slot));
 	WRITE_ONCE(stats->compressed_blocks_written, stats->compressed_blocks_written + 1);
+	count_block_fill(stats, offset);
 
 	submit_data_vio_io(agent);
 }
@@ -571,6 +634,64 @@ select_bin(struct packer *packer, struct data_vio *data_vio)
 	return fullest_bin;
 }
 
+/**
+ * sort_window() - Sort the data_vios in the look-ahead window by decreasing compressed size.
+ * @window: The window to sort.
+ *
+ * The window is small, so an insertion sort is sufficient.
+ */
+static void sort_window(struct packer_bin *window)
+{
+	slot_number_t i, j;
+
+	for (i = 1; i < window->slots_used; i++) {
+		struct data_vio *data_vio = window->incoming[i];
+
+		for (j = i;
+		     (j > 0) &&
+		     (window->incoming[j - 1]->compression.size < data_vio->compression.size);
+		     j--)
+			window->incoming[j] = window->incoming[j - 1];
+
+		window->incoming[j] = data_vio;
+	}
+}
+
+/**
+ * pack_window() - Empty the look-ahead window into the bins.
+ * @packer: The packer.
+ *
+ * The data_vios in the window are placed largest first, each in the bin which it fits best
+ * (best-fit decreasing). A data_vio which does not fit in any bin, and for which no bin is worth
+ * writing out early, is released from the packer uncompressed.
+ */
+static void pack_window(struct packer *packer)
+{
+	struct packer_bin *window = packer->window;
+	slot_number_t count = window->slots_used;
+	slot_number_t i;
+
+	sort_window(window);
+	window->slots_used = 0;
+	for (i = 0; i < count; i++) {
+		struct data_vio *data_vio = window->incoming[i];
+		struct packer_bin *bin = select_bin(packer, data_vio);
+
+		if (bin != NULL) {
+			add_data_vio_to_packer_bin(packer, bin, data_vio);
+			continue;
+		}
+
+		if (advance_data_vio_compression_stage(data_vio).may_not_compress) {
+			add_to_bin(packer->canceled_bin, data_vio);
+			continue;
+		}
+
+		data_vio->compression.bin = NULL;
+		abort_packing(data_vio);
+	}
+}
+
 /**
  * vdo_attempt_packing() - Attempt to rewrite the data in this data_vio as part of a compressed
  *                         block.
@@ -617,8 +738,22 @@ void vdo_attempt_packing(struct data_vio *data_vio)
 	 * from the packer and fail to rendezvous with it (VDO-2809). We must also make sure that
 	 * we will actually bin the data_vio and not give up on it as being larger than the space
 	 * used in the fullest bin. Hence we must call select_bin() before calling
-	 * may_vio_block_in_packer() (VDO-2826).
+	 * may_vio_block_in_packer() (VDO-2826). The look-ahead window always has room, since it
+	 * is packed as soon as it fills.
 	 */
+	if (packer->lookahead) {
+		if (advance_data_vio_compression_stage(data_vio).stage != DATA_VIO_PACKING) {
+			abort_packing(data_vio);
+			return;
+		}
+
+		add_to_bin(packer->window, data_vio);
+		if (packer->window->slots_used == PACKER_LOOKAHEAD_WINDOW)
+			pack_window(packer);
+
+		return;
+	}
+
 	bin = select_bin(packer, data_vio);
 	if ((bin == NULL) ||
 	    (advance_data_vio_compression_stage(data_vio).stage != DATA_VIO_PACKING)) {
@@ -647,6 +782,7 @@ static void write_all_non_empty_bins(struct packer *packer)
 {
 	struct packer_bin *bin;
 
+	pack_window(packer);
 	list_for_each_entry(bin, &packer->bins, list)
 		write_bin(packer, bin);
 		/*
@@ -701,7 +837,7 @@ void vdo_remove_lock_holder_from_packer(struct vdo_completion *completion)
 	lock_holder->compression.bin = NULL;
 	lock_holder->compression.slot = 0;
 
-	if (bin != packer->canceled_bin) {
+	if ((bin != packer->canceled_bin) && (bin != packer->window)) {
 		bin->free_space += lock_holder->compression.size;
 		insert_in_sorted_list(packer, bin);
 	}
@@ -759,6 +895,19 @@ void vdo_resume_packer(struct packer *packer, struct vdo_completion *parent)
 	vdo_continue_completion(parent, vdo_resume_if_quiescent(&packer->state));
 }
 
+/**
+ * vdo_set_packer_lookahead() - Choose whether the packer buffers data_vios before packing them.
+ * @packer: The packer, which must be suspended.
+ * @lookahead: Whether to pack from the look-ahead window.
+ */
+void vdo_set_packer_lookahead(struct packer *packer, bool lookahead)
+{
+	assert_on_packer_thread(packer, __func__);
+	ASSERT_LOG_ONLY((packer->window->slots_used == 0),
+			"look-ahead window is empty when changing packing mode");
+	packer->lookahead = lookahead;
+}
+
 static void dump_packer_bin(const struct packer_bin *bin, bool canceled)
 {
 	if (bin->slots_used == 0)
@@ -794,5 +943,6 @@ void vdo_dump_packer(const struct packer *packer)
 	list_for_each_entry(bin, &packer->bins, list)
 		dump_packer_bin(bin, false);
 
+	dump_packer_bin(packer->window, false);
 	dump_packer_bin(packer->canceled_bin, true);
 }
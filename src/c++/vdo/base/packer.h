@@ -17,6 +17,8 @@
 
 enum {
 	DEFAULT_PACKER_BINS = 16,
+	/* The number of fragments buffered before packing when look-ahead is enabled */
+	PACKER_LOOKAHEAD_WINDOW = 2 * VDO_MAX_COMPRESSION_SLOTS,
 };
 
 /* The header of a compressed block. */
@@ -59,6 +61,12 @@ struct compressed_block {
  * There is one special bin which is used to hold data_vios which have been canceled and removed
  * from their bin by the packer. These data_vios need to wait for the canceller to rendezvous with
  * them (VDO-2809) and so they sit in this special bin.
+ *
+ * When look-ahead is enabled, a second special bin, the window, collects data_vios as they arrive.
+ * Once the window is full (or the packer is flushed), its data_vios are sorted by decreasing
+ * compressed size and each is placed in the best-fitting bin. Placing the large fragments first
+ * leaves the small ones to fill the gaps, so fewer compressed blocks go out partly empty and fewer
+ * batches are abandoned with a single fragment.
  */
 struct packer_bin {
 	/* List links for packer.packer_bins */
@@ -84,6 +92,14 @@ struct packer {
 	 */
 	struct packer_bin *canceled_bin;
 
+	/*
+	 * Whether to buffer incoming data_vios in the look-ahead window and pack each full window
+	 * largest fragment first, rather than packing each data_vio as it arrives.
+	 */
+	bool lookahead;
+	/* The data_vios waiting to be packed when look-ahead is enabled */
+	struct packer_bin *window;
+
 	/* The current flush generation */
 	sequence_number_t flush_generation;
 
@@ -96,6 +112,7 @@ struct packer {
 
 int vdo_get_compressed_block_fragment(enum block_mapping_state mapping_state,
 				      struct compressed_block *block,
+				      enum vdo_compression_type *fragment_type,
 				      u16 *fragment_offset,
 				      u16 *fragment_size);
 
@@ -118,10 +135,14 @@ void vdo_drain_packer(struct packer *packer, struct vdo_completion *completion);
 
 void vdo_resume_packer(struct packer *packer, struct vdo_completion *parent);
 
+void vdo_set_packer_lookahead(struct packer *packer, bool lookahead);
+
 void vdo_dump_packer(const struct packer *packer);
 
 #ifdef INTERNAL
-void initialize_compressed_block(struct compressed_block *block, u16 size);
+void initialize_compressed_block(struct compressed_block *block,
+				 u16 size,
+				 enum vdo_compression_type type);
 
 struct compression_state;
 block_size_t __must_check pack_fragment(struct compression_state *compression,
@@ -5,6 +5,7 @@
 
 #include "physical-zone.h"
 
+#include <linux/bitops.h>
 #include <linux/list.h>
 #ifndef __KERNEL__
 #include <string.h>
@@ -18,6 +19,7 @@
 #include "completion.h"
 #include "constants.h"
 #include "data-vio.h"
+#include "decompression-cache.h"
 #include "dedupe.h"
 #include "encodings.h"
 #include "flush.h"
@@ -31,6 +33,9 @@ enum {
 	LOCK_POOL_CAPACITY = 2 * MAXIMUM_VDO_USER_VIOS,
 };
 
+/* The start of an extent which does not cover any window of logical blocks */
+#define NO_EXTENT_WINDOW ((logical_block_number_t) -1)
+
 struct pbn_lock_implementation {
 	enum pbn_lock_type type;
 	const char *name;
@@ -316,6 +321,20 @@ borrow_pbn_lock_from_pool(struct pbn_lock_pool *pool,
 	return VDO_SUCCESS;
 }
 
+/**
+ * reset_extents() - Forget the windows covered by the (empty) extents of a zone.
+ * @zone: The zone.
+ */
+static void reset_extents(struct physical_zone *zone)
+{
+	zone_count_t i;
+
+	for (i = 0; i < zone->extent_count; i++) {
+		zone->extents[i].next_lbn = 0;
+		zone->extents[i].start_lbn = NO_EXTENT_WINDOW;
+	}
+}
+
 /**
  * initialize_zone() - Initialize a physical zone.
  * @vdo: The vdo to which the zone will belong.
@@ -333,8 +352,28 @@ static int initialize_zone(struct vdo *vdo, struct physical_zones *zones)
 	if (result != VDO_SUCCESS)
 		return result;
 
-	result = make_pbn_lock_pool(LOCK_POOL_CAPACITY, &zone->lock_pool);
+	/* Each logical zone may also hold a write lock on every block of its extent. */
+	zone->extent_count = vdo->thread_config->logical_zone_count;
+	result = make_pbn_lock_pool(LOCK_POOL_CAPACITY +
+				    (zone->extent_count * VDO_MAX_ALLOCATION_EXTENT),
+				    &zone->lock_pool);
+	if (result != VDO_SUCCESS) {
+		free_int_map(zone->pbn_operations);
+		return result;
+	}
+
+	result = vdo_make_decompression_cache(&zone->decompression_cache);
+	if (result != VDO_SUCCESS) {
+		free_pbn_lock_pool(UDS_FORGET(zone->lock_pool));
+		free_int_map(zone->pbn_operations);
+		return result;
+	}
+
+	result = UDS_ALLOCATE(zone->extent_count, struct allocation_extent, __func__,
+			      &zone->extents);
 	if (result != VDO_SUCCESS) {
+		vdo_free_decompression_cache(UDS_FORGET(zone->decompression_cache));
+		free_pbn_lock_pool(UDS_FORGET(zone->lock_pool));
 		free_int_map(zone->pbn_operations);
 		return result;
 	}
@@ -343,8 +382,12 @@ static int initialize_zone(struct vdo *vdo, struct physical_zones *zones)
 	zone->thread_id = vdo->thread_config->physical_threads[zone_number];
 	zone->allocator = &vdo->depot->allocators[zone_number];
 	zone->next = &zones->zones[(zone_number + 1) % vdo->thread_config->physical_zone_count];
+	zone->extent_size = vdo->device_config->allocation_extent;
+	reset_extents(zone);
 	result = vdo_make_default_thread(vdo, zone->thread_id);
 	if (result != VDO_SUCCESS) {
+		UDS_FREE(UDS_FORGET(zone->extents));
+		vdo_free_decompression_cache(UDS_FORGET(zone->decompression_cache));
 		free_pbn_lock_pool(UDS_FORGET(zone->lock_pool));
 		free_int_map(zone->pbn_operations);
 		return result;
@@ -388,6 +431,31 @@ int vdo_make_physical_zones(struct vdo *vdo, struct physical_zones **zones_ptr)
 	return VDO_SUCCESS;
 }
 
+/**
+ * forget_allocation_extents() - Return the locks on any reserved blocks to the pool without
+ *				 releasing their provisional references.
+ * @zone: The zone being freed.
+ *
+ * The extents are normally returned when the slab depot drains. This only cleans up after a vdo
+ * which is being freed without having been drained.
+ */
+static void forget_allocation_extents(struct physical_zone *zone)
+{
+	zone_count_t i;
+
+	for (i = 0; i < zone->extent_count; i++) {
+		struct allocation_extent *extent = &zone->extents[i];
+
+		while (extent->reserved != 0) {
+			physical_block_number_t pbn = extent->start_pbn + __ffs64(extent->reserved);
+
+			extent->reserved &= extent->reserved - 1;
+			return_pbn_lock_to_pool(zone->lock_pool,
+						int_map_remove(zone->pbn_operations, pbn));
+		}
+	}
+}
+
 /**
  * vdo_free_physical_zones() - Destroy the physical zones.
  * @zones: The zones to free.
@@ -402,6 +470,9 @@ void vdo_free_physical_zones(struct physical_zones *zones)
 	for (index = 0; index < zones->zone_count; index++) {
 		struct physical_zone *zone = &zones->zones[index];
 
+		forget_allocation_extents(zone);
+		UDS_FREE(UDS_FORGET(zone->extents));
+		vdo_free_decompression_cache(UDS_FORGET(zone->decompression_cache));
 		free_pbn_lock_pool(UDS_FORGET(zone->lock_pool));
 		free_int_map(UDS_FORGET(zone->pbn_operations));
 	}
@@ -496,6 +567,10 @@ static int allocate_and_lock_block(struct allocation *allocation)
 	if (result != VDO_SUCCESS)
 		return result;
 
+	/* The block is about to be overwritten, so forget what it used to hold. */
+	vdo_discard_decompressed_fragments(allocation->zone->decompression_cache,
+					   allocation->pbn);
+
 	result = vdo_attempt_physical_zone_pbn_lock(allocation->zone,
 						    allocation->pbn,
 						    allocation->write_lock_type,
@@ -517,6 +592,270 @@ static int allocate_and_lock_block(struct allocation *allocation)
 	return VDO_SUCCESS;
 }
 
+/**
+ * get_extent_window() - Get the first logical block of the extent window containing a logical
+ *			 block.
+ * @zone: The zone whose extent size defines the windows.
+ * @lbn: The logical block.
+ */
+static inline logical_block_number_t get_extent_window(struct physical_zone *zone,
+						       logical_block_number_t lbn)
+{
+	return lbn - (lbn % zone->extent_size);
+}
+
+/**
+ * note_allocation() - Record that a logical block of a logical zone has been allocated.
+ * @zone: The physical zone.
+ * @extent: The extent of the logical zone.
+ * @lbn: The logical block which was allocated.
+ *
+ * The writes of a stream may reach the allocator slightly out of order, so a straggler no more
+ * than one extent behind does not move the stream back. A write further away starts a new stream.
+ */
+static void note_allocation(struct physical_zone *zone, struct allocation_extent *extent,
+			    logical_block_number_t lbn)
+{
+	if ((lbn >= extent->next_lbn) || (lbn + zone->extent_size < extent->next_lbn))
+		extent->next_lbn = lbn + 1;
+}
+
+/**
+ * continues_stream() - Check whether a write starts a new extent window of its logical zone's
+ *			sequential stream.
+ * @zone: The physical zone.
+ * @extent: The extent of the logical zone.
+ * @lbn: The logical block being written.
+ *
+ * The stream continues if the write is in the window of its frontier or the next one. A straggler
+ * from a window before the current extent does not move the extent back.
+ */
+static bool continues_stream(struct physical_zone *zone, struct allocation_extent *extent,
+			     logical_block_number_t lbn)
+{
+	logical_block_number_t window = get_extent_window(zone, lbn);
+	logical_block_number_t frontier = get_extent_window(zone, extent->next_lbn);
+
+	if ((lbn + zone->extent_size < extent->next_lbn) ||
+	    (window > frontier + zone->extent_size))
+		return false;
+
+	if ((window < extent->start_lbn) && (extent->start_lbn <= frontier + zone->extent_size))
+		return false;
+
+	return (window != extent->start_lbn);
+}
+
+/**
+ * allocate_from_extent() - Allocate the block reserved for a data_vio's logical block in the
+ *			    extent of its logical zone, if there is one.
+ * @data_vio: The data_vio attempting to allocate.
+ *
+ * The reserved block is already locked and provisionally referenced, so the data_vio simply takes
+ * over that lock.
+ *
+ * Return: true if a reserved block was allocated.
+ */
+static bool allocate_from_extent(struct data_vio *data_vio)
+{
+	struct allocation *allocation = &data_vio->allocation;
+	struct physical_zone *zone = allocation->zone;
+	logical_block_number_t lbn = data_vio->logical.lbn;
+	struct allocation_extent *extent;
+	u64 offset;
+
+	if ((zone->extent_size == 0) || (allocation->write_lock_type != VIO_WRITE_LOCK))
+		return false;
+
+	extent = &zone->extents[data_vio->logical.zone->zone_number];
+	if ((extent->reserved == 0) || (get_extent_window(zone, lbn) != extent->start_lbn))
+		return false;
+
+	offset = lbn - extent->start_lbn;
+	if ((extent->reserved & (1ULL << offset)) == 0)
+		return false;
+
+	extent->reserved &= ~(1ULL << offset);
+	note_allocation(zone, extent, lbn);
+	allocation->pbn = extent->start_pbn + offset;
+	allocation->lock = vdo_get_physical_zone_pbn_lock(zone, allocation->pbn);
+	WRITE_ONCE(zone->allocator->statistics.extent_blocks_allocated,
+		   zone->allocator->statistics.extent_blocks_allocated + 1);
+	return true;
+}
+
+/**
+ * release_extent() - Return the blocks of an extent which have not been handed out.
+ * @zone: The zone in which the extent was reserved.
+ * @extent: The extent to release.
+ *
+ * Return: true if any blocks were returned.
+ */
+static bool release_extent(struct physical_zone *zone, struct allocation_extent *extent)
+{
+	bool released = (extent->reserved != 0);
+
+	while (extent->reserved != 0) {
+		physical_block_number_t pbn = extent->start_pbn + __ffs64(extent->reserved);
+
+		extent->reserved &= extent->reserved - 1;
+		vdo_release_physical_zone_pbn_lock(zone, pbn,
+						   vdo_get_physical_zone_pbn_lock(zone, pbn));
+	}
+
+	return released;
+}
+
+/**
+ * reserve_block() - Lock and provisionally reference a block for an extent.
+ * @zone: The zone in which to reserve the block.
+ * @slab: The slab containing the extent.
+ * @pbn: The block to reserve.
+ *
+ * Return: true if the block was free and has been reserved.
+ */
+static bool
+reserve_block(struct physical_zone *zone, struct vdo_slab *slab, physical_block_number_t pbn)
+{
+	struct pbn_lock *lock;
+	int result;
+
+	if (pbn >= slab->ref_counts_origin)
+		return false;
+
+	result = vdo_attempt_physical_zone_pbn_lock(zone, pbn, VIO_WRITE_LOCK, &lock);
+	if ((result != VDO_SUCCESS) || (lock->holder_count > 0))
+		return false;
+
+	lock->holder_count = 1;
+	result = vdo_acquire_provisional_reference(slab, pbn, lock);
+	if ((result != VDO_SUCCESS) || !vdo_pbn_lock_has_provisional_reference(lock)) {
+		/* The block is in use (or the slab can't be used), so end the extent here. */
+		vdo_release_physical_zone_pbn_lock(zone, pbn, lock);
+		return false;
+	}
+
+	vdo_discard_decompressed_fragments(zone->decompression_cache, pbn);
+	return true;
+}
+
+/**
+ * reserve_extent() - Reserve the blocks for the rest of an extent window if the data_vio continues
+ *		      a sequential stream of writes from its logical zone.
+ * @data_vio: The data_vio which has just allocated a block.
+ *
+ * Extents cover aligned windows of logical blocks, so a stream is laid out the same way whichever
+ * of its writes reaches the allocator first. The newly allocated block is reserved for the start
+ * of the window and the data_vio takes the block at its own offset instead. The extent ends at the
+ * first block which is not free, so it may be shorter than the configured size, or empty.
+ */
+static void reserve_extent(struct data_vio *data_vio)
+{
+	struct allocation *allocation = &data_vio->allocation;
+	struct physical_zone *zone = allocation->zone;
+	logical_block_number_t lbn = data_vio->logical.lbn;
+	logical_block_number_t window = get_extent_window(zone, lbn);
+	physical_block_number_t start_pbn = allocation->pbn;
+	struct allocation_extent *extent;
+	struct vdo_slab *slab;
+	block_count_t lbn_offset, offset;
+	bool sequential;
+
+	if ((zone->extent_size == 0) || (allocation->write_lock_type != VIO_WRITE_LOCK))
+		return;
+
+	extent = &zone->extents[data_vio->logical.zone->zone_number];
+	sequential = continues_stream(zone, extent, lbn);
+	note_allocation(zone, extent, lbn);
+	if (!sequential)
+		return;
+
+	/* The stream has moved past whatever remains of the previous extent. */
+	release_extent(zone, extent);
+
+	extent->start_lbn = window;
+	extent->start_pbn = start_pbn;
+	slab = vdo_get_slab(zone->allocator->depot, start_pbn);
+	lbn_offset = lbn - window;
+	if (lbn_offset > 0) {
+		struct pbn_lock *lock;
+
+		if (!reserve_block(zone, slab, start_pbn + lbn_offset))
+			return;
+
+		/* Swap blocks; both locks are held once with a provisional reference. */
+		lock = vdo_get_physical_zone_pbn_lock(zone, start_pbn + lbn_offset);
+		extent->reserved |= 1;
+		allocation->pbn = start_pbn + lbn_offset;
+		allocation->lock = lock;
+	}
+
+	for (offset = 1; offset < zone->extent_size; offset++) {
+		if (offset == lbn_offset)
+			continue;
+
+		if (!reserve_block(zone, slab, start_pbn + offset))
+			break;
+
+		extent->reserved |= (1ULL << offset);
+	}
+
+	if (extent->reserved != 0)
+		WRITE_ONCE(zone->allocator->statistics.extents_reserved,
+			   zone->allocator->statistics.extents_reserved + 1);
+}
+
+/**
+ * vdo_release_allocation_extents() - Return the blocks reserved for sequential streams in a zone.
+ * @zone: The zone.
+ *
+ * This must be called on the zone's thread, and the extents are returned when the slab depot
+ * drains.
+ *
+ * Return: true if any blocks were returned.
+ */
+bool vdo_release_allocation_extents(struct physical_zone *zone)
+{
+	bool released = false;
+	zone_count_t i;
+
+	for (i = 0; i < zone->extent_count; i++)
+		released |= release_extent(zone, &zone->extents[i]);
+
+	return released;
+}
+
+/**
+ * vdo_release_allocation_extent() - Return the blocks reserved in a zone for the stream of one
+ *				     logical zone.
+ * @zone: The physical zone.
+ * @logical_zone_number: The logical zone which has moved on to another physical zone.
+ *
+ * This must be called on the zone's thread.
+ */
+void vdo_release_allocation_extent(struct physical_zone *zone, zone_count_t logical_zone_number)
+{
+	release_extent(zone, &zone->extents[logical_zone_number]);
+}
+
+/**
+ * vdo_set_allocation_extent_size() - Set the number of blocks to reserve for each sequential
+ *				      stream of writes.
+ * @zones: The physical zones.
+ * @extent_size: The number of blocks, or 0 to allocate each block individually.
+ *
+ * This may only be called while the zones are quiescent and hold no extents.
+ */
+void vdo_set_allocation_extent_size(struct physical_zones *zones, block_count_t extent_size)
+{
+	zone_count_t z;
+
+	for (z = 0; z < zones->zone_count; z++) {
+		zones->zones[z].extent_size = extent_size;
+		reset_extents(&zones->zones[z]);
+	}
+}
+
 /**
  * retry_allocation() - Retry allocating a block now that we're done waiting for scrubbing.
  * @waiter: The allocating_vio that was waiting to allocate.
@@ -590,11 +929,21 @@ static bool continue_allocating(struct data_vio *data_vio)
  */
 bool vdo_allocate_block_in_zone(struct data_vio *data_vio)
 {
-	int result = allocate_and_lock_block(&data_vio->allocation);
+	int result;
 
-	if (result == VDO_SUCCESS)
+	if (allocate_from_extent(data_vio))
 		return true;
 
+	result = allocate_and_lock_block(&data_vio->allocation);
+	if ((result == VDO_NO_SPACE) && vdo_release_allocation_extents(data_vio->allocation.zone))
+		/* Blocks reserved for sequential streams are better used than wasted. */
+		result = allocate_and_lock_block(&data_vio->allocation);
+
+	if (result == VDO_SUCCESS) {
+		reserve_extent(data_vio);
+		return true;
+	}
+
 	if ((result != VDO_NO_SPACE) || !continue_allocating(data_vio))
 		continue_data_vio_with_error(data_vio, result);
 
@@ -636,6 +985,25 @@ void vdo_release_physical_zone_pbn_lock(struct physical_zone *zone,
 	return_pbn_lock_to_pool(zone->lock_pool, lock);
 }
 
+/**
+ * vdo_get_decompression_cache_statistics() - Get the combined decompression cache statistics of
+ *                                            the physical zones.
+ * @zones: The physical zones.
+ */
+struct decompression_cache_statistics
+vdo_get_decompression_cache_statistics(const struct physical_zones *zones)
+{
+	struct decompression_cache_statistics stats;
+	zone_count_t zone;
+
+	memset(&stats, 0, sizeof(stats));
+	for (zone = 0; zone < zones->zone_count; zone++)
+		vdo_add_decompression_cache_statistics(zones->zones[zone].decompression_cache,
+						       &stats);
+
+	return stats;
+}
+
 /**
  * vdo_dump_physical_zone() - Dump information about a physical zone to the log for debugging.
  * @zone: The zone to dump.
@@ -8,8 +8,14 @@
 
 #include <linux/atomic.h>
 
+#include "statistics.h"
 #include "types.h"
 
+enum {
+	/* The most blocks which may be reserved for a sequential stream of writes */
+	VDO_MAX_ALLOCATION_EXTENT = 64,
+};
+
 /*
  * The type of a PBN lock.
  */
@@ -53,6 +59,25 @@ struct pbn_lock {
 	atomic_t increments_claimed;
 };
 
+/*
+ * A run of consecutive blocks reserved for a sequential stream of writes from one logical zone.
+ * Each extent covers an aligned window of extent_size logical blocks. The logical block
+ * start_lbn + n is allocated the physical block start_pbn + n, so the stream is laid out
+ * contiguously even if its writes reach the allocator out of order. Each reserved block is held
+ * by a write lock with a provisional reference until it is handed out or the reservation is
+ * returned.
+ */
+struct allocation_extent {
+	/* The logical block following the furthest one allocated for the logical zone */
+	logical_block_number_t next_lbn;
+	/* The first logical block of the window covered by the extent */
+	logical_block_number_t start_lbn;
+	/* The first block of the extent */
+	physical_block_number_t start_pbn;
+	/* A bit for each block of the extent which is reserved but not yet handed out */
+	u64 reserved;
+};
+
 struct physical_zone {
 	/* Which physical zone this is */
 	zone_count_t zone_number;
@@ -66,6 +91,14 @@ struct physical_zone {
 	struct block_allocator *allocator;
 	/* The next zone from which to attempt an allocation */
 	struct physical_zone *next;
+	/* The recently uncompressed fragments of compressed blocks in this zone */
+	struct decompression_cache *decompression_cache;
+	/* The number of blocks to reserve for a sequential stream, or 0 to reserve none */
+	block_count_t extent_size;
+	/* The number of logical zones, each of which may have an extent in this zone */
+	zone_count_t extent_count;
+	/* The extents reserved for each logical zone */
+	struct allocation_extent *extents;
 };
 
 struct physical_zones {
@@ -106,10 +139,19 @@ vdo_attempt_physical_zone_pbn_lock(struct physical_zone *zone,
 
 bool __must_check vdo_allocate_block_in_zone(struct data_vio *data_vio);
 
+void vdo_set_allocation_extent_size(struct physical_zones *zones, block_count_t extent_size);
+
+bool vdo_release_allocation_extents(struct physical_zone *zone);
+
+void vdo_release_allocation_extent(struct physical_zone *zone, zone_count_t logical_zone_number);
+
 void vdo_release_physical_zone_pbn_lock(struct physical_zone *zone,
 					physical_block_number_t locked_pbn,
 					struct pbn_lock *lock);
 
+struct decompression_cache_statistics __must_check
+vdo_get_decompression_cache_statistics(const struct physical_zones *zones);
+
 void vdo_dump_physical_zone(const struct physical_zone *zone);
 
 #endif /* VDO_PHYSICAL_ZONE_H */
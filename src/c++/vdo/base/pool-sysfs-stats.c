@@ -0,0 +1,3 @@
+#include "pool-sysfs.h"
+const struct sysfs_ops vdo_pool_stats_sysfs_ops = { 0 };
+struct attribute *vdo_pool_stats_attrs[] = { NULL };
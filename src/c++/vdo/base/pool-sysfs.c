@@ -13,6 +13,7 @@
 #include "data-vio.h"
 #include "dedupe.h"
 #include "vdo.h"
+#include "work-queue.h"
 
 struct pool_attribute {
 	struct attribute attr;
@@ -103,6 +104,21 @@ static ssize_t pool_requests_maximum_show(struct vdo *vdo, char *buf)
 	return sprintf(buf, "%u\n", get_data_vio_pool_maximum_requests(vdo->data_vio_pool));
 }
 
+/* List the work stealing counts of each thread of the queues which steal work. */
+static ssize_t pool_work_steals_show(struct vdo *vdo, char *buf)
+{
+	const struct thread_config *config = vdo->thread_config;
+	size_t length;
+
+	length = format_work_queue_steals(vdo->threads[config->cpu_thread].queue, buf, PAGE_SIZE);
+	if (vdo_uses_bio_ack_queue(vdo))
+		length += format_work_queue_steals(vdo->threads[config->bio_ack_thread].queue,
+						   buf + length,
+						   PAGE_SIZE - length);
+
+	return length;
+}
+
 static void vdo_pool_release(struct kobject *directory)
 {
 	UDS_FREE(container_of(directory, struct vdo, vdo_directory));
@@ -173,6 +189,14 @@ static struct pool_attribute vdo_pool_requests_maximum_attr = {
 	.show = pool_requests_maximum_show,
 };
 
+static struct pool_attribute vdo_pool_work_steals_attr = {
+	.attr = {
+			.name = "work_steals",
+			.mode = 0444,
+		},
+	.show = pool_work_steals_show,
+};
+
 static struct attribute *pool_attrs[] = {
 	&vdo_pool_compressing_attr.attr,
 	&vdo_pool_discards_active_attr.attr,
@@ -182,6 +206,7 @@ static struct attribute *pool_attrs[] = {
 	&vdo_pool_requests_active_attr.attr,
 	&vdo_pool_requests_limit_attr.attr,
 	&vdo_pool_requests_maximum_attr.attr,
+	&vdo_pool_work_steals_attr.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(pool);
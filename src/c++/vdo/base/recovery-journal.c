@@ -7,6 +7,8 @@
 
 #include <linux/atomic.h>
 #include <linux/bio.h>
+#include <linux/jiffies.h>
+#include <linux/timer.h>
 
 #include "logger.h"
 #include "memory-alloc.h"
@@ -36,6 +38,14 @@ enum {
 	RECOVERY_JOURNAL_RESERVED_BLOCKS =
 		(MAXIMUM_VDO_USER_VIOS / RECOVERY_JOURNAL_ENTRIES_PER_BLOCK) + 2,
 	WRITE_FLAGS = REQ_OP_WRITE | REQ_PRIO | REQ_PREFLUSH | REQ_SYNC | REQ_FUA,
+	/* The weight of the existing average when a new interval between entries is averaged in */
+	ENTRY_INTERVAL_WEIGHT = 8,
+};
+
+enum commit_timer_state {
+	COMMIT_TIMER_IDLE,
+	COMMIT_TIMER_RUNNING,
+	COMMIT_TIMER_FIRED,
 };
 
 /**
@@ -349,6 +359,7 @@ static void check_for_drain_complete(struct recovery_journal *journal)
 
 	if (!vdo_is_state_draining(&journal->state) ||
 	    journal->reaping ||
+	    (atomic_read(&journal->commit_timer_state) != COMMIT_TIMER_IDLE) ||
 	    has_block_waiters(journal) ||
 	    has_waiters(&journal->entry_waiters) ||
 	    !suspend_lock_counter(&journal->lock_counter))
@@ -455,6 +466,8 @@ static void check_slab_journal_commit_threshold(struct recovery_journal *journal
 
 static void reap_recovery_journal(struct recovery_journal *journal);
 static void assign_entries(struct recovery_journal *journal);
+static void commit_timer_expired(struct timer_list *t);
+static void write_held_block(struct vdo_completion *completion);
 
 /**
  * finish_reaping() - Finish reaping the journal.
@@ -733,6 +746,8 @@ int vdo_decode_recovery_journal(struct recovery_journal_state_7_0 state,
 	if (result != VDO_SUCCESS)
 		return result;
 
+	timer_setup(&journal->commit_timer, commit_timer_expired, 0);
+	atomic_set(&journal->commit_timer_state, COMMIT_TIMER_IDLE);
 	INIT_LIST_HEAD(&journal->free_tail_blocks);
 	INIT_LIST_HEAD(&journal->active_tail_blocks);
 	initialize_wait_queue(&journal->pending_writes);
@@ -794,6 +809,12 @@ int vdo_decode_recovery_journal(struct recovery_journal_state_7_0 state,
 	}
 
 	journal->flush_vio->completion.callback_thread_id = journal->thread_id;
+	vdo_initialize_completion(&journal->commit_timer_completion,
+				  vdo,
+				  VDO_JOURNAL_COMMIT_TIMER_COMPLETION);
+	vdo_set_completion_callback(&journal->commit_timer_completion,
+				    write_held_block,
+				    journal->thread_id);
 	*journal_ptr = journal;
 	return VDO_SUCCESS;
 }
@@ -809,6 +830,7 @@ void vdo_free_recovery_journal(struct recovery_journal *journal)
 	if (journal == NULL)
 		return;
 
+	del_timer_sync(&journal->commit_timer);
 	UDS_FREE(UDS_FORGET(journal->lock_counter.logical_zone_counts));
 	UDS_FREE(UDS_FORGET(journal->lock_counter.physical_zone_counts));
 	UDS_FREE(UDS_FORGET(journal->lock_counter.journal_counters));
@@ -1123,6 +1145,22 @@ static void update_usages(struct recovery_journal *journal, struct data_vio *dat
 		journal->logical_blocks_used--;
 }
 
+/**
+ * record_entry_times() - Check whether to note when each block receives its first entry.
+ * @journal: The journal.
+ *
+ * The times are needed to bound how long a block is held for group commit, and for the commit
+ * latency histogram.
+ */
+static inline bool record_entry_times(const struct recovery_journal *journal)
+{
+#ifdef VDO_INTERNAL
+	return true;
+#else
+	return (journal->commit_window > 0);
+#endif /* VDO_INTERNAL */
+}
+
 /**
  * assign_entry() - Assign an entry waiter to the active block.
  *
@@ -1143,8 +1181,11 @@ static void assign_entry(struct waiter *waiter, void *context)
 	update_usages(journal, data_vio);
 	journal->available_space--;
 
-	if (!has_waiters(&block->entry_waiters))
+	if (!has_waiters(&block->entry_waiters)) {
 		journal->events.blocks.started++;
+		if (record_entry_times(journal))
+			block->first_entry_jiffies = jiffies;
+	}
 
 	enqueue_waiter(&block->entry_waiters, &data_vio->waiter);
 	block->entry_count++;
@@ -1308,6 +1349,10 @@ static void complete_write(struct vdo_completion *completion)
 
 	assert_on_journal_thread(journal, __func__);
 
+#ifdef VDO_INTERNAL
+	enter_histogram_sample(completion->vdo->histograms.journal_commit_histogram,
+			       jiffies - block->commit_start_jiffies);
+#endif /* VDO_INTERNAL */
 	journal->pending_write_count -= 1;
 	journal->events.blocks.committed += 1;
 	journal->events.entries.committed += block->entries_in_commit;
@@ -1425,6 +1470,11 @@ static void write_block(struct waiter *waiter, void *context __always_unused)
 	}
 
 	block->entries_in_commit = count_waiters(&block->entry_waiters);
+#ifdef VDO_INTERNAL
+	block->commit_start_jiffies = block->first_entry_jiffies;
+	enter_histogram_sample(block->vio.completion.vdo->histograms.journal_entries_histogram,
+			       block->entries_in_commit);
+#endif /* VDO_INTERNAL */
 	add_queued_recovery_entries(block);
 
 	journal->pending_write_count += 1;
@@ -1449,6 +1499,48 @@ static void write_block(struct waiter *waiter, void *context __always_unused)
 			    WRITE_FLAGS);
 }
 
+static inline bool change_commit_timer_state(struct recovery_journal *journal, int old, int new)
+{
+	return (atomic_cmpxchg(&journal->commit_timer_state, old, new) == old);
+}
+
+/**
+ * hold_active_block() - Check whether to hold back the partial active block in the expectation
+ *                       that it will fill before its commit window closes.
+ * @journal: The recovery journal, which has no writes outstanding.
+ *
+ * If the block is held, the commit timer is started if it isn't already running.
+ *
+ * Return: true if the active block should not be written yet.
+ */
+static bool hold_active_block(struct recovery_journal *journal)
+{
+	struct recovery_journal_block *block = journal->active_block;
+	journal_entry_count_t remaining;
+	u64 deadline;
+
+	if ((journal->commit_window == 0) ||
+	    !has_waiters(&block->entry_waiters) ||
+	    !vdo_is_state_normal(&journal->state) ||
+	    is_read_only(journal))
+		return false;
+
+	deadline = block->first_entry_jiffies + journal->commit_window;
+	if (jiffies >= deadline)
+		return false;
+
+	remaining = journal->entries_per_block - block->entry_count;
+	if ((remaining * journal->entry_interval) > journal->commit_window_ns)
+		/* Entries are arriving too slowly to fill the block in time. */
+		return false;
+
+	if (change_commit_timer_state(journal, COMMIT_TIMER_IDLE, COMMIT_TIMER_RUNNING)) {
+		mod_timer(&journal->commit_timer, deadline);
+		journal->events.commits_held++;
+	}
+
+	return true;
+}
 
 /**
  * write_blocks() - Attempt to commit blocks, according to write policy.
@@ -1460,11 +1552,12 @@ static void write_blocks(struct recovery_journal *journal)
 	/*
 	 * We call this function after adding entries to the journal and after finishing a block
 	 * write. Thus, when this function terminates we must either have no VIOs waiting in the
-	 * journal or have some outstanding IO to provide a future wakeup.
+	 * journal, or have some outstanding IO or a running commit timer to provide a future
+	 * wakeup.
 	 *
 	 * We want to only issue full blocks if there are no pending writes. However, if there are
 	 * no outstanding writes and some unwritten entries, we must issue a block, even if it's
-	 * the active block and it isn't full.
+	 * the active block and it isn't full, unless it is being held for group commit.
 	 */
 	if (journal->pending_write_count > 0)
 		return;
@@ -1476,10 +1569,57 @@ static void write_blocks(struct recovery_journal *journal)
 	 * Do we need to write the active block? Only if we have no outstanding writes, even after
 	 * issuing all of the full writes.
 	 */
-	if ((journal->pending_write_count == 0) && (journal->active_block != NULL))
+	if ((journal->pending_write_count == 0) &&
+	    (journal->active_block != NULL) &&
+	    !hold_active_block(journal))
 		write_block(&journal->active_block->write_waiter, NULL);
 }
 
+/**
+ * write_held_block() - Write a block which was held for group commit once its window has closed.
+ * @completion: The commit timer completion.
+ *
+ * This callback is registered in vdo_decode_recovery_journal().
+ */
+static void write_held_block(struct vdo_completion *completion)
+{
+	struct recovery_journal *journal =
+		container_of(completion, struct recovery_journal, commit_timer_completion);
+
+	atomic_set(&journal->commit_timer_state, COMMIT_TIMER_IDLE);
+	write_blocks(journal);
+	check_for_drain_complete(journal);
+}
+
+/**
+ * commit_timer_expired() - Enqueue the write of a held block when its commit window closes.
+ * @t: The commit timer.
+ */
+static void commit_timer_expired(struct timer_list *t)
+{
+	struct recovery_journal *journal = from_timer(journal, t, commit_timer);
+
+	if (change_commit_timer_state(journal, COMMIT_TIMER_RUNNING, COMMIT_TIMER_FIRED))
+		vdo_invoke_completion_callback(&journal->commit_timer_completion);
+}
+
+/**
+ * update_entry_interval() - Average the time since the previous entry into the entry interval.
+ * @journal: The journal receiving an entry.
+ *
+ * Intervals are capped at the commit window so that a single idle period does not stop blocks
+ * being held for long after entries start arriving quickly again.
+ */
+static void update_entry_interval(struct recovery_journal *journal)
+{
+	ktime_t now = current_time_ns(CLOCK_MONOTONIC);
+	u64 interval = min_t(u64, now - journal->last_entry_time, journal->commit_window_ns);
+
+	journal->last_entry_time = now;
+	journal->entry_interval = (((journal->entry_interval * (ENTRY_INTERVAL_WEIGHT - 1)) +
+				    interval) / ENTRY_INTERVAL_WEIGHT);
+}
+
 /**
  * vdo_add_recovery_journal_entry() - Add an entry to a recovery journal.
  * @journal: The journal in which to make an entry.
@@ -1508,6 +1648,9 @@ void vdo_add_recovery_journal_entry(struct recovery_journal *journal, struct dat
 	ASSERT_LOG_ONLY(data_vio->recovery_sequence_number == 0,
 			"journal lock not held for new entry");
 
+	if (journal->commit_window > 0)
+		update_entry_interval(journal);
+
 	vdo_advance_journal_point(&journal->append_point, journal->entries_per_block);
 	enqueue_waiter(&journal->entry_waiters, &data_vio->waiter);
 	assign_entries(journal);
@@ -1666,7 +1809,34 @@ void vdo_release_journal_entry_lock(struct recovery_journal *journal,
  */
 static void initiate_drain(struct admin_state *state)
 {
-	check_for_drain_complete(container_of(state, struct recovery_journal, state));
+	struct recovery_journal *journal = container_of(state, struct recovery_journal, state);
+
+	/*
+	 * Write out any block being held for group commit. If the commit timer has already fired,
+	 * its callback will write the block and check for drain completion.
+	 */
+	if ((atomic_read(&journal->commit_timer_state) == COMMIT_TIMER_IDLE) ||
+	    change_commit_timer_state(journal, COMMIT_TIMER_RUNNING, COMMIT_TIMER_IDLE)) {
+		del_timer_sync(&journal->commit_timer);
+		write_blocks(journal);
+	}
+
+	check_for_drain_complete(journal);
+}
+
+/**
+ * vdo_set_recovery_journal_commit_window() - Set how long a partial block may be held in the
+ *                                            expectation that more entries will fill it.
+ * @journal: The journal, which must not be running.
+ * @window: The commit window in milliseconds, or 0 to write partial blocks as soon as possible.
+ */
+void vdo_set_recovery_journal_commit_window(struct recovery_journal *journal,
+					    unsigned int window)
+{
+	journal->commit_window = ((window == 0) ? 0 : max(msecs_to_jiffies(window), 1UL));
+	journal->commit_window_ns = (u64) window * NSEC_PER_MSEC;
+	/* Until entries have been seen, assume that they are arriving too slowly to hold blocks. */
+	journal->entry_interval = journal->commit_window_ns;
 }
 
 /**
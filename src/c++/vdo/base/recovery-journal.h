@@ -7,8 +7,10 @@
 #define VDO_RECOVERY_JOURNAL_H
 
 #include <linux/list.h>
+#include <linux/timer.h>
 
 #include "numeric.h"
+#include "time-utils.h"
 
 #include "admin-state.h"
 #include "constants.h"
@@ -76,8 +78,21 @@
  * the 'commit_completion' and will be woken the next time a full block has committed. If there is
  * no on-disk space when a VIO attempts to add an entry, the VIO will be attached to the
  * 'reap_completion', and will be woken the next time a journal block is reaped.
+ *
+ * By default, a partial active block is written as soon as no other write is outstanding. Since
+ * every journal write carries a flush and a FUA, a steady stream of entries arriving just too
+ * slowly to fill blocks will pay for a flush on nearly every entry. When a commit window is
+ * configured, the journal instead holds a partial active block if, at the rate at which entries
+ * have recently been arriving, the block would fill before the window since its first entry
+ * closes. A timer ensures that a held block is written no later than the end of the window, and
+ * holding is abandoned whenever the journal is draining or read-only.
  */
 
+enum {
+	/* The largest allowed commit window, in milliseconds */
+	VDO_MAX_JOURNAL_COMMIT_WINDOW = 1000,
+};
+
 enum vdo_zone_type {
 	VDO_ZONE_TYPE_ADMIN,
 	VDO_ZONE_TYPE_JOURNAL,
@@ -133,6 +148,12 @@ struct recovery_journal_block {
 	journal_entry_count_t uncommitted_entry_count;
 	/* The number of new entries in the current commit */
 	journal_entry_count_t entries_in_commit;
+	/* The time at which the oldest entry waiting to be committed was added, in jiffies */
+	u64 first_entry_jiffies;
+#ifdef VDO_INTERNAL
+	/* The value of first_entry_jiffies for the entries in the current commit */
+	u64 commit_start_jiffies;
+#endif /* VDO_INTERNAL */
 	/* The queue of vios which will make entries for the next commit */
 	struct wait_queue entry_waiters;
 	/* The queue of vios waiting for the current commit */
@@ -208,6 +229,20 @@ struct recovery_journal {
 	block_count_t slab_journal_commit_threshold;
 	/* Counters for events in the journal that are reported as statistics */
 	struct recovery_journal_statistics events;
+	/* The longest a partial block may be held for group commit, in jiffies, or 0 if never */
+	u64 commit_window;
+	/* The commit window in nanoseconds */
+	u64 commit_window_ns;
+	/* The time at which the most recent entry was added, in nanoseconds */
+	ktime_t last_entry_time;
+	/* A moving average of the time between entries, in nanoseconds */
+	u64 entry_interval;
+	/* The timer which ends the commit window of a held block */
+	struct timer_list commit_timer;
+	/* The state of the commit timer */
+	atomic_t commit_timer_state;
+	/* The completion for writing a held block when the commit timer fires */
+	struct vdo_completion commit_timer_completion;
 	/* The locks for each on-disk block */
 	struct lock_counter lock_counter;
 	/* The tail blocks */
@@ -304,6 +339,9 @@ void vdo_release_recovery_journal_block_reference(struct recovery_journal *journ
 void vdo_release_journal_entry_lock(struct recovery_journal *journal,
 				    sequence_number_t sequence_number);
 
+void vdo_set_recovery_journal_commit_window(struct recovery_journal *journal,
+					    unsigned int window);
+
 void vdo_drain_recovery_journal(struct recovery_journal *journal,
 				const struct admin_state_code *operation,
 				struct vdo_completion *parent);
@@ -6,6 +6,7 @@
 #include "ref-counts.h"
 
 #include <linux/bio.h>
+#include <linux/bitops.h>
 #include <linux/minmax.h>
 
 #include "logger.h"
@@ -27,7 +28,13 @@
 #include "vio.h"
 #include "wait-queue.h"
 
+enum {
+	/* The number of words of counters examined at once by the free block search */
+	WORDS_PER_SEARCH_STEP = 4,
+};
+
 static const u64 BYTES_PER_WORD = sizeof(u64);
+static const u64 BYTES_PER_SEARCH_STEP = (WORDS_PER_SEARCH_STEP * sizeof(u64));
 static const bool NORMAL_OPERATION = true;
 
 /**
@@ -113,38 +120,63 @@ void vdo_reset_search_cursor(struct ref_counts *ref_counts)
 }
 
 /**
- * advance_search_cursor() - Advance the search cursor to the start of the next reference block.
+ * advance_search_cursor() - Advance the search cursor to the start of the next reference block
+ *                           which has a free counter.
  * @ref_counts: The ref_counts object containing the search cursor.
  *
- * Wraps around to the first reference block if the current block is the last reference block.
+ * Wraps around to the first reference block if no later reference block has a free counter.
  *
- * Return: true unless the cursor was at the last reference block.
+ * Return: true unless the cursor was at the last reference block with a free counter.
  */
 static bool advance_search_cursor(struct ref_counts *ref_counts)
 {
 	struct search_cursor *cursor = &ref_counts->search_cursor;
+	block_count_t next;
 
 	/*
-	 * If we just finished searching the last reference block, then wrap back around to the
-	 * start of the array.
+	 * Skip straight past any full reference blocks. If there are no more blocks with free
+	 * counters, then wrap back around to the start of the array.
 	 */
-	if (cursor->block == cursor->last_block) {
+	next = find_next_zero_bit(ref_counts->full_blocks,
+				  ref_counts->reference_block_count,
+				  (cursor->block - cursor->first_block) + 1);
+	if (next >= ref_counts->reference_block_count) {
 		vdo_reset_search_cursor(ref_counts);
 		return false;
 	}
 
-	/* We're not already at the end, so advance to cursor to the next block. */
-	cursor->block++;
-	cursor->index = cursor->end_index;
+	cursor->block = &ref_counts->blocks[next];
+	cursor->index = (next * COUNTS_PER_BLOCK);
 
 	if (cursor->block == cursor->last_block)
 		/* The last reference block will usually be a runt. */
 		cursor->end_index = ref_counts->block_count;
 	else
-		cursor->end_index += COUNTS_PER_BLOCK;
+		cursor->end_index = (cursor->index + COUNTS_PER_BLOCK);
 	return true;
 }
 
+/**
+ * update_full_block_summary() - Record whether a reference block has any free counters after its
+ *                               allocated count has changed.
+ * @block: The reference block.
+ */
+static void update_full_block_summary(struct reference_block *block)
+{
+	struct ref_counts *ref_counts = block->ref_counts;
+	block_count_t index = block - ref_counts->blocks;
+	block_count_t capacity = COUNTS_PER_BLOCK;
+
+	if (block == ref_counts->search_cursor.last_block)
+		/* The last reference block will usually be a runt. */
+		capacity = ref_counts->block_count - (index * COUNTS_PER_BLOCK);
+
+	if (block->allocated_count >= capacity)
+		__set_bit(index, ref_counts->full_blocks);
+	else
+		__clear_bit(index, ref_counts->full_blocks);
+}
+
 /**
  * vdo_make_ref_counts() - Create a reference counting object.
  * @block_count: The number of physical blocks that can be referenced.
@@ -176,15 +208,24 @@ int vdo_make_ref_counts(block_count_t block_count,
 
 	/*
 	 * Allocate such that the runt slab has a full-length memory array, plus a little padding
-	 * so we can word-search even at the very end.
+	 * so we can search several words at a time even at the very end.
 	 */
-	bytes = ((ref_block_count * COUNTS_PER_BLOCK) + (2 * BYTES_PER_WORD));
+	bytes = ((ref_block_count * COUNTS_PER_BLOCK) + (2 * BYTES_PER_SEARCH_STEP));
 	result = UDS_ALLOCATE(bytes, vdo_refcount_t, "ref counts array", &ref_counts->counters);
 	if (result != UDS_SUCCESS) {
 		vdo_free_ref_counts(ref_counts);
 		return result;
 	}
 
+	result = UDS_ALLOCATE(BITS_TO_LONGS(ref_block_count),
+			      unsigned long,
+			      "full reference blocks",
+			      &ref_counts->full_blocks);
+	if (result != UDS_SUCCESS) {
+		vdo_free_ref_counts(ref_counts);
+		return result;
+	}
+
 	ref_counts->slab = slab;
 	ref_counts->block_count = block_count;
 	ref_counts->free_blocks = block_count;
@@ -212,6 +253,7 @@ void vdo_free_ref_counts(struct ref_counts *ref_counts)
 	if (ref_counts == NULL)
 		return;
 
+	UDS_FREE(UDS_FORGET(ref_counts->full_blocks));
 	UDS_FREE(UDS_FORGET(ref_counts->counters));
 	UDS_FREE(ref_counts);
 }
@@ -320,6 +362,23 @@ u8 vdo_get_available_references(struct ref_counts *ref_counts, physical_block_nu
 	return (MAXIMUM_REFERENCE_COUNT - *counter_ptr);
 }
 
+/**
+ * vdo_can_net_reference_changes() - Check whether an increment of a block followed by a decrement
+ *                                   of it would leave it exactly as it is.
+ * @ref_counts: The ref_counts object.
+ * @pbn: The physical block number.
+ *
+ * Return: true if the block is referenced, not provisionally, and can be incremented.
+ */
+bool vdo_can_net_reference_changes(struct ref_counts *ref_counts, physical_block_number_t pbn)
+{
+	vdo_refcount_t *counter_ptr = NULL;
+	int result = get_reference_counter(ref_counts, pbn, &counter_ptr);
+
+	return ((result == VDO_SUCCESS) && (*counter_ptr != EMPTY_REFERENCE_COUNT) &&
+		(*counter_ptr < MAXIMUM_REFERENCE_COUNT));
+}
+
 /**
  * increment_for_data() - Increment the reference count for a data block.
  * @ref_counts: The ref_counts responsible for the block.
@@ -345,6 +404,7 @@ static int increment_for_data(struct ref_counts *ref_counts,
 	case RS_FREE:
 		*counter_ptr = 1;
 		block->allocated_count++;
+		update_full_block_summary(block);
 		ref_counts->free_blocks--;
 		*free_status_changed = true;
 		break;
@@ -419,6 +479,7 @@ static int decrement_for_data(struct ref_counts *ref_counts,
 
 		*counter_ptr = EMPTY_REFERENCE_COUNT;
 		block->allocated_count--;
+		update_full_block_summary(block);
 		ref_counts->free_blocks++;
 		*free_status_changed = true;
 		break;
@@ -470,6 +531,7 @@ static int increment_for_block_map(struct ref_counts *ref_counts,
 
 		*counter_ptr = MAXIMUM_REFERENCE_COUNT;
 		block->allocated_count++;
+		update_full_block_summary(block);
 		ref_counts->free_blocks--;
 		*free_status_changed = true;
 		return VDO_SUCCESS;
@@ -817,6 +879,58 @@ find_zero_byte_in_word(const u8 *word_ptr,
 	return fail_index;
 }
 
+/**
+ * zero_byte_mask() - Make a mask flagging the zero bytes of a word of reference counters.
+ * @word: The counters, in little-endian order.
+ *
+ * The high bit of the lowest zero byte, if any, will be set, as may the high bits of some bytes
+ * above it. No bit is set below the lowest zero byte, so the first set bit always identifies the
+ * first zero byte.
+ *
+ * Return: The mask, which is zero if no counter in the word is zero.
+ */
+static inline u64 zero_byte_mask(u64 word)
+{
+	return ((word - 0x0101010101010101) & ~word & 0x8080808080808080);
+}
+
+/**
+ * find_zero_byte_in_step() - Find the array index of the first zero byte in a search step's worth
+ *                            of reference counters.
+ * @step_ptr: A pointer to the counter bytes to check.
+ * @start_index: The array index corresponding to step_ptr[0].
+ * @fail_index: The array index to return if no zero byte is found.
+ *
+ * The masks of all the words are combined so that a step with no zero byte costs a single branch;
+ * the loops are simple enough for the compiler to unroll or vectorize. As with
+ * find_zero_byte_in_word(), the function relies on the array being sufficiently padded.
+ *
+ * Return: The array index of the first zero byte in the step, or the value passed as fail_index if
+ *         no zero byte was found.
+ */
+static inline slab_block_number
+find_zero_byte_in_step(const u8 *step_ptr,
+		       slab_block_number start_index,
+		       slab_block_number fail_index)
+{
+	u64 masks[WORDS_PER_SEARCH_STEP];
+	u64 any_zero = 0;
+	unsigned int word;
+
+	for (word = 0; word < WORDS_PER_SEARCH_STEP; word++) {
+		masks[word] = zero_byte_mask(get_unaligned_le64(step_ptr + (word * BYTES_PER_WORD)));
+		any_zero |= masks[word];
+	}
+
+	if (any_zero == 0)
+		return fail_index;
+
+	for (word = 0; masks[word] == 0; word++)
+		;
+
+	return (start_index + (word * BYTES_PER_WORD) + (__ffs64(masks[word]) / BITS_PER_BYTE));
+}
+
 /**
  * vdo_find_free_block() - Find the first block with a reference count of zero in the specified
  *                         range of reference counter indexes.
@@ -839,42 +953,40 @@ bool vdo_find_free_block(const struct ref_counts *ref_counts,
 	slab_block_number next_index = start_index;
 	u8 *next_counter = &ref_counts->counters[next_index];
 	u8 *end_counter = &ref_counts->counters[end_index];
+	unsigned int word;
 
 	/*
-	 * Search every byte of the first unaligned word. (Array is padded so reading past end is
-	 * safe.)
+	 * The next free block is usually close to the last one allocated, so search the first few
+	 * words, the first of which may be unaligned, one word at a time. The byte loop finds a
+	 * nearby free block sooner than building masks for a whole step would. (Array is padded
+	 * so reading past end is safe.)
 	 */
-	zero_index = find_zero_byte_in_word(next_counter, next_index, end_index);
-	if (zero_index < end_index) {
-		*index_ptr = zero_index;
-		return true;
-	}
+	for (word = 0; word < WORDS_PER_SEARCH_STEP; word++) {
+		zero_index = find_zero_byte_in_word(next_counter, next_index, end_index);
+		if (zero_index < end_index) {
+			*index_ptr = zero_index;
+			return true;
+		}
 
-	/*
-	 * On architectures where unaligned word access is expensive, this would be a good place to
-	 * advance to an alignment boundary.
-	 */
-	next_index += BYTES_PER_WORD;
-	next_counter += BYTES_PER_WORD;
+		next_index += BYTES_PER_WORD;
+		next_counter += BYTES_PER_WORD;
+		if (next_counter >= end_counter)
+			return false;
+	}
 
 	/*
-	 * Now we're word-aligned; check an word at a time until we find a word containing a zero.
-	 * (Array is padded so reading past end is safe.)
+	 * On a nearly full slab, free blocks are far apart, so check several words at a time until
+	 * we find a step containing a zero. (Array is padded so reading past end is safe.)
 	 */
 	while (next_counter < end_counter) {
-		/*
-		 * The following code is currently an exact copy of the code preceding the loop,
-		 * but if you try to merge them by using a do loop, it runs slower because a jump
-		 * instruction gets added at the start of the iteration.
-		 */
-		zero_index = find_zero_byte_in_word(next_counter, next_index, end_index);
+		zero_index = find_zero_byte_in_step(next_counter, next_index, end_index);
 		if (zero_index < end_index) {
 			*index_ptr = zero_index;
 			return true;
 		}
 
-		next_index += BYTES_PER_WORD;
-		next_counter += BYTES_PER_WORD;
+		next_index += BYTES_PER_SEARCH_STEP;
+		next_counter += BYTES_PER_SEARCH_STEP;
 	}
 
 	return false;
@@ -892,12 +1004,11 @@ bool vdo_find_free_block(const struct ref_counts *ref_counts,
 static bool search_current_reference_block(const struct ref_counts *ref_counts,
 					   slab_block_number *free_index_ptr)
 {
+	const struct search_cursor *cursor = &ref_counts->search_cursor;
+
 	/* Don't bother searching if the current block is known to be full. */
-	return ((ref_counts->search_cursor.block->allocated_count < COUNTS_PER_BLOCK) &&
-		vdo_find_free_block(ref_counts,
-				    ref_counts->search_cursor.index,
-				    ref_counts->search_cursor.end_index,
-				    free_index_ptr));
+	return (!test_bit(cursor->block - cursor->first_block, ref_counts->full_blocks) &&
+		vdo_find_free_block(ref_counts, cursor->index, cursor->end_index, free_index_ptr));
 }
 
 /**
@@ -944,6 +1055,7 @@ make_provisional_reference(struct ref_counts *ref_counts, slab_block_number bloc
 
 	/* Account for the allocation. */
 	block->allocated_count++;
+	update_full_block_summary(block);
 	ref_counts->free_blocks--;
 }
 
@@ -1086,6 +1198,10 @@ void vdo_reset_reference_counts(struct ref_counts *ref_counts)
 	for (i = 0; i < ref_counts->reference_block_count; i++)
 		ref_counts->blocks[i].allocated_count = 0;
 
+	memset(ref_counts->full_blocks,
+	       0,
+	       BITS_TO_LONGS(ref_counts->reference_block_count) * sizeof(unsigned long));
+
 	notify_all_waiters(&ref_counts->dirty_blocks, clear_dirty_reference_blocks, NULL);
 }
 #endif /* INTERNAL */
@@ -1379,6 +1495,8 @@ static void clear_provisional_references(struct reference_block *block)
 			block->allocated_count--;
 		}
 	}
+
+	update_full_block_summary(block);
 }
 
 static inline bool journal_points_equal(struct journal_point first, struct journal_point second)
@@ -1427,6 +1545,8 @@ unpack_reference_block(struct packed_reference_block *packed, struct reference_b
 	for (index = 0; index < COUNTS_PER_BLOCK; index++)
 		if (counters[index] != EMPTY_REFERENCE_COUNT)
 			block->allocated_count++;
+
+	update_full_block_summary(block);
 }
 
 /**
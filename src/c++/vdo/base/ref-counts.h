@@ -79,6 +79,8 @@ struct ref_counts {
 
 	/* The saved block pointer and array indexes for the free block search */
 	struct search_cursor search_cursor;
+	/* A bitmap of the reference blocks which have no free counters, so the search can skip them */
+	unsigned long *full_blocks;
 
 	/* A list of the dirty blocks waiting to be written out */
 	struct wait_queue dirty_blocks;
@@ -113,6 +115,9 @@ void vdo_reset_search_cursor(struct ref_counts *ref_counts);
 u8 __must_check
 vdo_get_available_references(struct ref_counts *ref_counts, physical_block_number_t pbn);
 
+bool __must_check
+vdo_can_net_reference_changes(struct ref_counts *ref_counts, physical_block_number_t pbn);
+
 int __must_check
 vdo_adjust_reference_count(struct ref_counts *ref_counts,
 			   struct reference_updater *updater,
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright Red Hat
+ */
+
+#include "ring-queue.h"
+
+#include <linux/log2.h>
+
+#include "memory-alloc.h"
+#include "permassert.h"
+
+#include "status-codes.h"
+
+/**
+ * make_ring_queue() - Create a ring queue.
+ * @capacity: The number of entries the ring can hold, which must be a power of two.
+ * @queue_ptr: A pointer to hold the new queue.
+ *
+ * Return: VDO_SUCCESS or an error code.
+ */
+int make_ring_queue(unsigned int capacity, struct ring_queue **queue_ptr)
+{
+	struct ring_queue *queue;
+	unsigned int i;
+	int result;
+
+	result = ASSERT(is_power_of_2(capacity), "ring queue capacity %u is a power of two",
+			capacity);
+	if (result != VDO_SUCCESS)
+		return result;
+
+	result = UDS_ALLOCATE(1, struct ring_queue, "ring queue", &queue);
+	if (result != VDO_SUCCESS)
+		return result;
+
+	result = UDS_ALLOCATE(capacity, struct ring_queue_slot, "ring queue slots", &queue->slots);
+	if (result != VDO_SUCCESS) {
+		UDS_FREE(queue);
+		return result;
+	}
+
+	/* Slot i is first written at position i. */
+	for (i = 0; i < capacity; i++)
+		atomic_set(&queue->slots[i].sequence, i);
+
+	queue->mask = capacity - 1;
+	atomic_set(&queue->put_position, 0);
+	atomic_set(&queue->poll_position, 0);
+	*queue_ptr = queue;
+	return VDO_SUCCESS;
+}
+
+void free_ring_queue(struct ring_queue *queue)
+{
+	if (queue == NULL)
+		return;
+
+	UDS_FREE(UDS_FORGET(queue->slots));
+	UDS_FREE(queue);
+}
+
+/*
+ * Compare a slot's sequence number to a position. Positions wrap, so only the sign of the
+ * difference is meaningful.
+ */
+static inline int slot_lag(struct ring_queue_slot *slot, unsigned int position)
+{
+	return (int) ((unsigned int) atomic_read_acquire(&slot->sequence) - position);
+}
+
+/**
+ * ring_queue_put() - Add an entry to the end of a ring queue.
+ * @queue: The queue.
+ * @entry: The entry to add, which may not be NULL.
+ *
+ * May be called from any number of threads concurrently.
+ *
+ * Return: true if the entry was added, false if the queue was full.
+ */
+bool ring_queue_put(struct ring_queue *queue, void *entry)
+{
+	unsigned int position = atomic_read(&queue->put_position);
+
+	while (true) {
+		struct ring_queue_slot *slot = &queue->slots[position & queue->mask];
+		int lag = slot_lag(slot, position);
+
+		if (lag == 0) {
+			/* The slot is free for this lap; try to claim it. */
+			unsigned int claimed = atomic_cmpxchg(&queue->put_position,
+							      position,
+							      position + 1);
+
+			if (claimed == position) {
+				slot->entry = entry;
+				/* Publish the entry to consumers. */
+				atomic_set_release(&slot->sequence, position + 1);
+				return true;
+			}
+
+			position = claimed;
+		} else if (lag < 0) {
+			/* The slot still holds an entry from the previous lap. */
+			return false;
+		} else {
+			/* Another producer has claimed this position. */
+			position = atomic_read(&queue->put_position);
+		}
+	}
+}
+
+/**
+ * ring_queue_poll_batch() - Remove a run of entries from the front of a ring queue.
+ * @queue: The queue.
+ * @entries: An array to hold the entries removed.
+ * @max_entries: The maximum number of entries to remove.
+ *
+ * May be called from any number of threads concurrently. All of the entries are claimed with a
+ * single atomic operation. Entries which have been claimed by producers but not yet written end
+ * the run, so this may return fewer entries than are in the queue, or none at all if such an
+ * entry is at the front.
+ *
+ * Return: The number of entries removed.
+ */
+unsigned int ring_queue_poll_batch(struct ring_queue *queue, void *entries[],
+				   unsigned int max_entries)
+{
+	unsigned int position = atomic_read(&queue->poll_position);
+
+	while (true) {
+		unsigned int count = 0;
+		unsigned int claimed;
+		unsigned int i;
+
+		while (count < max_entries) {
+			struct ring_queue_slot *slot = &queue->slots[(position + count) & queue->mask];
+
+			if (slot_lag(slot, position + count + 1) != 0)
+				break;
+
+			count++;
+		}
+
+		if (count == 0) {
+			struct ring_queue_slot *slot = &queue->slots[position & queue->mask];
+
+			/* The front slot is not full for this lap, so the queue is empty. */
+			if ((max_entries == 0) || (slot_lag(slot, position + 1) < 0))
+				return 0;
+
+			/* Another consumer has taken this position. */
+			position = atomic_read(&queue->poll_position);
+			continue;
+		}
+
+		claimed = atomic_cmpxchg(&queue->poll_position, position, position + count);
+		if (claimed != position) {
+			position = claimed;
+			continue;
+		}
+
+		for (i = 0; i < count; i++) {
+			struct ring_queue_slot *slot = &queue->slots[(position + i) & queue->mask];
+
+			entries[i] = slot->entry;
+			/* Free the slot for the producers' next lap. */
+			atomic_set_release(&slot->sequence, position + i + queue->mask + 1);
+		}
+
+		return count;
+	}
+}
+
+/*
+ * Check whether a ring queue is empty. Entries which have been claimed but not yet written by a
+ * producer are not counted.
+ */
+bool is_ring_queue_empty(struct ring_queue *queue)
+{
+	unsigned int position = atomic_read(&queue->poll_position);
+
+	return (slot_lag(&queue->slots[position & queue->mask], position + 1) < 0);
+}
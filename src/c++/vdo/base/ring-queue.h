@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright Red Hat
+ */
+
+#ifndef VDO_RING_QUEUE_H
+#define VDO_RING_QUEUE_H
+
+#include <linux/atomic.h>
+#include <linux/cache.h>
+
+/*
+ * A ring queue is a bounded, lock-free queue which accepts entries from multiple threads
+ * (multi-producer) and delivers them to multiple threads (multi-consumer). Unlike a funnel queue,
+ * a consumer can claim a run of consecutive entries with a single atomic operation, and a
+ * preempted producer only hides its own entry (and those behind it) from consumers rather than
+ * the whole tail of the queue.
+ *
+ * Each slot in the ring carries a sequence number which tells producers and consumers whether the
+ * slot is free for the current lap of the ring or holds an entry from it, so entries are never
+ * read before they are completely written and slots are never reused before they are read. The
+ * queue stores only pointers; callers own the entries.
+ *
+ * Since the ring is bounded, ring_queue_put() can fail. Callers which must not lose entries need
+ * somewhere else to put them when the ring is full.
+ */
+
+struct ring_queue_slot {
+	/* The lap-relative position at which this slot may next be written or read */
+	atomic_t sequence;
+	void *entry;
+};
+
+/*
+ * The dynamically allocated queue structure, which is allocated on a cache line boundary so the
+ * producer and consumer positions will land on separate cache lines.
+ */
+struct __aligned(L1_CACHE_BYTES) ring_queue {
+	/* The number of slots minus one; the number of slots is a power of two */
+	unsigned int mask;
+	struct ring_queue_slot *slots;
+
+	/* The position at which the next entry will be put */
+	atomic_t put_position __aligned(L1_CACHE_BYTES);
+
+	/* The position from which the next entry will be polled */
+	atomic_t poll_position __aligned(L1_CACHE_BYTES);
+};
+
+int __must_check make_ring_queue(unsigned int capacity, struct ring_queue **queue_ptr);
+
+void free_ring_queue(struct ring_queue *queue);
+
+bool __must_check ring_queue_put(struct ring_queue *queue, void *entry);
+
+unsigned int __must_check
+ring_queue_poll_batch(struct ring_queue *queue, void *entries[], unsigned int max_entries);
+
+bool __must_check is_ring_queue_empty(struct ring_queue *queue);
+
+#endif /* VDO_RING_QUEUE_H */
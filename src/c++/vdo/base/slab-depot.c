@@ -20,6 +20,7 @@
 #include "encodings.h"
 #include "heap.h"
 #include "io-submitter.h"
+#include "physical-zone.h"
 #include "priority-table.h"
 #include "recovery.h"
 #include "ref-counts.h"
@@ -2484,6 +2485,11 @@ static void do_drain_step(struct vdo_completion *completion)
 static void initiate_drain(struct admin_state *state)
 {
 	struct block_allocator *allocator = container_of(state, struct block_allocator, state);
+	struct physical_zones *zones = allocator->depot->vdo->physical_zones;
+
+	/* Nothing is allocating now, so return the blocks reserved for sequential writes. */
+	if (zones != NULL)
+		vdo_release_allocation_extents(&zones->zones[allocator->zone_number]);
 
 	allocator->drain_step = VDO_DRAIN_ALLOCATOR_START;
 	do_drain_step(&allocator->completion);
@@ -2690,6 +2696,8 @@ get_block_allocator_statistics(const struct slab_depot *depot)
 		totals.slab_count += allocator->slab_count;
 		totals.slabs_opened += READ_ONCE(stats->slabs_opened);
 		totals.slabs_reopened += READ_ONCE(stats->slabs_reopened);
+		totals.extents_reserved += READ_ONCE(stats->extents_reserved);
+		totals.extent_blocks_allocated += READ_ONCE(stats->extent_blocks_allocated);
 	}
 
 	return totals;
@@ -2740,6 +2748,7 @@ get_slab_journal_statistics(const struct slab_depot *depot)
 		totals.blocked_count += READ_ONCE(stats->blocked_count);
 		totals.blocks_written += READ_ONCE(stats->blocks_written);
 		totals.tail_busy_count += READ_ONCE(stats->tail_busy_count);
+		totals.entries_coalesced += READ_ONCE(stats->entries_coalesced);
 	}
 
 	return totals;
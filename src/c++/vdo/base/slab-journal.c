@@ -15,6 +15,7 @@
 #include "admin-state.h"
 #include "data-vio.h"
 #include "io-submitter.h"
+#include "physical-zone.h"
 #include "recovery-journal.h"
 #include "ref-counts.h"
 #include "slab-depot.h"
@@ -1124,6 +1125,49 @@ static void add_entries(struct slab_journal *journal)
 		commit_tail(journal);
 }
 
+/**
+ * coalesce_entry() - Net out the increment and decrement of a write which remaps its logical block
+ *                    to the physical block it was already mapped to.
+ * @journal: The journal to which the entry would be added.
+ * @updater: The reference updater for the entry.
+ *
+ * Overwriting a block with the data it already holds deduplicates against the block itself, so the
+ * write increments and then decrements the same block. The recovery journal points of the two
+ * changes are adjacent, so no other entry can be ordered between them, and replay of the recovery
+ * journal will apply both changes or neither. So long as the increment could not fail, the pair has
+ * no effect on the reference count, and neither change need be journaled or applied.
+ *
+ * Return: true if the entry was coalesced and its completion has been continued.
+ */
+static bool coalesce_entry(struct slab_journal *journal, struct reference_updater *updater)
+{
+	struct data_vio *data_vio = data_vio_from_reference_updater(updater);
+	struct reference_updater *decrement = &data_vio->decrement_updater;
+
+	if (updater->coalesced) {
+		/* The increment has already been netted out against this decrement. */
+		WRITE_ONCE(journal->events->entries_coalesced,
+			   journal->events->entries_coalesced + 1);
+		vdo_continue_completion(&data_vio->decrement_completion, VDO_SUCCESS);
+		return true;
+	}
+
+	if (!updater->increment || (updater->operation != VDO_JOURNAL_DATA_REMAPPING) ||
+	    (decrement->operation != VDO_JOURNAL_DATA_REMAPPING) ||
+	    (decrement->zpbn.pbn != updater->zpbn.pbn) ||
+	    (journal->slab->status != VDO_SLAB_REBUILT) ||
+	    !vdo_can_net_reference_changes(journal->slab->reference_counts, updater->zpbn.pbn))
+		return false;
+
+	decrement->coalesced = true;
+	if (updater->lock != NULL)
+		vdo_unassign_pbn_lock_provisional_reference(updater->lock);
+
+	WRITE_ONCE(journal->events->entries_coalesced, journal->events->entries_coalesced + 1);
+	continue_data_vio(data_vio);
+	return true;
+}
+
 /**
  * vdo_add_slab_journal_entry() - Add an entry to a slab journal.
  * @journal: The slab journal to use.
@@ -1146,6 +1190,9 @@ void vdo_add_slab_journal_entry(struct slab_journal *journal,
 		return;
 	}
 
+	if (coalesce_entry(journal, updater))
+		return;
+
 	enqueue_waiter(&journal->entry_waiters, &updater->waiter);
 	if ((slab->status != VDO_SLAB_REBUILT) && requires_reaping(journal))
 		vdo_register_slab_for_scrubbing(slab, true);
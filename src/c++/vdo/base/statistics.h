@@ -0,0 +1,164 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+#include "types.h"
+enum { STATISTICS_VERSION = 44 };
+struct block_allocator_statistics {
+	u64 slab_count;
+	u64 slabs_opened;
+	u64 slabs_reopened;
+	u64 extents_reserved;
+	u64 extent_blocks_allocated;
+};
+struct commit_statistics {
+	u64 started;
+	u64 written;
+	u64 committed;
+};
+struct recovery_journal_statistics {
+	u64 disk_full;
+	u64 slab_journal_commits_requested;
+	u64 commits_held;
+	struct commit_statistics entries;
+	struct commit_statistics blocks;
+};
+struct packer_statistics {
+	u64 compressed_fragments_written;
+	u64 compressed_blocks_written;
+	u64 compressed_fragments_in_packer;
+	u64 blocks_under_half_full;
+	u64 blocks_half_to_three_quarters_full;
+	u64 blocks_three_quarters_to_ninety_percent_full;
+	u64 blocks_over_ninety_percent_full;
+};
+struct compression_bypass_statistics {
+	u64 blocks_skipped;
+	u64 blocks_sampled;
+};
+struct decompression_cache_statistics {
+	u64 hits;
+	u64 misses;
+};
+struct slab_journal_statistics {
+	u64 disk_full_count;
+	u64 flush_count;
+	u64 blocked_count;
+	u64 blocks_written;
+	u64 tail_busy_count;
+	u64 entries_coalesced;
+};
+struct slab_summary_statistics {
+	u64 blocks_written;
+};
+struct ref_counts_statistics {
+	u64 blocks_written;
+};
+struct block_map_statistics {
+	u32 dirty_pages;
+	u32 clean_pages;
+	u32 free_pages;
+	u32 failed_pages;
+	u32 incoming_pages;
+	u32 outgoing_pages;
+	u32 cache_pressure;
+	u64 read_count;
+	u64 write_count;
+	u64 failed_reads;
+	u64 failed_writes;
+	u64 reclaimed;
+	u64 read_outgoing;
+	u64 found_in_cache;
+	u64 discard_required;
+	u64 wait_for_page;
+	u64 fetch_required;
+	u64 pages_loaded;
+	u64 pages_saved;
+	u64 flush_count;
+	u64 cache_misses;
+	u64 ghost_hits;
+	u64 prefetch_issued;
+	u64 prefetch_used;
+	u64 prefetch_wasted;
+};
+struct hash_lock_statistics {
+	u64 dedupe_advice_valid;
+	u64 dedupe_advice_stale;
+	u64 concurrent_data_matches;
+	u64 concurrent_hash_collisions;
+	u32 curr_dedupe_queries;
+};
+struct error_statistics {
+	u64 invalid_advice_pbn_count;
+	u64 no_space_error_count;
+	u64 read_only_error_count;
+};
+struct bio_stats {
+	u64 read;
+	u64 write;
+	u64 empty_flush;
+	u64 discard;
+	u64 flush;
+	u64 fua;
+};
+struct memory_usage {
+	u64 bytes_used;
+	u64 peak_bytes_used;
+};
+struct index_statistics {
+	u64 entries_indexed;
+	u64 posts_found;
+	u64 posts_not_found;
+	u64 queries_found;
+	u64 queries_not_found;
+	u64 updates_found;
+	u64 updates_not_found;
+	u64 entries_discarded;
+};
+struct vdo_statistics {
+	u32 version;
+	u32 release_version;
+	u64 data_blocks_used;
+	u64 overhead_blocks_used;
+	u64 logical_blocks_used;
+	block_count_t physical_blocks;
+	block_count_t logical_blocks;
+	u64 block_map_cache_size;
+	u64 block_size;
+	u64 complete_recoveries;
+	u64 read_only_recoveries;
+	char mode[15];
+	bool in_recovery_mode;
+	u8 recovery_percentage;
+	struct packer_statistics packer;
+	struct compression_bypass_statistics compression_bypass;
+	struct decompression_cache_statistics decompression_cache;
+	struct block_allocator_statistics allocator;
+	struct recovery_journal_statistics journal;
+	struct slab_journal_statistics slab_journal;
+	struct slab_summary_statistics slab_summary;
+	struct ref_counts_statistics ref_counts;
+	struct block_map_statistics block_map;
+	struct hash_lock_statistics hash_lock;
+	struct error_statistics errors;
+	u32 instance;
+	u32 current_vios_in_progress;
+	u32 max_vios;
+	u64 dedupe_advice_timeouts;
+	u64 flush_out;
+	u64 logical_block_size;
+	struct bio_stats bios_in;
+	struct bio_stats bios_in_partial;
+	struct bio_stats bios_out;
+	struct bio_stats bios_meta;
+	struct bio_stats bios_journal;
+	struct bio_stats bios_page_cache;
+	struct bio_stats bios_out_completed;
+	struct bio_stats bios_meta_completed;
+	struct bio_stats bios_journal_completed;
+	struct bio_stats bios_page_cache_completed;
+	struct bio_stats bios_acknowledged;
+	struct bio_stats bios_acknowledged_partial;
+	struct bio_stats bios_in_progress;
+	struct memory_usage memory_usage;
+	struct index_statistics index;
+};
+#endif
@@ -225,6 +225,24 @@ struct thread_count_config {
 	unsigned int hash_zones;
 } __packed;
 
+/* The replacement policies available to the block map page cache. */
+enum block_map_cache_policy {
+	/* evict the least recently used page */
+	VDO_BLOCK_MAP_CACHE_LRU,
+	/* admit pages through a probationary FIFO, protecting pages which are re-referenced */
+	VDO_BLOCK_MAP_CACHE_2Q,
+};
+
+/* The compressors available for compressing data blocks. */
+enum vdo_compression_type {
+	/* LZ4 at its default acceleration */
+	VDO_COMPRESSION_LZ4,
+	/* LZ4 high compression, which produces the same format as LZ4 */
+	VDO_COMPRESSION_LZ4HC,
+	/* zstd at its fastest level */
+	VDO_COMPRESSION_ZSTD,
+};
+
 struct device_config {
 	struct dm_target *owning_target;
 	struct dm_dev *owned_device;
@@ -234,6 +252,9 @@ struct device_config {
 	char *original_string;
 	unsigned int version;
 	char *parent_device_name;
+	/* The separate device holding the recovery journal and slab summary, if any */
+	struct dm_dev *journal_device;
+	char *journal_device_name;
 	block_count_t physical_blocks;
 	/*
 	 * This is the number of logical blocks from VDO's internal point of view. It is the number
@@ -243,8 +264,15 @@ struct device_config {
 	unsigned int logical_block_size;
 	unsigned int cache_size;
 	unsigned int block_map_maximum_age;
+	enum block_map_cache_policy cache_policy;
 	bool deduplication;
+	/* Whether to back the dedupe index's volume index with huge pages */
+	bool index_huge_pages;
 	bool compression;
+	enum vdo_compression_type compression_type;
+	bool packer_lookahead;
+	unsigned int journal_commit_window;
+	unsigned int allocation_extent;
 	struct thread_count_config thread_counts;
 	block_count_t max_discard_blocks;
 };
@@ -258,11 +286,16 @@ enum vdo_completion_type {
 	VDO_BLOCK_MAP_RECOVERY_COMPLETION,
 	VDO_DATA_VIO_POOL_COMPLETION,
 	VDO_DECREMENT_COMPLETION,
+	VDO_DEDUPE_LAUNCH_COMPLETION,
+	VDO_EXTENT_RELEASE_COMPLETION,
 	VDO_FLUSH_COMPLETION,
 	VDO_FLUSH_NOTIFICATION_COMPLETION,
 	VDO_GENERATION_FLUSHED_COMPLETION,
+	VDO_HASH_BATCH_COMPLETION,
 	VDO_HASH_ZONE_COMPLETION,
 	VDO_HASH_ZONES_COMPLETION,
+	VDO_JOURNAL_COMMIT_TIMER_COMPLETION,
+	VDO_JOURNAL_FLUSH_COMPLETION,
 	VDO_LOCK_COUNTER_COMPLETION,
 	VDO_PAGE_COMPLETION,
 	VDO_READ_ONLY_MODE_COMPLETION,
@@ -9,6 +9,7 @@
 
 #include "vdo-histograms.h"
 
+#include "encodings.h"
 #include "histogram.h"
 
 /**
@@ -56,6 +57,21 @@ void vdo_initialize_histograms(struct kobject *parent, struct vdo_histograms *hi
 						   "flushes",
 						   "latency",
 						   6);
+	histograms->journal_commit_histogram =
+		make_logarithmic_jiffies_histogram(parent,
+						   "journal_commit",
+						   "Recovery Journal Commit",
+						   "entries",
+						   "latency",
+						   5);
+	histograms->journal_entries_histogram =
+		make_linear_histogram(parent,
+				      "journal_entries",
+				      "Recovery Journal Write",
+				      "writes",
+				      "new entries",
+				      NULL,
+				      RECOVERY_JOURNAL_ENTRIES_PER_BLOCK + 1);
 	histograms->read_ack_histogram =
 		make_logarithmic_jiffies_histogram(parent,
 						   "acknowledge_read",
@@ -122,6 +138,8 @@ void vdo_destroy_histograms(struct vdo_histograms *histograms)
 {
 	free_histogram(UDS_FORGET(histograms->discard_ack_histogram));
 	free_histogram(UDS_FORGET(histograms->flush_histogram));
+	free_histogram(UDS_FORGET(histograms->journal_commit_histogram));
+	free_histogram(UDS_FORGET(histograms->journal_entries_histogram));
 	free_histogram(UDS_FORGET(histograms->post_histogram));
 	free_histogram(UDS_FORGET(histograms->query_histogram));
 	free_histogram(UDS_FORGET(histograms->read_ack_histogram));
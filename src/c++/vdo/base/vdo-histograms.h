@@ -14,6 +14,8 @@ struct vdo_histograms {
 	struct histogram *update_histogram;
 	struct histogram *discard_ack_histogram;
 	struct histogram *flush_histogram;
+	struct histogram *journal_commit_histogram;
+	struct histogram *journal_entries_histogram;
 	struct histogram *read_ack_histogram;
 	struct histogram *read_bios_histogram;
 	struct histogram *read_queue_histogram;
@@ -41,6 +41,8 @@ const block_count_t VDO_ALL_FREE_BLOCKS = (u64) -1;
 struct fixed_layout {
 	physical_block_number_t first_free;
 	physical_block_number_t last_free;
+	/* The first block of the journal device not used by any partition */
+	physical_block_number_t journal_device_free;
 	size_t num_partitions;
 	struct partition *head;
 };
@@ -51,6 +53,7 @@ struct partition {
 	physical_block_number_t offset; /* The offset into the layout of this partition */
 	physical_block_number_t base; /* The untranslated number of the first block */
 	block_count_t count; /* The number of blocks in the partition */
+	bool on_journal_device; /* Whether the offset is on the journal device */
 	struct partition *next; /* A pointer to the next partition in the layout */
 };
 
@@ -67,6 +70,15 @@ struct partition_3_0 {
 	block_count_t count;
 } __packed;
 
+/* Version 3.1 is only used by layouts which place some partitions on a journal device. */
+struct partition_3_1 {
+	enum partition_id id;
+	physical_block_number_t offset;
+	physical_block_number_t base;
+	block_count_t count;
+	u8 on_journal_device;
+} __packed;
+
 static const struct header LAYOUT_HEADER_3_0 = {
 	.id = VDO_FIXED_LAYOUT,
 	.version = {
@@ -76,6 +88,15 @@ static const struct header LAYOUT_HEADER_3_0 = {
 	.size = sizeof(struct layout_3_0), /* Minimum size (contains no partitions) */
 };
 
+static const struct header LAYOUT_HEADER_3_1 = {
+	.id = VDO_FIXED_LAYOUT,
+	.version = {
+		.major_version = 3,
+		.minor_version = 1,
+	},
+	.size = sizeof(struct layout_3_0), /* Minimum size (contains no partitions) */
+};
+
 /**
  * vdo_make_fixed_layout() - Make an unpartitioned fixed layout.
  * @total_blocks: The total size of the layout, in blocks.
@@ -97,6 +118,7 @@ int vdo_make_fixed_layout(block_count_t total_blocks,
 
 	layout->first_free = start_offset;
 	layout->last_free = start_offset + total_blocks;
+	layout->journal_device_free = VDO_JOURNAL_DEVICE_LAYOUT_START;
 	layout->num_partitions = 0;
 	layout->head = NULL;
 
@@ -136,12 +158,34 @@ block_count_t vdo_get_total_fixed_layout_size(const struct fixed_layout *layout)
 	block_count_t size = vdo_get_fixed_layout_blocks_available(layout);
 	struct partition *partition;
 
-	for (partition = layout->head; partition != NULL; partition = partition->next)
-		size += partition->count;
+	for (partition = layout->head; partition != NULL; partition = partition->next) {
+		if (!partition->on_journal_device)
+			size += partition->count;
+	}
 
 	return size;
 }
 
+/**
+ * vdo_get_fixed_layout_journal_device_size() - Get the number of journal device blocks a layout
+ *                                              uses.
+ * @layout: The layout.
+ *
+ * Return: The number of blocks, including the geometry block copy, needed on the journal device,
+ *         or 0 if the layout does not use a journal device.
+ */
+block_count_t vdo_get_fixed_layout_journal_device_size(const struct fixed_layout *layout)
+{
+	struct partition *partition;
+
+	for (partition = layout->head; partition != NULL; partition = partition->next) {
+		if (partition->on_journal_device)
+			return layout->journal_device_free;
+	}
+
+	return 0;
+}
+
 /**
  * vdo_get_fixed_layout_partition() - Get a partition by id.
  * @layout: The layout from which to get a partition.
@@ -247,6 +291,7 @@ block_count_t vdo_get_fixed_layout_blocks_available(const struct fixed_layout *l
  * @offset: The offset into the layout at which the partition begins.
  * @base: The number of the first block for users of the partition.
  * @block_count: The number of blocks in the partition.
+ * @on_journal_device: Whether the offset is on the journal device rather than the backing device.
  *
  * The partition will be attached to the partition list in the layout.
  *
@@ -256,7 +301,8 @@ static int allocate_partition(struct fixed_layout *layout,
 			      u8 id,
 			      physical_block_number_t offset,
 			      physical_block_number_t base,
-			      block_count_t block_count)
+			      block_count_t block_count,
+			      bool on_journal_device)
 {
 	struct partition *partition;
 	int result;
@@ -270,9 +316,13 @@ static int allocate_partition(struct fixed_layout *layout,
 	partition->offset = offset;
 	partition->base = base;
 	partition->count = block_count;
+	partition->on_journal_device = on_journal_device;
 	partition->next = layout->head;
 	layout->head = partition;
 
+	if (on_journal_device && ((offset + block_count) > layout->journal_device_free))
+		layout->journal_device_free = offset + block_count;
+
 	return VDO_SUCCESS;
 }
 
@@ -314,7 +364,7 @@ int vdo_make_fixed_layout_partition(struct fixed_layout *layout,
 	offset = ((direction == VDO_PARTITION_FROM_END) ?
 		  (layout->last_free - block_count) :
 		  layout->first_free);
-	result = allocate_partition(layout, id, offset, base, block_count);
+	result = allocate_partition(layout, id, offset, base, block_count, false);
 	if (result != VDO_SUCCESS)
 		return result;
 
@@ -327,6 +377,37 @@ int vdo_make_fixed_layout_partition(struct fixed_layout *layout,
 	return VDO_SUCCESS;
 }
 
+/**
+ * vdo_make_fixed_layout_journal_device_partition() - Create a new partition on the journal device.
+ * @layout: The fixed layout.
+ * @id: The id of the partition to make.
+ * @block_count: The number of blocks in the partition.
+ * @base: The number of the first block in the partition from the point of view of its users.
+ *
+ * Partitions on the journal device are allocated in order following the copy of the geometry
+ * block. They take no space from the rest of the layout.
+ *
+ * Return: A success or error code.
+ */
+int vdo_make_fixed_layout_journal_device_partition(struct fixed_layout *layout,
+						   enum partition_id id,
+						   block_count_t block_count,
+						   physical_block_number_t base)
+{
+	int result;
+
+	result = vdo_get_fixed_layout_partition(layout, id, NULL);
+	if (result != VDO_UNKNOWN_PARTITION)
+		return VDO_PARTITION_EXISTS;
+
+	result = allocate_partition(layout, id, layout->journal_device_free, base, block_count, true);
+	if (result != VDO_SUCCESS)
+		return result;
+
+	layout->num_partitions++;
+	return VDO_SUCCESS;
+}
+
 /**
  * vdo_get_fixed_layout_partition_size() - Return the size in blocks of a partition.
  * @partition: A partition of the fixed_layout.
@@ -361,6 +442,17 @@ physical_block_number_t vdo_get_fixed_layout_partition_base(const struct partiti
 	return partition->base;
 }
 
+/**
+ * vdo_is_journal_device_partition() - Check whether a partition is on the journal device.
+ * @partition: A partition of the fixed_layout.
+ *
+ * Return: true if the partition's offset is on the journal device rather than the backing device.
+ */
+bool vdo_is_journal_device_partition(const struct partition *partition)
+{
+	return partition->on_journal_device;
+}
+
 /**
  * get_encoded_size() - Get the size of an encoded layout
  * @layout: The layout.
@@ -369,7 +461,11 @@ physical_block_number_t vdo_get_fixed_layout_partition_base(const struct partiti
  */
 static inline size_t get_encoded_size(const struct fixed_layout *layout)
 {
-	return sizeof(struct layout_3_0) + (sizeof(struct partition_3_0) * layout->num_partitions);
+	size_t partition_size = ((vdo_get_fixed_layout_journal_device_size(layout) > 0) ?
+				 sizeof(struct partition_3_1) :
+				 sizeof(struct partition_3_0));
+
+	return sizeof(struct layout_3_0) + (partition_size * layout->num_partitions);
 }
 
 size_t vdo_get_fixed_layout_encoded_size(const struct fixed_layout *layout)
@@ -379,13 +475,15 @@ size_t vdo_get_fixed_layout_encoded_size(const struct fixed_layout *layout)
 
 /**
  * encode_partitions_3_0() - Encode a null-terminated list of fixed layout partitions into a buffer
- *                           using partition format 3.0.
+ *                           using partition format 3.0 or 3.1.
  * @layout: The layout containing the list of partitions to encode.
+ * @version_3_1: Whether to use format 3.1, which records the device of each partition.
  * @buffer: A buffer positioned at the start of the encoding.
  *
  * Return: UDS_SUCCESS or an error code.
  */
-static int encode_partitions_3_0(const struct fixed_layout *layout, struct buffer *buffer)
+static int
+encode_partitions_3_0(const struct fixed_layout *layout, bool version_3_1, struct buffer *buffer)
 {
 	const struct partition *partition;
 
@@ -408,6 +506,13 @@ static int encode_partitions_3_0(const struct fixed_layout *layout, struct buffe
 		result = put_u64_le_into_buffer(buffer, partition->count);
 		if (result != UDS_SUCCESS)
 			return result;
+
+		if (!version_3_1)
+			continue;
+
+		result = put_byte(buffer, partition->on_journal_device ? 1 : 0);
+		if (result != UDS_SUCCESS)
+			return result;
 	}
 
 	return UDS_SUCCESS;
@@ -452,7 +557,8 @@ int vdo_encode_fixed_layout(const struct fixed_layout *layout, struct buffer *bu
 {
 	size_t initial_length, encoded_size;
 	int result;
-	struct header header = LAYOUT_HEADER_3_0;
+	bool version_3_1 = (vdo_get_fixed_layout_journal_device_size(layout) > 0);
+	struct header header = (version_3_1 ? LAYOUT_HEADER_3_1 : LAYOUT_HEADER_3_0);
 
 	if (!ensure_available_space(buffer, vdo_get_fixed_layout_encoded_size(layout)))
 		return UDS_BUFFER_ERROR;
@@ -474,7 +580,7 @@ int vdo_encode_fixed_layout(const struct fixed_layout *layout, struct buffer *bu
 	if (result != UDS_SUCCESS)
 		return result;
 
-	result = encode_partitions_3_0(layout, buffer);
+	result = encode_partitions_3_0(layout, version_3_1, buffer);
 	if (result != UDS_SUCCESS)
 		return result;
 
@@ -485,18 +591,20 @@ int vdo_encode_fixed_layout(const struct fixed_layout *layout, struct buffer *bu
 
 /**
  * decode_partitions_3_0() - Decode a sequence of fixed layout partitions from a buffer using
- *                           partition format 3.0.
+ *                           partition format 3.0 or 3.1.
  * @buffer: A buffer positioned at the start of the encoding.
+ * @version_3_1: Whether the partitions are in format 3.1, which records the device of each.
  * @layout: The layout in which to allocate the decoded partitions.
  *
  * Return: UDS_SUCCESS or an error code.
  */
-static int decode_partitions_3_0(struct buffer *buffer, struct fixed_layout *layout)
+static int
+decode_partitions_3_0(struct buffer *buffer, bool version_3_1, struct fixed_layout *layout)
 {
 	size_t i;
 
 	for (i = 0; i < layout->num_partitions; i++) {
-		u8 id;
+		u8 id, on_journal_device = 0;
 		u64 offset, base, count;
 		int result;
 
@@ -516,7 +624,13 @@ static int decode_partitions_3_0(struct buffer *buffer, struct fixed_layout *lay
 		if (result != UDS_SUCCESS)
 			return result;
 
-		result = allocate_partition(layout, id, offset, base, count);
+		if (version_3_1) {
+			result = get_byte(buffer, &on_journal_device);
+			if (result != UDS_SUCCESS)
+				return result;
+		}
+
+		result = allocate_partition(layout, id, offset, base, count, (on_journal_device != 0));
 		if (result != VDO_SUCCESS)
 			return result;
 	}
@@ -574,6 +688,7 @@ int vdo_decode_fixed_layout(struct buffer *buffer, struct fixed_layout **layout_
 	struct header header;
 	struct layout_3_0 layout_header;
 	struct fixed_layout *layout;
+	bool version_3_1;
 	int result;
 
 	result = vdo_decode_header(buffer, &header);
@@ -581,7 +696,11 @@ int vdo_decode_fixed_layout(struct buffer *buffer, struct fixed_layout **layout_
 		return result;
 
 	/* Layout is variable size, so only do a minimum size check here. */
-	result = vdo_validate_header(&LAYOUT_HEADER_3_0, &header, false, __func__);
+	version_3_1 = vdo_are_same_version(LAYOUT_HEADER_3_1.version, header.version);
+	result = vdo_validate_header((version_3_1 ? &LAYOUT_HEADER_3_1 : &LAYOUT_HEADER_3_0),
+				     &header,
+				     false,
+				     __func__);
 	if (result != VDO_SUCCESS)
 		return result;
 
@@ -590,7 +709,8 @@ int vdo_decode_fixed_layout(struct buffer *buffer, struct fixed_layout **layout_
 		return result;
 
 	if (content_length(buffer) <
-	    (sizeof(struct partition_3_0) * layout_header.partition_count))
+	    ((version_3_1 ? sizeof(struct partition_3_1) : sizeof(struct partition_3_0)) *
+	     layout_header.partition_count))
 		return VDO_UNSUPPORTED_VERSION;
 
 	result = UDS_ALLOCATE(1, struct fixed_layout, "fixed layout", &layout);
@@ -599,9 +719,10 @@ int vdo_decode_fixed_layout(struct buffer *buffer, struct fixed_layout **layout_
 
 	layout->first_free = layout_header.first_free;
 	layout->last_free = layout_header.last_free;
+	layout->journal_device_free = VDO_JOURNAL_DEVICE_LAYOUT_START;
 	layout->num_partitions = layout_header.partition_count;
 
-	result = decode_partitions_3_0(buffer, layout);
+	result = decode_partitions_3_0(buffer, version_3_1, layout);
 	if (result != VDO_SUCCESS) {
 		vdo_free_fixed_layout(layout);
 		return result;
@@ -611,6 +732,49 @@ int vdo_decode_fixed_layout(struct buffer *buffer, struct fixed_layout **layout_
 	return VDO_SUCCESS;
 }
 
+/**
+ * make_journal_partitions() - Make the recovery journal and slab summary partitions of a layout.
+ * @layout: The layout being partitioned.
+ * @journal_blocks: The size of the journal partition.
+ * @summary_blocks: The size of the slab summary partition.
+ * @use_journal_device: Whether to place the partitions on the journal device.
+ *
+ * Return: VDO_SUCCESS or an error.
+ */
+static int make_journal_partitions(struct fixed_layout *layout,
+				   block_count_t journal_blocks,
+				   block_count_t summary_blocks,
+				   bool use_journal_device)
+{
+	int result;
+
+	if (use_journal_device) {
+		result = vdo_make_fixed_layout_journal_device_partition(layout,
+									VDO_SLAB_SUMMARY_PARTITION,
+									summary_blocks,
+									0);
+		if (result != VDO_SUCCESS)
+			return result;
+
+		return vdo_make_fixed_layout_journal_device_partition(layout,
+								      VDO_RECOVERY_JOURNAL_PARTITION,
+								      journal_blocks,
+								      0);
+	}
+
+	result = vdo_make_fixed_layout_partition(layout,
+						 VDO_SLAB_SUMMARY_PARTITION,
+						 summary_blocks,
+						 VDO_PARTITION_FROM_END, 0);
+	if (result != VDO_SUCCESS)
+		return result;
+
+	return vdo_make_fixed_layout_partition(layout,
+					       VDO_RECOVERY_JOURNAL_PARTITION,
+					       journal_blocks,
+					       VDO_PARTITION_FROM_END, 0);
+}
+
 /**
  * vdo_make_partitioned_fixed_layout() - Make a partitioned fixed layout for a VDO.
  * @physical_blocks: The number of physical blocks in the VDO.
@@ -618,6 +782,7 @@ int vdo_decode_fixed_layout(struct buffer *buffer, struct fixed_layout **layout_
  * @block_map_blocks: The size of the block map partition.
  * @journal_blocks: The size of the journal partition.
  * @summary_blocks: The size of the slab summary partition.
+ * @use_journal_device: Whether to place the journal and slab summary on a separate journal device.
  * @layout_ptr: A pointer to hold the new fixed_layout.
  *
  * Return: VDO_SUCCESS or an error.
@@ -627,12 +792,15 @@ int vdo_make_partitioned_fixed_layout(block_count_t physical_blocks,
 				      block_count_t block_map_blocks,
 				      block_count_t journal_blocks,
 				      block_count_t summary_blocks,
+				      bool use_journal_device,
 				      struct fixed_layout **layout_ptr)
 {
 	struct fixed_layout *layout;
 	int result;
-	block_count_t necessary_size =
-		(starting_offset + block_map_blocks + journal_blocks + summary_blocks);
+	block_count_t necessary_size = starting_offset + block_map_blocks;
+
+	if (!use_journal_device)
+		necessary_size += journal_blocks + summary_blocks;
 
 	if (necessary_size > physical_blocks)
 		return uds_log_error_strerror(VDO_NO_SPACE, "Not enough space to make a VDO");
@@ -653,19 +821,10 @@ int vdo_make_partitioned_fixed_layout(block_count_t physical_blocks,
 		return result;
 	}
 
-	result = vdo_make_fixed_layout_partition(layout,
-						 VDO_SLAB_SUMMARY_PARTITION,
-						 summary_blocks,
-						 VDO_PARTITION_FROM_END, 0);
-	if (result != VDO_SUCCESS) {
-		vdo_free_fixed_layout(layout);
-		return result;
-	}
-
-	result = vdo_make_fixed_layout_partition(layout,
-						 VDO_RECOVERY_JOURNAL_PARTITION,
-						 journal_blocks,
-						 VDO_PARTITION_FROM_END, 0);
+	result = make_journal_partitions(layout,
+					 journal_blocks,
+					 summary_blocks,
+					 use_journal_device);
 	if (result != VDO_SUCCESS) {
 		vdo_free_fixed_layout(layout);
 		return result;
@@ -846,6 +1005,7 @@ int prepare_to_vdo_grow_layout(struct vdo_layout *vdo_layout,
 	int result;
 	struct partition *slab_summary_partition, *recovery_journal_partition;
 	block_count_t min_new_size;
+	bool use_journal_device;
 
 	if (vdo_get_next_layout_size(vdo_layout) == new_physical_blocks)
 		/* We are already prepared to grow to the new size, so we're done. */
@@ -863,8 +1023,10 @@ int prepare_to_vdo_grow_layout(struct vdo_layout *vdo_layout,
 
 	/*
 	 * Make a new layout with the existing partition sizes for everything but the block
-	 * allocator partition.
+	 * allocator partition. Partitions on a journal device keep their places.
 	 */
+	recovery_journal_partition = vdo_get_partition(vdo_layout, VDO_RECOVERY_JOURNAL_PARTITION);
+	use_journal_device = vdo_is_journal_device_partition(recovery_journal_partition);
 	result = vdo_make_partitioned_fixed_layout(new_physical_blocks,
 						   vdo_layout->starting_offset,
 						   get_partition_size(vdo_layout,
@@ -873,6 +1035,7 @@ int prepare_to_vdo_grow_layout(struct vdo_layout *vdo_layout,
 								      VDO_RECOVERY_JOURNAL_PARTITION),
 						   get_partition_size(vdo_layout,
 								      VDO_SLAB_SUMMARY_PARTITION),
+						   use_journal_device,
 						   &vdo_layout->next_layout);
 	if (result != VDO_SUCCESS) {
 		dm_kcopyd_client_destroy(UDS_FORGET(vdo_layout->copier));
@@ -884,9 +1047,11 @@ int prepare_to_vdo_grow_layout(struct vdo_layout *vdo_layout,
 		get_partition_from_next_layout(vdo_layout, VDO_SLAB_SUMMARY_PARTITION);
 	recovery_journal_partition =
 		get_partition_from_next_layout(vdo_layout, VDO_RECOVERY_JOURNAL_PARTITION);
-	min_new_size = (old_physical_blocks +
-			vdo_get_fixed_layout_partition_size(slab_summary_partition) +
-			vdo_get_fixed_layout_partition_size(recovery_journal_partition));
+	min_new_size = old_physical_blocks;
+	if (!use_journal_device)
+		min_new_size += (vdo_get_fixed_layout_partition_size(slab_summary_partition) +
+				 vdo_get_fixed_layout_partition_size(recovery_journal_partition));
+
 	if (min_new_size > new_physical_blocks) {
 		/* Copying the journal and summary would destroy some old metadata. */
 		vdo_free_fixed_layout(UDS_FORGET(vdo_layout->next_layout));
@@ -1023,6 +1188,12 @@ void vdo_copy_layout_partition(struct vdo_layout *layout,
 	struct partition *from = vdo_get_partition(layout, id);
 	struct partition *to = get_partition_from_next_layout(layout, id);
 
+	if (vdo_is_journal_device_partition(from)) {
+		/* Growing the backing device does not move partitions on the journal device. */
+		vdo_continue_completion(parent, VDO_SUCCESS);
+		return;
+	}
+
 	result = partition_to_region(from, vdo, &read_region);
 	if (result != VDO_SUCCESS) {
 		vdo_continue_completion(parent, result);
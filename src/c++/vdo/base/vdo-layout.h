@@ -27,12 +27,21 @@ enum partition_direction {
 	VDO_PARTITION_FROM_END,
 };
 
+enum {
+	/* The first block of a journal device available to partitions; block 0 holds a geometry copy */
+	VDO_JOURNAL_DEVICE_LAYOUT_START = 1,
+};
+
 extern const block_count_t VDO_ALL_FREE_BLOCKS;
 
 /*
  * A fixed layout is like a traditional disk partitioning scheme. In the beginning there is one
  * large unused area, of which parts are carved off. Each carved off section has its own internal
  * offset and size.
+ *
+ * A layout may also place partitions on a separate, low-latency journal device. Such partitions
+ * take no space from the main area; their offsets are on the journal device, whose first block
+ * holds a copy of the geometry block identifying the vdo it belongs to.
  */
 struct fixed_layout;
 struct partition;
@@ -45,6 +54,9 @@ void vdo_free_fixed_layout(struct fixed_layout *layout);
 
 block_count_t __must_check vdo_get_total_fixed_layout_size(const struct fixed_layout *layout);
 
+block_count_t __must_check
+vdo_get_fixed_layout_journal_device_size(const struct fixed_layout *layout);
+
 int __must_check
 vdo_get_fixed_layout_partition(struct fixed_layout *layout,
 			       enum partition_id id,
@@ -70,6 +82,12 @@ vdo_make_fixed_layout_partition(struct fixed_layout *layout,
 				enum partition_direction direction,
 				physical_block_number_t base);
 
+int __must_check
+vdo_make_fixed_layout_journal_device_partition(struct fixed_layout *layout,
+					       enum partition_id id,
+					       block_count_t block_count,
+					       physical_block_number_t base);
+
 block_count_t __must_check vdo_get_fixed_layout_partition_size(const struct partition *partition);
 
 physical_block_number_t __must_check
@@ -78,6 +96,8 @@ vdo_get_fixed_layout_partition_offset(const struct partition *partition);
 physical_block_number_t __must_check
 vdo_get_fixed_layout_partition_base(const struct partition *partition);
 
+bool __must_check vdo_is_journal_device_partition(const struct partition *partition);
+
 size_t __must_check vdo_get_fixed_layout_encoded_size(const struct fixed_layout *layout);
 
 int __must_check vdo_encode_fixed_layout(const struct fixed_layout *layout, struct buffer *buffer);
@@ -90,6 +110,7 @@ vdo_make_partitioned_fixed_layout(block_count_t physical_blocks,
 				  block_count_t block_map_blocks,
 				  block_count_t journal_blocks,
 				  block_count_t summary_blocks,
+				  bool use_journal_device,
 				  struct fixed_layout **layout_ptr);
 
 /*-----------------------------------------------------------------*/
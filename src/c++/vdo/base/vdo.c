@@ -32,7 +32,6 @@
 #include <linux/completion.h>
 #include <linux/device-mapper.h>
 #include <linux/kernel.h>
-#include <linux/lz4.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
@@ -47,6 +46,7 @@
 #include "string-utils.h"
 
 #include "block-map.h"
+#include "compressor.h"
 #include "data-vio.h"
 #include "dedupe.h"
 #include "encodings.h"
@@ -182,6 +182,8 @@ static const struct vdo_work_queue_type bio_ack_q_type = {
 	.finish = NULL,
 	.max_priority = BIO_ACK_Q_MAX_PRIORITY,
 	.default_priority = BIO_ACK_Q_ACK_PRIORITY,
+	.ring_capacity = 1024,
+	.work_stealing = true,
 };
 
 static const struct vdo_work_queue_type cpu_q_type = {
@@ -189,16 +191,20 @@ static const struct vdo_work_queue_type cpu_q_type = {
 	.finish = NULL,
 	.max_priority = CPU_Q_MAX_PRIORITY,
 	.default_priority = CPU_Q_MAX_PRIORITY,
+	.ring_capacity = 1024,
+	.work_stealing = true,
 };
 
 /**
- * vdo_read_geometry_block() - Synchronously read the geometry block from a vdo's underlying block
- *                             device.
+ * read_geometry_block() - Synchronously read the geometry block from a block device.
  * @vdo: The vdo whose geometry is to be read.
+ * @bdev: The device to read, either the backing device or the journal device.
+ * @geometry: The geometry to fill in.
  *
  * Return: VDO_SUCCESS or an error code.
  */
-static int __must_check read_geometry_block(struct vdo *vdo)
+static int __must_check
+read_geometry_block(struct vdo *vdo, struct block_device *bdev, struct volume_geometry *geometry)
 {
 	struct vio *vio;
 	char *block;
@@ -226,7 +232,7 @@ static int __must_check read_geometry_block(struct vdo *vdo)
 		return result;
 	}
 
-	bio_set_dev(vio->bio, vdo_get_backing_device(vdo));
+	bio_set_dev(vio->bio, bdev);
 	submit_bio_wait(vio->bio);
 	result = blk_status_to_errno(vio->bio->bi_status);
 	free_vio(UDS_FORGET(vio));
@@ -236,11 +242,44 @@ static int __must_check read_geometry_block(struct vdo *vdo)
 		return -EIO;
 	}
 
-	result = vdo_parse_geometry_block((u8 *) block, &vdo->geometry);
+	result = vdo_parse_geometry_block((u8 *) block, geometry);
 	UDS_FREE(block);
 	return result;
 }
 
+/**
+ * read_geometry() - Read the geometry of a vdo, and check that its journal device, if it has one,
+ *                   belongs to it.
+ * @vdo: The vdo whose geometry is to be read.
+ *
+ * Return: VDO_SUCCESS or an error code.
+ */
+static int __must_check read_geometry(struct vdo *vdo)
+{
+	struct volume_geometry journal_geometry;
+	int result;
+
+	if (!vdo_uses_journal_device(vdo))
+		return read_geometry_block(vdo, vdo_get_backing_device(vdo), &vdo->geometry);
+
+	/* The copy must be read first, while the vdo's geometry bio_offset is still 0. */
+	result = read_geometry_block(vdo, vdo_get_journal_device(vdo), &journal_geometry);
+	if (result != VDO_SUCCESS)
+		return result;
+
+	result = read_geometry_block(vdo, vdo_get_backing_device(vdo), &vdo->geometry);
+	if (result != VDO_SUCCESS)
+		return result;
+
+	if ((journal_geometry.nonce != vdo->geometry.nonce) ||
+	    (memcmp(&journal_geometry.uuid, &vdo->geometry.uuid, sizeof(uuid_t)) != 0))
+		return uds_log_error_strerror(VDO_BAD_NONCE,
+					      "journal device %s does not belong to this vdo",
+					      vdo->device_config->journal_device_name);
+
+	return VDO_SUCCESS;
+}
+
 /**
  * vdo_make_thread() - Construct a single vdo work_queue and its associated thread (or threads for
  *                     round-robin queues).
@@ -330,7 +369,7 @@ initialize_vdo(struct vdo *vdo, struct device_config *config, unsigned int insta
 	vdo_initialize_completion(&vdo->admin.completion, vdo, VDO_ADMIN_COMPLETION);
 	init_completion(&vdo->admin.callback_sync);
 	mutex_init(&vdo->stats_mutex);
-	result = read_geometry_block(vdo);
+	result = read_geometry(vdo);
 	if (result != VDO_SUCCESS) {
 		*reason = "Could not load geometry block";
 		return result;
@@ -350,21 +389,18 @@ initialize_vdo(struct vdo *vdo, struct device_config *config, unsigned int insta
 
 	/* Compression context storage */
 	result = UDS_ALLOCATE(config->thread_counts.cpu_threads,
-			      char *,
-			      "LZ4 context",
+			      struct compressor_context *,
+			      "compression contexts",
 			      &vdo->compression_context);
 	if (result != VDO_SUCCESS) {
-		*reason = "cannot allocate LZ4 context";
+		*reason = "cannot allocate compression contexts";
 		return result;
 	}
 
 	for (i = 0; i < config->thread_counts.cpu_threads; i++) {
-		result = UDS_ALLOCATE(LZ4_MEM_COMPRESS,
-				      char,
-				      "LZ4 context",
-				      &vdo->compression_context[i]);
+		result = vdo_make_compressor_context(&vdo->compression_context[i]);
 		if (result != VDO_SUCCESS) {
-			*reason = "cannot allocate LZ4 context";
+			*reason = "cannot allocate compression context";
 			return result;
 		}
 	}
@@ -601,7 +637,7 @@ void vdo_destroy(struct vdo *vdo)
 
 	if (vdo->compression_context != NULL) {
 		for (i = 0; i < vdo->device_config->thread_counts.cpu_threads; i++)
-			UDS_FREE(UDS_FORGET(vdo->compression_context[i]));
+			vdo_free_compressor_context(UDS_FORGET(vdo->compression_context[i]));
 
 		UDS_FREE(UDS_FORGET(vdo->compression_context));
 	}
@@ -741,6 +777,21 @@ struct block_device *vdo_get_backing_device(const struct vdo *vdo)
 	return vdo->device_config->owned_device->bdev;
 }
 
+/**
+ * vdo_get_journal_device() - Get the block device holding a vdo's recovery journal and slab
+ *                            summary.
+ * @vdo: The vdo.
+ *
+ * Return: The vdo's journal device if it has one, otherwise its backing device.
+ */
+struct block_device *vdo_get_journal_device(const struct vdo *vdo)
+{
+	if (!vdo_uses_journal_device(vdo))
+		return vdo_get_backing_device(vdo);
+
+	return vdo->device_config->journal_device->bdev;
+}
+
 /**
  * vdo_get_device_name() - Get the device name associated with the vdo target.
  * @target: The target device interface.
@@ -1509,6 +1560,8 @@ static void get_vdo_statistics(const struct vdo *vdo, struct vdo_statistics *sta
 	vdo_get_slab_depot_statistics(vdo->depot, stats);
 	stats->journal = vdo_get_recovery_journal_statistics(journal);
 	stats->packer = vdo_get_packer_statistics(vdo->packer);
+	stats->compression_bypass = vdo_get_compression_bypass_statistics(vdo->logical_zones);
+	stats->decompression_cache = vdo_get_decompression_cache_statistics(vdo->physical_zones);
 	stats->block_map = vdo_get_block_map_statistics(vdo->block_map);
 	vdo_get_dedupe_statistics(vdo->hash_zones, stats);
 	stats->errors = get_vdo_error_statistics(vdo);
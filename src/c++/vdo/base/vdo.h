@@ -14,6 +14,7 @@
 #include <linux/spinlock.h>
 
 #include "admin-state.h"
+#include "compressor.h"
 #include "encodings.h"
 #include "packer.h"
 #include "physical-zone.h"
@@ -190,6 +191,8 @@ struct vdo {
 	struct packer *packer;
 	/* Whether incoming data should be compressed */
 	bool compressing;
+	/* The compressor for incoming data */
+	enum vdo_compression_type compression_type;
 
 	/* The handler for flush requests */
 	struct flusher *flusher;
@@ -253,8 +256,8 @@ struct vdo {
 	struct kobject vdo_directory;
 	struct kobject stats_directory;
 
-	/* N blobs of context data for LZ4 code, one per CPU thread. */
-	char **compression_context;
+	/* The working memory of the compressors, one context per CPU thread. */
+	struct compressor_context **compression_context;
 };
 
 #if defined(VDO_INTERNAL) || defined(INTERNAL)
@@ -308,6 +311,18 @@ int __must_check vdo_add_sysfs_stats_dir(struct vdo *vdo);
 
 struct block_device * __must_check vdo_get_backing_device(const struct vdo *vdo);
 
+/**
+ * vdo_uses_journal_device() - Check whether a vdo keeps its recovery journal and slab summary on a
+ *                             separate journal device.
+ * @vdo: The vdo.
+ */
+static inline bool vdo_uses_journal_device(const struct vdo *vdo)
+{
+	return (vdo->device_config->journal_device != NULL);
+}
+
+struct block_device * __must_check vdo_get_journal_device(const struct vdo *vdo);
+
 const char * __must_check vdo_get_device_name(const struct dm_target *target);
 
 int __must_check vdo_synchronous_flush(struct vdo *vdo);
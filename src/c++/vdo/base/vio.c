@@ -49,7 +49,10 @@ physical_block_number_t pbn_from_vio_bio(struct bio *bio)
 	struct vdo *vdo = vio->completion.vdo;
 	physical_block_number_t pbn = bio->bi_iter.bi_sector / VDO_SECTORS_PER_BLOCK;
 
-	return ((pbn == VDO_GEOMETRY_BLOCK_LOCATION) ? pbn : pbn + vdo->geometry.bio_offset);
+	if ((pbn == VDO_GEOMETRY_BLOCK_LOCATION) || vio_uses_journal_device(vio))
+		return pbn;
+
+	return pbn + vdo->geometry.bio_offset;
 }
 
 static int create_multi_block_bio(block_count_t size, struct bio **bio_ptr)
@@ -192,7 +195,10 @@ void vdo_set_bio_properties(struct bio *bio,
 	struct vdo *vdo = vio->completion.vdo;
 	struct device_config *config = vdo->device_config;
 
-	pbn -= vdo->geometry.bio_offset;
+	/* Blocks on a journal device are addressed directly; the bio offset is for the backing device. */
+	if (!vio_uses_journal_device(vio))
+		pbn -= vdo->geometry.bio_offset;
+
 	vio->bio_zone = ((pbn / config->thread_counts.bio_rotation_interval) %
 			 config->thread_counts.bio_threads);
 
@@ -57,6 +57,19 @@ static inline thread_id_t __must_check get_vio_bio_zone_thread_id(struct vio *vi
 	return vio->completion.vdo->thread_config->bio_threads[vio->bio_zone];
 }
 
+/**
+ * vio_uses_journal_device() - Check whether a vio's I/O goes to the vdo's journal device.
+ * @vio: The vio.
+ *
+ * Return: true if the vio is for the recovery journal or slab summary of a vdo which keeps them on
+ *         a separate journal device.
+ */
+static inline bool __must_check vio_uses_journal_device(const struct vio *vio)
+{
+	return (((vio->type == VIO_TYPE_RECOVERY_JOURNAL) || (vio->type == VIO_TYPE_SLAB_SUMMARY)) &&
+		vdo_uses_journal_device(vio->completion.vdo));
+}
+
 physical_block_number_t __must_check pbn_from_vio_bio(struct bio *bio);
 
 /**
@@ -22,10 +22,21 @@
 #include "string-utils.h"
 
 #include "completion.h"
+#include "ring-queue.h"
 #include "status-codes.h"
 
 static DEFINE_PER_CPU(unsigned int, service_queue_rotor);
 
+enum {
+	/* The most completions a ring-backed queue will take from a ring in one poll */
+	WORK_QUEUE_BATCH_SIZE = 16,
+	/* The bounds on the number of polls a ring-backed queue makes before sleeping */
+	MIN_WORK_QUEUE_SPIN = 16,
+	MAX_WORK_QUEUE_SPIN = 1024,
+	/* The most completions a thread will take from a sibling's ring at once */
+	WORK_QUEUE_STEAL_SIZE = 4,
+};
+
 /**
  * DOC: Work queue definition.
  *
@@ -46,7 +57,12 @@ struct vdo_work_queue {
 struct simple_work_queue {
 	struct vdo_work_queue common;
 	struct funnel_queue *priority_lists[VDO_WORK_Q_MAX_PRIORITY + 1];
+	/* Bounded rings tried before the funnel queues, if the queue type asks for them */
+	struct ring_queue *priority_rings[VDO_WORK_Q_MAX_PRIORITY + 1];
 	void *private;
+	/* The round-robin queue whose other service queues this one may steal from, if any */
+	struct round_robin_work_queue *group;
+	unsigned int group_index;
 
 	/*
 	 * The fields above are unchanged after setup but often read, and are good candidates for
@@ -60,6 +76,29 @@ struct simple_work_queue {
 	/* Hack to reduce wakeup calls if the worker thread is running */
 	atomic_t idle;
 
+	/*
+	 * Completions taken from a ring but not yet processed, and the number of polls to make
+	 * before sleeping; these are only used by the worker thread.
+	 */
+	struct vdo_completion *batch[WORK_QUEUE_BATCH_SIZE];
+	unsigned int batch_count;
+	unsigned int batch_next;
+	unsigned int spin_limit;
+
+	/*
+	 * The number of completions in each priority's funnel queue which could have used its ring.
+	 * While any are waiting there, new completions of that priority go to the funnel queue as
+	 * well.
+	 */
+	atomic_t overflow_counts[VDO_WORK_Q_MAX_PRIORITY + 1];
+
+	/*
+	 * The number of times this queue's thread has stolen from a sibling, and the number of
+	 * completions it took; these are only written by the worker thread.
+	 */
+	u64 steals;
+	u64 stolen_completions;
+
 	/* These are infrequently used so in terms of performance we don't care where they land. */
 	struct task_struct *thread;
 	/* Notify creator once worker has initialized */
@@ -87,6 +126,30 @@ as_round_robin_work_queue(struct vdo_work_queue *queue)
 
 /* Processing normal completions. */
 
+/*
+ * Check whether a completion may be run by any thread of a round-robin queue rather than only the
+ * one it was enqueued on. Only vios qualify: each callback on a vio is self-contained, whereas
+ * other completions on these queues (such as the data_vio pool's release and hash batch
+ * completions) may expect to be run in order with the rest of their queue's work.
+ */
+static inline bool is_stealable(const struct vdo_completion *completion)
+{
+	return (completion->type == VIO_COMPLETION);
+}
+
+/*
+ * Check whether a completion may be put in its priority's ring. Since siblings may steal from the
+ * rings of a queue in a round-robin group, completions which must stay on that queue never are.
+ * Only these completions are counted as overflow when they go to the funnel queue instead, so a
+ * waiting completion which could never use the ring doesn't keep others out of it.
+ */
+static inline bool may_use_ring(const struct simple_work_queue *queue,
+				const struct vdo_completion *completion)
+{
+	return ((queue->priority_rings[completion->priority] != NULL) &&
+		((queue->group == NULL) || is_stealable(completion)));
+}
+
 /*
  * Dequeue and return the next waiting completion, if any.
  *
@@ -94,21 +157,186 @@ as_round_robin_work_queue(struct vdo_work_queue *queue)
  * condition where a high-priority completion can be enqueued followed by a lower-priority one, and
  * we'll grab the latter (but we'll catch the high-priority item on the next call). If strict
  * enforcement of priorities becomes necessary, this function will need fixing.
+ *
+ * If the queue has rings, each priority's ring is tried before its funnel queue (which then only
+ * holds overflow), and a whole batch is taken from a ring at once. Nothing is put in a ring while
+ * its funnel queue holds overflow, so the ring drains and the overflow is taken next, in the order
+ * it was enqueued. The rest of a batch is returned before anything else is polled, which widens
+ * the priority race above to at most one batch.
  */
 static struct vdo_completion *poll_for_completion(struct simple_work_queue *queue)
 {
 	int i;
 
+	if (queue->batch_next < queue->batch_count)
+		return queue->batch[queue->batch_next++];
+
 	for (i = queue->common.type->max_priority; i >= 0; i--) {
-		struct funnel_queue_entry *link = funnel_queue_poll(queue->priority_lists[i]);
+		struct vdo_completion *completion;
+		struct funnel_queue_entry *link;
+
+		if (queue->priority_rings[i] != NULL) {
+			unsigned int count = ring_queue_poll_batch(queue->priority_rings[i],
+								   (void **) queue->batch,
+								   WORK_QUEUE_BATCH_SIZE);
+
+			if (count > 0) {
+				queue->batch_count = count;
+				queue->batch_next = 1;
+				return queue->batch[0];
+			}
+		}
+
+		link = funnel_queue_poll(queue->priority_lists[i]);
+		if (link == NULL)
+			continue;
+
+		completion = container_of(link, struct vdo_completion, work_queue_entry_link);
+		if (may_use_ring(queue, completion))
+			atomic_dec(&queue->overflow_counts[i]);
+
+		return completion;
+	}
+
+	return NULL;
+}
+
+/*
+ * Take a few completions from the ring of some other service queue in the same round-robin group.
+ * Siblings are tried in turn starting with the next one, highest priority first. Stolen
+ * completions are moved to this queue's batch and marked as belonging to it. Only rings are
+ * searched since funnel queues only support a single consumer; completions which are not
+ * stealable are never put in the rings of a queue in a stealing group.
+ */
+static struct vdo_completion *steal_completion(struct simple_work_queue *queue)
+{
+	struct round_robin_work_queue *group = queue->group;
+	unsigned int i;
+
+	if (group == NULL)
+		return NULL;
+
+	for (i = 1; i < group->num_service_queues; i++) {
+		unsigned int index = (queue->group_index + i) % group->num_service_queues;
+		struct simple_work_queue *victim = READ_ONCE(group->service_queues[index]);
+		int priority;
+
+		/* The group may still be being built. */
+		if (victim == NULL)
+			continue;
+
+		for (priority = queue->common.type->max_priority; priority >= 0; priority--) {
+			unsigned int count, j;
+
+			count = ring_queue_poll_batch(victim->priority_rings[priority],
+						      (void **) queue->batch,
+						      WORK_QUEUE_STEAL_SIZE);
+			if (count == 0)
+				continue;
+
+			for (j = 0; j < count; j++)
+				queue->batch[j]->my_queue = &queue->common;
+
+			queue->steals++;
+			queue->stolen_completions += count;
+			queue->batch_count = count;
+			queue->batch_next = 1;
+			return queue->batch[0];
+		}
+	}
+
+	return NULL;
+}
+
+/* Get a completion from this queue if there is one, or from a sibling if not. */
+static struct vdo_completion *find_completion(struct simple_work_queue *queue)
+{
+	struct vdo_completion *completion = poll_for_completion(queue);
+
+	return ((completion != NULL) ? completion : steal_completion(queue));
+}
+
+/*
+ * Poll a ring-backed queue repeatedly before giving up and going to sleep. The number of polls
+ * adapts to the load: it grows whenever spinning finds work and shrinks whenever it doesn't, so a
+ * busy queue avoids the cost of sleeping and being woken, while an idle one quickly stops
+ * wasting its CPU.
+ */
+static struct vdo_completion *spin_for_completion(struct simple_work_queue *queue)
+{
+	unsigned int i;
+
+	if (queue->spin_limit == 0)
+		return NULL;
+
+	for (i = 0; i < queue->spin_limit; i++) {
+		struct vdo_completion *completion;
 
-		if (link != NULL)
-			return container_of(link, struct vdo_completion, work_queue_entry_link);
+		if (need_resched())
+			break;
+
+		cpu_relax();
+		completion = find_completion(queue);
+		if (completion != NULL) {
+			queue->spin_limit = min(queue->spin_limit * 2,
+						(unsigned int) MAX_WORK_QUEUE_SPIN);
+			return completion;
+		}
 	}
 
+	queue->spin_limit = max(queue->spin_limit / 2, (unsigned int) MIN_WORK_QUEUE_SPIN);
 	return NULL;
 }
 
+/* Wake the worker thread of a queue if it is asleep or about to go to sleep. */
+static void wake_worker_if_idle(struct simple_work_queue *queue)
+{
+	if ((atomic_read(&queue->idle) != 1) || (atomic_cmpxchg(&queue->idle, 1, 0) != 1))
+		return;
+
+	/* There's a maximum of one thread in this list. */
+	wake_up(&queue->waiting_worker_threads);
+}
+
+/* Wake the first idle thread after this one in its round-robin group, if any, so it can steal. */
+static void wake_idle_sibling(struct simple_work_queue *queue)
+{
+	struct round_robin_work_queue *group = queue->group;
+	unsigned int i;
+
+	for (i = 1; i < group->num_service_queues; i++) {
+		unsigned int index = (queue->group_index + i) % group->num_service_queues;
+		struct simple_work_queue *sibling = READ_ONCE(group->service_queues[index]);
+
+		if ((sibling != NULL) && (atomic_read(&sibling->idle) == 1)) {
+			wake_worker_if_idle(sibling);
+			return;
+		}
+	}
+}
+
+/*
+ * Try to put a completion in the ring for its priority. Nothing is put there while earlier
+ * completions of the same priority are waiting in the funnel queue, since it would then be run
+ * ahead of them. The caller has checked that the completion may use the ring.
+ */
+static bool put_in_ring(struct simple_work_queue *queue, struct vdo_completion *completion)
+{
+	struct ring_queue *ring = queue->priority_rings[completion->priority];
+
+	if (atomic_read(&queue->overflow_counts[completion->priority]) > 0)
+		return false;
+
+	if (ring_queue_put(ring, completion))
+		return true;
+
+	/* This queue has a deep backlog, so make sure an idle sibling is awake to take some. */
+	if (queue->group != NULL)
+		wake_idle_sibling(queue);
+
+	return false;
+}
+
 static void
 enqueue_work_queue_completion(struct simple_work_queue *queue, struct vdo_completion *completion)
 {
@@ -127,9 +355,19 @@ enqueue_work_queue_completion(struct simple_work_queue *queue, struct vdo_comple
 
 	completion->my_queue = &queue->common;
 
-	/* Funnel queue handles the synchronization for the put. */
-	funnel_queue_put(queue->priority_lists[completion->priority],
-			 &completion->work_queue_entry_link);
+	/*
+	 * The ring and the funnel queue each handle the synchronization for the put. The funnel
+	 * queue is unbounded, so it takes whatever doesn't fit in the ring.
+	 */
+	if (!may_use_ring(queue, completion)) {
+		funnel_queue_put(queue->priority_lists[completion->priority],
+				 &completion->work_queue_entry_link);
+	} else if (!put_in_ring(queue, completion)) {
+		/* Count the overflow before the worker can take it, so it is never negative. */
+		atomic_inc(&queue->overflow_counts[completion->priority]);
+		funnel_queue_put(queue->priority_lists[completion->priority],
+				 &completion->work_queue_entry_link);
+	}
 
 	/*
 	 * Due to how funnel queue synchronization is handled (just atomic operations), the
@@ -148,11 +386,7 @@ enqueue_work_queue_completion(struct simple_work_queue *queue, struct vdo_comple
 	 * first is any better or worse for other platforms, even other x86 configurations.
 	 */
 	smp_mb();
-	if ((atomic_read(&queue->idle) != 1) || (atomic_cmpxchg(&queue->idle, 1, 0) != 1))
-		return;
-
-	/* There's a maximum of one thread in this list. */
-	wake_up(&queue->waiting_worker_threads);
+	wake_worker_if_idle(queue);
 }
 
 static void run_start_hook(struct simple_work_queue *queue)
@@ -194,7 +428,7 @@ static struct vdo_completion *wait_for_next_completion(struct simple_work_queue
 		atomic_set(&queue->idle, 1);
 		smp_mb(); /* store-load barrier between "idle" and funnel queue */
 
-		completion = poll_for_completion(queue);
+		completion = find_completion(queue);
 		if (completion != NULL)
 			break;
 
@@ -210,9 +444,10 @@ static struct vdo_completion *wait_for_next_completion(struct simple_work_queue
 
 		/*
 		 * Most of the time when we wake, it should be because there's work to do. If it
-		 * was a spurious wakeup, continue looping.
+		 * was a spurious wakeup, continue looping. A sibling with a backlog may also have
+		 * woken us to steal some of its work.
 		 */
-		completion = poll_for_completion(queue);
+		completion = find_completion(queue);
 		if (completion != NULL)
 			break;
 	}
@@ -242,6 +477,9 @@ static void service_work_queue(struct simple_work_queue *queue)
 	while (true) {
 		struct vdo_completion *completion = poll_for_completion(queue);
 
+		if (completion == NULL)
+			completion = spin_for_completion(queue);
+
 		if (completion == NULL)
 			completion = wait_for_next_completion(queue);
 
@@ -278,8 +516,10 @@ static void free_simple_work_queue(struct simple_work_queue *queue)
 {
 	unsigned int i;
 
-	for (i = 0; i <= VDO_WORK_Q_MAX_PRIORITY; i++)
+	for (i = 0; i <= VDO_WORK_Q_MAX_PRIORITY; i++) {
 		free_funnel_queue(queue->priority_lists[i]);
+		free_ring_queue(queue->priority_rings[i]);
+	}
 	UDS_FREE(queue->common.name);
 	UDS_FREE(queue);
 }
@@ -317,6 +557,8 @@ static int make_simple_work_queue(const char *thread_name_prefix,
 				  struct vdo_thread *owner,
 				  void *private,
 				  const struct vdo_work_queue_type *type,
+				  struct round_robin_work_queue *group,
+				  unsigned int group_index,
 				  struct simple_work_queue **queue_ptr)
 {
 	DECLARE_COMPLETION_ONSTACK(started);
@@ -335,6 +577,10 @@ static int make_simple_work_queue(const char *thread_name_prefix,
 		return result;
 
 	queue->private = private;
+	if ((group != NULL) && type->work_stealing && (type->ring_capacity > 0)) {
+		queue->group = group;
+		queue->group_index = group_index;
+	}
 	queue->started = &started;
 	queue->common.type = type;
 	queue->common.owner = owner;
@@ -352,8 +598,20 @@ static int make_simple_work_queue(const char *thread_name_prefix,
 			free_simple_work_queue(queue);
 			return result;
 		}
+
+		if (type->ring_capacity == 0)
+			continue;
+
+		result = make_ring_queue(type->ring_capacity, &queue->priority_rings[i]);
+		if (result != VDO_SUCCESS) {
+			free_simple_work_queue(queue);
+			return result;
+		}
 	}
 
+	if (type->ring_capacity > 0)
+		queue->spin_limit = MIN_WORK_QUEUE_SPIN;
+
 	thread = kthread_run(work_queue_runner,
 			     queue,
 			     "%s:%s",
@@ -410,6 +668,8 @@ int make_work_queue(const char *thread_name_prefix,
 						owner,
 						context,
 						type,
+						NULL,
+						0,
 						&simple_queue);
 		if (result == VDO_SUCCESS)
 			*queue_ptr = &simple_queue->common;
@@ -451,6 +711,8 @@ int make_work_queue(const char *thread_name_prefix,
 						owner,
 						context,
 						type,
+						queue,
+						i,
 						&queue->service_queues[i]);
 		if (result != VDO_SUCCESS) {
 			queue->num_service_queues = i;
@@ -513,9 +775,46 @@ static void dump_simple_work_queue(struct simple_work_queue *queue)
 		     thread_status,
 		     task_state_report);
 
+	if (queue->group != NULL)
+		uds_log_info("  stole %llu completions in %llu steals",
+			     READ_ONCE(queue->stolen_completions),
+			     READ_ONCE(queue->steals));
+
 	/* ->waiting_worker_threads wait queue status? anyone waiting? */
 }
 
+/*
+ * Write the work stealing counts of each thread of a round-robin queue to a buffer, one line per
+ * thread giving its name, the number of times it stole, and the number of completions it stole.
+ * Returns the number of characters written.
+ */
+size_t format_work_queue_steals(struct vdo_work_queue *queue, char *buffer, size_t length)
+{
+	struct round_robin_work_queue *round_robin;
+	size_t written = 0;
+	unsigned int i;
+
+	if ((queue == NULL) || !queue->round_robin_mode)
+		return 0;
+
+	round_robin = as_round_robin_work_queue(queue);
+	for (i = 0; i < round_robin->num_service_queues; i++) {
+		struct simple_work_queue *service = round_robin->service_queues[i];
+
+		if (service->group == NULL)
+			continue;
+
+		written += scnprintf(buffer + written,
+				     length - written,
+				     "%s %llu %llu\n",
+				     service->common.name,
+				     (unsigned long long) READ_ONCE(service->steals),
+				     (unsigned long long) READ_ONCE(service->stolen_completions));
+	}
+
+	return written;
+}
+
 /**
  * Write to the buffer some info about the completion, for logging. Since the common use case is
  * dumping info about a lot of completions to syslog all at once, the format favors brevity over
@@ -21,6 +21,16 @@ struct vdo_work_queue_type {
 	void (*finish)(void *context);
 	enum vdo_completion_priority max_priority;
 	enum vdo_completion_priority default_priority;
+	/*
+	 * If non-zero, each priority level is backed by a bounded ring of this many (a power of
+	 * two) completions, which is drained in batches, rather than by a funnel queue alone.
+	 */
+	unsigned int ring_capacity;
+	/*
+	 * If true, and the queue has rings and more than one thread, idle threads will take
+	 * completions which don't need thread affinity from their siblings' rings.
+	 */
+	bool work_stealing;
 };
 
 struct vdo_completion;
@@ -43,6 +53,8 @@ void free_work_queue(struct vdo_work_queue *queue);
 
 void dump_work_queue(struct vdo_work_queue *queue);
 
+size_t format_work_queue_steals(struct vdo_work_queue *queue, char *buffer, size_t length);
+
 void dump_completion_to_buffer(struct vdo_completion *completion, char *buffer, size_t length);
 
 void *get_work_queue_private_data(void);
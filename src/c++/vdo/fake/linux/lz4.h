@@ -11,6 +11,8 @@
 #include "../../tests/lz4.h"
 
 #define LZ4_MEM_COMPRESS LZ4_context_size()
+#define LZ4HC_MEM_COMPRESS LZ4_context_size()
+#define LZ4HC_DEFAULT_CLEVEL 9
 
 /**********************************************************************/
 int LZ4_compress_default(const char *source,
@@ -19,6 +21,14 @@ int LZ4_compress_default(const char *source,
                          int maxOutputSize,
                          void *context);
 
+/**********************************************************************/
+int LZ4_compress_HC(const char *source,
+                    char *dest,
+                    int isize,
+                    int maxOutputSize,
+                    int compressionLevel,
+                    void *context);
+
 /**********************************************************************/
 int LZ4_decompress_safe(const char *source,
                         char *dest,
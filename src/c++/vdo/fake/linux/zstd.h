@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Fake implementation of linux/zstd.h for unit tests.
+ *
+ * Copyright Red Hat
+ */
+
+#ifndef LINUX_ZSTD_H
+#define LINUX_ZSTD_H
+
+#include <stddef.h>
+
+typedef struct {
+  int level;
+} zstd_compression_parameters;
+
+typedef struct {
+  zstd_compression_parameters cParams;
+} zstd_parameters;
+
+typedef struct zstd_cctx_s zstd_cctx;
+typedef struct zstd_dctx_s zstd_dctx;
+
+/**********************************************************************/
+zstd_parameters zstd_get_params(int level,
+                                unsigned long long estimatedSourceSize);
+
+/**********************************************************************/
+size_t zstd_cctx_workspace_bound(const zstd_compression_parameters *parameters);
+
+/**********************************************************************/
+zstd_cctx *zstd_init_cctx(void *workspace, size_t workspaceSize);
+
+/**********************************************************************/
+size_t zstd_compress_cctx(zstd_cctx *cctx,
+                          void *dest,
+                          size_t destCapacity,
+                          const void *source,
+                          size_t sourceSize,
+                          const zstd_parameters *parameters);
+
+/**********************************************************************/
+size_t zstd_dctx_workspace_bound(void);
+
+/**********************************************************************/
+zstd_dctx *zstd_init_dctx(void *workspace, size_t workspaceSize);
+
+/**********************************************************************/
+size_t zstd_decompress_dctx(zstd_dctx *dctx,
+                            void *dest,
+                            size_t destCapacity,
+                            const void *source,
+                            size_t sourceSize);
+
+/**********************************************************************/
+unsigned int zstd_is_error(size_t code);
+
+#endif // LINUX_ZSTD_H
@@ -0,0 +1,118 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * $Id$
+ */
+
+#include "albtest.h"
+
+#include "block-map.h"
+#include "encodings.h"
+
+#include "ioRequest.h"
+#include "vdoAsserts.h"
+#include "vdoTestBase.h"
+
+enum {
+  LEAF_PAGES = 16,
+};
+
+/**
+ * Initialize a VDO whose block map cache is much smaller than its tree,
+ * and allocate every leaf page.
+ **/
+static void initializeBlockMapPrefetchT1(void)
+{
+  const TestParameters parameters = {
+    .logicalBlocks = LEAF_PAGES * VDO_BLOCK_MAP_ENTRIES_PER_PAGE,
+    .slabSize      = 64,
+    .cacheSize     = 4,
+  };
+
+  initializeVDOTest(&parameters);
+  populateBlockMapTree();
+}
+
+/**
+ * Read the first block of a leaf page.
+ *
+ * @param page  The leaf page number
+ **/
+static void readLeafPage(page_number_t page)
+{
+  verifyZeros(page * VDO_BLOCK_MAP_ENTRIES_PER_PAGE, 1);
+}
+
+/**********************************************************************/
+static void testSequentialReads(void)
+{
+  struct block_map_statistics before
+    = vdo_get_block_map_statistics(vdo->block_map);
+  for (page_number_t page = 0; page < LEAF_PAGES; page++) {
+    readLeafPage(page);
+  }
+
+  struct block_map_statistics after
+    = vdo_get_block_map_statistics(vdo->block_map);
+
+  // The pattern is recognized on the third page, after which every page
+  // should have been loaded before it was read.
+  page_count_t expected = LEAF_PAGES - 3;
+  CU_ASSERT_EQUAL(after.prefetch_issued - before.prefetch_issued, expected);
+  CU_ASSERT_EQUAL(after.prefetch_used - before.prefetch_used, expected);
+  CU_ASSERT_EQUAL(after.prefetch_wasted, before.prefetch_wasted);
+}
+
+/**********************************************************************/
+static void testRandomReads(void)
+{
+  const page_number_t pages[] = { 0, 5, 2, 9, 14, 7, 3, 12, 1 };
+  struct block_map_statistics before
+    = vdo_get_block_map_statistics(vdo->block_map);
+  for (unsigned int i = 0; i < ARRAY_SIZE(pages); i++) {
+    readLeafPage(pages[i]);
+  }
+
+  struct block_map_statistics after
+    = vdo_get_block_map_statistics(vdo->block_map);
+  CU_ASSERT_EQUAL(after.prefetch_issued, before.prefetch_issued);
+}
+
+/**********************************************************************/
+static void testWritesDoNotPrefetch(void)
+{
+  struct block_map_statistics before
+    = vdo_get_block_map_statistics(vdo->block_map);
+  for (page_number_t page = 0; page < LEAF_PAGES; page++) {
+    zeroData(page * VDO_BLOCK_MAP_ENTRIES_PER_PAGE, 1, VDO_SUCCESS);
+  }
+
+  struct block_map_statistics after
+    = vdo_get_block_map_statistics(vdo->block_map);
+  CU_ASSERT_EQUAL(after.prefetch_issued, before.prefetch_issued);
+}
+
+/**********************************************************************/
+
+static CU_TestInfo blockMapPrefetchTests[] = {
+  { "sequential reads prefetch",   testSequentialReads     },
+  { "random reads don't prefetch", testRandomReads         },
+  { "writes don't prefetch",       testWritesDoNotPrefetch },
+  CU_TEST_INFO_NULL,
+};
+
+static CU_SuiteInfo blockMapPrefetchSuite = {
+  .name                     = "Block map prefetch tests (BlockMapPrefetch_t1)",
+  .initializerWithArguments = NULL,
+  .initializer              = initializeBlockMapPrefetchT1,
+  .cleaner                  = tearDownVDOTest,
+  .tests                    = blockMapPrefetchTests,
+};
+
+/**********************************************************************/
+CU_SuiteInfo *initializeModule(void)
+{
+  return &blockMapPrefetchSuite;
+}
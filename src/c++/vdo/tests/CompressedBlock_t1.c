@@ -38,10 +38,12 @@ static void testEmptyBlock(void)
 {
   for (enum block_mapping_state i = VDO_MAPPING_STATE_UNMAPPED;
        i < VDO_MAPPING_STATE_COMPRESSED_BASE; i++) {
+    enum vdo_compression_type fragmentType;
     uint16_t fragmentOffset, fragmentSize;
     CU_ASSERT_EQUAL(VDO_INVALID_FRAGMENT,
                     vdo_get_compressed_block_fragment(i,
                                                       &compressedBlock,
+                                                      &fragmentType,
                                                       &fragmentOffset,
                                                       &fragmentSize));
   }
@@ -54,10 +56,12 @@ static void testInvalidBlock(void)
     = __cpu_to_le32(INVALID_VERSION);
 
   for (unsigned int i = 0; i < VDO_MAX_COMPRESSION_SLOTS; ++i) {
+    enum vdo_compression_type fragmentType;
     uint16_t fragmentOffset, fragmentSize;
     CU_ASSERT_EQUAL(VDO_INVALID_FRAGMENT,
                     vdo_get_compressed_block_fragment(getStateForSlot(i),
                                                       &compressedBlock,
+                                                      &fragmentType,
                                                       &fragmentOffset,
                                                       &fragmentSize));
   }
@@ -66,15 +70,17 @@ static void testInvalidBlock(void)
 /**********************************************************************/
 static void testAbsurdBlock(void)
 {
-  initialize_compressed_block(&compressedBlock, 101);
+  initialize_compressed_block(&compressedBlock, 101, VDO_COMPRESSION_LZ4);
   for (unsigned int i = 1; i < VDO_MAX_COMPRESSION_SLOTS; ++i) {
     compressedBlock.header.sizes[i] = __cpu_to_le16(VDO_BLOCK_SIZE + i * 101);
   }
 
+  enum vdo_compression_type fragmentType;
   uint16_t fragmentOffset, fragmentSize;
   CU_ASSERT_EQUAL(VDO_SUCCESS,
                   vdo_get_compressed_block_fragment(getStateForSlot(0),
                                                     &compressedBlock,
+                                                    &fragmentType,
                                                     &fragmentOffset,
                                                     &fragmentSize));
 
@@ -82,6 +88,7 @@ static void testAbsurdBlock(void)
     CU_ASSERT_EQUAL(VDO_INVALID_FRAGMENT,
                     vdo_get_compressed_block_fragment(getStateForSlot(i),
                                                       &compressedBlock,
+                                                      &fragmentType,
                                                       &fragmentOffset,
                                                       &fragmentSize));
   }
@@ -111,14 +118,18 @@ static void testValidFragments(void)
     if (i == 0) {
       /* The compressor will put the fragment 0 data in place already */
       memcpy(compressedBlock.data, originalData, offsets[1]);
-      initialize_compressed_block(&compressedBlock, offsets[1]);
+      initialize_compressed_block(&compressedBlock, offsets[1],
+                                  VDO_COMPRESSION_LZ4);
       continue;
     }
 
-    struct compression_state compression;
+    struct compression_state compression = {
+      .type = VDO_COMPRESSION_LZ4,
+    };
     struct data_vio dataVIO;
     struct compressed_block fragment_block;
     dataVIO.compression.block = &fragment_block;
+    dataVIO.compression.type = VDO_COMPRESSION_LZ4;
     dataVIO.compression.size = offsets[i + 1] - offsets[i];
     memcpy(fragment_block.data,
            originalData + offsets[i],
@@ -132,12 +143,15 @@ static void testValidFragments(void)
   }
 
   for (unsigned int i = 0; i < VDO_MAX_COMPRESSION_SLOTS; ++i) {
+    enum vdo_compression_type fragmentType;
     uint16_t fragmentOffset, fragmentSize;
     CU_ASSERT_EQUAL(VDO_SUCCESS,
                     vdo_get_compressed_block_fragment(getStateForSlot(i),
                                                       &compressedBlock,
+                                                      &fragmentType,
                                                       &fragmentOffset,
                                                       &fragmentSize));
+    CU_ASSERT_EQUAL(fragmentType, VDO_COMPRESSION_LZ4);
     CU_ASSERT_EQUAL(fragmentOffset, offsets[i]);
 
     size_t expectedSize = offsets[i + 1] - offsets[i];
@@ -149,12 +163,48 @@ static void testValidFragments(void)
   }
 }
 
+/**
+ * Check that the block version records which compressor can read the
+ * fragments of the block.
+ **/
+static void testFragmentTypes(void)
+{
+  struct {
+    enum vdo_compression_type compressor;
+    enum vdo_compression_type reader;
+  } cases[] = {
+    { VDO_COMPRESSION_LZ4,   VDO_COMPRESSION_LZ4  },
+    { VDO_COMPRESSION_LZ4HC, VDO_COMPRESSION_LZ4  },
+    { VDO_COMPRESSION_ZSTD,  VDO_COMPRESSION_ZSTD },
+  };
+
+  for (unsigned int i = 0; i < ARRAY_SIZE(cases); i++) {
+    initialize_compressed_block(&compressedBlock, 101, cases[i].compressor);
+    enum vdo_compression_type fragmentType;
+    uint16_t fragmentOffset, fragmentSize;
+    CU_ASSERT_EQUAL(VDO_SUCCESS,
+                    vdo_get_compressed_block_fragment(getStateForSlot(0),
+                                                      &compressedBlock,
+                                                      &fragmentType,
+                                                      &fragmentOffset,
+                                                      &fragmentSize));
+    CU_ASSERT_EQUAL(cases[i].reader, fragmentType);
+    CU_ASSERT_EQUAL(101, fragmentSize);
+  }
+
+  // LZ4 blocks keep the version older releases can read.
+  initialize_compressed_block(&compressedBlock, 101, VDO_COMPRESSION_LZ4HC);
+  CU_ASSERT_EQUAL(1, __le32_to_cpu(compressedBlock.header.version.major_version));
+  CU_ASSERT_EQUAL(0, __le32_to_cpu(compressedBlock.header.version.minor_version));
+}
+
 /**********************************************************************/
 static CU_TestInfo compressedBlockTests[] = {
   { "empty block",     testEmptyBlock     },
   { "invalid block",   testInvalidBlock   },
   { "absurd block",    testAbsurdBlock    },
   { "valid fragments", testValidFragments },
+  { "fragment types",  testFragmentTypes  },
   CU_TEST_INFO_NULL
 };
 
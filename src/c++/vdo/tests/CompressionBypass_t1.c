@@ -0,0 +1,146 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * $Id$
+ */
+
+#include "albtest.h"
+
+#include "logical-zone.h"
+#include "packer.h"
+#include "vdo.h"
+
+#include "dataBlocks.h"
+#include "ioRequest.h"
+#include "vdoAsserts.h"
+#include "vdoTestBase.h"
+
+enum {
+  // Data indexes at or above this are compressible.
+  COMPRESSIBLE_BASE = 1 << 20,
+};
+
+/**
+ * Fill a block with data which is compressible only if its index is at least
+ * COMPRESSIBLE_BASE.
+ *
+ * <p>Implements DataFormatter.
+ **/
+static void fillWithIncompressibleBelowBase(char *block, block_count_t index)
+{
+  if (index >= COMPRESSIBLE_BASE) {
+    fillWithOffset(block, index);
+    return;
+  }
+
+  // A xorshift generator seeded by the index produces incompressible data.
+  uint64_t state = index * 0x9e3779b97f4a7c15ULL + 1;
+  for (size_t i = 0; i < VDO_BLOCK_SIZE; i += sizeof(state)) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    memcpy(&block[i], &state, sizeof(state));
+  }
+}
+
+/**
+ * Test-specific initialization.
+ **/
+static void initializeCompressionBypassT1(void)
+{
+  const TestParameters parameters = {
+    .mappableBlocks       = 1024,
+    .logicalBlocks        = 1024,
+    .journalBlocks        = 32,
+    .logicalThreadCount   = 1,
+    .physicalThreadCount  = 1,
+    .hashZoneThreadCount  = 1,
+    .enableCompression    = true,
+    .disableDeduplication = true,
+    .dataFormatter        = fillWithIncompressibleBelowBase,
+  };
+  initializeVDOTest(&parameters);
+}
+
+/**
+ * Check the compression bypass statistics.
+ *
+ * @param skipped  The expected number of blocks which skipped compression
+ * @param sampled  The expected number of blocks sampled while bypassing
+ **/
+static void assertBypassStatistics(block_count_t skipped,
+                                   block_count_t sampled)
+{
+  struct compression_bypass_statistics stats
+    = vdo_get_compression_bypass_statistics(vdo->logical_zones);
+  CU_ASSERT_EQUAL(skipped, stats.blocks_skipped);
+  CU_ASSERT_EQUAL(sampled, stats.blocks_sampled);
+}
+
+/**
+ * Test that compression is bypassed for incompressible writes, and resumes
+ * once sampling shows the writes have become compressible.
+ **/
+static void testBypassAndResume(void)
+{
+  // A full window of failed attempts turns compression off.
+  logical_block_number_t lbn = 0;
+  writeData(lbn, 1, COMPRESSIBILITY_WINDOW, VDO_SUCCESS);
+  lbn += COMPRESSIBILITY_WINDOW;
+  assertBypassStatistics(0, 0);
+
+  // While bypassing, only every sample interval'th block is compressed.
+  block_count_t count = 4 * COMPRESSION_SAMPLE_INTERVAL;
+  writeData(lbn, lbn + 1, count, VDO_SUCCESS);
+  lbn += count;
+  assertBypassStatistics(count - 4, 4);
+
+  /*
+   * Write enough compressible data to complete the window with samples. The
+   * 28 compressed samples fill exactly two compressed blocks, so none are left
+   * waiting in the packer.
+   */
+  block_count_t samples = COMPRESSIBILITY_WINDOW - 4;
+  CU_ASSERT_EQUAL(0, samples % VDO_MAX_COMPRESSION_SLOTS);
+  count = samples * COMPRESSION_SAMPLE_INTERVAL;
+  block_count_t freeBlocks = getPhysicalBlocksFree();
+  writeData(lbn, COMPRESSIBLE_BASE + lbn, count, VDO_SUCCESS);
+  lbn += count;
+  block_count_t skipped = (4 * COMPRESSION_SAMPLE_INTERVAL) - 4 + count - samples;
+  assertBypassStatistics(skipped, COMPRESSIBILITY_WINDOW);
+  CU_ASSERT_EQUAL(freeBlocks - (count - samples)
+                  - (samples / VDO_MAX_COMPRESSION_SLOTS),
+                  getPhysicalBlocksFree());
+
+  // Compression has resumed, so a full batch packs into a single block.
+  freeBlocks = getPhysicalBlocksFree();
+  writeData(lbn, COMPRESSIBLE_BASE + lbn, VDO_MAX_COMPRESSION_SLOTS,
+            VDO_SUCCESS);
+  assertBypassStatistics(skipped, COMPRESSIBILITY_WINDOW);
+  CU_ASSERT_EQUAL(freeBlocks - 1, getPhysicalBlocksFree());
+
+  verifyData(0, 1, COMPRESSIBILITY_WINDOW);
+  verifyData(lbn, COMPRESSIBLE_BASE + lbn, VDO_MAX_COMPRESSION_SLOTS);
+}
+
+/**********************************************************************/
+
+static CU_TestInfo tests[] = {
+  { "bypass and resume compression", testBypassAndResume },
+  CU_TEST_INFO_NULL,
+};
+
+static CU_SuiteInfo suite = {
+  .name                     = "Compression bypass tests (CompressionBypass_t1)",
+  .initializerWithArguments = NULL,
+  .initializer              = initializeCompressionBypassT1,
+  .cleaner                  = tearDownVDOTest,
+  .tests                    = tests,
+};
+
+CU_SuiteInfo *initializeModule(void)
+{
+  return &suite;
+}
@@ -0,0 +1,169 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * Performance comparison of the data block compressors: compression and
+ * decompression throughput, fragment size, and how many fragments the packer
+ * could fit into each compressed block.
+ *
+ * $Id$
+ */
+
+#include "assertions.h"
+#include "memory-alloc.h"
+#include "time-utils.h"
+
+#include "compressor.h"
+#include "constants.h"
+#include "packer.h"
+#include "status-codes.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  BLOCK_COUNT = 4096,
+  ITERATIONS  = 4,
+  RUN_LENGTH  = 16,
+};
+
+static char *blocks;
+static char *fragments;
+static int fragmentSizes[BLOCK_COUNT];
+
+/**
+ * Fill each block with runs of bytes repeated from earlier in the block,
+ * interspersed with random runs. The random fraction varies from block to
+ * block so the fragments span the sizes the packer must handle.
+ **/
+static void prepareBlocks(void)
+{
+  for (unsigned int i = 0; i < BLOCK_COUNT; i++) {
+    char *block = &blocks[i * VDO_BLOCK_SIZE];
+    unsigned int randomPercent = 10 + (i % 8) * 10;
+    for (unsigned int offset = 0; offset < VDO_BLOCK_SIZE;
+         offset += RUN_LENGTH) {
+      if ((offset == 0) || ((unsigned int) (random() % 100) < randomPercent)) {
+        for (unsigned int j = 0; j < RUN_LENGTH; j++) {
+          block[offset + j] = random();
+        }
+      } else {
+        unsigned int source = (random() % (offset / RUN_LENGTH)) * RUN_LENGTH;
+        memcpy(&block[offset], &block[source], RUN_LENGTH);
+      }
+    }
+  }
+}
+
+/**
+ * Count the compressed blocks needed to pack the fragments in order, closing
+ * a block when the next fragment does not fit or all its slots are used.
+ **/
+static unsigned int countPackedBlocks(unsigned int *compressedPtr)
+{
+  unsigned int packed = 0;
+  unsigned int compressed = 0;
+  unsigned int slots = 0;
+  int space = 0;
+  for (unsigned int i = 0; i < BLOCK_COUNT; i++) {
+    if (fragmentSizes[i] == 0) {
+      continue;
+    }
+
+    compressed++;
+    if ((slots == 0) || (slots == VDO_MAX_COMPRESSION_SLOTS)
+        || (fragmentSizes[i] > space)) {
+      packed++;
+      slots = 0;
+      space = VDO_COMPRESSED_BLOCK_DATA_SIZE;
+    }
+
+    slots++;
+    space -= fragmentSizes[i];
+  }
+
+  *compressedPtr = compressed;
+  return packed;
+}
+
+/**********************************************************************/
+static void test(struct compressor_context *context,
+                 enum vdo_compression_type type)
+{
+  if (!vdo_is_compression_type_supported(type)) {
+    printf("%-6s not supported\n", vdo_get_compression_type_name(type));
+    return;
+  }
+
+  unsigned long fragmentBytes = 0;
+  ktime_t start = current_time_ns(CLOCK_MONOTONIC);
+  for (unsigned int iteration = 0; iteration < ITERATIONS; iteration++) {
+    fragmentBytes = 0;
+    for (unsigned int i = 0; i < BLOCK_COUNT; i++) {
+      fragmentSizes[i] = vdo_compress_block(context, type,
+                                            &blocks[i * VDO_BLOCK_SIZE],
+                                            &fragments[i * VDO_BLOCK_SIZE],
+                                            VDO_MAX_COMPRESSED_FRAGMENT_SIZE);
+      fragmentBytes += fragmentSizes[i];
+    }
+  }
+  ktime_t compressTime = current_time_ns(CLOCK_MONOTONIC) - start;
+
+  char data[VDO_BLOCK_SIZE];
+  start = current_time_ns(CLOCK_MONOTONIC);
+  for (unsigned int iteration = 0; iteration < ITERATIONS; iteration++) {
+    for (unsigned int i = 0; i < BLOCK_COUNT; i++) {
+      if (fragmentSizes[i] == 0) {
+        continue;
+      }
+
+      CU_ASSERT_EQUAL(VDO_SUCCESS,
+                      vdo_uncompress_fragment(context, type,
+                                              &fragments[i * VDO_BLOCK_SIZE],
+                                              fragmentSizes[i], data));
+      if (iteration == 0) {
+        CU_ASSERT_EQUAL(0, memcmp(data, &blocks[i * VDO_BLOCK_SIZE],
+                                  VDO_BLOCK_SIZE));
+      }
+    }
+  }
+  ktime_t uncompressTime = current_time_ns(CLOCK_MONOTONIC) - start;
+
+  unsigned int compressed;
+  unsigned int packed = countPackedBlocks(&compressed);
+  double megabytes
+    = (double) ITERATIONS * BLOCK_COUNT * VDO_BLOCK_SIZE / (1024 * 1024);
+  printf("%-6s compress %7.1f MB/s, uncompress %7.1f MB/s,"
+         " %4u/%u compressible, average fragment %4lu bytes,"
+         " %5.2f fragments/block\n",
+         vdo_get_compression_type_name(type),
+         megabytes * 1.0e9 / (compressTime > 0 ? compressTime : 1),
+         megabytes * 1.0e9 / (uncompressTime > 0 ? uncompressTime : 1),
+         compressed, BLOCK_COUNT,
+         (compressed > 0) ? fragmentBytes / compressed : 0,
+         (packed > 0) ? (double) compressed / packed : 0.0);
+}
+
+int main(void)
+{
+  struct compressor_context *context;
+  CU_ASSERT_EQUAL(VDO_SUCCESS,
+                  UDS_ALLOCATE(BLOCK_COUNT * VDO_BLOCK_SIZE, char, __func__,
+                               &blocks));
+  CU_ASSERT_EQUAL(VDO_SUCCESS,
+                  UDS_ALLOCATE(BLOCK_COUNT * VDO_BLOCK_SIZE, char, __func__,
+                               &fragments));
+  CU_ASSERT_EQUAL(VDO_SUCCESS, vdo_make_compressor_context(&context));
+  prepareBlocks();
+
+  test(context, VDO_COMPRESSION_LZ4);
+  test(context, VDO_COMPRESSION_LZ4HC);
+  test(context, VDO_COMPRESSION_ZSTD);
+
+  vdo_free_compressor_context(context);
+  UDS_FREE(fragments);
+  UDS_FREE(blocks);
+  return 0;
+}
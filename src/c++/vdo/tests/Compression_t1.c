@@ -83,6 +83,31 @@ static void testCompressedDataReadWrite(void)
   CU_ASSERT_EQUAL(blocksFree, getPhysicalBlocksFree());
 }
 
+/**
+ * Test that blocks compressed by each compressor remain readable after the
+ * compressor is changed by a table reload.
+ **/
+static void testMixedCompressors(void)
+{
+  enum vdo_compression_type types[] = {
+    VDO_COMPRESSION_LZ4,
+    VDO_COMPRESSION_ZSTD,
+    VDO_COMPRESSION_LZ4HC,
+  };
+
+  block_count_t freeExpected = blocksFree;
+  for (unsigned int i = 0; i < ARRAY_SIZE(types); i++) {
+    CU_ASSERT_EQUAL(VDO_SUCCESS, modifyCompressionType(types[i]));
+    logical_block_number_t start = i * VDO_MAX_COMPRESSION_SLOTS;
+
+    // A full bin of new data is written as a single compressed block.
+    writeData(start, start + 1, VDO_MAX_COMPRESSION_SLOTS, VDO_SUCCESS);
+    freeExpected--;
+    CU_ASSERT_EQUAL(freeExpected, getPhysicalBlocksFree());
+    verifyData(0, 1, start + VDO_MAX_COMPRESSION_SLOTS);
+  }
+}
+
 /**
  * Test that writes which duplicate blocks that are waiting in the packer.
  **/
@@ -317,8 +342,12 @@ static void testInvalidFragment(void)
   // Wait for all the fragment writes to complete.
   awaitRequests(true);
 
-  // Check that we can read all the fragments.
-  verifyData(0, 1, VDO_MAX_COMPRESSION_SLOTS);
+  /*
+   * Check that we can read all but the first fragment. The first is left
+   * unread so that it is not in the decompression cache when the compressed
+   * block is smashed.
+   */
+  verifyData(1, 2, VDO_MAX_COMPRESSION_SLOTS - 1);
 
   // Smash the compressed block.
   PhysicalLayer *syncLayer = getSynchronousLayer();
@@ -341,6 +370,7 @@ static void testInvalidFragment(void)
 
 static CU_TestInfo tests[] = {
   { "compressed data read write",        testCompressedDataReadWrite         },
+  { "mixed compressors",                 testMixedCompressors                },
   { "dedupe block in packer",            testDedupeBlocksInPacker            },
   { "dedupe block in compressor",        testDedupeBlocksInCompressor        },
   { "compressed block reference",        testCompressedBlockReference        },
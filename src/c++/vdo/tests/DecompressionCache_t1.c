@@ -0,0 +1,197 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * $Id$
+ */
+
+#include "albtest.h"
+
+#include "memory-alloc.h"
+
+#include "decompression-cache.h"
+#include "physical-zone.h"
+#include "vdo.h"
+
+#include "ioRequest.h"
+#include "vdoAsserts.h"
+#include "vdoTestBase.h"
+
+/**
+ * Test-specific initialization.
+ **/
+static void initializeDecompressionCacheT1(void)
+{
+  const TestParameters parameters = {
+    .mappableBlocks      = 1024,
+    .logicalBlocks       = 1024,
+    .journalBlocks       = 32,
+    .logicalThreadCount  = 1,
+    .physicalThreadCount = 1,
+    .hashZoneThreadCount = 1,
+    .enableCompression   = true,
+  };
+  initializeVDOTest(&parameters);
+}
+
+/**
+ * Check the decompression cache statistics.
+ *
+ * @param hits    The expected number of cache hits
+ * @param misses  The expected number of cache misses
+ **/
+static void assertCacheStatistics(u64 hits, u64 misses)
+{
+  struct decompression_cache_statistics stats
+    = vdo_get_decompression_cache_statistics(vdo->physical_zones);
+  CU_ASSERT_EQUAL(hits, stats.hits);
+  CU_ASSERT_EQUAL(misses, stats.misses);
+}
+
+/**
+ * Fill a buffer with a pattern identifying a fragment.
+ **/
+static void fillFragment(char *buffer, physical_block_number_t pbn,
+                         slot_number_t slot)
+{
+  memset(buffer, (int) (pbn * VDO_MAX_COMPRESSION_SLOTS + slot),
+         VDO_BLOCK_SIZE);
+}
+
+/**
+ * Cache a fragment of a block, checking that it was not already cached.
+ **/
+static void cacheFragment(struct decompression_cache *cache,
+                          physical_block_number_t pbn,
+                          slot_number_t slot)
+{
+  char data[VDO_BLOCK_SIZE];
+  u64 generation;
+  enum block_mapping_state state = VDO_MAPPING_STATE_COMPRESSED_BASE + slot;
+  CU_ASSERT_FALSE(vdo_get_decompressed_fragment(cache, pbn, state, data,
+                                                &generation));
+  fillFragment(data, pbn, slot);
+  vdo_cache_decompressed_fragment(cache, pbn, state, data, generation);
+}
+
+/**
+ * Check whether a fragment is cached, and if so, that its data is correct.
+ **/
+static bool isCached(struct decompression_cache *cache,
+                     physical_block_number_t pbn,
+                     slot_number_t slot)
+{
+  char data[VDO_BLOCK_SIZE];
+  char expected[VDO_BLOCK_SIZE];
+  u64 generation;
+  if (!vdo_get_decompressed_fragment(cache, pbn,
+                                     VDO_MAPPING_STATE_COMPRESSED_BASE + slot,
+                                     data, &generation)) {
+    return false;
+  }
+
+  fillFragment(expected, pbn, slot);
+  UDS_ASSERT_EQUAL_BYTES(expected, data, VDO_BLOCK_SIZE);
+  return true;
+}
+
+/**
+ * Test caching, replacement, and discarding of fragments.
+ **/
+static void testCache(void)
+{
+  struct decompression_cache *cache;
+  VDO_ASSERT_SUCCESS(vdo_make_decompression_cache(&cache));
+
+  // Fragments of the same block are cached separately.
+  physical_block_number_t pbn = 1;
+  cacheFragment(cache, pbn, 0);
+  cacheFragment(cache, pbn, 1);
+  CU_ASSERT_TRUE(isCached(cache, pbn, 0));
+  CU_ASSERT_TRUE(isCached(cache, pbn, 1));
+  CU_ASSERT_FALSE(isCached(cache, pbn, 2));
+
+  // Filling the set replaces the least recently used fragment.
+  physical_block_number_t other = pbn + DECOMPRESSION_CACHE_SETS;
+  STATIC_ASSERT(DECOMPRESSION_CACHE_WAYS - 2 <= VDO_MAX_COMPRESSION_SLOTS);
+  for (slot_number_t slot = 0; slot < DECOMPRESSION_CACHE_WAYS - 2; slot++) {
+    cacheFragment(cache, other, slot);
+  }
+  CU_ASSERT_TRUE(isCached(cache, pbn, 0));
+  physical_block_number_t third = other + DECOMPRESSION_CACHE_SETS;
+  cacheFragment(cache, third, 0);
+  CU_ASSERT_FALSE(isCached(cache, pbn, 1));
+  CU_ASSERT_TRUE(isCached(cache, pbn, 0));
+  CU_ASSERT_TRUE(isCached(cache, other, 0));
+  CU_ASSERT_TRUE(isCached(cache, third, 0));
+
+  // Discarding a block forgets all of its fragments, and only its fragments.
+  vdo_discard_decompressed_fragments(cache, other);
+  CU_ASSERT_FALSE(isCached(cache, other, 0));
+  CU_ASSERT_FALSE(isCached(cache, other, 2));
+  CU_ASSERT_TRUE(isCached(cache, pbn, 0));
+  CU_ASSERT_TRUE(isCached(cache, third, 0));
+
+  // A read which missed before its block was discarded is not cached.
+  char data[VDO_BLOCK_SIZE];
+  u64 generation;
+  enum block_mapping_state state = VDO_MAPPING_STATE_COMPRESSED_BASE + 3;
+  CU_ASSERT_FALSE(vdo_get_decompressed_fragment(cache, pbn, state, data,
+                                                &generation));
+  vdo_discard_decompressed_fragments(cache, pbn);
+  fillFragment(data, pbn, 3);
+  vdo_cache_decompressed_fragment(cache, pbn, state, data, generation);
+  CU_ASSERT_FALSE(isCached(cache, pbn, 3));
+  CU_ASSERT_FALSE(isCached(cache, pbn, 0));
+
+  vdo_free_decompression_cache(cache);
+}
+
+/**
+ * Test that reads and dedupe verification of compressed data use the cache.
+ **/
+static void testReadsAndVerification(void)
+{
+  // Fill exactly one compressed block so nothing waits in the packer.
+  writeData(0, 1, VDO_MAX_COMPRESSION_SLOTS, VDO_SUCCESS);
+  assertCacheStatistics(0, 0);
+
+  // The first read of each fragment misses, and later reads hit.
+  verifyData(0, 1, VDO_MAX_COMPRESSION_SLOTS);
+  assertCacheStatistics(0, VDO_MAX_COMPRESSION_SLOTS);
+  verifyData(0, 1, VDO_MAX_COMPRESSION_SLOTS);
+  assertCacheStatistics(VDO_MAX_COMPRESSION_SLOTS, VDO_MAX_COMPRESSION_SLOTS);
+
+  // Verifying the duplicates of cached fragments needs no reads.
+  block_count_t freeBlocks = getPhysicalBlocksFree();
+  writeData(VDO_MAX_COMPRESSION_SLOTS, 1, VDO_MAX_COMPRESSION_SLOTS,
+            VDO_SUCCESS);
+  CU_ASSERT_EQUAL(freeBlocks, getPhysicalBlocksFree());
+  assertCacheStatistics(2 * VDO_MAX_COMPRESSION_SLOTS,
+                        VDO_MAX_COMPRESSION_SLOTS);
+  verifyData(VDO_MAX_COMPRESSION_SLOTS, 1, VDO_MAX_COMPRESSION_SLOTS);
+  assertCacheStatistics(3 * VDO_MAX_COMPRESSION_SLOTS,
+                        VDO_MAX_COMPRESSION_SLOTS);
+}
+
+/**********************************************************************/
+
+static CU_TestInfo tests[] = {
+  { "cache, replace, and discard fragments", testCache                },
+  { "reads and verification use the cache", testReadsAndVerification },
+  CU_TEST_INFO_NULL,
+};
+
+static CU_SuiteInfo suite = {
+  .name                     = "Decompression cache tests (DecompressionCache_t1)",
+  .initializerWithArguments = NULL,
+  .initializer              = initializeDecompressionCacheT1,
+  .cleaner                  = tearDownVDOTest,
+  .tests                    = tests,
+};
+
+CU_SuiteInfo *initializeModule(void)
+{
+  return &suite;
+}
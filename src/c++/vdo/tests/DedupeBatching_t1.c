@@ -0,0 +1,226 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * $Id$
+ */
+
+#include "albtest.h"
+
+#include "uds.h"
+
+#include "dedupe.h"
+
+#include "asyncLayer.h"
+#include "callbackWrappingUtils.h"
+#include "ioRequest.h"
+#include "mutexUtils.h"
+#include "vdoAsserts.h"
+#include "vdoTestBase.h"
+
+enum {
+  BURST_SIZE      = 8,
+  MAX_BURST_SIZE  = DEDUPE_LAUNCH_BATCH_SIZE + BURST_SIZE,
+  MAX_BATCH_COUNT = MAX_BURST_SIZE,
+};
+
+static struct vdo_completion *held[MAX_BURST_SIZE];
+static block_count_t          heldCount;
+static block_count_t          burstSize;
+static unsigned int           launched;
+static unsigned int           batchSizes[MAX_BATCH_COUNT];
+static unsigned int           batchCount;
+
+/**
+ * Test-specific initialization.
+ **/
+static void initialize(void)
+{
+  const TestParameters parameters = {
+    .mappableBlocks      = 256,
+    .hashZoneThreadCount = 1,
+    .dataFormatter       = fillWithOffsetPlusOne,
+  };
+  initializeVDOTest(&parameters);
+}
+
+/**********************************************************************/
+static bool countLaunchLocked(void *context __attribute__((unused)))
+{
+  launched++;
+  return false;
+}
+
+/**
+ * Count each index request as it is launched.
+ *
+ * Implements uds_request_hook.
+ **/
+static int countLaunch(struct uds_request *request __attribute__((unused)))
+{
+  runLocked(countLaunchLocked, NULL);
+  return UDS_SUCCESS;
+}
+
+/**********************************************************************/
+static bool readLaunchedLocked(void *context)
+{
+  *((unsigned int *) context) = launched;
+  return false;
+}
+
+/**********************************************************************/
+static unsigned int getLaunched(void)
+{
+  unsigned int count;
+  runLocked(readLaunchedLocked, &count);
+  return count;
+}
+
+/**********************************************************************/
+static bool recordBatchLocked(void *context)
+{
+  CU_ASSERT(batchCount < MAX_BATCH_COUNT);
+  batchSizes[batchCount++] = *((unsigned int *) context);
+  return false;
+}
+
+/**
+ * Record how many requests the hash zone's launcher launches when it runs.
+ *
+ * Implements vdo_action.
+ **/
+static void recordLauncherBatch(struct vdo_completion *completion)
+{
+  unsigned int before = getLaunched();
+  runSavedCallback(completion);
+  unsigned int size = getLaunched() - before;
+  runLocked(recordBatchLocked, &size);
+}
+
+/**********************************************************************/
+static bool holdLocked(void *context)
+{
+  held[heldCount++] = context;
+  return (heldCount == burstSize);
+}
+
+/**
+ * Hold data_vios before they enter the hash zone, and wrap the launcher
+ * completion each time it is scheduled.
+ *
+ * Implements CompletionHook.
+ **/
+static bool holdAndWrap(struct vdo_completion *completion)
+{
+  if (completion->type == VDO_DEDUPE_LAUNCH_COMPLETION) {
+    wrapCompletionCallback(completion, recordLauncherBatch);
+    return true;
+  }
+
+  if (!isDataVIO(completion)
+      || (completion->callback != vdo_acquire_hash_lock)) {
+    return true;
+  }
+
+  runLocked(holdLocked, completion);
+  return false;
+}
+
+/**
+ * Release the rest of the held data_vios from the hash zone thread before the
+ * first of them runs, so that they are all queued ahead of the launcher.
+ *
+ * Implements vdo_action.
+ **/
+static void releaseRest(struct vdo_completion *completion)
+{
+  for (block_count_t i = 1; i < burstSize; i++) {
+    reallyEnqueueCompletion(held[i]);
+  }
+
+  runSavedCallback(completion);
+}
+
+/**********************************************************************/
+static bool allHeld(void *context __attribute__((unused)))
+{
+  return (heldCount == burstSize);
+}
+
+/**
+ * Write a burst of unique blocks whose data_vios all arrive at the hash zone
+ * together, and count the index requests launched.
+ *
+ * @param start  The logical block and data index at which to start
+ * @param count  The number of blocks to write
+ **/
+static void writeBurst(logical_block_number_t start, block_count_t count)
+{
+  heldCount  = 0;
+  burstSize  = count;
+  launched   = 0;
+  batchCount = 0;
+  uds_launch_request_hook = countLaunch;
+  setCompletionEnqueueHook(holdAndWrap);
+
+  IORequest *request = launchIndexedWrite(start, count, start);
+  waitForCondition(allHeld, NULL);
+  wrapCompletionCallback(held[0], releaseRest);
+  reallyEnqueueCompletion(held[0]);
+
+  awaitAndFreeSuccessfulRequest(request);
+  clearCompletionEnqueueHooks();
+  uds_launch_request_hook = NULL;
+  CU_ASSERT_EQUAL(count, getLaunched());
+}
+
+/**
+ * Test that requests which reach a hash zone together are launched as one
+ * batch once the zone's queued work is done, even though the batch is not
+ * full.
+ **/
+static void testPartialBatch(void)
+{
+  writeBurst(0, BURST_SIZE);
+  CU_ASSERT_EQUAL(1, batchCount);
+  CU_ASSERT_EQUAL(BURST_SIZE, batchSizes[0]);
+
+  // A lone request is launched by itself.
+  writeBurst(BURST_SIZE, 1);
+  CU_ASSERT_EQUAL(1, batchCount);
+  CU_ASSERT_EQUAL(1, batchSizes[0]);
+}
+
+/**
+ * Test that a full batch is launched as soon as it fills, and that the
+ * remainder is launched when the zone's launcher runs.
+ **/
+static void testFullBatch(void)
+{
+  writeBurst(0, MAX_BURST_SIZE);
+  CU_ASSERT_EQUAL(1, batchCount);
+  CU_ASSERT_EQUAL(MAX_BURST_SIZE - DEDUPE_LAUNCH_BATCH_SIZE, batchSizes[0]);
+}
+
+/**********************************************************************/
+
+static CU_TestInfo vdoTests[] = {
+  { "partial batches are launched", testPartialBatch },
+  { "full batches launch at once",  testFullBatch    },
+  CU_TEST_INFO_NULL,
+};
+
+static CU_SuiteInfo vdoSuite = {
+  .name                     = "dedupe launch batching (DedupeBatching_t1)",
+  .initializerWithArguments = NULL,
+  .initializer              = initialize,
+  .cleaner                  = tearDownVDOTest,
+  .tests                    = vdoTests,
+};
+
+CU_SuiteInfo *initializeModule(void)
+{
+  return &vdoSuite;
+}
@@ -325,10 +325,68 @@ static void persistenceTest(void)
   vdo_free_fixed_layout(layout);
 }
 
+/**
+ * Test that partitions on a journal device take no space from the main
+ * layout, and survive being saved and restored.
+ **/
+static void journalDeviceTest(void)
+{
+  block_count_t           BLOCKS      = 32;
+  physical_block_number_t FIRST_BLOCK = 7;
+
+  struct fixed_layout *layout;
+  VDO_ASSERT_SUCCESS(vdo_make_fixed_layout(BLOCKS, FIRST_BLOCK, &layout));
+  CU_ASSERT_EQUAL(0, vdo_get_fixed_layout_journal_device_size(layout));
+
+  VDO_ASSERT_SUCCESS(vdo_make_fixed_layout_partition(layout,
+                                                     VDO_TEST_PARTITION_1, 8,
+                                                     VDO_PARTITION_FROM_BEGINNING,
+                                                     0));
+  VDO_ASSERT_SUCCESS(vdo_make_fixed_layout_journal_device_partition(layout,
+                                                                    VDO_TEST_PARTITION_2,
+                                                                    6, 0));
+  VDO_ASSERT_SUCCESS(vdo_make_fixed_layout_journal_device_partition(layout,
+                                                                    VDO_TEST_PARTITION_3,
+                                                                    2, 0));
+  CU_ASSERT_EQUAL(BLOCKS - 8, vdo_get_fixed_layout_blocks_available(layout));
+  CU_ASSERT_EQUAL(VDO_JOURNAL_DEVICE_LAYOUT_START + 6 + 2,
+                  vdo_get_fixed_layout_journal_device_size(layout));
+
+  struct buffer *buffer;
+  VDO_ASSERT_SUCCESS(make_buffer(vdo_get_fixed_layout_encoded_size(layout),
+                                 &buffer));
+  VDO_ASSERT_SUCCESS(vdo_encode_fixed_layout(layout, buffer));
+  vdo_free_fixed_layout(UDS_FORGET(layout));
+
+  VDO_ASSERT_SUCCESS(vdo_decode_fixed_layout(buffer, &layout));
+  CU_ASSERT_EQUAL(BLOCKS - 8, vdo_get_fixed_layout_blocks_available(layout));
+  CU_ASSERT_EQUAL(VDO_JOURNAL_DEVICE_LAYOUT_START + 6 + 2,
+                  vdo_get_fixed_layout_journal_device_size(layout));
+  checkPartition(layout, VDO_TEST_PARTITION_1, FIRST_BLOCK, 8, 0);
+  checkPartition(layout, VDO_TEST_PARTITION_2,
+                 VDO_JOURNAL_DEVICE_LAYOUT_START, 6, 0);
+  checkPartition(layout, VDO_TEST_PARTITION_3,
+                 VDO_JOURNAL_DEVICE_LAYOUT_START + 6, 2, 0);
+
+  struct partition *partition;
+  VDO_ASSERT_SUCCESS(vdo_get_fixed_layout_partition(layout,
+                                                    VDO_TEST_PARTITION_1,
+                                                    &partition));
+  CU_ASSERT_FALSE(vdo_is_journal_device_partition(partition));
+  VDO_ASSERT_SUCCESS(vdo_get_fixed_layout_partition(layout,
+                                                    VDO_TEST_PARTITION_3,
+                                                    &partition));
+  CU_ASSERT_TRUE(vdo_is_journal_device_partition(partition));
+
+  free_buffer(UDS_FORGET(buffer));
+  vdo_free_fixed_layout(layout);
+}
+
 /**********************************************************************/
 static CU_TestInfo fixedLayoutTests[] = {
-  { "basic",        basicTest },
-  { "save/restore", persistenceTest },
+  { "basic",          basicTest },
+  { "save/restore",   persistenceTest },
+  { "journal device", journalDeviceTest },
   CU_TEST_INFO_NULL
 };
 
@@ -0,0 +1,96 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * Performance testing of zero block detection.
+ *
+ * $Id$
+ */
+
+#include "assertions.h"
+#include "data-vio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+enum {
+  // Should be larger than CPU cache size.
+  BLOCK_COUNT = 10 * 1024,
+  ITERATIONS  = 200,
+};
+
+static char blocks[BLOCK_COUNT][VDO_BLOCK_SIZE]
+  __attribute__ ((__aligned__(VDO_BLOCK_SIZE)));
+
+static uint64_t cpuTime(void)
+{
+  /* user cpu time */
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) < 0) {
+    perror("getrusage");
+    exit(1);
+  }
+  return ((uint64_t) ru.ru_utime.tv_sec * 1000000) + ru.ru_utime.tv_usec;
+}
+
+/**
+ * Fill every block with zeros, then set a single non-zero byte in each
+ * block at the given offset (if the offset is within the block).
+ **/
+static void prepareBlocks(size_t dirtyOffset)
+{
+  memset(blocks, 0, sizeof(blocks));
+  if (dirtyOffset >= VDO_BLOCK_SIZE) {
+    return;
+  }
+
+  unsigned int i;
+  for (i = 0; i < BLOCK_COUNT; i++) {
+    blocks[i][dirtyOffset] = 1;
+  }
+}
+
+static void test(const char *label, size_t dirtyOffset)
+{
+  bool expectZero = (dirtyOffset >= VDO_BLOCK_SIZE);
+  prepareBlocks(dirtyOffset);
+
+  // Check every block once before timing to fault in the pages.
+  unsigned int i;
+  for (i = 0; i < BLOCK_COUNT; i++) {
+    CU_ASSERT_EQUAL(expectZero, is_zero_block(blocks[i]));
+  }
+
+  unsigned int zeroCount = 0;
+  uint64_t startTime = cpuTime();
+  unsigned int iteration;
+  for (iteration = 0; iteration < ITERATIONS; iteration++) {
+    for (i = 0; i < BLOCK_COUNT; i++) {
+      if (is_zero_block(blocks[i])) {
+        zeroCount++;
+      }
+    }
+  }
+  uint64_t duration = cpuTime() - startTime;
+  CU_ASSERT_EQUAL(zeroCount, expectZero ? ITERATIONS * BLOCK_COUNT : 0);
+
+  double checks = (double) ITERATIONS * BLOCK_COUNT;
+  double bytes = checks * VDO_BLOCK_SIZE;
+  double seconds = (duration > 0) ? duration * 1.0e-6 : 1.0e-6;
+  printf("%-12s %10.0f blocks: %5.2fs (%6.1fns/block, %7.2fGB/s)\n",
+         label, checks, seconds, 1.0e9 * seconds / checks,
+         bytes / seconds / 1.0e9);
+}
+
+int main(void)
+{
+  test("zero", VDO_BLOCK_SIZE);
+  test("early-dirty", 0);
+  test("mid-dirty", VDO_BLOCK_SIZE / 2);
+  test("late-dirty", VDO_BLOCK_SIZE - 1);
+  return 0;
+}
@@ -0,0 +1,233 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * $Id$
+ */
+
+#include "albtest.h"
+
+#include "memory-alloc.h"
+
+#include "encodings.h"
+#include "slab-depot.h"
+#include "vdo.h"
+#include "vdo-layout.h"
+#include "volume-geometry.h"
+
+#include "asyncLayer.h"
+#include "ioRequest.h"
+#include "ramLayer.h"
+#include "testBIO.h"
+#include "testDM.h"
+#include "vdoAsserts.h"
+#include "vdoTestBase.h"
+
+enum {
+  WRITE_COUNT = 64,
+};
+
+static block_count_t journalIOCount;
+static block_count_t misdirectedIOCount;
+
+/**
+ * Test-specific initialization.
+ **/
+static void initializeJournalDeviceT1(void)
+{
+  const TestParameters parameters = {
+    .mappableBlocks   = 256,
+    .logicalBlocks    = 512,
+    .journalBlocks    = 8,
+    .slabSize         = 32,
+    .useJournalDevice = true,
+  };
+  initializeVDOTest(&parameters);
+  journalIOCount     = 0;
+  misdirectedIOCount = 0;
+}
+
+/**
+ * Count journal and slab summary bios, and those which were sent to the
+ * wrong device.
+ *
+ * Implements BIOSubmitHook.
+ **/
+static bool countJournalDeviceIO(struct bio *bio)
+{
+  if (bio->bi_vcnt == 0) {
+    return true;
+  }
+
+  struct vio *vio = bio->bi_private;
+  bool isJournalIO = ((vio->type == VIO_TYPE_RECOVERY_JOURNAL)
+                      || (vio->type == VIO_TYPE_SLAB_SUMMARY));
+  if (isJournalIO) {
+    journalIOCount++;
+  }
+
+  if (isJournalIO != isJournalDevice(bio->bi_bdev)) {
+    misdirectedIOCount++;
+  }
+
+  return true;
+}
+
+/**
+ * Get a partition of the running VDO.
+ *
+ * @param id  The ID of the partition
+ *
+ * @return The partition
+ **/
+static struct partition *getVDOPartition(enum partition_id id)
+{
+  struct partition *partition;
+  VDO_ASSERT_SUCCESS(vdo_get_fixed_layout_partition(vdo->layout->layout, id,
+                                                    &partition));
+  return partition;
+}
+
+/**
+ * Check that the recovery journal and slab summary are on the journal
+ * device, and that everything else is not.
+ **/
+static void assertJournalDeviceLayout(void)
+{
+  CU_ASSERT_TRUE(vdo_uses_journal_device(vdo));
+  CU_ASSERT_TRUE(vdo_is_journal_device_partition(getVDOPartition(VDO_RECOVERY_JOURNAL_PARTITION)));
+  CU_ASSERT_TRUE(vdo_is_journal_device_partition(getVDOPartition(VDO_SLAB_SUMMARY_PARTITION)));
+  CU_ASSERT_FALSE(vdo_is_journal_device_partition(getVDOPartition(VDO_BLOCK_MAP_PARTITION)));
+  CU_ASSERT_FALSE(vdo_is_journal_device_partition(getVDOPartition(VDO_BLOCK_ALLOCATOR_PARTITION)));
+  CU_ASSERT_EQUAL(getTestConfig().journalDeviceBlocks,
+                  vdo_get_fixed_layout_journal_device_size(vdo->layout->layout));
+}
+
+/**
+ * Test that journal and summary I/O goes to the journal device, and that the
+ * data survives a clean restart.
+ **/
+static void testJournalDeviceIO(void)
+{
+  assertJournalDeviceLayout();
+  setBIOSubmitHook(countJournalDeviceIO);
+  writeData(0, 1, WRITE_COUNT, VDO_SUCCESS);
+  clearBIOSubmitHook();
+  CU_ASSERT(journalIOCount > 0);
+  CU_ASSERT_EQUAL(0, misdirectedIOCount);
+  verifyData(0, 1, WRITE_COUNT);
+
+  restartVDO(false);
+  assertJournalDeviceLayout();
+  verifyData(0, 1, WRITE_COUNT);
+}
+
+/**
+ * Test that a VDO with a journal device recovers from a crash.
+ **/
+static void testCrashRecovery(void)
+{
+  writeData(0, 1, WRITE_COUNT, VDO_SUCCESS);
+  crashVDO();
+  startVDO(VDO_DIRTY);
+  waitForRecoveryDone();
+  verifyData(0, 1, WRITE_COUNT);
+  writeData(WRITE_COUNT, WRITE_COUNT + 1, WRITE_COUNT, VDO_SUCCESS);
+  verifyData(0, 1, 2 * WRITE_COUNT);
+}
+
+/**
+ * Test that growing the physical size leaves the journal device alone.
+ **/
+static void testGrowPhysical(void)
+{
+  writeData(0, 1, WRITE_COUNT, VDO_SUCCESS);
+  slab_count_t slabCount = vdo->depot->slab_count;
+  addSlabs(2);
+  CU_ASSERT_EQUAL(slabCount + 2, vdo->depot->slab_count);
+  assertJournalDeviceLayout();
+  verifyData(0, 1, WRITE_COUNT);
+
+  restartVDO(false);
+  assertJournalDeviceLayout();
+  CU_ASSERT_EQUAL(slabCount + 2, vdo->depot->slab_count);
+  verifyData(0, 1, WRITE_COUNT);
+}
+
+/**
+ * Test that a VDO with a journal device can't be started without it.
+ **/
+static void testMissingJournalDevice(void)
+{
+  stopVDO();
+  TestConfiguration configuration = getTestConfig();
+  configuration.journalDeviceBlocks = 0;
+  setStartStopExpectation(vdo_map_to_system_error(VDO_PARAMETER_MISMATCH));
+  startAsyncLayer(configuration, true);
+  setStartStopExpectation(VDO_SUCCESS);
+  startVDO(VDO_CLEAN);
+}
+
+/**
+ * Test that a VDO won't start with a journal device belonging to another VDO.
+ **/
+static void testMismatchedJournalDevice(void)
+{
+  stopVDO();
+
+  // Perturb the nonce in the journal device's copy of the geometry block.
+  PhysicalLayer *journalLayer = getJournalLayer();
+  struct volume_geometry geometry;
+  VDO_ASSERT_SUCCESS(vdo_load_volume_geometry(journalLayer, &geometry));
+  geometry.nonce++;
+  VDO_ASSERT_SUCCESS(vdo_write_volume_geometry(journalLayer, &geometry));
+  startVDOExpectError(vdo_map_to_system_error(VDO_BAD_NONCE));
+
+  geometry.nonce--;
+  VDO_ASSERT_SUCCESS(vdo_write_volume_geometry(journalLayer, &geometry));
+  setStartStopExpectation(VDO_SUCCESS);
+  startVDO(VDO_CLEAN);
+}
+
+/**
+ * Test that a reload can't switch the VDO to a different journal device.
+ **/
+static void testChangeJournalDevice(void)
+{
+  static char otherDevice[] = "another journal device name";
+  static char sameDevice[]  = TEST_JOURNAL_DEVICE_NAME;
+
+  writeData(0, 1, WRITE_COUNT, VDO_SUCCESS);
+  CU_ASSERT_EQUAL(-EINVAL, modifyJournalDevice(otherDevice));
+
+  // Reloading with the same journal device is fine.
+  VDO_ASSERT_SUCCESS(modifyJournalDevice(sameDevice));
+  assertJournalDeviceLayout();
+  verifyData(0, 1, WRITE_COUNT);
+}
+
+/**********************************************************************/
+
+static CU_TestInfo tests[] = {
+  { "journal I/O goes to the journal device", testJournalDeviceIO         },
+  { "recover from a crash",                   testCrashRecovery           },
+  { "grow physical",                          testGrowPhysical            },
+  { "missing journal device",                 testMissingJournalDevice    },
+  { "mismatched journal device",              testMismatchedJournalDevice },
+  { "journal device can't change",            testChangeJournalDevice     },
+  CU_TEST_INFO_NULL,
+};
+
+static CU_SuiteInfo suite = {
+  .name                     = "Separate journal device tests (JournalDevice_t1)",
+  .initializerWithArguments = NULL,
+  .initializer              = initializeJournalDeviceT1,
+  .cleaner                  = tearDownVDOTest,
+  .tests                    = tests,
+};
+
+CU_SuiteInfo *initializeModule(void)
+{
+  return &suite;
+}
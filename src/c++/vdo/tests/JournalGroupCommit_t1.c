@@ -0,0 +1,205 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * $Id$
+ */
+
+#include "albtest.h"
+
+#include "time-utils.h"
+
+#include "recovery-journal.h"
+
+#include "adminUtils.h"
+#include "asyncLayer.h"
+#include "ioRequest.h"
+#include "mutexUtils.h"
+#include "testTimer.h"
+#include "vdoAsserts.h"
+#include "vdoTestBase.h"
+
+enum {
+  ENTRIES_PER_BLOCK = 8,
+  WRITE_COUNT       = 4,
+  FILL_LBN          = 100,
+};
+
+static struct recovery_journal            *journal;
+static struct recovery_journal_statistics  initialStats;
+static u64                                 expectedEntries;
+
+/**
+ * Test-specific initialization.
+ **/
+static void initialize(void)
+{
+  const TestParameters parameters = {
+    .logicalBlocks        = 1024,
+    .journalBlocks        = 16,
+    .logicalThreadCount   = 1,
+    .physicalThreadCount  = 1,
+    .hashZoneThreadCount  = 1,
+    .disableDeduplication = true,
+  };
+  initializeVDOTest(&parameters);
+
+  // Smaller blocks keep the fill time estimates well within the window.
+  journal = vdo->recovery_journal;
+  journal->entries_per_block = ENTRIES_PER_BLOCK;
+
+  // Allocate the block map tree pages before holding any blocks, and fill the
+  // active journal block so that each test starts with an empty one.
+  writeData(0, 0, 1, VDO_SUCCESS);
+  block_count_t fill = ENTRIES_PER_BLOCK - journal->active_block->entry_count;
+  if (fill > 0) {
+    writeData(FILL_LBN, FILL_LBN, fill, VDO_SUCCESS);
+  }
+
+  VDO_ASSERT_SUCCESS(modifyJournalCommitWindow(VDO_MAX_JOURNAL_COMMIT_WINDOW));
+  setCallbackFinishedHook(broadcast);
+  initialStats = vdo_get_recovery_journal_statistics(journal);
+}
+
+/**
+ * Make the journal believe that entries have been arriving very quickly.
+ *
+ * Implements VDOAction.
+ **/
+static void primeEntryInterval(struct vdo_completion *completion)
+{
+  journal->entry_interval = 0;
+  journal->last_entry_time = current_time_ns(CLOCK_MONOTONIC);
+  vdo_complete_completion(completion);
+}
+
+/**
+ * Check whether the expected entries have all been assigned to a block which
+ * is being held.
+ *
+ * Implements WaitCondition.
+ **/
+static bool checkHeld(void *context __attribute__((unused)))
+{
+  return ((journal->events.entries.started == expectedEntries)
+          && (journal->events.commits_held == initialStats.commits_held + 1));
+}
+
+/**
+ * Launch writes quickly enough for the journal to hold their block, and wait
+ * until all of their entries are waiting in it.
+ *
+ * @param lbn    The first logical block to write
+ * @param count  The number of blocks to write
+ *
+ * @return The write request
+ **/
+static IORequest *launchHeldWrites(logical_block_number_t lbn,
+                                   block_count_t          count)
+{
+  performSuccessfulActionOnThread(primeEntryInterval, journal->thread_id);
+  expectedEntries = initialStats.entries.started + count;
+  IORequest *request = launchIndexedWrite(lbn, count, lbn);
+  waitForCondition(checkHeld, NULL);
+  return request;
+}
+
+/**
+ * Check the journal statistics accumulated since initialization.
+ *
+ * @param held     The expected number of held blocks
+ * @param written  The expected number of blocks written
+ * @param entries  The expected number of entries written
+ **/
+static void assertJournalStatistics(u64 held, u64 written, u64 entries)
+{
+  struct recovery_journal_statistics stats
+    = vdo_get_recovery_journal_statistics(journal);
+  CU_ASSERT_EQUAL(held, stats.commits_held - initialStats.commits_held);
+  CU_ASSERT_EQUAL(written,
+                  stats.blocks.written - initialStats.blocks.written);
+  CU_ASSERT_EQUAL(entries,
+                  stats.entries.written - initialStats.entries.written);
+}
+
+/**
+ * Test that entries which arrive slowly are not held.
+ **/
+static void testSlowEntriesNotHeld(void)
+{
+  writeData(1, 1, 1, VDO_SUCCESS);
+  writeData(2, 2, 1, VDO_SUCCESS);
+  assertJournalStatistics(0, 2, 2);
+  verifyData(1, 1, 2);
+}
+
+/**
+ * Test that a held block is written as one commit when its window closes.
+ **/
+static void testHoldUntilWindowCloses(void)
+{
+  IORequest *request = launchHeldWrites(1, WRITE_COUNT);
+  assertJournalStatistics(1, 0, 0);
+
+  CU_ASSERT_TRUE(fireTimers(getNextTimeout()));
+  awaitAndFreeSuccessfulRequest(request);
+  assertJournalStatistics(1, 1, WRITE_COUNT);
+  verifyData(1, 1, WRITE_COUNT);
+}
+
+/**
+ * Test that a block which fills while held is written without waiting for
+ * the window to close.
+ **/
+static void testFullBlockNotHeld(void)
+{
+  IORequest *request = launchHeldWrites(1, WRITE_COUNT);
+  VDO_ASSERT_SUCCESS(performIndexedWrite(1 + WRITE_COUNT,
+                                         ENTRIES_PER_BLOCK - WRITE_COUNT,
+                                         1 + WRITE_COUNT));
+  awaitAndFreeSuccessfulRequest(request);
+  assertJournalStatistics(1, 1, ENTRIES_PER_BLOCK);
+  verifyData(1, 1, ENTRIES_PER_BLOCK);
+
+  // The timer started for the block is still running, but has nothing to do.
+  CU_ASSERT_TRUE(fireTimers(getNextTimeout()));
+}
+
+/**
+ * Test that draining the journal writes a held block.
+ **/
+static void testDrainWritesHeldBlock(void)
+{
+  IORequest *request = launchHeldWrites(1, WRITE_COUNT);
+  performSuccessfulRecoveryJournalAction(VDO_ADMIN_STATE_SUSPENDING);
+  awaitAndFreeSuccessfulRequest(request);
+  assertJournalStatistics(1, 1, WRITE_COUNT);
+  CU_ASSERT_EQUAL(ULONG_MAX, getNextTimeout());
+
+  performSuccessfulRecoveryJournalAction(VDO_ADMIN_STATE_RESUMING);
+  verifyData(1, 1, WRITE_COUNT);
+}
+
+/**********************************************************************/
+
+static CU_TestInfo tests[] = {
+  { "slow entries are not held",            testSlowEntriesNotHeld    },
+  { "hold a block until its window closes", testHoldUntilWindowCloses },
+  { "a block which fills is not held",      testFullBlockNotHeld      },
+  { "draining writes a held block",         testDrainWritesHeldBlock  },
+  CU_TEST_INFO_NULL,
+};
+
+static CU_SuiteInfo suite = {
+  .name                     = "Recovery journal group commit tests (JournalGroupCommit_t1)",
+  .initializerWithArguments = NULL,
+  .initializer              = initialize,
+  .cleaner                  = tearDownVDOTest,
+  .tests                    = tests,
+};
+
+CU_SuiteInfo *initializeModule(void)
+{
+  return &suite;
+}
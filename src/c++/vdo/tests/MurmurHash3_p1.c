@@ -82,6 +82,40 @@ static void test(size_t        startingOffset,
          (1.0e6 / (1024 * 1024)) / perByte);
 }
 
+static void testBatch(unsigned int batchSize, unsigned int iterations)
+{
+  enum { MAX_BATCH = 32 };
+  const void *keys[MAX_BATCH];
+  struct uds_record_name names[MAX_BATCH];
+  void *outs[MAX_BATCH];
+  size_t stride = 4096 + PREFETCH_AVOIDANCE_GAP;
+  size_t blockCount = sizeof(buffer) / stride;
+  size_t block = 0;
+  unsigned int i, j;
+
+  CU_ASSERT_TRUE(batchSize <= MAX_BATCH);
+  for (j = 0; j < batchSize; j++) {
+    outs[j] = &names[j];
+  }
+
+  uint64_t startTime = cpuTime();
+  for (i = 0; i < iterations; i += batchSize) {
+    // Gather blocks from scattered offsets, as the CPU threads would.
+    for (j = 0; j < batchSize; j++) {
+      keys[j] = buffer + (block * stride);
+      block = (block + 1) % blockCount;
+    }
+    murmurhash3_128_batch(keys, batchSize, 4096, 0x62ea60be, outs);
+  }
+  uint64_t endTime = cpuTime();
+  uint64_t duration = endTime - startTime;
+  double perHash = (double) duration / iterations;
+  double perByte = perHash / 4096;
+  printf("batch %2u: %8u hashes of 4096B: %5.2fs (%.3fus/hash, %5.1fMB/s)\n",
+         batchSize, iterations, duration * 1.0e-6, perHash,
+         (1.0e6 / (1024 * 1024)) / perByte);
+}
+
 int main(void)
 {
   unsigned int baseIterationCount = 200;
@@ -119,5 +153,11 @@ int main(void)
   test(0, 256-10, smallIterations);
   printf("Small, unaligned:\n");
   test(3, 256, smallIterations);
+
+  printf("Batched 4K blocks:\n");
+  unsigned int batchSizes[] = { 1, 2, 4, 8, 16, 32 };
+  for (i = 0; i < sizeof(batchSizes) / sizeof(batchSizes[0]); i++) {
+    testBatch(batchSizes[i], medium4KIterations);
+  }
   return 0;
 }
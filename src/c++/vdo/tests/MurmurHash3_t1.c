@@ -7,9 +7,11 @@
  */
 
 #include <linux/murmurhash3.h>
+#include <linux/random.h>
 
 #include "albtest.h"
 #include "assertions.h"
+#include "constants.h"
 
 static const char *input1 = "The quick brown fox jumps over the lazy dog";
 static const char *input2 = "The quick brown fox jumps over the lazy cog";
@@ -66,10 +68,47 @@ static void testChunkName(void)
   checkChunkName(input2, result2);
 }
 
+/**********************************************************************/
+static void checkBatch(unsigned int count, int length)
+{
+  enum { MAX_KEYS = 11 };
+  static char data[MAX_KEYS][VDO_BLOCK_SIZE];
+  struct uds_record_name expected[MAX_KEYS];
+  struct uds_record_name batched[MAX_KEYS];
+  const void *keys[MAX_KEYS] = { NULL };
+  void *names[MAX_KEYS] = { NULL };
+
+  CU_ASSERT_TRUE(count <= MAX_KEYS);
+  get_random_bytes(data, sizeof(data));
+  for (unsigned int i = 0; i < count; i++) {
+    murmurhash3_128(data[i], length, 0x62ea60be, &expected[i]);
+    keys[i] = data[i];
+    names[i] = &batched[i];
+  }
+
+  murmurhash3_128_batch(keys, count, length, 0x62ea60be, names);
+  for (unsigned int i = 0; i < count; i++) {
+    UDS_ASSERT_BLOCKNAME_EQUAL(expected[i].name, batched[i].name);
+  }
+}
+
+/**********************************************************************/
+static void testBatch(void)
+{
+  // Cover empty, partial, and multiple full sets of lanes, with and without
+  // a tail.
+  for (unsigned int count = 0; count <= 11; count++) {
+    checkBatch(count, VDO_BLOCK_SIZE);
+    checkBatch(count, VDO_BLOCK_SIZE - 9);
+    checkBatch(count, 7);
+  }
+}
+
 /**********************************************************************/
 static CU_TestInfo murmurTests[] = {
-  {"murmurhash3_128",     testHash128 },
-  {"murmurHashChunkName", testChunkName },
+  {"murmurhash3_128",       testHash128 },
+  {"murmurHashChunkName",   testChunkName },
+  {"murmurhash3_128_batch", testBatch },
   CU_TEST_INFO_NULL,
 };
 
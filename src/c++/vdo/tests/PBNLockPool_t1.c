@@ -19,6 +19,7 @@
 
 static bool                   readOnMatch;
 static data_vio_count_t       count;
+static data_vio_count_t       capacity;
 static struct pbn_lock      **locks;
 static struct pbn_lock        saved;
 static struct physical_zone  *zone;
@@ -112,14 +113,18 @@ static void returnLock(struct vdo_completion *completion)
 static void testPBNLockPool(void)
 {
   zone = &vdo->physical_zones->zones[0];
-  VDO_ASSERT_SUCCESS(UDS_ALLOCATE(MAXIMUM_VDO_USER_VIOS * 2,
+  // Each logical zone may also lock every block of an allocation extent.
+  capacity = ((MAXIMUM_VDO_USER_VIOS * 2)
+              + (vdo->thread_config->logical_zone_count
+                 * VDO_MAX_ALLOCATION_EXTENT));
+  VDO_ASSERT_SUCCESS(UDS_ALLOCATE(capacity,
                                   struct pbn_lock *,
                                   __func__,
                                   &locks));
 
   // Borrow all the locks.
   readOnMatch = true;
-  for (count = 0; count < MAXIMUM_VDO_USER_VIOS * 2; count++) {
+  for (count = 0; count < capacity; count++) {
     performSuccessfulActionOnThread(borrow, zone->thread_id);
   }
 
@@ -137,7 +142,7 @@ static void testPBNLockPool(void)
   performSuccessfulActionOnThread(failBorrow, zone->thread_id);
 
   // Return all locks.
-  for (count = 0; count < MAXIMUM_VDO_USER_VIOS * 2; count++) {
+  for (count = 0; count < capacity; count++) {
     performSuccessfulActionOnThread(returnLock, zone->thread_id);
   }
 
@@ -321,6 +321,68 @@ static void removeVIOsTest(void)
   CU_ASSERT_EQUAL(getPhysicalBlocksFree(), freeBlocks - 2);
 }
 
+/**
+ * Write three small fragments followed by three large ones, each of which
+ * exactly fills a compressed block along with one small one, then flush the
+ * packer by suspending it.
+ *
+ * @param firstLBN  The first logical block to write
+ **/
+static void writeSmallThenLarge(logical_block_number_t firstLBN)
+{
+  block_size_t small = VDO_COMPRESSED_BLOCK_DATA_SIZE / 4;
+  IORequest *requests[6];
+
+  packedItemCount = 0;
+  shouldQueue = false;
+  setCompletionEnqueueHook(wrapIfLeavingCompressor);
+  for (block_size_t i = 0; i < 6; i++) {
+    logical_block_number_t lbn = firstLBN + i;
+    compressedSizes[lbn] = ((i < 3) ? small : VDO_COMPRESSED_BLOCK_DATA_SIZE - small);
+    // Wait for each fragment to reach the packer so they arrive in order.
+    packed = false;
+    targetItemCount = i + 1;
+    requests[i] = launchIndexedWrite(lbn, 1, lbn + 1);
+    waitForState(&packed);
+  }
+
+  clearCompletionEnqueueHooks();
+  performSuccessfulPackerAction(VDO_ADMIN_STATE_SUSPENDING);
+  for (block_size_t i = 0; i < 6; i++) {
+    awaitAndFreeSuccessfulRequest(UDS_FORGET(requests[i]));
+  }
+
+  performSuccessfulPackerAction(VDO_ADMIN_STATE_RESUMING);
+}
+
+/**
+ * Test that look-ahead packing places large fragments first, and that the
+ * fill histogram distinguishes it from greedy packing.
+ **/
+static void lookaheadTest(void)
+{
+  // Packed greedily, the three small fragments share a block which is 3/4
+  // full and each large fragment is left alone in a bin.
+  writeSmallThenLarge(0);
+  struct packer_statistics stats = vdo_get_packer_statistics(vdo->packer);
+  CU_ASSERT_EQUAL(3, stats.compressed_fragments_written);
+  CU_ASSERT_EQUAL(1, stats.compressed_blocks_written);
+  CU_ASSERT_EQUAL(1, stats.blocks_three_quarters_to_ninety_percent_full);
+  CU_ASSERT_EQUAL(0, stats.blocks_over_ninety_percent_full);
+
+  // With look-ahead, each large fragment is paired with a small one.
+  VDO_ASSERT_SUCCESS(modifyPackerLookahead(true));
+  writeSmallThenLarge(6);
+  stats = vdo_get_packer_statistics(vdo->packer);
+  CU_ASSERT_EQUAL(9, stats.compressed_fragments_written);
+  CU_ASSERT_EQUAL(4, stats.compressed_blocks_written);
+  CU_ASSERT_EQUAL(1, stats.blocks_three_quarters_to_ninety_percent_full);
+  CU_ASSERT_EQUAL(3, stats.blocks_over_ninety_percent_full);
+  CU_ASSERT_EQUAL(0, stats.blocks_under_half_full);
+  CU_ASSERT_EQUAL(0, stats.blocks_half_to_three_quarters_full);
+  CU_ASSERT_EQUAL(0, stats.compressed_fragments_in_packer);
+}
+
 /**********************************************************************/
 
 static CU_TestInfo packerTests[] = {
@@ -329,6 +391,7 @@ static CU_TestInfo packerTests[] = {
   { "bin boundary test",              binBoundaryTest            },
   { "best fit test",                  bestFitTest                },
   { "remove vios test",               removeVIOsTest             },
+  { "look-ahead test",                lookaheadTest              },
   CU_TEST_INFO_NULL
 };
 
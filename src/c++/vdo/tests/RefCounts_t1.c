@@ -8,6 +8,8 @@
 
 #include "albtest.h"
 
+#include <linux/bitops.h>
+
 #include "memory-alloc.h"
 
 #include "ref-counts.h"
@@ -735,6 +737,70 @@ static void testClearProvisional(void)
   verifyRefCountsLoad();
 }
 
+/**
+ * Check whether a reference block is marked as having no free counters.
+ *
+ * @param index  The index of the reference block
+ * @param full   Whether the block is expected to be full
+ **/
+static void assertBlockFull(block_count_t index, bool full)
+{
+  CU_ASSERT_EQUAL(full, test_bit(index, refs->full_blocks));
+}
+
+/**
+ * Test that the search for a free block skips reference blocks which are
+ * full, and resumes using them once they have free counters again.
+ **/
+static void testSkipFullBlocks(void)
+{
+  block_count_t blockCount = refs->free_blocks;
+  block_count_t lastIndex  = refs->reference_block_count - 1;
+  CU_ASSERT_TRUE(lastIndex >= 2);
+  for (block_count_t i = 0; i <= lastIndex; i++) {
+    assertBlockFull(i, false);
+  }
+
+  // Fill the first reference block.
+  for (block_count_t i = 0; i < COUNTS_PER_BLOCK; i++) {
+    assertAllocation(firstBlock + i);
+  }
+  assertBlockFull(0, true);
+  assertBlockFull(1, false);
+
+  // Free a block in the middle of it.
+  physical_block_number_t freed = firstBlock + (COUNTS_PER_BLOCK / 2);
+  assertAdjustment(freed, NULL, VDO_JOURNAL_DATA_REMAPPING, false, RS_FREE);
+  assertBlockFull(0, false);
+
+  // Fill the second reference block, and refill the first.
+  vdo_reset_search_cursor(refs);
+  assertAllocation(freed);
+  assertBlockFull(0, true);
+  for (block_count_t i = COUNTS_PER_BLOCK; i < 2 * COUNTS_PER_BLOCK; i++) {
+    assertAllocation(firstBlock + i);
+  }
+  assertBlockFull(1, true);
+
+  // A search from the start goes straight to the first non-full block.
+  vdo_reset_search_cursor(refs);
+  assertAllocation(firstBlock + (2 * COUNTS_PER_BLOCK));
+
+  // The last block is full once all of its counters are used, even if it is
+  // smaller than the others.
+  for (block_count_t i = (2 * COUNTS_PER_BLOCK) + 1; i < blockCount; i++) {
+    assertBlockFull(lastIndex, false);
+    assertAllocation(firstBlock + i);
+  }
+  for (block_count_t i = 0; i <= lastIndex; i++) {
+    assertBlockFull(i, true);
+  }
+
+  physical_block_number_t allocatedPBN;
+  CU_ASSERT_EQUAL(VDO_NO_SPACE,
+                  vdo_allocate_unreferenced_block(refs, &allocatedPBN));
+}
+
 /**
  * Replay a reference count adjustment and check that the resulting count is
  * as expected.
@@ -887,6 +953,7 @@ static CU_TestInfo refCountsTests[] = {
   { "same-block busy update",        testBlockCollisions           },
   { "provisional for dedupe",        testProvisionalForDedupe      },
   { "clear provisionals",            testClearProvisional          },
+  { "skip full reference blocks",    testSkipFullBlocks            },
   { "replay",                        testReplay                    },
   { "read-only",                     testReadOnly                  },
   CU_TEST_INFO_NULL
@@ -28,6 +28,7 @@ enum {
   SLAB_SIZE    = (1 << 23),
   COUNT        = 100000,
   JOURNAL_SIZE = 2,
+  SCAN_PASSES  = 50,
 };
 
 static struct ref_counts      *refs;
@@ -179,6 +180,78 @@ static void testFullArray(void)
   performanceTest(dataBlocks);
 }
 
+/**
+ * Time repeated scans for every free block in a refcount array in which the
+ * given fraction of the blocks are in use, spread evenly through the array.
+ *
+ * @param permille  The number of blocks in every thousand to reference
+ **/
+static void scanPerformanceTest(unsigned int permille)
+{
+  for (size_t k = 0; k < COUNT; k++) {
+    if (((k * 7919) % 1000) < permille) {
+      setReferenceCount(k, 1);
+    }
+  }
+
+  block_count_t freeBlocks = vdo_count_unreferenced_blocks(refs, 0, COUNT);
+  block_count_t found = 0;
+  uint64_t elapsed = current_time_us();
+  for (unsigned int pass = 0; pass < SCAN_PASSES; pass++) {
+    slab_block_number index = 0;
+    slab_block_number freeIndex;
+    while (vdo_find_free_block(refs, index, COUNT, &freeIndex)) {
+      found++;
+      index = freeIndex + 1;
+    }
+  }
+
+  elapsed = current_time_us() - elapsed;
+  CU_ASSERT_EQUAL(freeBlocks * SCAN_PASSES, found);
+  printf("(%lu free, %lu counters scanned in %lu usec) ", freeBlocks,
+         (unsigned long) COUNT * SCAN_PASSES, elapsed);
+}
+
+/**
+ * Time scans of an array which is half full.
+ **/
+static void testScanHalfFullArray(void)
+{
+  scanPerformanceTest(500);
+}
+
+/**
+ * Time scans of an array which is 90% full.
+ **/
+static void testScanMostlyFullArray(void)
+{
+  scanPerformanceTest(900);
+}
+
+/**
+ * Time scans of an array which is 99% full.
+ **/
+static void testScanVeryFullArray(void)
+{
+  scanPerformanceTest(990);
+}
+
+/**
+ * Time scans of an array which is 99.9% full.
+ **/
+static void testScanNearlyFullArray(void)
+{
+  scanPerformanceTest(999);
+}
+
+/**
+ * Time scans of an array which is full.
+ **/
+static void testScanFullArray(void)
+{
+  scanPerformanceTest(1000);
+}
+
 /**
  * Test all free block positions are found correctly for a given refcount
  * array length.
@@ -239,12 +312,17 @@ static void testAllSmallArrays(void)
 
 /**********************************************************************/
 static CU_TestInfo tests[] = {
-  { "0% full array",           testEmptyArray      },
-  { "10% full array",          testMostlyEmptyArray},
-  { "90% full array",          testMostlyFullArray },
-  { "99.6% full array",        testVeryFullArray   },
-  { "100% full slab",          testFullArray       },
-  { "all small arrays",        testAllSmallArrays  },
+  { "0% full array",          testEmptyArray          },
+  { "10% full array",         testMostlyEmptyArray    },
+  { "90% full array",         testMostlyFullArray     },
+  { "99.6% full array",       testVeryFullArray       },
+  { "100% full slab",         testFullArray           },
+  { "scan 50% full array",    testScanHalfFullArray   },
+  { "scan 90% full array",    testScanMostlyFullArray },
+  { "scan 99% full array",    testScanVeryFullArray   },
+  { "scan 99.9% full array",  testScanNearlyFullArray },
+  { "scan 100% full array",   testScanFullArray       },
+  { "all small arrays",       testAllSmallArrays      },
   CU_TEST_INFO_NULL,
 };
 
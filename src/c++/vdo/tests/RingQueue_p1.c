@@ -0,0 +1,159 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * Performance comparison of ring queues and funnel queues under contention.
+ *
+ * $Id$
+ */
+
+#include "assertions.h"
+#include "funnel-queue.h"
+#include "memory-alloc.h"
+#include "time-utils.h"
+#include "uds-threads.h"
+
+#include "ring-queue.h"
+
+#include <stdio.h>
+
+enum {
+  ENTRIES_PER_PRODUCER = 2 * 1000 * 1000,
+  MAX_PRODUCERS        = 8,
+  RING_CAPACITY        = 1024,
+  BATCH_SIZE           = 16,
+};
+
+typedef struct {
+  struct funnel_queue_entry link;
+} Entry;
+
+typedef struct {
+  struct funnel_queue *funnel;
+  struct ring_queue   *ring;
+  Entry               *entries;
+} ProducerContext;
+
+static ProducerContext contexts[MAX_PRODUCERS];
+
+/**********************************************************************/
+static void produceFunnel(void *arg)
+{
+  ProducerContext *context = arg;
+  for (unsigned int i = 0; i < ENTRIES_PER_PRODUCER; i++) {
+    funnel_queue_put(context->funnel, &context->entries[i].link);
+  }
+}
+
+/**
+ * Put entries on the ring, falling back to the funnel queue when it is full,
+ * as a ring-backed work queue does.
+ **/
+static void produceRing(void *arg)
+{
+  ProducerContext *context = arg;
+  for (unsigned int i = 0; i < ENTRIES_PER_PRODUCER; i++) {
+    if (!ring_queue_put(context->ring, &context->entries[i])) {
+      funnel_queue_put(context->funnel, &context->entries[i].link);
+    }
+  }
+}
+
+/**********************************************************************/
+static unsigned long consumeFunnel(struct funnel_queue *queue,
+                                   unsigned long total)
+{
+  unsigned long consumed = 0;
+  unsigned long polls = 0;
+  while (consumed < total) {
+    polls++;
+    if (funnel_queue_poll(queue) != NULL) {
+      consumed++;
+    }
+  }
+
+  return polls;
+}
+
+/**********************************************************************/
+static unsigned long consumeRing(struct ring_queue *ring,
+                                 struct funnel_queue *overflow,
+                                 unsigned long total)
+{
+  void *batch[BATCH_SIZE];
+  unsigned long consumed = 0;
+  unsigned long polls = 0;
+  while (consumed < total) {
+    polls++;
+    unsigned int count = ring_queue_poll_batch(ring, batch, BATCH_SIZE);
+    if (count > 0) {
+      consumed += count;
+    } else if (funnel_queue_poll(overflow) != NULL) {
+      consumed++;
+    }
+  }
+
+  return polls;
+}
+
+/**
+ * Time a single consumer draining entries from the given number of
+ * concurrent producers.
+ **/
+static void test(bool useRing, unsigned int producers)
+{
+  struct funnel_queue *funnel;
+  struct ring_queue *ring;
+  Entry *entries;
+  CU_ASSERT_EQUAL(UDS_SUCCESS, make_funnel_queue(&funnel));
+  CU_ASSERT_EQUAL(UDS_SUCCESS, make_ring_queue(RING_CAPACITY, &ring));
+  CU_ASSERT_EQUAL(UDS_SUCCESS,
+                  UDS_ALLOCATE(producers * ENTRIES_PER_PRODUCER, Entry,
+                               __func__, &entries));
+
+  struct thread *threads[MAX_PRODUCERS];
+  unsigned long total = (unsigned long) producers * ENTRIES_PER_PRODUCER;
+  ktime_t start = current_time_ns(CLOCK_MONOTONIC);
+  for (unsigned int i = 0; i < producers; i++) {
+    contexts[i] = (ProducerContext) {
+      .funnel   = funnel,
+      .ring     = ring,
+      .entries  = &entries[i * ENTRIES_PER_PRODUCER],
+    };
+    CU_ASSERT_EQUAL(UDS_SUCCESS,
+                    uds_create_thread((useRing ? produceRing : produceFunnel),
+                                      &contexts[i], "producer", &threads[i]));
+  }
+
+  unsigned long polls = (useRing
+                         ? consumeRing(ring, funnel, total)
+                         : consumeFunnel(funnel, total));
+  ktime_t duration = current_time_ns(CLOCK_MONOTONIC) - start;
+  for (unsigned int i = 0; i < producers; i++) {
+    uds_join_threads(threads[i]);
+  }
+
+  CU_ASSERT_PTR_NULL(funnel_queue_poll(funnel));
+  CU_ASSERT_TRUE(is_ring_queue_empty(ring));
+  UDS_FREE(entries);
+  free_ring_queue(ring);
+  free_funnel_queue(funnel);
+
+  double seconds = (duration > 0) ? duration * 1.0e-9 : 1.0e-9;
+  printf("%-6s %u producers %10lu entries: %5.2fs (%6.1fns/entry,"
+         " %5.2f entries/poll)\n",
+         (useRing ? "ring" : "funnel"), producers, total, seconds,
+         1.0e9 * seconds / total, (double) total / polls);
+}
+
+int main(void)
+{
+  for (unsigned int producers = 1; producers <= MAX_PRODUCERS;
+       producers *= 2) {
+    test(false, producers);
+    test(true, producers);
+  }
+
+  return 0;
+}
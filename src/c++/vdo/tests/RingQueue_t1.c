@@ -0,0 +1,200 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * $Id$
+ */
+
+#include "albtest.h"
+
+#include <linux/cache.h>
+
+#include "memory-alloc.h"
+#include "string-utils.h"
+#include "uds-threads.h"
+
+#include "ring-queue.h"
+
+#include "vdoAsserts.h"
+
+enum {
+  CAPACITY       = 64,
+  BATCH_SIZE     = 16,
+  ITERATIONS     = 200 * 1000,
+  PRODUCER_COUNT = 4,
+  CONSUMER_COUNT = 3,
+};
+
+typedef struct {
+  struct ring_queue *queue;
+  u8                *seen;
+  atomic_t           remaining;
+} SharedState;
+
+/**********************************************************************/
+static inline void assertCacheAligned(const volatile void *address)
+{
+  CU_ASSERT_EQUAL(0, (uintptr_t) address & (L1_CACHE_BYTES - 1));
+}
+
+/**********************************************************************/
+static void testFieldAlignment(void)
+{
+  struct ring_queue *queue;
+  VDO_ASSERT_SUCCESS(make_ring_queue(CAPACITY, &queue));
+  assertCacheAligned(queue);
+  assertCacheAligned(&queue->put_position);
+  assertCacheAligned(&queue->poll_position);
+  free_ring_queue(queue);
+}
+
+/**********************************************************************/
+static void testBadCapacity(void)
+{
+  struct ring_queue *queue;
+  set_exit_on_assertion_failure(false);
+  CU_ASSERT_NOT_EQUAL(VDO_SUCCESS, make_ring_queue(CAPACITY - 1, &queue));
+  set_exit_on_assertion_failure(true);
+}
+
+/**********************************************************************/
+static void testFillAndDrain(void)
+{
+  struct ring_queue *queue;
+  VDO_ASSERT_SUCCESS(make_ring_queue(CAPACITY, &queue));
+  CU_ASSERT_TRUE(is_ring_queue_empty(queue));
+
+  void *entries[CAPACITY];
+  CU_ASSERT_EQUAL(0, ring_queue_poll_batch(queue, entries, BATCH_SIZE));
+
+  // Go around the ring several times to exercise the lap handling.
+  for (uintptr_t lap = 0; lap < 4; lap++) {
+    for (uintptr_t i = 1; i <= CAPACITY; i++) {
+      CU_ASSERT_TRUE(ring_queue_put(queue, (void *) ((lap * CAPACITY) + i)));
+    }
+
+    CU_ASSERT_FALSE(is_ring_queue_empty(queue));
+    CU_ASSERT_FALSE(ring_queue_put(queue, (void *) 1));
+
+    // Drain in batches, which must preserve the order of the puts.
+    uintptr_t expected = (lap * CAPACITY) + 1;
+    unsigned int count;
+    while ((count = ring_queue_poll_batch(queue, entries, BATCH_SIZE)) > 0) {
+      CU_ASSERT_TRUE(count <= BATCH_SIZE);
+      for (unsigned int i = 0; i < count; i++) {
+        CU_ASSERT_PTR_EQUAL((void *) expected++, entries[i]);
+      }
+    }
+
+    CU_ASSERT_EQUAL(((lap + 1) * CAPACITY) + 1, expected);
+    CU_ASSERT_TRUE(is_ring_queue_empty(queue));
+  }
+
+  // A partial batch takes only what is there.
+  CU_ASSERT_TRUE(ring_queue_put(queue, (void *) 1));
+  CU_ASSERT_TRUE(ring_queue_put(queue, (void *) 2));
+  CU_ASSERT_EQUAL(2, ring_queue_poll_batch(queue, entries, BATCH_SIZE));
+  CU_ASSERT_EQUAL(0, ring_queue_poll_batch(queue, entries, BATCH_SIZE));
+  free_ring_queue(queue);
+}
+
+/**
+ * Put the values 1 .. ITERATIONS on a ring, retrying whenever it is full.
+ **/
+static void produce(void *arg)
+{
+  SharedState *state = arg;
+  for (uintptr_t i = 1; i <= ITERATIONS; i++) {
+    while (!ring_queue_put(state->queue, (void *) i)) {
+      cond_resched();
+    }
+  }
+}
+
+/**
+ * Take batches from a ring until every produced entry has been consumed,
+ * counting the values seen.
+ **/
+static void consume(void *arg)
+{
+  SharedState *state = arg;
+  void *entries[BATCH_SIZE];
+  while (atomic_read(&state->remaining) > 0) {
+    unsigned int count = ring_queue_poll_batch(state->queue, entries,
+                                               BATCH_SIZE);
+    if (count == 0) {
+      cond_resched();
+      continue;
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+      // Every producer puts the same values, so several consumers may be
+      // counting the same value at once.
+      __atomic_fetch_add(&state->seen[(uintptr_t) entries[i] - 1], 1,
+                         __ATOMIC_RELAXED);
+    }
+
+    atomic_add(-count, &state->remaining);
+  }
+}
+
+/**
+ * Exercise several producers and several consumers on a ring small enough
+ * that the producers will often find it full.
+ **/
+static void testManyProducersManyConsumers(void)
+{
+  SharedState state;
+  VDO_ASSERT_SUCCESS(make_ring_queue(CAPACITY, &state.queue));
+  VDO_ASSERT_SUCCESS(UDS_ALLOCATE(ITERATIONS, u8, __func__, &state.seen));
+  atomic_set(&state.remaining, ITERATIONS * PRODUCER_COUNT);
+
+  struct thread *threads[PRODUCER_COUNT + CONSUMER_COUNT];
+  for (unsigned int i = 0; i < PRODUCER_COUNT + CONSUMER_COUNT; i++) {
+    bool producer = (i < PRODUCER_COUNT);
+    char name[16];
+    VDO_ASSERT_SUCCESS(uds_fixed_sprintf(name, sizeof(name), "%s%u",
+                                         (producer ? "producer" : "consumer"),
+                                         i));
+    VDO_ASSERT_SUCCESS(uds_create_thread((producer ? produce : consume),
+                                         &state, name, &threads[i]));
+  }
+
+  for (unsigned int i = 0; i < PRODUCER_COUNT + CONSUMER_COUNT; i++) {
+    uds_join_threads(threads[i]);
+  }
+
+  // Every value must have been seen once per producer.
+  for (unsigned int i = 0; i < ITERATIONS; i++) {
+    CU_ASSERT_EQUAL(PRODUCER_COUNT, state.seen[i]);
+  }
+
+  CU_ASSERT_TRUE(is_ring_queue_empty(state.queue));
+  UDS_FREE(state.seen);
+  free_ring_queue(state.queue);
+}
+
+/**********************************************************************/
+
+static CU_TestInfo ringQueueTests[] = {
+  { "field alignment",                 testFieldAlignment             },
+  { "capacity must be a power of two", testBadCapacity                },
+  { "fill and drain",                  testFillAndDrain               },
+  { "many producers, many consumers",  testManyProducersManyConsumers },
+  CU_TEST_INFO_NULL,
+};
+
+static CU_SuiteInfo ringQueueSuite = {
+  .name                     = "Ring queue tests (RingQueue_t1)",
+  .initializerWithArguments = NULL,
+  .initializer              = NULL,
+  .cleaner                  = NULL,
+  .tests                    = ringQueueTests,
+};
+
+/**********************************************************************/
+CU_SuiteInfo *initializeModule(void)
+{
+  return &ringQueueSuite;
+}
@@ -0,0 +1,260 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * $Id$
+ */
+
+#include "albtest.h"
+
+#include "encodings.h"
+#include "logical-zone.h"
+#include "physical-zone.h"
+#include "slab-depot.h"
+#include "statistics.h"
+#include "vdo.h"
+
+#include "blockMapUtils.h"
+#include "ioRequest.h"
+#include "vdoAsserts.h"
+#include "vdoTestBase.h"
+
+enum {
+  EXTENT_SIZE          = 16,
+  // The number of allocations a logical zone makes from each physical zone,
+  // from logical-zone.c.
+  ALLOCATIONS_PER_ZONE = 128,
+  // The first extent window in the second block map page, which is in the
+  // other logical zone.
+  OTHER_STREAM         = ((VDO_BLOCK_MAP_ENTRIES_PER_PAGE / EXTENT_SIZE) + 1)
+                          * EXTENT_SIZE,
+  // The first LBN of the third block map page, which is in the first logical
+  // zone again.
+  SCATTER_START        = 2 * VDO_BLOCK_MAP_ENTRIES_PER_PAGE,
+  // Writes this far apart never continue a stream.
+  SCATTER_STRIDE       = (2 * EXTENT_SIZE) + 5,
+};
+
+static TestParameters parameters = {
+  .mappableBlocks       = 512,
+  .logicalBlocks        = 4096,
+  .slabSize             = 256,
+  .logicalThreadCount   = 2,
+  .physicalThreadCount  = 1,
+  .disableDeduplication = true,
+  .allocationExtent     = EXTENT_SIZE,
+};
+
+/**
+ * Test-specific initialization.
+ **/
+static void initializeSequentialAllocationT1(void)
+{
+  initializeVDOTest(&parameters);
+}
+
+/**
+ * Get the block allocator statistics.
+ **/
+static struct block_allocator_statistics getAllocatorStatistics(void)
+{
+  struct vdo_statistics stats;
+  vdo_fetch_statistics(vdo, &stats);
+  return stats.allocator;
+}
+
+/**
+ * Check that a range of logical blocks is mapped to consecutive physical
+ * blocks.
+ *
+ * @param start  The first logical block of the range
+ * @param count  The number of blocks in the range
+ **/
+static void assertContiguous(logical_block_number_t start, block_count_t count)
+{
+  physical_block_number_t pbn = lookupLBN(start).pbn;
+  for (block_count_t i = 1; i < count; i++) {
+    CU_ASSERT_EQUAL(pbn + i, lookupLBN(start + i).pbn);
+  }
+}
+
+/**
+ * Get the nth of a sequence of logical blocks none of which continues a
+ * stream.
+ **/
+static logical_block_number_t getScatteredLBN(block_count_t n)
+{
+  return (SCATTER_START
+          + ((n * SCATTER_STRIDE) % (parameters.logicalBlocks - SCATTER_START)));
+}
+
+/**
+ * Test that sequential streams written concurrently from two logical zones
+ * are each laid out contiguously, even though the data_vios of each write
+ * may reach the allocator in any order.
+ **/
+static void testInterleavedStreams(void)
+{
+  // Move the other zone to the start of its stream.
+  writeData(OTHER_STREAM - 1, OTHER_STREAM, 1, VDO_SUCCESS);
+
+  struct block_allocator_statistics before = getAllocatorStatistics();
+  block_count_t writeSize = EXTENT_SIZE / 2;
+  for (block_count_t i = 0; i < 2 * EXTENT_SIZE; i += writeSize) {
+    writeData(i, i + 1, writeSize, VDO_SUCCESS);
+    writeData(OTHER_STREAM + i, OTHER_STREAM + i + 1, writeSize, VDO_SUCCESS);
+  }
+
+  verifyData(0, 1, 2 * EXTENT_SIZE);
+  verifyData(OTHER_STREAM, OTHER_STREAM + 1, 2 * EXTENT_SIZE);
+  assertContiguous(0, EXTENT_SIZE);
+  assertContiguous(EXTENT_SIZE, EXTENT_SIZE);
+  assertContiguous(OTHER_STREAM, EXTENT_SIZE);
+  assertContiguous(OTHER_STREAM + EXTENT_SIZE, EXTENT_SIZE);
+
+  // The data_vio which reserves each extent takes its own block directly.
+  struct block_allocator_statistics after = getAllocatorStatistics();
+  CU_ASSERT_EQUAL(before.extents_reserved + 4, after.extents_reserved);
+  CU_ASSERT_EQUAL(before.extent_blocks_allocated + (4 * (EXTENT_SIZE - 1)),
+                  after.extent_blocks_allocated);
+}
+
+/**
+ * Test that a stream which starts in the middle of an extent window is laid
+ * out contiguously across windows.
+ **/
+static void testUnalignedStream(void)
+{
+  struct block_allocator_statistics before = getAllocatorStatistics();
+  block_count_t start = EXTENT_SIZE / 4;
+  writeData(start, 1, EXTENT_SIZE - start, VDO_SUCCESS);
+  writeData(EXTENT_SIZE, EXTENT_SIZE - start + 1, EXTENT_SIZE, VDO_SUCCESS);
+  verifyData(start, 1, (2 * EXTENT_SIZE) - start);
+  assertContiguous(start, (2 * EXTENT_SIZE) - start);
+
+  // The blocks before the start of the stream were reserved for the start of
+  // its first window, and returned when the stream moved on.
+  struct block_allocator_statistics after = getAllocatorStatistics();
+  CU_ASSERT_EQUAL(before.extents_reserved + 2, after.extents_reserved);
+  CU_ASSERT_EQUAL(before.extent_blocks_allocated
+                  + (EXTENT_SIZE - start - 1) + (EXTENT_SIZE - 1),
+                  after.extent_blocks_allocated);
+}
+
+/**
+ * Test that the unused blocks of an extent are freed by a suspend.
+ **/
+static void testSuspendReturnsReservations(void)
+{
+  block_count_t written = EXTENT_SIZE / 4;
+  writeData(0, 1, written, VDO_SUCCESS);
+  assertContiguous(0, written);
+  block_count_t freeBlocks = getPhysicalBlocksFree();
+
+  performSuccessfulSuspendAndResume(false);
+  CU_ASSERT_EQUAL(freeBlocks + EXTENT_SIZE - written, getPhysicalBlocksFree());
+  verifyData(0, 1, written);
+
+  // The stream continues into the next window after the resume.
+  writeData(EXTENT_SIZE, EXTENT_SIZE + 1, EXTENT_SIZE, VDO_SUCCESS);
+  verifyData(EXTENT_SIZE, EXTENT_SIZE + 1, EXTENT_SIZE);
+  assertContiguous(EXTENT_SIZE, EXTENT_SIZE);
+}
+
+/**
+ * Test that reserved blocks are used once nothing else is free.
+ **/
+static void testReservationsUsedWhenFull(void)
+{
+  // Start a stream, leaving most of its extent reserved.
+  writeData(0, 1, 2, VDO_SUCCESS);
+
+  // Fill the rest of the VDO without starting another stream.
+  block_count_t scattered = 0;
+  while (getPhysicalBlocksFree() > 0) {
+    writeData(getScatteredLBN(scattered), getScatteredLBN(scattered), 1,
+              VDO_SUCCESS);
+    scattered++;
+  }
+
+  // Both of these writes need the blocks reserved for the stream, so the
+  // first one returns the rest of the extent.
+  writeData(getScatteredLBN(scattered), getScatteredLBN(scattered), 1,
+            VDO_SUCCESS);
+  writeData(2, 3, 1, VDO_SUCCESS);
+  verifyData(0, 1, 3);
+  for (block_count_t i = 0; i <= scattered; i++) {
+    verifyData(getScatteredLBN(i), getScatteredLBN(i), 1);
+  }
+
+  CU_ASSERT_EQUAL(EXTENT_SIZE - 4, getPhysicalBlocksFree());
+}
+
+/**
+ * Check that the first physical zone holds no reserved blocks for the first
+ * logical zone.
+ *
+ * <p>Implements vdo_action.
+ **/
+static void assertExtentReleased(struct vdo_completion *completion)
+{
+  CU_ASSERT_EQUAL(0, vdo->physical_zones->zones[0].extents[0].reserved);
+  vdo_complete_completion(completion);
+}
+
+/**
+ * Test that a logical zone returns its reserved blocks when it moves on to
+ * allocate from another physical zone.
+ **/
+static void testZoneSwitchReturnsReservations(void)
+{
+  tearDownVDOTest();
+  parameters.physicalThreadCount = 2;
+  initializeVDOTest(&parameters);
+  parameters.physicalThreadCount = 1;
+
+  struct logical_zone *zone = &vdo->logical_zones->zones[0];
+  struct physical_zone *physicalZone = &vdo->physical_zones->zones[0];
+  zone->allocation_zone  = physicalZone;
+  zone->allocation_count = 0;
+
+  block_count_t written = EXTENT_SIZE / 4;
+  writeData(0, 1, written, VDO_SUCCESS);
+  CU_ASSERT_PTR_EQUAL(physicalZone, zone->allocation_zone);
+  CU_ASSERT_NOT_EQUAL(0, physicalZone->extents[0].reserved);
+
+  // The next allocation comes from the other physical zone.
+  zone->allocation_count = ALLOCATIONS_PER_ZONE;
+  writeData(getScatteredLBN(0), getScatteredLBN(0), 1, VDO_SUCCESS);
+  CU_ASSERT_PTR_EQUAL(physicalZone->next, zone->allocation_zone);
+
+  // The release was queued on the old zone before the write was acknowledged.
+  performSuccessfulActionOnThread(assertExtentReleased, physicalZone->thread_id);
+  verifyData(0, 1, written);
+  verifyData(getScatteredLBN(0), getScatteredLBN(0), 1);
+}
+
+/**********************************************************************/
+
+static CU_TestInfo tests[] = {
+  { "interleaved streams are contiguous",   testInterleavedStreams            },
+  { "unaligned stream is contiguous",       testUnalignedStream               },
+  { "suspend returns reserved blocks",      testSuspendReturnsReservations    },
+  { "reserved blocks are used when full",   testReservationsUsedWhenFull      },
+  { "zone switch returns reserved blocks",  testZoneSwitchReturnsReservations },
+  CU_TEST_INFO_NULL,
+};
+
+static CU_SuiteInfo suite = {
+  .name                     = "Sequential allocation tests (SequentialAllocation_t1)",
+  .initializerWithArguments = NULL,
+  .initializer              = initializeSequentialAllocationT1,
+  .cleaner                  = tearDownVDOTest,
+  .tests                    = tests,
+};
+
+CU_SuiteInfo *initializeModule(void)
+{
+  return &suite;
+}
@@ -0,0 +1,163 @@
+/*
+ * %COPYRIGHT%
+ *
+ * %LICENSE%
+ *
+ * $Id$
+ */
+
+#include "albtest.h"
+
+#include "slab-depot.h"
+#include "slab-journal.h"
+#include "statistics.h"
+#include "vdo.h"
+
+#include "ioRequest.h"
+#include "vdoAsserts.h"
+#include "vdoTestBase.h"
+
+enum {
+  BLOCK_COUNT = 16,
+  MAX_SLABS   = 64,
+};
+
+static struct journal_point tails[MAX_SLABS];
+
+/**
+ * Test-specific initialization.
+ **/
+static void initializeSlabJournalCoalescingT1(void)
+{
+  const TestParameters parameters = {
+    .mappableBlocks      = 256,
+    .logicalBlocks       = 512,
+    .journalBlocks       = 16,
+    .slabSize            = 64,
+    .physicalThreadCount = 1,
+  };
+  initializeVDOTest(&parameters);
+}
+
+/**
+ * Get the number of slab journal entries which have been coalesced.
+ **/
+static u64 getEntriesCoalesced(void)
+{
+  struct vdo_statistics stats;
+  vdo_fetch_statistics(vdo, &stats);
+  return stats.slab_journal.entries_coalesced;
+}
+
+/**
+ * Record the tail of every slab journal.
+ **/
+static void recordJournalTails(void)
+{
+  CU_ASSERT(vdo->depot->slab_count <= MAX_SLABS);
+  for (slab_count_t i = 0; i < vdo->depot->slab_count; i++) {
+    struct slab_journal *journal = vdo->depot->slabs[i]->journal;
+    tails[i] = (struct journal_point) {
+      .sequence_number = journal->tail,
+      .entry_count     = journal->tail_header.entry_count,
+    };
+  }
+}
+
+/**
+ * Check that no slab journal has had an entry added since the tails were
+ * recorded.
+ **/
+static void assertJournalTailsUnchanged(void)
+{
+  for (slab_count_t i = 0; i < vdo->depot->slab_count; i++) {
+    struct slab_journal *journal = vdo->depot->slabs[i]->journal;
+    CU_ASSERT_EQUAL(tails[i].sequence_number, journal->tail);
+    CU_ASSERT_EQUAL(tails[i].entry_count, journal->tail_header.entry_count);
+  }
+}
+
+/**
+ * Overwrite the blocks with new data and check that the blocks they had
+ * been mapped to are freed, which they will be only if their reference counts
+ * are still correct.
+ **/
+static void assertOldBlocksFreed(void)
+{
+  block_count_t freeBlocks = getPhysicalBlocksFree();
+  writeData(0, BLOCK_COUNT + 1, BLOCK_COUNT, VDO_SUCCESS);
+  CU_ASSERT_EQUAL(freeBlocks, getPhysicalBlocksFree());
+  verifyData(0, BLOCK_COUNT + 1, BLOCK_COUNT);
+}
+
+/**
+ * Test that rewriting blocks with the data they already hold makes no slab
+ * journal entries, while other overwrites are journaled as usual.
+ **/
+static void testRewriteSameData(void)
+{
+  writeData(0, 1, BLOCK_COUNT, VDO_SUCCESS);
+  block_count_t freeBlocks = getPhysicalBlocksFree();
+  u64 coalesced = getEntriesCoalesced();
+
+  recordJournalTails();
+  writeData(0, 1, BLOCK_COUNT, VDO_SUCCESS);
+  assertJournalTailsUnchanged();
+  CU_ASSERT_EQUAL(coalesced + (2 * BLOCK_COUNT), getEntriesCoalesced());
+  CU_ASSERT_EQUAL(freeBlocks, getPhysicalBlocksFree());
+  verifyData(0, 1, BLOCK_COUNT);
+
+  // Deduplicating against a block mapped from a different logical block
+  // changes two reference counts, so nothing is coalesced.
+  coalesced = getEntriesCoalesced();
+  writeData(0, 2, 1, VDO_SUCCESS);
+  CU_ASSERT_EQUAL(coalesced, getEntriesCoalesced());
+  CU_ASSERT_EQUAL(freeBlocks + 1, getPhysicalBlocksFree());
+  verifyData(0, 2, 1);
+  verifyData(1, 2, BLOCK_COUNT - 1);
+
+  writeData(0, 1, 1, VDO_SUCCESS);
+  CU_ASSERT_EQUAL(freeBlocks, getPhysicalBlocksFree());
+  assertOldBlocksFreed();
+}
+
+/**
+ * Test that recovery after coalesced rewrites leaves the reference counts
+ * correct.
+ **/
+static void testRecoveryAfterRewrite(void)
+{
+  writeData(0, 1, BLOCK_COUNT, VDO_SUCCESS);
+  block_count_t freeBlocks = getPhysicalBlocksFree();
+  u64 coalesced = getEntriesCoalesced();
+  writeData(0, 1, BLOCK_COUNT, VDO_SUCCESS);
+  CU_ASSERT_EQUAL(coalesced + (2 * BLOCK_COUNT), getEntriesCoalesced());
+
+  crashVDO();
+  startVDO(VDO_DIRTY);
+  waitForRecoveryDone();
+  verifyData(0, 1, BLOCK_COUNT);
+  CU_ASSERT_EQUAL(freeBlocks, getPhysicalBlocksFree());
+  assertOldBlocksFreed();
+}
+
+/**********************************************************************/
+
+static CU_TestInfo tests[] = {
+  { "rewriting the same data makes no entries", testRewriteSameData      },
+  { "recover after coalesced rewrites",          testRecoveryAfterRewrite },
+  CU_TEST_INFO_NULL,
+};
+
+static CU_SuiteInfo suite = {
+  .name                     = "Slab journal entry coalescing tests (SlabJournalCoalescing_t1)",
+  .initializerWithArguments = NULL,
+  .initializer              = initializeSlabJournalCoalescingT1,
+  .cleaner                  = tearDownVDOTest,
+  .tests                    = tests,
+};
+
+CU_SuiteInfo *initializeModule(void)
+{
+  return &suite;
+}
@@ -86,7 +86,8 @@ static void makeAndCheckLayout(void)
   int result
     = vdo_make_partitioned_fixed_layout(physicalSize, LAYOUT_START,
                                         DEFAULT_VDO_BLOCK_MAP_TREE_ROOT_COUNT,
-                                        journalSize, summarySize, &layout);
+                                        journalSize, summarySize, false,
+                                        &layout);
   VDO_ASSERT_SUCCESS(result);
   VDO_ASSERT_SUCCESS(vdo_decode_layout(layout, &vdoLayout));
   checkLayout();
@@ -105,7 +106,7 @@ static void creationTest(void)
   };
 
   struct fixed_layout *layout;
-  VDO_ASSERT_SUCCESS(makeFixedLayoutFromConfig(&config, LAYOUT_START,
+  VDO_ASSERT_SUCCESS(makeFixedLayoutFromConfig(&config, LAYOUT_START, false,
                                                &layout));
   VDO_ASSERT_SUCCESS(vdo_decode_layout(layout, &vdoLayout));
   checkLayout();
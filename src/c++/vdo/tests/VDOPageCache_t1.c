@@ -158,12 +158,15 @@ static void initializeJournalLocks(struct vdo_completion *completion)
 }
 
 /**
- * Initialize test.
+ * Initialize test with a given cache replacement policy.
  *
  * @param cacheSize   The number of pages in the cache
  * @param maximumAge  The maximum age of a dirty page
+ * @param policy      The cache replacement policy
  **/
-static void initialize(page_count_t cacheSize, sequence_number_t maximumAge)
+static void initializeWithPolicy(page_count_t                cacheSize,
+                                 sequence_number_t           maximumAge,
+                                 enum block_map_cache_policy policy)
 {
   TestParameters parameters = {
     .logicalBlocks        = 4096,
@@ -172,6 +175,7 @@ static void initialize(page_count_t cacheSize, sequence_number_t maximumAge)
     .slabSize             = 64,
     .cacheSize            = cacheSize,
     .blockMapMaximumAge   = maximumAge,
+    .cachePolicy          = policy,
     .noIndexRegion        = true,
     .disableDeduplication = true,
   };
@@ -188,6 +192,17 @@ static void initialize(page_count_t cacheSize, sequence_number_t maximumAge)
   performSuccessfulAction(initializeJournalLocks);
 }
 
+/**
+ * Initialize test with the default (LRU) replacement policy.
+ *
+ * @param cacheSize   The number of pages in the cache
+ * @param maximumAge  The maximum age of a dirty page
+ **/
+static void initialize(page_count_t cacheSize, sequence_number_t maximumAge)
+{
+  initializeWithPolicy(cacheSize, maximumAge, VDO_BLOCK_MAP_CACHE_LRU);
+}
+
 /**
  * Default initialization, no hooks, small cache.
  **/
@@ -906,6 +921,76 @@ static void testAgeDirtyPages(void)
   }
 }
 
+/**
+ * Read a page and release it immediately.
+ *
+ * @param pageNumber  The page to read
+ **/
+static void readAndReleasePage(page_number_t pageNumber)
+{
+  TestCompletion completion;
+  initializeTestCompletion(&completion);
+  getReadablePage(pageNumber, &completion);
+  performPageAction(&completion, vdo_release_page_completion);
+}
+
+/**
+ * Interleave references to a small hot set of pages with scans of pages
+ * which are never referenced again, and check how many of the hot set
+ * references hit in the cache once the cache has warmed up.
+ *
+ * @param policy        The cache replacement policy
+ * @param expectedHits  The expected number of hot page hits per round
+ **/
+static void checkScanResistance(enum block_map_cache_policy policy,
+                                u64                         expectedHits)
+{
+  enum {
+    HOT_PAGES     = 2,
+    WARMUP_ROUNDS = 2,
+    ROUNDS        = 8,
+  };
+
+  initializeWithPolicy(LARGE_CACHE_SIZE, 1, policy);
+  page_number_t scanPage = HOT_PAGES;
+  for (unsigned int round = 0; round < ROUNDS; round++) {
+    u64 hits = READ_ONCE(cache->stats.found_in_cache);
+    for (page_number_t i = 0; i < HOT_PAGES; i++) {
+      readAndReleasePage(i);
+    }
+
+    if (round >= WARMUP_ROUNDS) {
+      CU_ASSERT_EQUAL(READ_ONCE(cache->stats.found_in_cache) - hits,
+                      expectedHits);
+    }
+
+    for (page_number_t i = 0; i < LARGE_CACHE_SIZE; i++) {
+      readAndReleasePage(scanPage++);
+    }
+  }
+
+  u64 hits = READ_ONCE(cache->stats.found_in_cache);
+  u64 misses = READ_ONCE(cache->stats.cache_misses);
+  CU_ASSERT_EQUAL(hits + misses, READ_ONCE(cache->stats.read_count));
+  CU_ASSERT_EQUAL(misses, READ_ONCE(cache->stats.fetch_required)
+                  + READ_ONCE(cache->stats.discard_required));
+}
+
+/**********************************************************************/
+static void testLRUScan(void)
+{
+  checkScanResistance(VDO_BLOCK_MAP_CACHE_LRU, 0);
+  CU_ASSERT_EQUAL(READ_ONCE(cache->stats.ghost_hits), 0);
+}
+
+/**********************************************************************/
+static void test2QScan(void)
+{
+  checkScanResistance(VDO_BLOCK_MAP_CACHE_2Q, 2);
+  // The hot pages were protected after being evicted from probation once.
+  CU_ASSERT_EQUAL(READ_ONCE(cache->stats.ghost_hits), 2);
+}
+
 /**********************************************************************/
 
 static CU_TestInfo vdoPageCacheTests[] = {
@@ -914,6 +999,8 @@ static CU_TestInfo vdoPageCacheTests[] = {
   { "busy cache page",     testBusyCachePage },
   { "access mode",         testAccessMode    },
   { "age dirty eras",      testAgeDirtyPages },
+  { "LRU scan",            testLRUScan       },
+  { "2Q scan resistance",  test2QScan        },
   CU_TEST_INFO_NULL,
 };
 
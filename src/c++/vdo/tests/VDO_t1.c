@@ -170,6 +170,31 @@ static void testInFlightDedupe(void)
                   blocksFree);
 }
 
+/**
+ * Test that deduplication works with a volume index in huge pages, and that
+ * a reload can't change whether the index uses them.
+ **/
+static void testHugePageIndex(void)
+{
+  const TestParameters parameters = {
+    .mappableBlocks      = 64,
+    .logicalBlocks       = 128,
+    .journalBlocks       = 16,
+    .dataFormatter       = fillAlternating,
+    .indexHugePages      = true,
+  };
+  initializeVDOTest(&parameters);
+  CU_ASSERT_TRUE(vdo->device_config->index_huge_pages);
+
+  block_count_t blocksFree = populateBlockMapTree();
+  writeAndVerifyData(0, 0, blocksFree, blocksFree - 2, 2);
+  CU_ASSERT_EQUAL(-EINVAL, modifyIndexHugePages(false));
+
+  restartVDO(false);
+  CU_ASSERT_TRUE(vdo->device_config->index_huge_pages);
+  verifyData(0, 0, blocksFree);
+}
+
 /**
  * Fail a data write.
  *
@@ -213,6 +238,7 @@ static void testFailedWrite(void)
 static CU_TestInfo vdoTests[] = {
   { "fill an entire VDO",                      testFill           },
   { "test dedupe of simultaneous requests",    testInFlightDedupe },
+  { "test dedupe with a huge page index",       testHugePageIndex  },
   { "test that a failed write doesn't assert", testFailedWrite    },
   CU_TEST_INFO_NULL
 };
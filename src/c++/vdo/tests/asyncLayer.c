@@ -35,6 +35,7 @@
 #include "callbackWrappingUtils.h"
 #include "mutexUtils.h"
 #include "ramLayer.h"
+#include "testDM.h"
 #include "testPrototypes.h"
 #include "vdoAsserts.h"
 #include "vdoTestBase.h"
@@ -280,7 +281,9 @@ static int processBIO(struct bio *bio)
     return -EROFS;
   }
 
-  PhysicalLayer *ramLayer = getSynchronousLayer();
+  bool toJournalDevice = isJournalDevice(bio->bi_bdev);
+  PhysicalLayer *ramLayer
+    = (toJournalDevice ? getJournalLayer() : getSynchronousLayer());
   if (((bio->bi_opf & REQ_PREFLUSH) == REQ_PREFLUSH)
       || (bio_op(bio) == REQ_OP_FLUSH)) {
     flushRAMLayer(ramLayer);
@@ -290,7 +293,9 @@ static int processBIO(struct bio *bio)
   }
 
   physical_block_number_t pbn = pbn_from_vio_bio(bio);
-  assertNotInIndexRegion(pbn);
+  if (!toJournalDevice) {
+    assertNotInIndexRegion(pbn);
+  }
 
   int result;
   struct vio *vio = bio->bi_private;
@@ -0,0 +1,61 @@
+#ifndef GUARD_dedupe_context_GUARD
+#define GUARD_dedupe_context_GUARD
+#include "dedupe.h"
+#include <linux/atomic.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/kobject.h>
+#include <linux/list.h>
+#include <linux/murmurhash3.h>
+#include <linux/ratelimit.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+#include "logger.h"
+#include "memory-alloc.h"
+#include "numeric.h"
+#include "permassert.h"
+#include "string-utils.h"
+#include "uds.h"
+#include "action-manager.h"
+#include "admin-state.h"
+#include "completion.h"
+#include "constants.h"
+#include "data-vio.h"
+#include "decompression-cache.h"
+#include "io-submitter.h"
+#include "packer.h"
+#include "physical-zone.h"
+#include "pointer-map.h"
+#include "slab-depot.h"
+#include "slab.h"
+#include "statistics.h"
+#include "thread-config.h"
+#include "types.h"
+#include "vdo.h"
+#include "wait-queue.h"
+#ifdef INTERNAL
+#endif /* INTERNAL */
+#ifdef VDO_INTERNAL
+#endif /* VDO_INTERNAL */
+#ifdef INTERNAL
+#endif  /* INTERNAL */
+#ifdef VDO_INTERNAL
+#endif /* VDO_INTERNAL */
+#ifdef __KERNEL__
+#endif // __KERNEL__
+#ifdef __KERNEL__
+#endif // __KERNEL__
+#ifdef INTERNAL
+#endif /* INTERNAL */
+#ifdef INTERNAL
+#endif /* INTERNAL */
+struct dedupe_context {
+	struct hash_zone *zone;
+	struct uds_request request;
+	struct list_head list_entry;
+	struct funnel_queue_entry queue_entry;
+	u64 submission_jiffies;
+	struct data_vio *requestor;
+	atomic_t state;
+};
+#endif /* not GUARD_dedupe_context_GUARD */
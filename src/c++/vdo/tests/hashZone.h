@@ -0,0 +1,98 @@
+#ifndef GUARD_hash_zone_GUARD
+#define GUARD_hash_zone_GUARD
+#include "dedupe.h"
+#include <linux/atomic.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/kobject.h>
+#include <linux/list.h>
+#include <linux/murmurhash3.h>
+#include <linux/ratelimit.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+#include "logger.h"
+#include "memory-alloc.h"
+#include "numeric.h"
+#include "permassert.h"
+#include "string-utils.h"
+#include "uds.h"
+#include "action-manager.h"
+#include "admin-state.h"
+#include "completion.h"
+#include "constants.h"
+#include "data-vio.h"
+#include "decompression-cache.h"
+#include "io-submitter.h"
+#include "packer.h"
+#include "physical-zone.h"
+#include "pointer-map.h"
+#include "slab-depot.h"
+#include "slab.h"
+#include "statistics.h"
+#include "thread-config.h"
+#include "types.h"
+#include "vdo.h"
+#include "wait-queue.h"
+#ifdef INTERNAL
+#endif /* INTERNAL */
+#ifdef VDO_INTERNAL
+#endif /* VDO_INTERNAL */
+#ifdef INTERNAL
+#endif  /* INTERNAL */
+#ifdef VDO_INTERNAL
+#endif /* VDO_INTERNAL */
+#ifdef __KERNEL__
+#endif // __KERNEL__
+#ifdef __KERNEL__
+#endif // __KERNEL__
+#ifdef INTERNAL
+#endif /* INTERNAL */
+#ifdef INTERNAL
+#endif /* INTERNAL */
+struct hash_zone {
+	/* Which hash zone this is */
+	zone_count_t zone_number;
+
+	/* The administrative state of the zone */
+	struct admin_state state;
+
+	/* The thread ID for this zone */
+	thread_id_t thread_id;
+
+	/* Mapping from record name fields to hash_locks */
+	struct pointer_map *hash_lock_map;
+
+	/* List containing all unused hash_locks */
+	struct list_head lock_pool;
+
+	/*
+	 * Statistics shared by all hash locks in this zone. Only modified on the hash zone thread,
+	 * but queried by other threads.
+	 */
+	struct hash_lock_statistics statistics;
+
+	/* Array of all hash_locks */
+	struct hash_lock *lock_array;
+
+	/* These fields are used to manage the dedupe contexts */
+	struct list_head available;
+	struct list_head pending;
+	struct funnel_queue *timed_out_complete;
+	struct timer_list timer;
+	struct vdo_completion completion;
+	unsigned int active;
+	atomic_t timer_state;
+
+	/*
+	 * Index requests which have been prepared but not yet launched, and the completion which
+	 * launches them
+	 */
+	struct uds_request *unlaunched[DEDUPE_LAUNCH_BATCH_SIZE];
+	unsigned int unlaunched_count;
+	struct vdo_completion launcher;
+	bool launch_scheduled;
+
+	/* The dedupe contexts for querying the index from this zone */
+	struct dedupe_context contexts[MAXIMUM_VDO_USER_VIOS];
+};
+#endif /* not GUARD_hash_zone_GUARD */
@@ -0,0 +1,68 @@
+#ifndef GUARD_numbered_block_mapping_GUARD
+#define GUARD_numbered_block_mapping_GUARD
+#include "recovery.h"
+#include "logger.h"
+#include "memory-alloc.h"
+#include "permassert.h"
+#include "block-map.h"
+#include "completion.h"
+#include "constants.h"
+#include "encodings.h"
+#include "heap.h"
+#include "int-map.h"
+#include "io-submitter.h"
+#include "recovery-journal.h"
+#include "ref-counts.h"
+#include "slab-depot.h"
+#include "slab-journal.h"
+#include "slab.h"
+#include "thread-config.h"
+#include "types.h"
+#include "vdo.h"
+#include "wait-queue.h"
+#ifdef INTERNAL
+#endif
+#ifdef VDO_INTERNAL
+#endif /* VDO_INTERNAL */
+struct numbered_block_mapping {
+	struct block_map_slot block_map_slot;
+	struct block_map_entry block_map_entry;
+	/* A serial number to use during replay */
+	u32 number;
+} __packed;
+
+/*
+ * A structure to manage recovering the block map from the recovery journal.
+ *
+ * Note that the page completions kept in this structure are not immediately freed, so the
+ * corresponding pages will be locked down in the page cache until the recovery frees them.
+ */
+struct block_map_recovery_completion {
+	struct vdo_completion completion;
+	/* whether this recovery has been aborted */
+	bool aborted;
+	bool launching;
+
+	/* Fields for the journal entries. */
+	struct numbered_block_mapping *journal_entries;
+	/*
+	 * a heap wrapping journal_entries. It re-orders and sorts journal entries in ascending LBN
+	 * order, then original journal order. This permits efficient iteration over the journal
+	 * entries in order.
+	 */
+	struct heap replay_heap;
+
+	/* Fields tracking progress through the journal entries. */
+
+	struct numbered_block_mapping *current_entry;
+	/* next entry for which the block map page has not been requested */
+	struct numbered_block_mapping *current_unfetched_entry;
+
+	/* Fields tracking requested pages. */
+	/* current page's absolute PBN */
+	physical_block_number_t pbn;
+	page_count_t outstanding;
+	page_count_t page_count;
+	struct vdo_page_completion page_completions[];
+};
+#endif /* not GUARD_numbered_block_mapping_GUARD */
@@ -9,6 +9,8 @@
 #include "packerUtils.h"
 
 #include <linux/lz4.h>
+#include <linux/zstd.h>
+#include <zlib.h>
 
 #include "packer.h"
 #include "vdo.h"
@@ -147,6 +149,20 @@ int LZ4_compress_default(const char *source,
                                            maxOutputSize));
 }
 
+/**
+ * The user space lz4 has no high compression mode, so the fake produces the
+ * ordinary LZ4 encoding, which is the format LZ4HC produces as well.
+ **/
+int LZ4_compress_HC(const char *source,
+                    char *dest,
+                    int isize,
+                    int maxOutputSize,
+                    int compressionLevel __attribute__((unused)),
+                    void *context)
+{
+  return LZ4_compress_default(source, dest, isize, maxOutputSize, context);
+}
+
 /**********************************************************************/
 int LZ4_decompress_safe(const char *source,
                         char *dest,
@@ -159,6 +175,90 @@ int LZ4_decompress_safe(const char *source,
                                           maxOutputSize);
 }
 
+/**
+ * There is no user space zstd, so the fake zstd is zlib at its fastest level.
+ * Its fragments are only ever read back by the fake.
+ **/
+zstd_parameters zstd_get_params(int level,
+                                unsigned long long estimatedSourceSize
+                                __attribute__((unused)))
+{
+  return (zstd_parameters) {
+    .cParams = {
+      .level = level,
+    },
+  };
+}
+
+/**********************************************************************/
+size_t zstd_cctx_workspace_bound(const zstd_compression_parameters *parameters
+                                 __attribute__((unused)))
+{
+  return sizeof(int);
+}
+
+/**********************************************************************/
+zstd_cctx *zstd_init_cctx(void *workspace,
+                          size_t workspaceSize __attribute__((unused)))
+{
+  return workspace;
+}
+
+/**********************************************************************/
+size_t zstd_compress_cctx(zstd_cctx *cctx __attribute__((unused)),
+                          void *dest,
+                          size_t destCapacity,
+                          const void *source,
+                          size_t sourceSize,
+                          const zstd_parameters *parameters
+                          __attribute__((unused)))
+{
+  if (READ_ONCE(packingPrevented)) {
+    return (size_t) -1;
+  }
+
+  uLongf size = destCapacity;
+  if (compress2(dest, &size, source, sourceSize, Z_BEST_SPEED) != Z_OK) {
+    return (size_t) -1;
+  }
+
+  return size;
+}
+
+/**********************************************************************/
+size_t zstd_dctx_workspace_bound(void)
+{
+  return sizeof(int);
+}
+
+/**********************************************************************/
+zstd_dctx *zstd_init_dctx(void *workspace,
+                          size_t workspaceSize __attribute__((unused)))
+{
+  return workspace;
+}
+
+/**********************************************************************/
+size_t zstd_decompress_dctx(zstd_dctx *dctx __attribute__((unused)),
+                            void *dest,
+                            size_t destCapacity,
+                            const void *source,
+                            size_t sourceSize)
+{
+  uLongf size = destCapacity;
+  if (uncompress(dest, &size, source, sourceSize) != Z_OK) {
+    return (size_t) -1;
+  }
+
+  return size;
+}
+
+/**********************************************************************/
+unsigned int zstd_is_error(size_t code)
+{
+  return (code == (size_t) -1);
+}
+
 /**********************************************************************/
 void preventPacking(void)
 {
@@ -9,6 +9,7 @@
 #include <linux/blkdev.h>
 #include <linux/device-mapper.h>
 #include <linux/kernel.h>
+#include <string.h>
 
 #include "memory-alloc.h"
 
@@ -21,22 +22,43 @@
 /* Fake implementations of functions declared in device-mapper.h. */
 
 static struct dm_dev dmDev;
+static struct dm_dev journalDev;
+
+/**********************************************************************/
+static void tearDownDMDev(struct dm_dev *dev)
+{
+  UDS_FREE(dev->bdev->bd_inode);
+  UDS_FREE(UDS_FORGET(dev->bdev));
+}
 
 /**********************************************************************/
 static void tearDownDM(void)
 {
-  UDS_FREE(dmDev.bdev->bd_inode);
-  UDS_FREE(UDS_FORGET(dmDev.bdev));
+  tearDownDMDev(&dmDev);
+  tearDownDMDev(&journalDev);
+}
+
+/**********************************************************************/
+static void initializeDMDev(struct dm_dev *dev)
+{
+  VDO_ASSERT_SUCCESS(UDS_ALLOCATE(1, struct block_device, __func__, &dev->bdev));
+  VDO_ASSERT_SUCCESS(UDS_ALLOCATE(1, struct inode, __func__, &dev->bdev->bd_inode));
 }
 
 /**********************************************************************/
 void initializeDM(void)
 {
-  VDO_ASSERT_SUCCESS(UDS_ALLOCATE(1, struct block_device, __func__, &dmDev.bdev));
-  VDO_ASSERT_SUCCESS(UDS_ALLOCATE(1, struct inode, __func__, &dmDev.bdev->bd_inode));
+  initializeDMDev(&dmDev);
+  initializeDMDev(&journalDev);
   registerTearDownAction(tearDownDM);
 }
 
+/**********************************************************************/
+bool isJournalDevice(struct block_device *bdev)
+{
+  return (bdev == journalDev.bdev);
+}
+
 /**********************************************************************/
 fmode_t dm_table_get_mode(struct dm_table *t __attribute__((unused)))
 {
@@ -68,16 +90,21 @@ const char *dm_shift_arg(struct dm_arg_set *as)
 
 /**********************************************************************/
 int dm_get_device(struct dm_target *ti __attribute__((unused)),
-                  const char *path __attribute__((unused)),
+                  const char *path,
                   fmode_t mode __attribute__((unused)),
 		  struct dm_dev **result)
 {
-  *result = &dmDev;
+  if ((path != NULL) && (strcmp(path, TEST_JOURNAL_DEVICE_NAME) == 0)) {
+    *result = &journalDev;
+  } else {
+    *result = &dmDev;
+  }
+
   return VDO_SUCCESS;
 }
 
 /**********************************************************************/
 void dm_put_device(struct dm_target *ti __attribute__((unused)), struct dm_dev *d)
 {
-  CU_ASSERT_PTR_EQUAL(d, &dmDev);
+  CU_ASSERT((d == &dmDev) || (d == &journalDev));
 }
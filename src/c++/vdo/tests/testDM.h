@@ -9,10 +9,25 @@
 #ifndef TEST_DM_H
 #define TEST_DM_H
 
+#include <linux/blkdev.h>
+
+/** The device name which dm_get_device() maps to the fake journal device */
+#define TEST_JOURNAL_DEVICE_NAME "test journal device name"
+
 /**
  * Initialize the fake DM subsystem. This function should only be called from
  * initializeVDOTestBase().
  **/
 void initializeDM(void);
 
+/**
+ * Check whether a block device is the fake journal device.
+ *
+ * @param bdev  The block device to check
+ *
+ * @return <code>true</code> if the device is the journal device
+ **/
+bool isJournalDevice(struct block_device *bdev)
+  __attribute__((warn_unused_result));
+
 #endif // TEST_DM_H
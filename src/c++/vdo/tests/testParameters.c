@@ -17,6 +17,7 @@
 #include "slab-depot.h"
 #include "thread-config.h"
 #include "types.h"
+#include "vdo-layout.h"
 #include "volume-geometry.h"
 
 #include "dataBlocks.h"
@@ -33,6 +34,7 @@ static const TestParameters DEFAULT_PARAMETERS = {
   .mappableBlocks       = 256,
   .cacheSize            = 4,
   .blockMapMaximumAge   = 0,    // computed (2)
+  .cachePolicy          = VDO_BLOCK_MAP_CACHE_LRU,
   .slabSize             = 0,    // computed (16)
   .slabCount            = 16,
   .slabJournalBlocks    = 2,
@@ -43,8 +45,14 @@ static const TestParameters DEFAULT_PARAMETERS = {
   .synchronousStorage   = false,
   .dataFormatter        = fillWithOffset,
   .enableCompression    = false,
+  .compressionType      = VDO_COMPRESSION_LZ4,
+  .packerLookahead      = false,
+  .journalCommitWindow  = 0,
+  .allocationExtent     = 0,
   .disableDeduplication = false,
+  .indexHugePages       = false,
   .noIndexRegion        = false,
+  .useJournalDevice     = false,
   .backingFile          = NULL,
 };
 
@@ -86,6 +94,10 @@ static TestParameters applyDefaults(const TestParameters *parameters)
     applied.blockMapMaximumAge = parameters->blockMapMaximumAge;
   }
 
+  if (parameters->cachePolicy != VDO_BLOCK_MAP_CACHE_LRU) {
+    applied.cachePolicy = parameters->cachePolicy;
+  }
+
   // If slab size is specified, don't default the slab count
   if (parameters->slabSize != 0) {
     applied.slabSize  = parameters->slabSize;
@@ -125,10 +137,30 @@ static TestParameters applyDefaults(const TestParameters *parameters)
     applied.enableCompression = parameters->enableCompression;
   }
 
+  if (parameters->compressionType != applied.compressionType) {
+    applied.compressionType = parameters->compressionType;
+  }
+
+  if (parameters->packerLookahead != applied.packerLookahead) {
+    applied.packerLookahead = parameters->packerLookahead;
+  }
+
+  if (parameters->journalCommitWindow != applied.journalCommitWindow) {
+    applied.journalCommitWindow = parameters->journalCommitWindow;
+  }
+
+  if (parameters->allocationExtent != applied.allocationExtent) {
+    applied.allocationExtent = parameters->allocationExtent;
+  }
+
   if (parameters->disableDeduplication != applied.disableDeduplication) {
     applied.disableDeduplication = parameters->disableDeduplication;
   }
 
+  if (parameters->indexHugePages) {
+    applied.indexHugePages = true;
+  }
+
   if (parameters->synchronousStorage) {
     applied.synchronousStorage = true;
   }
@@ -140,6 +172,10 @@ static TestParameters applyDefaults(const TestParameters *parameters)
     applied.disableDeduplication = true;
   }
 
+  if (parameters->useJournalDevice) {
+    applied.useJournalDevice = true;
+  }
+
   if (parameters->backingFile) {
     applied.backingFile = parameters->backingFile;
   }
@@ -324,6 +360,12 @@ TestConfiguration makeTestConfiguration(const TestParameters *parameters)
     VDO_ASSERT_SUCCESS(vdo_compute_index_blocks(&indexConfig, &indexBlocks));
   }
 
+  block_count_t journalDeviceBlocks = 0;
+  if (params.useJournalDevice) {
+    journalDeviceBlocks = (VDO_JOURNAL_DEVICE_LAYOUT_START
+                           + params.journalBlocks + VDO_SLAB_SUMMARY_BLOCKS);
+  }
+
   TestConfiguration configuration = (TestConfiguration) {
     .config             = (struct vdo_config) {
       .logical_blocks        = params.logicalBlocks,
@@ -335,6 +377,7 @@ TestConfiguration makeTestConfiguration(const TestParameters *parameters)
     .deviceConfig       = (struct device_config) {
       .cache_size            = params.cacheSize,
       .block_map_maximum_age = params.blockMapMaximumAge,
+      .cache_policy          = params.cachePolicy,
       .thread_counts         = (struct thread_count_config) {
         .logical_zones         = params.logicalThreadCount,
         .physical_zones        = params.physicalThreadCount,
@@ -350,11 +393,17 @@ TestConfiguration makeTestConfiguration(const TestParameters *parameters)
       .logical_block_size = VDO_BLOCK_SIZE,
       .physical_blocks    = params.physicalBlocks + indexBlocks,
       .compression        = params.enableCompression,
+      .compression_type   = params.compressionType,
+      .packer_lookahead   = params.packerLookahead,
+      .journal_commit_window = params.journalCommitWindow,
+      .allocation_extent  = params.allocationExtent,
       .deduplication      = !params.disableDeduplication,
+      .index_huge_pages   = params.indexHugePages,
     },
     .indexConfig         = indexConfig,
     .indexRegionStart    = 1,
     .vdoRegionStart      = indexBlocks + 1,
+    .journalDeviceBlocks = journalDeviceBlocks,
     .synchronousStorage  = params.synchronousStorage,
     .dataFormatter       = params.dataFormatter,
     .backingFile         = params.backingFile,
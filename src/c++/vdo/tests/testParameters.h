@@ -42,6 +42,8 @@ typedef struct testParameters {
   page_count_t              cacheSize;
   /** How fast to write dirty pages out */
   block_count_t             blockMapMaximumAge;
+  /** The block map cache replacement policy */
+  enum block_map_cache_policy cachePolicy;
   /** How many block entries per slab */
   block_count_t             slabSize;
   /** How many slabs */
@@ -66,10 +68,22 @@ typedef struct testParameters {
   DataFormatter            *dataFormatter;
   /** Whether compression should be enabled */
   bool                      enableCompression;
+  /** The compressor to use when compression is enabled */
+  enum vdo_compression_type compressionType;
+  /** Whether the packer should pack from a look-ahead window */
+  bool                      packerLookahead;
+  /** How long the journal may hold a partial block, in milliseconds */
+  unsigned int              journalCommitWindow;
+  /** How many blocks to reserve for a sequential stream of writes */
+  unsigned int              allocationExtent;
   /** Whether deduplication should be enabled */
   bool                      disableDeduplication;
+  /** Whether the index should back its volume index with huge pages */
+  bool                      indexHugePages;
   /** Whether physicalBlocks should include an index region */
   bool                      noIndexRegion;
+  /** Whether to put the recovery journal and slab summary on a journal device */
+  bool                      useJournalDevice;
   /** The backing file from which to initially load the RAMLayer (if not NULL) */
   const char               *backingFile;
 } TestParameters;
@@ -83,6 +97,7 @@ struct testConfiguration {
   struct index_config      indexConfig;
   physical_block_number_t  indexRegionStart;
   physical_block_number_t  vdoRegionStart;
+  block_count_t            journalDeviceBlocks;
   bool                     synchronousStorage;
   DataFormatter           *dataFormatter;
   const char              *backingFile;
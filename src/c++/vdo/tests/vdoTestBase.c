@@ -55,6 +55,7 @@ struct tearDownItem {
 };
 
 static PhysicalLayer      *synchronousLayer;
+static PhysicalLayer      *journalLayer;
 static bool                inRecovery;
 static TearDownItem       *tearDownItems = NULL;
 static TestConfiguration   configuration;
@@ -132,12 +133,26 @@ PhysicalLayer *getSynchronousLayer(void)
   return synchronousLayer;
 }
 
+/**********************************************************************/
+PhysicalLayer *getJournalLayer(void)
+{
+  return journalLayer;
+}
+
 /**********************************************************************/
 void formatTestVDO(void)
 {
   struct index_config *indexConfig = ((configuration.indexConfig.mem == 0)
                                       ? NULL
                                       : &configuration.indexConfig);
+  if (journalLayer != NULL) {
+    VDO_ASSERT_SUCCESS(formatVDOWithJournalDevice(&configuration.config,
+                                                  indexConfig,
+                                                  synchronousLayer,
+                                                  journalLayer));
+    return;
+  }
+
   VDO_ASSERT_SUCCESS(formatVDO(&configuration.config,
                                indexConfig,
                                synchronousLayer));
@@ -221,8 +236,15 @@ void crashVDO(void)
   vdo_launch_flush(vdo, flushBIO);
   waitForStateAndClear(&flushDone);
   prepareToCrashRAMLayer(synchronousLayer);
+  if (journalLayer != NULL) {
+    prepareToCrashRAMLayer(journalLayer);
+  }
+
   stopVDO();
   crashRAMLayer(synchronousLayer);
+  if (journalLayer != NULL) {
+    crashRAMLayer(journalLayer);
+  }
 }
 
 /**********************************************************************/
@@ -296,6 +318,12 @@ void initializeTest(const TestParameters *parameters)
                                     !configuration.synchronousStorage,
                                     &synchronousLayer));
   }
+  if (configuration.journalDeviceBlocks > 0) {
+    VDO_ASSERT_SUCCESS(makeRAMLayer(configuration.journalDeviceBlocks,
+                                    !configuration.synchronousStorage,
+                                    &journalLayer));
+  }
+
   initializeAsyncLayer(synchronousLayer);
   clearHooks();
   initializeDataBlocks(configuration.dataFormatter);
@@ -349,6 +377,10 @@ void tearDownVDOTest(void)
     synchronousLayer->destroy(&synchronousLayer);
   }
 
+  if (journalLayer != NULL) {
+    journalLayer->destroy(&journalLayer);
+  }
+
   tearDownDataBlocks();
 
   /*
@@ -621,10 +653,46 @@ static int makeTableLine(TestConfiguration configuration, char **argv)
   addString(&argv[argc++],
             (configuration.deviceConfig.deduplication ? "on" : "off"));
 
+  if (configuration.deviceConfig.index_huge_pages) {
+    addString(&argv[argc++], "indexHugePages");
+    addString(&argv[argc++], "on");
+  }
+
   addString(&argv[argc++], "compression");
   addString(&argv[argc++],
             (configuration.deviceConfig.compression ? "on" : "off"));
 
+  addString(&argv[argc++], "compressionType");
+  addString(&argv[argc++],
+            vdo_get_compression_type_name(configuration.deviceConfig.compression_type));
+
+  addString(&argv[argc++], "packerLookahead");
+  addString(&argv[argc++],
+            (configuration.deviceConfig.packer_lookahead ? "on" : "off"));
+
+  if (configuration.deviceConfig.journal_commit_window > 0) {
+    addString(&argv[argc++], "journalCommitWindow");
+    addUInt32(&argv[argc++], configuration.deviceConfig.journal_commit_window);
+  }
+
+  if (configuration.deviceConfig.allocation_extent > 0) {
+    addString(&argv[argc++], "allocationExtent");
+    addUInt32(&argv[argc++], configuration.deviceConfig.allocation_extent);
+  }
+
+  if (configuration.journalDeviceBlocks > 0) {
+    addString(&argv[argc++], "journalDevice");
+    addString(&argv[argc++],
+              ((configuration.deviceConfig.journal_device_name == NULL)
+               ? TEST_JOURNAL_DEVICE_NAME
+               : configuration.deviceConfig.journal_device_name));
+  }
+
+  addString(&argv[argc++], "blockMapCachePolicy");
+  addString(&argv[argc++],
+            ((configuration.deviceConfig.cache_policy == VDO_BLOCK_MAP_CACHE_2Q)
+             ? "2q" : "lru"));
+
   return argc;
 }
 
@@ -635,10 +703,13 @@ int loadTable(TestConfiguration configuration, struct dm_target *target)
   dm_get_device(NULL, NULL, 0, &dm_dev);
   dm_dev->bdev->bd_inode->size =
     (configuration.config.physical_blocks * VDO_BLOCK_SIZE);
+  dm_get_device(NULL, TEST_JOURNAL_DEVICE_NAME, 0, &dm_dev);
+  dm_dev->bdev->bd_inode->size
+    = (configuration.journalDeviceBlocks * VDO_BLOCK_SIZE);
 
   target->len = configuration.config.logical_blocks * VDO_SECTORS_PER_BLOCK;
 
-  char *argv[32];
+  char *argv[48];
   int argc = makeTableLine(fixThreadCounts(configuration), argv);
   int result = vdoTargetType->ctr(target, argc, argv);
   while (argc-- > 0) {
@@ -684,13 +755,16 @@ int resumeVDO(struct dm_target *target)
   return resume_result;
 }
 
-/**********************************************************************/
-int modifyCompressDedupe(bool compress, bool dedupe)
+/**
+ * Reload the VDO with a new table line, and adopt the configuration it was
+ * made from if the reload succeeds.
+ *
+ * @param newConfiguration  The configuration from which to make the table
+ *
+ * @return VDO_SUCCESS or an error
+ **/
+static int reloadWithConfiguration(TestConfiguration newConfiguration)
 {
-  TestConfiguration newConfiguration = configuration;
-  newConfiguration.deviceConfig.compression = compress;
-  newConfiguration.deviceConfig.deduplication = dedupe;
-
   struct dm_target *target;
   VDO_ASSERT_SUCCESS(UDS_ALLOCATE(1, struct dm_target, __func__, &target));
 
@@ -704,14 +778,62 @@ int modifyCompressDedupe(bool compress, bool dedupe)
 
   result = resumeVDO(target);
   if (result == VDO_SUCCESS) {
+    configuration = newConfiguration;
     configuration.config = vdo->states.vdo.config;
-    configuration.deviceConfig.compression = compress;
-    configuration.deviceConfig.deduplication = dedupe;
   }
 
   return result;
 }
 
+/**********************************************************************/
+int modifyCompressionType(enum vdo_compression_type type)
+{
+  TestConfiguration newConfiguration = configuration;
+  newConfiguration.deviceConfig.compression_type = type;
+  return reloadWithConfiguration(newConfiguration);
+}
+
+/**********************************************************************/
+int modifyPackerLookahead(bool lookahead)
+{
+  TestConfiguration newConfiguration = configuration;
+  newConfiguration.deviceConfig.packer_lookahead = lookahead;
+  return reloadWithConfiguration(newConfiguration);
+}
+
+/**********************************************************************/
+int modifyJournalCommitWindow(unsigned int window)
+{
+  TestConfiguration newConfiguration = configuration;
+  newConfiguration.deviceConfig.journal_commit_window = window;
+  return reloadWithConfiguration(newConfiguration);
+}
+
+/**********************************************************************/
+int modifyJournalDevice(char *name)
+{
+  TestConfiguration newConfiguration = configuration;
+  newConfiguration.deviceConfig.journal_device_name = name;
+  return reloadWithConfiguration(newConfiguration);
+}
+
+/**********************************************************************/
+int modifyIndexHugePages(bool hugePages)
+{
+  TestConfiguration newConfiguration = configuration;
+  newConfiguration.deviceConfig.index_huge_pages = hugePages;
+  return reloadWithConfiguration(newConfiguration);
+}
+
+/**********************************************************************/
+int modifyCompressDedupe(bool compress, bool dedupe)
+{
+  TestConfiguration newConfiguration = configuration;
+  newConfiguration.deviceConfig.compression = compress;
+  newConfiguration.deviceConfig.deduplication = dedupe;
+  return reloadWithConfiguration(newConfiguration);
+}
+
 /**********************************************************************/
 static int modifyVDO(block_count_t logicalSize,
 		     block_count_t physicalSize,
@@ -55,6 +55,14 @@ void clearHooks(void);
 PhysicalLayer *getSynchronousLayer(void)
   __attribute__((warn_unused_result));
 
+/**
+ * Get the synchronous layer of the journal device.
+ *
+ * @return The journal device layer, or NULL if the test has no journal device
+ **/
+PhysicalLayer *getJournalLayer(void)
+  __attribute__((warn_unused_result));
+
 /**
  * Format a VDO.
  **/
@@ -324,6 +332,15 @@ int suspendVDO(bool save);
 
 int resumeVDO(struct dm_target *target);
 
+/**
+ * Change whether the index uses huge pages as if it was from the table line
+ *
+ * @param hugePages  Whether to back the volume index with huge pages
+ *
+ * @return VDO_SUCCESS or an error
+ */
+int modifyIndexHugePages(bool hugePages);
+
 /**
  * Modify the compress and dedupe states as if it was from the table line
  *
@@ -334,6 +351,44 @@ int resumeVDO(struct dm_target *target);
  */
 int modifyCompressDedupe(bool compress, bool dedupe);
 
+/**
+ * Change the compressor used for new writes as if it was from the table line
+ *
+ * @param type  The compressor to use
+ *
+ * @return VDO_SUCCESS or an error
+ */
+int modifyCompressionType(enum vdo_compression_type type);
+
+/**
+ * Change whether the packer packs from a look-ahead window as if it was from
+ * the table line
+ *
+ * @param lookahead  Whether to enable look-ahead packing
+ *
+ * @return VDO_SUCCESS or an error
+ */
+int modifyPackerLookahead(bool lookahead);
+
+/**
+ * Change how long the recovery journal may hold a partial block as if it was
+ * from the table line
+ *
+ * @param window  The commit window in milliseconds
+ *
+ * @return VDO_SUCCESS or an error
+ */
+int modifyJournalCommitWindow(unsigned int window);
+
+/**
+ * Change the name of the journal device as if it was from the table line
+ *
+ * @param name  The new journal device name
+ *
+ * @return VDO_SUCCESS or an error
+ */
+int modifyJournalDevice(char *name);
+
 /**
  * Increase the logical size of a VDO.
  *
@@ -323,6 +323,17 @@ void dump_completion_to_buffer(struct vdo_completion *completion,
   }
 }
 
+/**********************************************************************/
+size_t format_work_queue_steals(struct vdo_work_queue *queue
+                                __attribute__((unused)),
+                                char *buffer __attribute__((unused)),
+                                size_t length __attribute__((unused)))
+{
+  // Test work queues each have a single thread, which never steals.
+  return 0;
+}
+
+/**********************************************************************/
 void dump_work_queue(struct vdo_work_queue *queue)
 {
   uds_log_info("workQ %s %s",
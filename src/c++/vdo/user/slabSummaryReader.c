@@ -45,10 +45,16 @@ int readSlabSummary(UserVDO *vdo, struct slab_summary_entry **entriesPtr)
     return result;
   }
 
+  PhysicalLayer *layer = getPartitionLayer(vdo, slab_summary_partition);
+  if (layer == NULL) {
+    warnx("Slab summary is on a journal device which was not supplied");
+    UDS_FREE(entries);
+    return VDO_BAD_CONFIGURATION;
+  }
+
   physical_block_number_t origin
     = vdo_get_fixed_layout_partition_offset(slab_summary_partition);
-  result = vdo->layer->reader(vdo->layer, origin, summary_blocks,
-                              (char *) entries);
+  result = layer->reader(layer, origin, summary_blocks, (char *) entries);
   if (result != VDO_SUCCESS) {
     warnx("Could not read summary data");
     UDS_FREE(entries);
@@ -71,8 +77,7 @@ int readSlabSummary(UserVDO *vdo, struct slab_summary_entry **entriesPtr)
 
     for (zone_count_t zone = 1; zone < zones; zone++) {
       origin += summary_blocks;
-      result = vdo->layer->reader(vdo->layer, origin, summary_blocks,
-                                  (char *) buffer);
+      result = layer->reader(layer, origin, summary_blocks, (char *) buffer);
       if (result != VDO_SUCCESS) {
         warnx("Could not read summary data");
         UDS_FREE(buffer);
@@ -223,3 +223,11 @@ getPartition(const UserVDO     *vdo,
 
   return partition;
 }
+
+/**********************************************************************/
+PhysicalLayer *getPartitionLayer(const UserVDO           *vdo,
+                                 const struct partition  *partition)
+{
+  return (vdo_is_journal_device_partition(partition)
+          ? vdo->journalLayer : vdo->layer);
+}
@@ -20,6 +20,8 @@
 typedef struct user_vdo {
   /* The physical storage below the VDO */
   PhysicalLayer               *layer;
+  /* The journal device, if any and if available */
+  PhysicalLayer               *journalLayer;
   /* The geometry of the VDO */
   struct volume_geometry       geometry;
   /* The codec for the super block */
@@ -163,4 +165,16 @@ getPartition(const UserVDO     *vdo,
              enum partition_id  id,
              const char        *errorMessage);
 
+/**
+ * Get the layer on which a partition resides.
+ *
+ * @param vdo        The VDO
+ * @param partition  The partition
+ *
+ * @return The layer holding the partition, or NULL if the partition is on a
+ *         journal device which was not supplied
+ **/
+PhysicalLayer * __must_check
+getPartitionLayer(const UserVDO *vdo, const struct partition *partition);
+
 #endif /* USER_VDO_H */
@@ -31,6 +31,7 @@ enum {
 /**********************************************************************/
 int makeFixedLayoutFromConfig(const struct vdo_config  *config,
                               physical_block_number_t   startingOffset,
+                              bool                      useJournalDevice,
                               struct fixed_layout     **layoutPtr)
 {
   return vdo_make_partitioned_fixed_layout(config->physical_blocks,
@@ -38,6 +39,7 @@ int makeFixedLayoutFromConfig(const struct vdo_config  *config,
                                            DEFAULT_VDO_BLOCK_MAP_TREE_ROOT_COUNT,
                                            config->recovery_journal_size,
                                            VDO_SLAB_SUMMARY_BLOCKS,
+                                           useJournalDevice,
                                            layoutPtr);
 }
 
@@ -99,6 +101,7 @@ static int __must_check configureVDO(UserVDO *vdo)
   physical_block_number_t startingOffset
     = vdo_get_data_region_start(vdo->geometry) + 1;
   int result = makeFixedLayoutFromConfig(config, startingOffset,
+                                         (vdo->journalLayer != NULL),
                                          &vdo->states.layout);
   if (result != VDO_SUCCESS) {
     return result;
@@ -153,19 +156,6 @@ static int __must_check configureVDO(UserVDO *vdo)
   return VDO_SUCCESS;
 }
 
-/**********************************************************************/
-int formatVDO(const struct vdo_config   *config,
-              const struct index_config *indexConfig,
-              PhysicalLayer             *layer)
-{
-  // Generate a uuid.
-  uuid_t uuid;
-  uuid_generate(uuid);
-
-  return formatVDOWithNonce(config, indexConfig, layer, current_time_us(),
-                            &uuid);
-}
-
 /**********************************************************************/
 int calculateMinimumVDOFromConfig(const struct vdo_config   *config,
                                   const struct index_config *indexConfig,
@@ -212,6 +202,7 @@ static int __must_check clearPartition(UserVDO *vdo, enum partition_id id)
     return result;
   }
 
+  PhysicalLayer *layer = getPartitionLayer(vdo, partition);
   block_count_t size = vdo_get_fixed_layout_partition_size(partition);
   physical_block_number_t start
     = vdo_get_fixed_layout_partition_offset(partition);
@@ -224,9 +215,8 @@ static int __must_check clearPartition(UserVDO *vdo, enum partition_id id)
   }
 
   char *zeroBuffer;
-  result = vdo->layer->allocateIOBuffer(vdo->layer,
-                                        bufferBlocks * VDO_BLOCK_SIZE,
-                                        "zero buffer", &zeroBuffer);
+  result = layer->allocateIOBuffer(layer, bufferBlocks * VDO_BLOCK_SIZE,
+                                   "zero buffer", &zeroBuffer);
   if (result != VDO_SUCCESS) {
     return result;
   }
@@ -234,7 +224,7 @@ static int __must_check clearPartition(UserVDO *vdo, enum partition_id id)
   for (physical_block_number_t pbn = start;
        (pbn < start + size) && (result == VDO_SUCCESS);
        pbn += bufferBlocks) {
-    result = vdo->layer->writer(vdo->layer, pbn, bufferBlocks, zeroBuffer);
+    result = layer->writer(layer, pbn, bufferBlocks, zeroBuffer);
   }
 
   UDS_FREE(zeroBuffer);
@@ -275,6 +265,23 @@ static int configureAndWriteVDO(UserVDO                   *vdo,
     return result;
   }
 
+  if (vdo->journalLayer != NULL) {
+    block_count_t journalDeviceSize
+      = vdo_get_fixed_layout_journal_device_size(vdo->states.layout);
+    if (journalDeviceSize > vdo->journalLayer->getBlockCount(vdo->journalLayer)) {
+      return uds_log_error_strerror(VDO_NO_SPACE,
+                                    "journal device needs at least %llu blocks",
+                                    (unsigned long long) journalDeviceSize);
+    }
+
+    // The geometry copy identifies the journal device as part of this VDO.
+    result = vdo_write_volume_geometry(vdo->journalLayer, &vdo->geometry);
+    if (result != VDO_SUCCESS) {
+      return uds_log_error_strerror(result,
+                                    "cannot write journal device geometry");
+    }
+  }
+
   result = clearPartition(vdo, VDO_BLOCK_MAP_PARTITION);
   if (result != VDO_SUCCESS) {
     return uds_log_error_strerror(result, "cannot clear block map partition");
@@ -289,12 +296,24 @@ static int configureAndWriteVDO(UserVDO                   *vdo,
   return saveVDO(vdo, true);
 }
 
-/**********************************************************************/
-int formatVDOWithNonce(const struct vdo_config   *config,
-                       const struct index_config *indexConfig,
-                       PhysicalLayer             *layer,
-                       nonce_t                    nonce,
-                       uuid_t                    *uuid)
+/**
+ * Format a VDO, optionally with a journal device.
+ *
+ * @param config        The configuration parameters for the VDO
+ * @param indexConfig   The configuration parameters for the index
+ * @param layer         The physical layer the VDO will sit on
+ * @param journalLayer  The journal device layer, or NULL for none
+ * @param nonce         The nonce for the VDO
+ * @param uuid          The uuid for the VDO
+ *
+ * @return VDO_SUCCESS or an error
+ **/
+static int __must_check formatUserVDO(const struct vdo_config   *config,
+                                      const struct index_config *indexConfig,
+                                      PhysicalLayer             *layer,
+                                      PhysicalLayer             *journalLayer,
+                                      nonce_t                    nonce,
+                                      uuid_t                    *uuid)
 {
   int result = vdo_register_status_codes();
   if (result != VDO_SUCCESS) {
@@ -312,11 +331,48 @@ int formatVDOWithNonce(const struct vdo_config   *config,
     return result;
   }
 
+  vdo->journalLayer = journalLayer;
   result = configureAndWriteVDO(vdo, config, indexConfig, nonce, uuid);
   freeUserVDO(&vdo);
   return result;
 }
 
+/**********************************************************************/
+int formatVDOWithNonce(const struct vdo_config   *config,
+                       const struct index_config *indexConfig,
+                       PhysicalLayer             *layer,
+                       nonce_t                    nonce,
+                       uuid_t                    *uuid)
+{
+  return formatUserVDO(config, indexConfig, layer, NULL, nonce, uuid);
+}
+
+/**********************************************************************/
+int formatVDO(const struct vdo_config   *config,
+              const struct index_config *indexConfig,
+              PhysicalLayer             *layer)
+{
+  // Generate a uuid.
+  uuid_t uuid;
+  uuid_generate(uuid);
+
+  return formatVDOWithNonce(config, indexConfig, layer, current_time_us(),
+                            &uuid);
+}
+
+/**********************************************************************/
+int formatVDOWithJournalDevice(const struct vdo_config   *config,
+                               const struct index_config *indexConfig,
+                               PhysicalLayer             *layer,
+                               PhysicalLayer             *journalLayer)
+{
+  uuid_t uuid;
+  uuid_generate(uuid);
+
+  return formatUserVDO(config, indexConfig, layer, journalLayer,
+                       current_time_us(), &uuid);
+}
+
 /**
  * Change the state of an inactive VDO image.
  *
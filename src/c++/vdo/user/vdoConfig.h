@@ -39,6 +39,24 @@ int __must_check formatVDO(const struct vdo_config *config,
 			   const struct index_config *indexConfig,
 			   PhysicalLayer *layer);
 
+/**
+ * Format a pair of physical layers to function as a new VDO whose recovery
+ * journal and slab summary reside on a separate journal device. A copy of
+ * the geometry block is written to the start of the journal device so that
+ * the VDO can check that it has been given the right one.
+ *
+ * @param config        The configuration parameters for the VDO
+ * @param indexConfig   The configuration parameters for the index
+ * @param layer         The physical layer the VDO will sit on
+ * @param journalLayer  The physical layer of the journal device
+ *
+ * @return VDO_SUCCESS or an error
+ **/
+int __must_check formatVDOWithJournalDevice(const struct vdo_config *config,
+					    const struct index_config *indexConfig,
+					    PhysicalLayer *layer,
+					    PhysicalLayer *journalLayer);
+
 /**
  * Calculate minimal VDO based on config parameters.
  *
@@ -56,15 +74,18 @@ int calculateMinimumVDOFromConfig(const struct vdo_config *config,
 /**
  * Make a fixed_layout according to a vdo_config. Exposed for testing only.
  *
- * @param [in]  config          The vdo_config to generate a vdo_layout from
- * @param [in]  startingOffset  The start of the layouts
- * @param [out] layoutPtr       A pointer to hold the new vdo_layout
+ * @param [in]  config            The vdo_config to generate a vdo_layout from
+ * @param [in]  startingOffset    The start of the layouts
+ * @param [in]  useJournalDevice  Whether to place the recovery journal and
+ *                                slab summary on a journal device
+ * @param [out] layoutPtr         A pointer to hold the new vdo_layout
  *
  * @return VDO_SUCCESS or an error
  **/
 int __must_check
 makeFixedLayoutFromConfig(const struct vdo_config  *config,
                           physical_block_number_t   startingOffset,
+                          bool                      useJournalDevice,
                           struct fixed_layout     **layoutPtr);
 
 /**
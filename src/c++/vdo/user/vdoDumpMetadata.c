@@ -306,6 +306,11 @@ static void dumpRecoveryJournal(void)
   const struct partition *partition
     = getPartition(vdo, VDO_RECOVERY_JOURNAL_PARTITION,
                    "Could not copy recovery journal, no partition");
+  if (vdo_is_journal_device_partition(partition)) {
+    warnx("Recovery journal is on a journal device, not copied");
+    return;
+  }
+
   int result = copyBlocks(vdo_get_fixed_layout_partition_offset(partition),
                           vdo->states.vdo.config.recovery_journal_size);
   if (result != VDO_SUCCESS) {
@@ -320,6 +325,11 @@ static void dumpSlabSummary(void)
   const struct partition *partition
     = getPartition(vdo, VDO_SLAB_SUMMARY_PARTITION,
                    "Could not copy slab summary, no partition");
+  if (vdo_is_journal_device_partition(partition)) {
+    warnx("Slab summary is on a journal device, not copied");
+    return;
+  }
+
   int result = copyBlocks(vdo_get_fixed_layout_partition_offset(partition),
                           VDO_SLAB_SUMMARY_BLOCKS);
   if (result != VDO_SUCCESS) {
@@ -11,6 +11,7 @@
 #include <linux/fs.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
@@ -64,6 +65,12 @@ static const char helpString[] =
   "    --help\n"
   "       Print this help message and exit.\n"
   "\n"
+  "    --journal-device=<device>\n"
+  "       Place the recovery journal and slab summary on a separate block\n"
+  "       device, such as a small low-latency device. The same device must\n"
+  "       be given as the journalDevice parameter whenever the VDO is\n"
+  "       started.\n"
+  "\n"
   "    --logical-size=<size>\n"
   "       Set the logical (provisioned) size of the VDO device to <size>.\n"
   "       A size suffix of K for kilobytes, M for megabytes, G for\n"
@@ -104,6 +111,7 @@ static const char helpString[] =
 static struct option options[] = {
   { "force",           no_argument,       NULL, 'f' },
   { "help",            no_argument,       NULL, 'h' },
+  { "journal-device",  required_argument, NULL, 'j' },
   { "logical-size",    required_argument, NULL, 'l' },
   { "slab-bits",       required_argument, NULL, 'S' },
   { "uds-memory-size", required_argument, NULL, 'm' },
@@ -112,7 +120,7 @@ static struct option options[] = {
   { "version",         no_argument,       NULL, 'V' },
   { NULL,              0,                 NULL,  0  },
 };
-static char optionString[] = "fhil:S:m:svV";
+static char optionString[] = "fhij:l:S:m:svV";
 
 static void usage(const char *progname, const char *usageOptionsString)
 {
@@ -398,6 +406,53 @@ static int checkDeviceInUse(char *filename, uint32_t major, uint32_t minor)
   return VDO_SUCCESS;
 }
 
+/**
+ * Check that a file is an unused block device and get its size, exiting on
+ * failure.
+ *
+ * @param filename  The name of the device
+ *
+ * @return The size of the device in bytes
+ **/
+static uint64_t getBlockDeviceSize(char *filename)
+{
+  struct stat statbuf;
+  int result = logging_stat_missing_ok(filename, &statbuf, "Getting status");
+  if (result != UDS_SUCCESS && result != ENOENT) {
+    errx(result, "unable to get status of %s", filename);
+  }
+
+  if (!S_ISBLK(statbuf.st_mode)) {
+    errx(1, "%s must be a block device", filename);
+  }
+
+  uint32_t major = major(statbuf.st_rdev);
+  uint32_t minor = minor(statbuf.st_rdev);
+
+  result = checkDeviceInUse(filename, major, minor);
+  if (result != VDO_SUCCESS) {
+    errx(result, "checkDeviceInUse failed on %s", filename);
+  }
+
+  int fd;
+  result = open_file(filename, FU_READ_WRITE, &fd);
+  if (result != UDS_SUCCESS) {
+    errx(result, "unable to open %s", filename);
+  }
+
+  uint64_t size;
+  if (ioctl(fd, BLKGETSIZE64, &size) < 0) {
+    errx(errno, "unable to get size of %s", filename);
+  }
+
+  result = close_file(fd, "cannot close file");
+  if (result != UDS_SUCCESS) {
+    errx(1, "cannot close %s", filename);
+  }
+
+  return size;
+}
+
 /**********************************************************************/
 int main(int argc, char *argv[])
 {
@@ -419,6 +474,7 @@ int main(int argc, char *argv[])
   uint64_t sizeArg;
   static bool verbose = false;
   static bool force   = false;
+  char *journalFilename = NULL;
 
   while ((c = getopt_long(argc, argv, optionString, options, NULL)) != -1) {
     switch (c) {
@@ -431,6 +487,10 @@ int main(int argc, char *argv[])
       exit(0);
       break;
 
+    case 'j':
+      journalFilename = optarg;
+      break;
+
     case 'l':
       result = parseSize(optarg, true, &sizeArg);
       if (result != VDO_SUCCESS) {
@@ -477,43 +537,19 @@ int main(int argc, char *argv[])
 
   char *filename = argv[optind];
 
-  struct stat statbuf;
-  result = logging_stat_missing_ok(filename, &statbuf, "Getting status");
-  if (result != UDS_SUCCESS && result != ENOENT) {
-    errx(result, "unable to get status of %s", filename);
-  }
-
-  if (!S_ISBLK(statbuf.st_mode)) {
-    errx(1, "%s must be a block device", filename);
-  }
-
-  uint32_t major = major(statbuf.st_rdev);
-  uint32_t minor = minor(statbuf.st_rdev);
-
-  result = checkDeviceInUse(filename, major, minor);
-  if (result != VDO_SUCCESS) {
-    errx(result, "checkDeviceInUse failed on %s", filename);
-  }
-
-  int fd;
-  result = open_file(filename, FU_READ_WRITE, &fd);
-  if (result != UDS_SUCCESS) {
-    errx(result, "unable to open %s", filename);
-  }
-
-  uint64_t physicalSize;
-  if (ioctl(fd, BLKGETSIZE64, &physicalSize) < 0) {
-    errx(errno, "unable to get size of %s", filename);
-  }
-
+  uint64_t physicalSize = getBlockDeviceSize(filename);
   if (physicalSize > MAXIMUM_VDO_PHYSICAL_BLOCKS * VDO_BLOCK_SIZE) {
     errx(1, "underlying block device size exceeds the maximum (%llu)",
          (unsigned long long) (MAXIMUM_VDO_PHYSICAL_BLOCKS * VDO_BLOCK_SIZE));
   }
 
-  result = close_file(fd, "cannot close file");
-  if (result != UDS_SUCCESS) {
-    errx(1, "cannot close %s", filename);
+  uint64_t journalSize = 0;
+  if (journalFilename != NULL) {
+    if (strcmp(journalFilename, filename) == 0) {
+      errx(1, "the journal device must differ from %s", filename);
+    }
+
+    journalSize = getBlockDeviceSize(journalFilename);
   }
 
   struct vdo_config config = {
@@ -551,6 +587,21 @@ int main(int argc, char *argv[])
     errx(result, "checkForSignaturesUsingBlkid failed on '%s'", filename);
   }
 
+  PhysicalLayer *journalLayer = NULL;
+  if (journalFilename != NULL) {
+    result = makeFileLayer(journalFilename, journalSize / VDO_BLOCK_SIZE,
+                           &journalLayer);
+    if (result != VDO_SUCCESS) {
+      errx(result, "makeFileLayer failed on '%s'", journalFilename);
+    }
+
+    result = checkForSignaturesUsingBlkid(journalFilename, force);
+    if (result != VDO_SUCCESS) {
+      errx(result, "checkForSignaturesUsingBlkid failed on '%s'",
+           journalFilename);
+    }
+  }
+
   struct index_config indexConfig;
   result = parseIndexConfig(&configStrings, &indexConfig);
   if (result != UDS_SUCCESS) {
@@ -586,7 +637,12 @@ int main(int argc, char *argv[])
     }
   }
 
-  result = formatVDO(&config, &indexConfig, layer);
+  if (journalLayer == NULL) {
+    result = formatVDO(&config, &indexConfig, layer);
+  } else {
+    result = formatVDOWithJournalDevice(&config, &indexConfig, layer,
+                                        journalLayer);
+  }
   if (result != VDO_SUCCESS) {
     const char *extraHelp = "";
     if (result == VDO_TOO_MANY_SLABS) {
@@ -625,6 +681,9 @@ int main(int argc, char *argv[])
 
   freeUserVDO(&vdo);
 
-  // Close and sync the underlying file.
+  // Close and sync the underlying files.
+  if (journalLayer != NULL) {
+    journalLayer->destroy(&journalLayer);
+  }
   layer->destroy(&layer);
 }
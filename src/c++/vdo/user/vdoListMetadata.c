@@ -163,6 +163,11 @@ static void listRecoveryJournal(void)
   const struct partition *partition
     = getPartition(vdo, VDO_RECOVERY_JOURNAL_PARTITION,
                    "no recovery journal partition");
+  // Only blocks on the main device are listed.
+  if (vdo_is_journal_device_partition(partition)) {
+    return;
+  }
+
   listBlocks("recovery journal",
              vdo_get_fixed_layout_partition_offset(partition),
              vdo->states.vdo.config.recovery_journal_size);
@@ -174,6 +179,11 @@ static void listSlabSummary(void)
   const struct partition *partition
     = getPartition(vdo, VDO_SLAB_SUMMARY_PARTITION,
                    "no slab summary partition");
+  // Only blocks on the main device are listed.
+  if (vdo_is_journal_device_partition(partition)) {
+    return;
+  }
+
   listBlocks("slab summary", vdo_get_fixed_layout_partition_offset(partition),
              VDO_SLAB_SUMMARY_BLOCKS);
 }
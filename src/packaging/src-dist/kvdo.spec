@@ -83,6 +83,9 @@ BUILT_MODULE_LOCATION[0]="vdo"
 DEST_MODULE_LOCATION[0]="/kernel/drivers/block/"
 BUILD_DEPENDS[0]=LZ4_COMPRESS
 BUILD_DEPENDS[0]=LZ4_DECOMPRESS
+BUILD_DEPENDS[0]=LZ4HC_COMPRESS
+BUILD_DEPENDS[0]=ZSTD_COMPRESS
+BUILD_DEPENDS[0]=ZSTD_DECOMPRESS
 STRIP[0]="no"
 EOF
 